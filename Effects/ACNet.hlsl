@@ -386,38 +386,55 @@ const static float kernelsLB[9 * 8 * 4] = {
 
 const static float4 biasLB = { 0.0082, -0.0263, -0.0048, -0.0167 };
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex1[TILE_SIZE][TILE_SIZE];
+groupshared float4 shTex2[TILE_SIZE][TILE_SIZE];
+
 void Pass2(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex1[tilePos.y][tilePos.x] = tex1.SampleLevel(sam, tpos, 0);
+		shTex2[tilePos.y][tilePos.x] = tex2.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [tl, tc, tr]
 	// [ml, mc, mr]
 	// [bl, bc, br]
-	float4 tl1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 ml1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 bl1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 tc1 = tex1.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 mc1 = tex1.SampleLevel(sam, pos, 0);
-	float4 bc1 = tex1.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 tr1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 mr1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 br1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
-
-	float4 tl2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 ml2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 bl2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 tc2 = tex2.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 mc2 = tex2.SampleLevel(sam, pos, 0);
-	float4 bc2 = tex2.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 tr2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 mr2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 br2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 tl1 = shTex1[tilePos.y - 1][tilePos.x - 1];
+	float4 ml1 = shTex1[tilePos.y][tilePos.x - 1];
+	float4 bl1 = shTex1[tilePos.y + 1][tilePos.x - 1];
+	float4 tc1 = shTex1[tilePos.y - 1][tilePos.x];
+	float4 mc1 = shTex1[tilePos.y][tilePos.x];
+	float4 bc1 = shTex1[tilePos.y + 1][tilePos.x];
+	float4 tr1 = shTex1[tilePos.y - 1][tilePos.x + 1];
+	float4 mr1 = shTex1[tilePos.y][tilePos.x + 1];
+	float4 br1 = shTex1[tilePos.y + 1][tilePos.x + 1];
+
+	float4 tl2 = shTex2[tilePos.y - 1][tilePos.x - 1];
+	float4 ml2 = shTex2[tilePos.y][tilePos.x - 1];
+	float4 bl2 = shTex2[tilePos.y + 1][tilePos.x - 1];
+	float4 tc2 = shTex2[tilePos.y - 1][tilePos.x];
+	float4 mc2 = shTex2[tilePos.y][tilePos.x];
+	float4 bc2 = shTex2[tilePos.y + 1][tilePos.x];
+	float4 tr2 = shTex2[tilePos.y - 1][tilePos.x + 1];
+	float4 mr2 = shTex2[tilePos.y][tilePos.x + 1];
+	float4 br2 = shTex2[tilePos.y + 1][tilePos.x + 1];
 
 	float4 target1 = RELU(float4(
 		tl1.x * kernelsLA[0 * 72 + 0 * 9 + 0] + tc1.x * kernelsLA[0 * 72 + 0 * 9 + 1] + tr1.x * kernelsLA[0 * 72 + 0 * 9 + 2] +
@@ -894,38 +911,55 @@ const static float kernelsLB[9 * 8 * 4] = {
 const static float4 biasLB = { -0.0225,  0.0082, -0.0191, -0.0185 };
 
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex3[TILE_SIZE][TILE_SIZE];
+groupshared float4 shTex4[TILE_SIZE][TILE_SIZE];
+
 void Pass3(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex3[tilePos.y][tilePos.x] = tex3.SampleLevel(sam, tpos, 0);
+		shTex4[tilePos.y][tilePos.x] = tex4.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [tl, tc, tr]
 	// [ml, mc, mr]
 	// [bl, bc, br]
-	float4 tl1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 ml1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 bl1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 tc1 = tex3.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 mc1 = tex3.SampleLevel(sam, pos, 0);
-	float4 bc1 = tex3.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 tr1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 mr1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 br1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
-
-	float4 tl2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 ml2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 bl2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 tc2 = tex4.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 mc2 = tex4.SampleLevel(sam, pos, 0);
-	float4 bc2 = tex4.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 tr2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 mr2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 br2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 tl1 = shTex3[tilePos.y - 1][tilePos.x - 1];
+	float4 ml1 = shTex3[tilePos.y][tilePos.x - 1];
+	float4 bl1 = shTex3[tilePos.y + 1][tilePos.x - 1];
+	float4 tc1 = shTex3[tilePos.y - 1][tilePos.x];
+	float4 mc1 = shTex3[tilePos.y][tilePos.x];
+	float4 bc1 = shTex3[tilePos.y + 1][tilePos.x];
+	float4 tr1 = shTex3[tilePos.y - 1][tilePos.x + 1];
+	float4 mr1 = shTex3[tilePos.y][tilePos.x + 1];
+	float4 br1 = shTex3[tilePos.y + 1][tilePos.x + 1];
+
+	float4 tl2 = shTex4[tilePos.y - 1][tilePos.x - 1];
+	float4 ml2 = shTex4[tilePos.y][tilePos.x - 1];
+	float4 bl2 = shTex4[tilePos.y + 1][tilePos.x - 1];
+	float4 tc2 = shTex4[tilePos.y - 1][tilePos.x];
+	float4 mc2 = shTex4[tilePos.y][tilePos.x];
+	float4 bc2 = shTex4[tilePos.y + 1][tilePos.x];
+	float4 tr2 = shTex4[tilePos.y - 1][tilePos.x + 1];
+	float4 mr2 = shTex4[tilePos.y][tilePos.x + 1];
+	float4 br2 = shTex4[tilePos.y + 1][tilePos.x + 1];
 
 	float4 target1 = RELU(float4(
 		tl1.x * kernelsLA[0 * 72 + 0 * 9 + 0] + tc1.x * kernelsLA[0 * 72 + 0 * 9 + 1] + tr1.x * kernelsLA[0 * 72 + 0 * 9 + 2] +
@@ -1402,38 +1436,55 @@ const static float kernelsLB[9 * 8 * 4] = {
 const static float4 biasLB = { -8.1892e-04, 3.3171e-03, -1.1582e-02, -4.1205e-40 };
 
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex1[TILE_SIZE][TILE_SIZE];
+groupshared float4 shTex2[TILE_SIZE][TILE_SIZE];
+
 void Pass4(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex1[tilePos.y][tilePos.x] = tex1.SampleLevel(sam, tpos, 0);
+		shTex2[tilePos.y][tilePos.x] = tex2.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [tl, tc, tr]
 	// [ml, mc, mr]
 	// [bl, bc, br]
-	float4 tl1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 ml1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 bl1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 tc1 = tex1.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 mc1 = tex1.SampleLevel(sam, pos, 0);
-	float4 bc1 = tex1.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 tr1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 mr1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 br1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
-
-	float4 tl2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 ml2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 bl2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 tc2 = tex2.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 mc2 = tex2.SampleLevel(sam, pos, 0);
-	float4 bc2 = tex2.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 tr2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 mr2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 br2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 tl1 = shTex1[tilePos.y - 1][tilePos.x - 1];
+	float4 ml1 = shTex1[tilePos.y][tilePos.x - 1];
+	float4 bl1 = shTex1[tilePos.y + 1][tilePos.x - 1];
+	float4 tc1 = shTex1[tilePos.y - 1][tilePos.x];
+	float4 mc1 = shTex1[tilePos.y][tilePos.x];
+	float4 bc1 = shTex1[tilePos.y + 1][tilePos.x];
+	float4 tr1 = shTex1[tilePos.y - 1][tilePos.x + 1];
+	float4 mr1 = shTex1[tilePos.y][tilePos.x + 1];
+	float4 br1 = shTex1[tilePos.y + 1][tilePos.x + 1];
+
+	float4 tl2 = shTex2[tilePos.y - 1][tilePos.x - 1];
+	float4 ml2 = shTex2[tilePos.y][tilePos.x - 1];
+	float4 bl2 = shTex2[tilePos.y + 1][tilePos.x - 1];
+	float4 tc2 = shTex2[tilePos.y - 1][tilePos.x];
+	float4 mc2 = shTex2[tilePos.y][tilePos.x];
+	float4 bc2 = shTex2[tilePos.y + 1][tilePos.x];
+	float4 tr2 = shTex2[tilePos.y - 1][tilePos.x + 1];
+	float4 mr2 = shTex2[tilePos.y][tilePos.x + 1];
+	float4 br2 = shTex2[tilePos.y + 1][tilePos.x + 1];
 
 	float4 target1 = RELU(float4(
 		tl1.x * kernelsLA[0 * 72 + 0 * 9 + 0] + tc1.x * kernelsLA[0 * 72 + 0 * 9 + 1] + tr1.x * kernelsLA[0 * 72 + 0 * 9 + 2] +
@@ -1910,38 +1961,55 @@ const static float kernelsLB[9 * 8 * 4] = {
 const static float4 biasLB = { -0.0039, -0.0426,  0.0053, -0.0017 };
 
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex3[TILE_SIZE][TILE_SIZE];
+groupshared float4 shTex4[TILE_SIZE][TILE_SIZE];
+
 void Pass5(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex3[tilePos.y][tilePos.x] = tex3.SampleLevel(sam, tpos, 0);
+		shTex4[tilePos.y][tilePos.x] = tex4.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [tl, tc, tr]
 	// [ml, mc, mr]
 	// [bl, bc, br]
-	float4 tl1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 ml1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 bl1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 tc1 = tex3.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 mc1 = tex3.SampleLevel(sam, pos, 0);
-	float4 bc1 = tex3.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 tr1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 mr1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 br1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
-
-	float4 tl2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 ml2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 bl2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 tc2 = tex4.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 mc2 = tex4.SampleLevel(sam, pos, 0);
-	float4 bc2 = tex4.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 tr2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 mr2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 br2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 tl1 = shTex3[tilePos.y - 1][tilePos.x - 1];
+	float4 ml1 = shTex3[tilePos.y][tilePos.x - 1];
+	float4 bl1 = shTex3[tilePos.y + 1][tilePos.x - 1];
+	float4 tc1 = shTex3[tilePos.y - 1][tilePos.x];
+	float4 mc1 = shTex3[tilePos.y][tilePos.x];
+	float4 bc1 = shTex3[tilePos.y + 1][tilePos.x];
+	float4 tr1 = shTex3[tilePos.y - 1][tilePos.x + 1];
+	float4 mr1 = shTex3[tilePos.y][tilePos.x + 1];
+	float4 br1 = shTex3[tilePos.y + 1][tilePos.x + 1];
+
+	float4 tl2 = shTex4[tilePos.y - 1][tilePos.x - 1];
+	float4 ml2 = shTex4[tilePos.y][tilePos.x - 1];
+	float4 bl2 = shTex4[tilePos.y + 1][tilePos.x - 1];
+	float4 tc2 = shTex4[tilePos.y - 1][tilePos.x];
+	float4 mc2 = shTex4[tilePos.y][tilePos.x];
+	float4 bc2 = shTex4[tilePos.y + 1][tilePos.x];
+	float4 tr2 = shTex4[tilePos.y - 1][tilePos.x + 1];
+	float4 mr2 = shTex4[tilePos.y][tilePos.x + 1];
+	float4 br2 = shTex4[tilePos.y + 1][tilePos.x + 1];
 
 
 	float4 target1 = RELU(float4(
@@ -2419,38 +2487,55 @@ const static float kernelsLB[9 * 8 * 4] = {
 const static float4 biasLB = { 0.1077,  0.0347, -0.0165,  0.7296 };
 
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex1[TILE_SIZE][TILE_SIZE];
+groupshared float4 shTex2[TILE_SIZE][TILE_SIZE];
+
 void Pass6(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex1[tilePos.y][tilePos.x] = tex1.SampleLevel(sam, tpos, 0);
+		shTex2[tilePos.y][tilePos.x] = tex2.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [tl, tc, tr]
 	// [ml, mc, mr]
 	// [bl, bc, br]
-	float4 tl1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 ml1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 bl1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 tc1 = tex1.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 mc1 = tex1.SampleLevel(sam, pos, 0);
-	float4 bc1 = tex1.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 tr1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 mr1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 br1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
-
-	float4 tl2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 ml2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 bl2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 tc2 = tex2.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 mc2 = tex2.SampleLevel(sam, pos, 0);
-	float4 bc2 = tex2.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 tr2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 mr2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 br2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 tl1 = shTex1[tilePos.y - 1][tilePos.x - 1];
+	float4 ml1 = shTex1[tilePos.y][tilePos.x - 1];
+	float4 bl1 = shTex1[tilePos.y + 1][tilePos.x - 1];
+	float4 tc1 = shTex1[tilePos.y - 1][tilePos.x];
+	float4 mc1 = shTex1[tilePos.y][tilePos.x];
+	float4 bc1 = shTex1[tilePos.y + 1][tilePos.x];
+	float4 tr1 = shTex1[tilePos.y - 1][tilePos.x + 1];
+	float4 mr1 = shTex1[tilePos.y][tilePos.x + 1];
+	float4 br1 = shTex1[tilePos.y + 1][tilePos.x + 1];
+
+	float4 tl2 = shTex2[tilePos.y - 1][tilePos.x - 1];
+	float4 ml2 = shTex2[tilePos.y][tilePos.x - 1];
+	float4 bl2 = shTex2[tilePos.y + 1][tilePos.x - 1];
+	float4 tc2 = shTex2[tilePos.y - 1][tilePos.x];
+	float4 mc2 = shTex2[tilePos.y][tilePos.x];
+	float4 bc2 = shTex2[tilePos.y + 1][tilePos.x];
+	float4 tr2 = shTex2[tilePos.y - 1][tilePos.x + 1];
+	float4 mr2 = shTex2[tilePos.y][tilePos.x + 1];
+	float4 br2 = shTex2[tilePos.y + 1][tilePos.x + 1];
 
 	float4 target1 = RELU(float4(
 		tl1.x * kernelsLA[0 * 72 + 0 * 9 + 0] + tc1.x * kernelsLA[0 * 72 + 0 * 9 + 1] + tr1.x * kernelsLA[0 * 72 + 0 * 9 + 2] +
@@ -2927,38 +3012,55 @@ const static float kernelsLB[9 * 8 * 4] = {
 const static float4 biasLB = { 2.3381e-02, -1.2136e-40, -5.6040e-39,  3.7100e-02 };
 
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex3[TILE_SIZE][TILE_SIZE];
+groupshared float4 shTex4[TILE_SIZE][TILE_SIZE];
+
 void Pass7(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex3[tilePos.y][tilePos.x] = tex3.SampleLevel(sam, tpos, 0);
+		shTex4[tilePos.y][tilePos.x] = tex4.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [tl, tc, tr]
 	// [ml, mc, mr]
 	// [bl, bc, br]
-	float4 tl1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 ml1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 bl1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 tc1 = tex3.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 mc1 = tex3.SampleLevel(sam, pos, 0);
-	float4 bc1 = tex3.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 tr1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 mr1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 br1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
-
-	float4 tl2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 ml2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 bl2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 tc2 = tex4.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 mc2 = tex4.SampleLevel(sam, pos, 0);
-	float4 bc2 = tex4.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 tr2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 mr2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 br2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 tl1 = shTex3[tilePos.y - 1][tilePos.x - 1];
+	float4 ml1 = shTex3[tilePos.y][tilePos.x - 1];
+	float4 bl1 = shTex3[tilePos.y + 1][tilePos.x - 1];
+	float4 tc1 = shTex3[tilePos.y - 1][tilePos.x];
+	float4 mc1 = shTex3[tilePos.y][tilePos.x];
+	float4 bc1 = shTex3[tilePos.y + 1][tilePos.x];
+	float4 tr1 = shTex3[tilePos.y - 1][tilePos.x + 1];
+	float4 mr1 = shTex3[tilePos.y][tilePos.x + 1];
+	float4 br1 = shTex3[tilePos.y + 1][tilePos.x + 1];
+
+	float4 tl2 = shTex4[tilePos.y - 1][tilePos.x - 1];
+	float4 ml2 = shTex4[tilePos.y][tilePos.x - 1];
+	float4 bl2 = shTex4[tilePos.y + 1][tilePos.x - 1];
+	float4 tc2 = shTex4[tilePos.y - 1][tilePos.x];
+	float4 mc2 = shTex4[tilePos.y][tilePos.x];
+	float4 bc2 = shTex4[tilePos.y + 1][tilePos.x];
+	float4 tr2 = shTex4[tilePos.y - 1][tilePos.x + 1];
+	float4 mr2 = shTex4[tilePos.y][tilePos.x + 1];
+	float4 br2 = shTex4[tilePos.y + 1][tilePos.x + 1];
 
 	float4 target1 = RELU(float4(
 		tl1.x * kernelsLA[0 * 72 + 0 * 9 + 0] + tc1.x * kernelsLA[0 * 72 + 0 * 9 + 1] + tr1.x * kernelsLA[0 * 72 + 0 * 9 + 2] +
@@ -3435,38 +3537,55 @@ const static float kernelsLB[9 * 8 * 4] = {
 const static float4 biasLB = { 7.9956e-02, 3.0679e-04, -1.0257e-02, -1.2037e-02 };
 
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex1[TILE_SIZE][TILE_SIZE];
+groupshared float4 shTex2[TILE_SIZE][TILE_SIZE];
+
 void Pass8(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex1[tilePos.y][tilePos.x] = tex1.SampleLevel(sam, tpos, 0);
+		shTex2[tilePos.y][tilePos.x] = tex2.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [tl, tc, tr]
 	// [ml, mc, mr]
 	// [bl, bc, br]
-	float4 tl1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 ml1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 bl1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 tc1 = tex1.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 mc1 = tex1.SampleLevel(sam, pos, 0);
-	float4 bc1 = tex1.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 tr1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 mr1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 br1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
-
-	float4 tl2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 ml2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 bl2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 tc2 = tex2.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 mc2 = tex2.SampleLevel(sam, pos, 0);
-	float4 bc2 = tex2.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 tr2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 mr2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 br2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 tl1 = shTex1[tilePos.y - 1][tilePos.x - 1];
+	float4 ml1 = shTex1[tilePos.y][tilePos.x - 1];
+	float4 bl1 = shTex1[tilePos.y + 1][tilePos.x - 1];
+	float4 tc1 = shTex1[tilePos.y - 1][tilePos.x];
+	float4 mc1 = shTex1[tilePos.y][tilePos.x];
+	float4 bc1 = shTex1[tilePos.y + 1][tilePos.x];
+	float4 tr1 = shTex1[tilePos.y - 1][tilePos.x + 1];
+	float4 mr1 = shTex1[tilePos.y][tilePos.x + 1];
+	float4 br1 = shTex1[tilePos.y + 1][tilePos.x + 1];
+
+	float4 tl2 = shTex2[tilePos.y - 1][tilePos.x - 1];
+	float4 ml2 = shTex2[tilePos.y][tilePos.x - 1];
+	float4 bl2 = shTex2[tilePos.y + 1][tilePos.x - 1];
+	float4 tc2 = shTex2[tilePos.y - 1][tilePos.x];
+	float4 mc2 = shTex2[tilePos.y][tilePos.x];
+	float4 bc2 = shTex2[tilePos.y + 1][tilePos.x];
+	float4 tr2 = shTex2[tilePos.y - 1][tilePos.x + 1];
+	float4 mr2 = shTex2[tilePos.y][tilePos.x + 1];
+	float4 br2 = shTex2[tilePos.y + 1][tilePos.x + 1];
 
 	float4 target1 = RELU(float4(
 		tl1.x * kernelsLA[0 * 72 + 0 * 9 + 0] + tc1.x * kernelsLA[0 * 72 + 0 * 9 + 1] + tr1.x * kernelsLA[0 * 72 + 0 * 9 + 2] +
@@ -3971,40 +4090,57 @@ const static float3x3 yuv2rgb = {
 	1, 1.77216, 0.00099
 };
 
+#define TILE_SIZE (MP_BLOCK_WIDTH / 2 + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex3[TILE_SIZE][TILE_SIZE];
+groupshared float4 shTex4[TILE_SIZE][TILE_SIZE];
+
 void Pass9(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint k = threadId.x; k < TILE_SIZE * TILE_SIZE; k += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(k % TILE_SIZE, k / TILE_SIZE);
+		float2 tpos = ((blockStart >> 1) + tilePos - 0.5f) * inputPt;
+		shTex3[tilePos.y][tilePos.x] = tex3.SampleLevel(sam, tpos, 0);
+		shTex4[tilePos.y][tilePos.x] = tex4.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = (Rmp8x8(threadId.x) << 1) + blockStart;
 
 	if (!CheckViewport(gxy)) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
 	float2 outputPt = GetOutputPt();
-
 	float2 pos = ((gxy >> 1) + 0.5f) * inputPt;
+	uint2 tilePos = (gxy >> 1) - (blockStart >> 1) + 1;
 
 	// [tl, tc, tr]
 	// [ml, mc, mr]
 	// [bl, bc, br]
-	float4 tl1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 ml1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 bl1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 tc1 = tex3.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 mc1 = tex3.SampleLevel(sam, pos, 0);
-	float4 bc1 = tex3.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 tr1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 mr1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 br1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
-
-	float4 tl2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 ml2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 bl2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 tc2 = tex4.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 mc2 = tex4.SampleLevel(sam, pos, 0);
-	float4 bc2 = tex4.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 tr2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 mr2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 br2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 tl1 = shTex3[tilePos.y - 1][tilePos.x - 1];
+	float4 ml1 = shTex3[tilePos.y][tilePos.x - 1];
+	float4 bl1 = shTex3[tilePos.y + 1][tilePos.x - 1];
+	float4 tc1 = shTex3[tilePos.y - 1][tilePos.x];
+	float4 mc1 = shTex3[tilePos.y][tilePos.x];
+	float4 bc1 = shTex3[tilePos.y + 1][tilePos.x];
+	float4 tr1 = shTex3[tilePos.y - 1][tilePos.x + 1];
+	float4 mr1 = shTex3[tilePos.y][tilePos.x + 1];
+	float4 br1 = shTex3[tilePos.y + 1][tilePos.x + 1];
+
+	float4 tl2 = shTex4[tilePos.y - 1][tilePos.x - 1];
+	float4 ml2 = shTex4[tilePos.y][tilePos.x - 1];
+	float4 bl2 = shTex4[tilePos.y + 1][tilePos.x - 1];
+	float4 tc2 = shTex4[tilePos.y - 1][tilePos.x];
+	float4 mc2 = shTex4[tilePos.y][tilePos.x];
+	float4 bc2 = shTex4[tilePos.y + 1][tilePos.x];
+	float4 tr2 = shTex4[tilePos.y - 1][tilePos.x + 1];
+	float4 mr2 = shTex4[tilePos.y][tilePos.x + 1];
+	float4 br2 = shTex4[tilePos.y + 1][tilePos.x + 1];
 
 	float4 target1 = RELU(float4(
 		tl1.x * kernelsLA[0 * 72 + 0 * 9 + 0] + tc1.x * kernelsLA[0 * 72 + 0 * 9 + 1] + tr1.x * kernelsLA[0 * 72 + 0 * 9 + 2] +
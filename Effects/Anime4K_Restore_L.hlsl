@@ -45,32 +45,46 @@ Texture2D tex4;
 //!BLOCK_SIZE 16
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块和周围一圈像素，所有卷积核从这里读取
+groupshared float3 shSrc[TILE_SIZE][TILE_SIZE];
+
 void Pass1(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+	uint i, j;
+
+	// 每次 Gather 读取 2x2 个像素
+	for (i = threadId.x; i < (TILE_SIZE / 2) * (TILE_SIZE / 2); i += MP_NUM_THREADS_X) {
+		uint2 pos = uint2(i % (TILE_SIZE / 2), i / (TILE_SIZE / 2)) * 2;
+		float2 tpos = (blockStart + pos) * inputPt;
+		const float4 sr = INPUT.GatherRed(sam, tpos);
+		const float4 sg = INPUT.GatherGreen(sam, tpos);
+		const float4 sb = INPUT.GatherBlue(sam, tpos);
+
+		// w z
+		// x y
+		shSrc[pos.y][pos.x] = float3(sr.w, sg.w, sb.w);
+		shSrc[pos.y][pos.x + 1] = float3(sr.z, sg.z, sb.z);
+		shSrc[pos.y + 1][pos.x] = float3(sr.x, sg.x, sb.x);
+		shSrc[pos.y + 1][pos.x + 1] = float3(sr.y, sg.y, sb.y);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = (Rmp8x8(threadId.x) << 1) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	uint i, j;
-
+	uint2 tilePos = gxy - blockStart;
 	float3 src[4][4];
 	[unroll]
-	for (i = 0; i <= 2; i += 2) {
+	for (i = 0; i < 4; ++i) {
 		[unroll]
-		for (j = 0; j <= 2; j += 2) {
-			float2 tpos = (gxy + uint2(i, j)) * inputPt;
-			const float4 sr = INPUT.GatherRed(sam, tpos);
-			const float4 sg = INPUT.GatherGreen(sam, tpos);
-			const float4 sb = INPUT.GatherBlue(sam, tpos);
-
-			// w z
-			// x y
-			src[i][j] = float3(sr.w, sg.w, sb.w);
-			src[i][j + 1] = float3(sr.x, sg.x, sb.x);
-			src[i + 1][j] = float3(sr.z, sg.z, sb.z);
-			src[i + 1][j + 1] = float3(sr.y, sg.y, sb.y);
+		for (j = 0; j < 4; ++j) {
+			src[i][j] = shSrc[tilePos.y + j][tilePos.x + i];
 		}
 	}
 
@@ -122,28 +136,45 @@ void Pass1(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 8
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex1[TILE_SIZE][TILE_SIZE];
+groupshared float4 shTex2[TILE_SIZE][TILE_SIZE];
+
 void Pass2(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex1[tilePos.y][tilePos.x] = tex1.SampleLevel(sam, tpos, 0);
+		shTex2[tilePos.y][tilePos.x] = tex2.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [ a, d, g ]
 	// [ b, e, h ]
 	// [ c, f, i ]
-	float4 a1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d1 = tex1.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e1 = tex1.SampleLevel(sam, pos, 0);
-	float4 f1 = tex1.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a1 = shTex1[tilePos.y - 1][tilePos.x - 1];
+	float4 b1 = shTex1[tilePos.y][tilePos.x - 1];
+	float4 c1 = shTex1[tilePos.y + 1][tilePos.x - 1];
+	float4 d1 = shTex1[tilePos.y - 1][tilePos.x];
+	float4 e1 = shTex1[tilePos.y][tilePos.x];
+	float4 f1 = shTex1[tilePos.y + 1][tilePos.x];
+	float4 g1 = shTex1[tilePos.y - 1][tilePos.x + 1];
+	float4 h1 = shTex1[tilePos.y][tilePos.x + 1];
+	float4 i1 = shTex1[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na1 = max(-a1, 0);
 	float4 nb1 = max(-b1, 0);
@@ -165,15 +196,15 @@ void Pass2(uint2 blockStart, uint3 threadId) {
 	h1 = max(h1, 0);
 	i1 = max(i1, 0);
 
-	float4 a2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d2 = tex2.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e2 = tex2.SampleLevel(sam, pos, 0);
-	float4 f2 = tex2.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a2 = shTex2[tilePos.y - 1][tilePos.x - 1];
+	float4 b2 = shTex2[tilePos.y][tilePos.x - 1];
+	float4 c2 = shTex2[tilePos.y + 1][tilePos.x - 1];
+	float4 d2 = shTex2[tilePos.y - 1][tilePos.x];
+	float4 e2 = shTex2[tilePos.y][tilePos.x];
+	float4 f2 = shTex2[tilePos.y + 1][tilePos.x];
+	float4 g2 = shTex2[tilePos.y - 1][tilePos.x + 1];
+	float4 h2 = shTex2[tilePos.y][tilePos.x + 1];
+	float4 i2 = shTex2[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na2 = max(-a2, 0);
 	float4 nb2 = max(-b2, 0);
@@ -283,28 +314,45 @@ void Pass2(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 8
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex3[TILE_SIZE][TILE_SIZE];
+groupshared float4 shTex4[TILE_SIZE][TILE_SIZE];
+
 void Pass3(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex3[tilePos.y][tilePos.x] = tex3.SampleLevel(sam, tpos, 0);
+		shTex4[tilePos.y][tilePos.x] = tex4.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [ a, d, g ]
 	// [ b, e, h ]
 	// [ c, f, i ]
-	float4 a1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d1 = tex3.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e1 = tex3.SampleLevel(sam, pos, 0);
-	float4 f1 = tex3.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a1 = shTex3[tilePos.y - 1][tilePos.x - 1];
+	float4 b1 = shTex3[tilePos.y][tilePos.x - 1];
+	float4 c1 = shTex3[tilePos.y + 1][tilePos.x - 1];
+	float4 d1 = shTex3[tilePos.y - 1][tilePos.x];
+	float4 e1 = shTex3[tilePos.y][tilePos.x];
+	float4 f1 = shTex3[tilePos.y + 1][tilePos.x];
+	float4 g1 = shTex3[tilePos.y - 1][tilePos.x + 1];
+	float4 h1 = shTex3[tilePos.y][tilePos.x + 1];
+	float4 i1 = shTex3[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na1 = max(-a1, 0);
 	float4 nb1 = max(-b1, 0);
@@ -326,15 +374,15 @@ void Pass3(uint2 blockStart, uint3 threadId) {
 	h1 = max(h1, 0);
 	i1 = max(i1, 0);
 
-	float4 a2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d2 = tex4.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e2 = tex4.SampleLevel(sam, pos, 0);
-	float4 f2 = tex4.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a2 = shTex4[tilePos.y - 1][tilePos.x - 1];
+	float4 b2 = shTex4[tilePos.y][tilePos.x - 1];
+	float4 c2 = shTex4[tilePos.y + 1][tilePos.x - 1];
+	float4 d2 = shTex4[tilePos.y - 1][tilePos.x];
+	float4 e2 = shTex4[tilePos.y][tilePos.x];
+	float4 f2 = shTex4[tilePos.y + 1][tilePos.x];
+	float4 g2 = shTex4[tilePos.y - 1][tilePos.x + 1];
+	float4 h2 = shTex4[tilePos.y][tilePos.x + 1];
+	float4 i2 = shTex4[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na2 = max(-a2, 0);
 	float4 nb2 = max(-b2, 0);
@@ -444,28 +492,45 @@ void Pass3(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 8
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex1[TILE_SIZE][TILE_SIZE];
+groupshared float4 shTex2[TILE_SIZE][TILE_SIZE];
+
 void Pass4(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex1[tilePos.y][tilePos.x] = tex1.SampleLevel(sam, tpos, 0);
+		shTex2[tilePos.y][tilePos.x] = tex2.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [ a, d, g ]
 	// [ b, e, h ]
 	// [ c, f, i ]
-	float4 a1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d1 = tex1.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e1 = tex1.SampleLevel(sam, pos, 0);
-	float4 f1 = tex1.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i1 = tex1.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a1 = shTex1[tilePos.y - 1][tilePos.x - 1];
+	float4 b1 = shTex1[tilePos.y][tilePos.x - 1];
+	float4 c1 = shTex1[tilePos.y + 1][tilePos.x - 1];
+	float4 d1 = shTex1[tilePos.y - 1][tilePos.x];
+	float4 e1 = shTex1[tilePos.y][tilePos.x];
+	float4 f1 = shTex1[tilePos.y + 1][tilePos.x];
+	float4 g1 = shTex1[tilePos.y - 1][tilePos.x + 1];
+	float4 h1 = shTex1[tilePos.y][tilePos.x + 1];
+	float4 i1 = shTex1[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na1 = max(-a1, 0);
 	float4 nb1 = max(-b1, 0);
@@ -487,15 +552,15 @@ void Pass4(uint2 blockStart, uint3 threadId) {
 	h1 = max(h1, 0);
 	i1 = max(i1, 0);
 
-	float4 a2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c2 = tex2.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d2 = tex2.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e2 = tex2.SampleLevel(sam, pos, 0);
-	float4 f2 = tex2.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i2 = tex2.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a2 = shTex2[tilePos.y - 1][tilePos.x - 1];
+	float4 b2 = shTex2[tilePos.y][tilePos.x - 1];
+	float4 c2 = shTex2[tilePos.y + 1][tilePos.x - 1];
+	float4 d2 = shTex2[tilePos.y - 1][tilePos.x];
+	float4 e2 = shTex2[tilePos.y][tilePos.x];
+	float4 f2 = shTex2[tilePos.y + 1][tilePos.x];
+	float4 g2 = shTex2[tilePos.y - 1][tilePos.x + 1];
+	float4 h2 = shTex2[tilePos.y][tilePos.x + 1];
+	float4 i2 = shTex2[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na2 = max(-a2, 0);
 	float4 nb2 = max(-b2, 0);
@@ -604,38 +669,56 @@ void Pass4(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 8
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex3[TILE_SIZE][TILE_SIZE];
+groupshared float4 shTex4[TILE_SIZE][TILE_SIZE];
+
 void Pass5(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex3[tilePos.y][tilePos.x] = tex3.SampleLevel(sam, tpos, 0);
+		shTex4[tilePos.y][tilePos.x] = tex4.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (!CheckViewport(gxy)) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
 	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [ a, d, g ]
 	// [ b, e, h ]
 	// [ c, f, i ]
-	float4 a1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y),0);
-	float4 b1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c1 = tex3.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d1 = tex3.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e1 = tex3.SampleLevel(sam, pos, 0);
-	float4 f1 = tex3.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i1 = tex3.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
-
-	float4 a2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c2 = tex4.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d2 = tex4.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e2 = tex4.SampleLevel(sam, pos, 0);
-	float4 f2 = tex4.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i2 = tex4.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a1 = shTex3[tilePos.y - 1][tilePos.x - 1];
+	float4 b1 = shTex3[tilePos.y][tilePos.x - 1];
+	float4 c1 = shTex3[tilePos.y + 1][tilePos.x - 1];
+	float4 d1 = shTex3[tilePos.y - 1][tilePos.x];
+	float4 e1 = shTex3[tilePos.y][tilePos.x];
+	float4 f1 = shTex3[tilePos.y + 1][tilePos.x];
+	float4 g1 = shTex3[tilePos.y - 1][tilePos.x + 1];
+	float4 h1 = shTex3[tilePos.y][tilePos.x + 1];
+	float4 i1 = shTex3[tilePos.y + 1][tilePos.x + 1];
+
+	float4 a2 = shTex4[tilePos.y - 1][tilePos.x - 1];
+	float4 b2 = shTex4[tilePos.y][tilePos.x - 1];
+	float4 c2 = shTex4[tilePos.y + 1][tilePos.x - 1];
+	float4 d2 = shTex4[tilePos.y - 1][tilePos.x];
+	float4 e2 = shTex4[tilePos.y][tilePos.x];
+	float4 f2 = shTex4[tilePos.y + 1][tilePos.x];
+	float4 g2 = shTex4[tilePos.y - 1][tilePos.x + 1];
+	float4 h2 = shTex4[tilePos.y][tilePos.x + 1];
+	float4 i2 = shTex4[tilePos.y + 1][tilePos.x + 1];
 
 	float4 result = mul(max(a1, 0), float4x4(0.012102164, 0.01385959, 0.018815203, 0.0, -0.017435113, -0.04530735, -0.051318135, 0.0, 0.01267727, 0.01400136, 0.017735276, 0.0, 0.012681183, 0.035241637, 0.03990959, 0.0));
 	result += mul(max(b1, 0), float4x4(0.16069227, 0.098007366, 0.076831706, 0.0, 0.081593364, 0.017831434, 0.010174303, 0.0, 0.014732323, 0.02229113, 0.029828338, 0.0, 0.0048171813, 0.051809076, 0.055740006, 0.0));
@@ -58,32 +58,46 @@ Texture2D tex6;
 //!BLOCK_SIZE 16
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块和周围一圈像素，所有卷积核从这里读取
+groupshared float3 shSrc[TILE_SIZE][TILE_SIZE];
+
 void Pass1(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+	uint i, j;
+
+	// 每次 Gather 读取 2x2 个像素
+	for (i = threadId.x; i < (TILE_SIZE / 2) * (TILE_SIZE / 2); i += MP_NUM_THREADS_X) {
+		uint2 pos = uint2(i % (TILE_SIZE / 2), i / (TILE_SIZE / 2)) * 2;
+		float2 tpos = (blockStart + pos) * inputPt;
+		const float4 sr = INPUT.GatherRed(sam, tpos);
+		const float4 sg = INPUT.GatherGreen(sam, tpos);
+		const float4 sb = INPUT.GatherBlue(sam, tpos);
+
+		// w z
+		// x y
+		shSrc[pos.y][pos.x] = float3(sr.w, sg.w, sb.w);
+		shSrc[pos.y][pos.x + 1] = float3(sr.z, sg.z, sb.z);
+		shSrc[pos.y + 1][pos.x] = float3(sr.x, sg.x, sb.x);
+		shSrc[pos.y + 1][pos.x + 1] = float3(sr.y, sg.y, sb.y);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = (Rmp8x8(threadId.x) << 1) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
-	float2 inputPt = GetInputPt();
-
-	uint i, j;
 
+	uint2 tilePos = gxy - blockStart;
 	float3 src[4][4];
 	[unroll]
-	for (i = 0; i <= 2; i += 2) {
+	for (i = 0; i < 4; ++i) {
 		[unroll]
-		for (j = 0; j <= 2; j += 2) {
-			float2 tpos = (gxy + uint2(i, j)) * inputPt;
-			const float4 sr = INPUT.GatherRed(sam, tpos);
-			const float4 sg = INPUT.GatherGreen(sam, tpos);
-			const float4 sb = INPUT.GatherBlue(sam, tpos);
-
-			// w z
-			// x y
-			src[i][j] = float3(sr.w, sg.w, sb.w);
-			src[i][j + 1] = float3(sr.x, sg.x, sb.x);
-			src[i + 1][j] = float3(sr.z, sg.z, sb.z);
-			src[i + 1][j + 1] = float3(sr.y, sg.y, sb.y);
+		for (j = 0; j < 4; ++j) {
+			src[i][j] = shSrc[tilePos.y + j][tilePos.x + i];
 		}
 	}
 
@@ -123,33 +137,47 @@ void Pass1(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 16
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块和周围一圈像素，所有卷积核从这里读取
+groupshared float4 shSrc[TILE_SIZE][TILE_SIZE];
+
 void Pass2(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+	uint i, j;
+
+	// 每次 Gather 读取 2x2 个像素
+	for (i = threadId.x; i < (TILE_SIZE / 2) * (TILE_SIZE / 2); i += MP_NUM_THREADS_X) {
+		uint2 pos = uint2(i % (TILE_SIZE / 2), i / (TILE_SIZE / 2)) * 2;
+		float2 tpos = (blockStart + pos) * inputPt;
+		const float4 sr = tex1.GatherRed(sam, tpos);
+		const float4 sg = tex1.GatherGreen(sam, tpos);
+		const float4 sb = tex1.GatherBlue(sam, tpos);
+		const float4 sa = tex1.GatherAlpha(sam, tpos);
+
+		// w z
+		// x y
+		shSrc[pos.y][pos.x] = float4(sr.w, sg.w, sb.w, sa.w);
+		shSrc[pos.y][pos.x + 1] = float4(sr.z, sg.z, sb.z, sa.z);
+		shSrc[pos.y + 1][pos.x] = float4(sr.x, sg.x, sb.x, sa.x);
+		shSrc[pos.y + 1][pos.x + 1] = float4(sr.y, sg.y, sb.y, sa.y);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = (Rmp8x8(threadId.x) << 1) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
-	float2 inputPt = GetInputPt();
-
-	uint i, j;
 
+	uint2 tilePos = gxy - blockStart;
 	float4 src[4][4];
 	[unroll]
-	for (i = 0; i <= 2; i += 2) {
+	for (i = 0; i < 4; ++i) {
 		[unroll]
-		for (j = 0; j <= 2; j += 2) {
-			float2 tpos = (gxy + uint2(i, j)) * inputPt;
-			const float4 sr = tex1.GatherRed(sam, tpos);
-			const float4 sg = tex1.GatherGreen(sam, tpos);
-			const float4 sb = tex1.GatherBlue(sam, tpos);
-			const float4 sa = tex1.GatherAlpha(sam, tpos);
-
-			// w z
-			// x y
-			src[i][j] = float4(sr.w, sg.w, sb.w, sa.w);
-			src[i][j + 1] = float4(sr.x, sg.x, sb.x, sa.x);
-			src[i + 1][j] = float4(sr.z, sg.z, sb.z, sa.z);
-			src[i + 1][j + 1] = float4(sr.y, sg.y, sb.y, sa.y);
+		for (j = 0; j < 4; ++j) {
+			src[i][j] = shSrc[tilePos.y + j][tilePos.x + i];
 		}
 	}
 
@@ -198,33 +226,47 @@ void Pass2(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 16
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块和周围一圈像素，所有卷积核从这里读取
+groupshared float4 shSrc[TILE_SIZE][TILE_SIZE];
+
 void Pass3(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+	uint i, j;
+
+	// 每次 Gather 读取 2x2 个像素
+	for (i = threadId.x; i < (TILE_SIZE / 2) * (TILE_SIZE / 2); i += MP_NUM_THREADS_X) {
+		uint2 pos = uint2(i % (TILE_SIZE / 2), i / (TILE_SIZE / 2)) * 2;
+		float2 tpos = (blockStart + pos) * inputPt;
+		const float4 sr = tex2.GatherRed(sam, tpos);
+		const float4 sg = tex2.GatherGreen(sam, tpos);
+		const float4 sb = tex2.GatherBlue(sam, tpos);
+		const float4 sa = tex2.GatherAlpha(sam, tpos);
+
+		// w z
+		// x y
+		shSrc[pos.y][pos.x] = float4(sr.w, sg.w, sb.w, sa.w);
+		shSrc[pos.y][pos.x + 1] = float4(sr.z, sg.z, sb.z, sa.z);
+		shSrc[pos.y + 1][pos.x] = float4(sr.x, sg.x, sb.x, sa.x);
+		shSrc[pos.y + 1][pos.x + 1] = float4(sr.y, sg.y, sb.y, sa.y);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = (Rmp8x8(threadId.x) << 1) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
-	float2 inputPt = GetInputPt();
-
-	uint i, j;
 
+	uint2 tilePos = gxy - blockStart;
 	float4 src[4][4];
 	[unroll]
-	for (i = 0; i <= 2; i += 2) {
+	for (i = 0; i < 4; ++i) {
 		[unroll]
-		for (j = 0; j <= 2; j += 2) {
-			float2 tpos = (gxy + uint2(i, j)) * inputPt;
-			const float4 sr = tex2.GatherRed(sam, tpos);
-			const float4 sg = tex2.GatherGreen(sam, tpos);
-			const float4 sb = tex2.GatherBlue(sam, tpos);
-			const float4 sa = tex2.GatherAlpha(sam, tpos);
-
-			// w z
-			// x y
-			src[i][j] = float4(sr.w, sg.w, sb.w, sa.w);
-			src[i][j + 1] = float4(sr.x, sg.x, sb.x, sa.x);
-			src[i + 1][j] = float4(sr.z, sg.z, sb.z, sa.z);
-			src[i + 1][j + 1] = float4(sr.y, sg.y, sb.y, sa.y);
+		for (j = 0; j < 4; ++j) {
+			src[i][j] = shSrc[tilePos.y + j][tilePos.x + i];
 		}
 	}
 
@@ -273,33 +315,47 @@ void Pass3(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 16
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块和周围一圈像素，所有卷积核从这里读取
+groupshared float4 shSrc[TILE_SIZE][TILE_SIZE];
+
 void Pass4(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+	uint i, j;
+
+	// 每次 Gather 读取 2x2 个像素
+	for (i = threadId.x; i < (TILE_SIZE / 2) * (TILE_SIZE / 2); i += MP_NUM_THREADS_X) {
+		uint2 pos = uint2(i % (TILE_SIZE / 2), i / (TILE_SIZE / 2)) * 2;
+		float2 tpos = (blockStart + pos) * inputPt;
+		const float4 sr = tex3.GatherRed(sam, tpos);
+		const float4 sg = tex3.GatherGreen(sam, tpos);
+		const float4 sb = tex3.GatherBlue(sam, tpos);
+		const float4 sa = tex3.GatherAlpha(sam, tpos);
+
+		// w z
+		// x y
+		shSrc[pos.y][pos.x] = float4(sr.w, sg.w, sb.w, sa.w);
+		shSrc[pos.y][pos.x + 1] = float4(sr.z, sg.z, sb.z, sa.z);
+		shSrc[pos.y + 1][pos.x] = float4(sr.x, sg.x, sb.x, sa.x);
+		shSrc[pos.y + 1][pos.x + 1] = float4(sr.y, sg.y, sb.y, sa.y);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = (Rmp8x8(threadId.x) << 1) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
-	float2 inputPt = GetInputPt();
-
-	uint i, j;
 
+	uint2 tilePos = gxy - blockStart;
 	float4 src[4][4];
 	[unroll]
-	for (i = 0; i <= 2; i += 2) {
+	for (i = 0; i < 4; ++i) {
 		[unroll]
-		for (j = 0; j <= 2; j += 2) {
-			float2 tpos = (gxy + uint2(i, j)) * inputPt;
-			const float4 sr = tex3.GatherRed(sam, tpos);
-			const float4 sg = tex3.GatherGreen(sam, tpos);
-			const float4 sb = tex3.GatherBlue(sam, tpos);
-			const float4 sa = tex3.GatherAlpha(sam, tpos);
-
-			// w z
-			// x y
-			src[i][j] = float4(sr.w, sg.w, sb.w, sa.w);
-			src[i][j + 1] = float4(sr.x, sg.x, sb.x, sa.x);
-			src[i + 1][j] = float4(sr.z, sg.z, sb.z, sa.z);
-			src[i + 1][j + 1] = float4(sr.y, sg.y, sb.y, sa.y);
+		for (j = 0; j < 4; ++j) {
+			src[i][j] = shSrc[tilePos.y + j][tilePos.x + i];
 		}
 	}
 
@@ -348,33 +404,47 @@ void Pass4(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 16
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块和周围一圈像素，所有卷积核从这里读取
+groupshared float4 shSrc[TILE_SIZE][TILE_SIZE];
+
 void Pass5(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+	uint i, j;
+
+	// 每次 Gather 读取 2x2 个像素
+	for (i = threadId.x; i < (TILE_SIZE / 2) * (TILE_SIZE / 2); i += MP_NUM_THREADS_X) {
+		uint2 pos = uint2(i % (TILE_SIZE / 2), i / (TILE_SIZE / 2)) * 2;
+		float2 tpos = (blockStart + pos) * inputPt;
+		const float4 sr = tex4.GatherRed(sam, tpos);
+		const float4 sg = tex4.GatherGreen(sam, tpos);
+		const float4 sb = tex4.GatherBlue(sam, tpos);
+		const float4 sa = tex4.GatherAlpha(sam, tpos);
+
+		// w z
+		// x y
+		shSrc[pos.y][pos.x] = float4(sr.w, sg.w, sb.w, sa.w);
+		shSrc[pos.y][pos.x + 1] = float4(sr.z, sg.z, sb.z, sa.z);
+		shSrc[pos.y + 1][pos.x] = float4(sr.x, sg.x, sb.x, sa.x);
+		shSrc[pos.y + 1][pos.x + 1] = float4(sr.y, sg.y, sb.y, sa.y);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = (Rmp8x8(threadId.x) << 1) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
-	float2 inputPt = GetInputPt();
-
-	uint i, j;
 
+	uint2 tilePos = gxy - blockStart;
 	float4 src[4][4];
 	[unroll]
-	for (i = 0; i <= 2; i += 2) {
+	for (i = 0; i < 4; ++i) {
 		[unroll]
-		for (j = 0; j <= 2; j += 2) {
-			float2 tpos = (gxy + uint2(i, j)) * inputPt;
-			const float4 sr = tex4.GatherRed(sam, tpos);
-			const float4 sg = tex4.GatherGreen(sam, tpos);
-			const float4 sb = tex4.GatherBlue(sam, tpos);
-			const float4 sa = tex4.GatherAlpha(sam, tpos);
-
-			// w z
-			// x y
-			src[i][j] = float4(sr.w, sg.w, sb.w, sa.w);
-			src[i][j + 1] = float4(sr.x, sg.x, sb.x, sa.x);
-			src[i + 1][j] = float4(sr.z, sg.z, sb.z, sa.z);
-			src[i + 1][j + 1] = float4(sr.y, sg.y, sb.y, sa.y);
+		for (j = 0; j < 4; ++j) {
+			src[i][j] = shSrc[tilePos.y + j][tilePos.x + i];
 		}
 	}
 
@@ -423,33 +493,47 @@ void Pass5(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 16
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块和周围一圈像素，所有卷积核从这里读取
+groupshared float4 shSrc[TILE_SIZE][TILE_SIZE];
+
 void Pass6(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+	uint i, j;
+
+	// 每次 Gather 读取 2x2 个像素
+	for (i = threadId.x; i < (TILE_SIZE / 2) * (TILE_SIZE / 2); i += MP_NUM_THREADS_X) {
+		uint2 pos = uint2(i % (TILE_SIZE / 2), i / (TILE_SIZE / 2)) * 2;
+		float2 tpos = (blockStart + pos) * inputPt;
+		const float4 sr = tex5.GatherRed(sam, tpos);
+		const float4 sg = tex5.GatherGreen(sam, tpos);
+		const float4 sb = tex5.GatherBlue(sam, tpos);
+		const float4 sa = tex5.GatherAlpha(sam, tpos);
+
+		// w z
+		// x y
+		shSrc[pos.y][pos.x] = float4(sr.w, sg.w, sb.w, sa.w);
+		shSrc[pos.y][pos.x + 1] = float4(sr.z, sg.z, sb.z, sa.z);
+		shSrc[pos.y + 1][pos.x] = float4(sr.x, sg.x, sb.x, sa.x);
+		shSrc[pos.y + 1][pos.x + 1] = float4(sr.y, sg.y, sb.y, sa.y);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = (Rmp8x8(threadId.x) << 1) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
-	float2 inputPt = GetInputPt();
-
-	uint i, j;
 
+	uint2 tilePos = gxy - blockStart;
 	float4 src[4][4];
 	[unroll]
-	for (i = 0; i <= 2; i += 2) {
+	for (i = 0; i < 4; ++i) {
 		[unroll]
-		for (j = 0; j <= 2; j += 2) {
-			float2 tpos = (gxy + uint2(i, j)) * inputPt;
-			const float4 sr = tex5.GatherRed(sam, tpos);
-			const float4 sg = tex5.GatherGreen(sam, tpos);
-			const float4 sb = tex5.GatherBlue(sam, tpos);
-			const float4 sa = tex5.GatherAlpha(sam, tpos);
-
-			// w z
-			// x y
-			src[i][j] = float4(sr.w, sg.w, sb.w, sa.w);
-			src[i][j + 1] = float4(sr.x, sg.x, sb.x, sa.x);
-			src[i + 1][j] = float4(sr.z, sg.z, sb.z, sa.z);
-			src[i + 1][j + 1] = float4(sr.y, sg.y, sb.y, sa.y);
+		for (j = 0; j < 4; ++j) {
+			src[i][j] = shSrc[tilePos.y + j][tilePos.x + i];
 		}
 	}
 
@@ -497,34 +581,51 @@ void Pass6(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 8
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex6[TILE_SIZE][TILE_SIZE];
+
 void Pass7(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint k = threadId.x; k < TILE_SIZE * TILE_SIZE; k += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(k % TILE_SIZE, k / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex6[tilePos.y][tilePos.x] = tex6.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (!CheckViewport(gxy)) {
 		return;
 	}
-	float2 inputPt = GetInputPt();
+
 	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [ a, d, g ]
 	// [ b, e, h ]
 	// [ c, f, i ]
-	float4 a = tex6.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b = tex6.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c = tex6.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d = tex6.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e = tex6.SampleLevel(sam, pos, 0);
-	float4 f = tex6.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g = tex6.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h = tex6.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i = tex6.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a = shTex6[tilePos.y - 1][tilePos.x - 1];
+	float4 b = shTex6[tilePos.y][tilePos.x - 1];
+	float4 c = shTex6[tilePos.y + 1][tilePos.x - 1];
+	float4 d = shTex6[tilePos.y - 1][tilePos.x];
+	float4 e = shTex6[tilePos.y][tilePos.x];
+	float4 f = shTex6[tilePos.y + 1][tilePos.x];
+	float4 g = shTex6[tilePos.y - 1][tilePos.x + 1];
+	float4 h = shTex6[tilePos.y][tilePos.x + 1];
+	float4 i = shTex6[tilePos.y + 1][tilePos.x + 1];
 
 	float4 src1 = tex1.SampleLevel(sam, pos, 0);
 	float4 src2 = tex2.SampleLevel(sam, pos, 0);
 	float4 src3 = tex3.SampleLevel(sam, pos, 0);
 	float4 src4 = tex4.SampleLevel(sam, pos, 0);
 	float4 src5 = tex5.SampleLevel(sam, pos, 0);
-	float4 src6 = tex6.SampleLevel(sam, pos, 0);
+	float4 src6 = shTex6[tilePos.y][tilePos.x];
 	float3 origin = INPUT.SampleLevel(sam, pos, 0).rgb;
 
 	float4 src7 = mul(max(a, 0), float4x4(-0.35835463, 0.038305778, -0.10198824, -0.021951782, 0.02142098, -0.072417736, -0.2577152, 0.054713376, 0.075116105, -0.21191697, -0.1213158, -0.105036296, 0.12030758, -0.17591658, 0.1726511, 0.17754573));
@@ -74,32 +74,46 @@ Texture2D tex8;
 //!BLOCK_SIZE 16
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块和周围一圈像素，所有卷积核从这里读取
+groupshared float3 shSrc[TILE_SIZE][TILE_SIZE];
+
 void Pass1(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+	uint i, j;
+
+	// 每次 Gather 读取 2x2 个像素
+	for (i = threadId.x; i < (TILE_SIZE / 2) * (TILE_SIZE / 2); i += MP_NUM_THREADS_X) {
+		uint2 pos = uint2(i % (TILE_SIZE / 2), i / (TILE_SIZE / 2)) * 2;
+		float2 tpos = (blockStart + pos) * inputPt;
+		const float4 sr = INPUT.GatherRed(sam, tpos);
+		const float4 sg = INPUT.GatherGreen(sam, tpos);
+		const float4 sb = INPUT.GatherBlue(sam, tpos);
+
+		// w z
+		// x y
+		shSrc[pos.y][pos.x] = float3(sr.w, sg.w, sb.w);
+		shSrc[pos.y][pos.x + 1] = float3(sr.z, sg.z, sb.z);
+		shSrc[pos.y + 1][pos.x] = float3(sr.x, sg.x, sb.x);
+		shSrc[pos.y + 1][pos.x + 1] = float3(sr.y, sg.y, sb.y);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = (Rmp8x8(threadId.x) << 1) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
-	float2 inputPt = GetInputPt();
-
-	uint i, j;
 
+	uint2 tilePos = gxy - blockStart;
 	float3 src[4][4];
 	[unroll]
-	for (i = 0; i <= 2; i += 2) {
+	for (i = 0; i < 4; ++i) {
 		[unroll]
-		for (j = 0; j <= 2; j += 2) {
-			float2 tpos = (gxy + uint2(i, j)) * inputPt;
-			const float4 sr = INPUT.GatherRed(sam, tpos);
-			const float4 sg = INPUT.GatherGreen(sam, tpos);
-			const float4 sb = INPUT.GatherBlue(sam, tpos);
-
-			// w z
-			// x y
-			src[i][j] = float3(sr.w, sg.w, sb.w);
-			src[i][j + 1] = float3(sr.x, sg.x, sb.x);
-			src[i + 1][j] = float3(sr.z, sg.z, sb.z);
-			src[i + 1][j + 1] = float3(sr.y, sg.y, sb.y);
+		for (j = 0; j < 4; ++j) {
+			src[i][j] = shSrc[tilePos.y + j][tilePos.x + i];
 		}
 	}
 
@@ -139,28 +153,43 @@ void Pass1(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 8
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex1[TILE_SIZE][TILE_SIZE];
+
 void Pass2(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint k = threadId.x; k < TILE_SIZE * TILE_SIZE; k += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(k % TILE_SIZE, k / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex1[tilePos.y][tilePos.x] = tex1.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [ a, d, g ]
 	// [ b, e, h ]
 	// [ c, f, i ]
-	float4 a = tex1.SampleLevel(sam, pos - inputPt, 0);
-	float4 b = tex1.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c = tex1.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d = tex1.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e = tex1.SampleLevel(sam, pos, 0);
-	float4 f = tex1.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g = tex1.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h = tex1.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i = tex1.SampleLevel(sam, pos + inputPt, 0);
+	float4 a = shTex1[tilePos.y - 1][tilePos.x - 1];
+	float4 b = shTex1[tilePos.y][tilePos.x - 1];
+	float4 c = shTex1[tilePos.y + 1][tilePos.x - 1];
+	float4 d = shTex1[tilePos.y - 1][tilePos.x];
+	float4 e = shTex1[tilePos.y][tilePos.x];
+	float4 f = shTex1[tilePos.y + 1][tilePos.x];
+	float4 g = shTex1[tilePos.y - 1][tilePos.x + 1];
+	float4 h = shTex1[tilePos.y][tilePos.x + 1];
+	float4 i = shTex1[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na = max(-a, 0);
 	float4 nb = max(-b, 0);
@@ -242,28 +271,44 @@ void Pass2(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 8
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex4[TILE_SIZE][TILE_SIZE];
+
 void Pass3(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint k = threadId.x; k < TILE_SIZE * TILE_SIZE; k += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(k % TILE_SIZE, k / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex4[tilePos.y][tilePos.x] = tex4.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
 	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [ a, d, g ]
 	// [ b, e, h ]
 	// [ c, f, i ]
-	float4 a = tex4.SampleLevel(sam, pos - inputPt, 0);
-	float4 b = tex4.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c = tex4.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d = tex4.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e = tex4.SampleLevel(sam, pos, 0);
-	float4 f = tex4.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g = tex4.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h = tex4.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i = tex4.SampleLevel(sam, pos + inputPt, 0);
+	float4 a = shTex4[tilePos.y - 1][tilePos.x - 1];
+	float4 b = shTex4[tilePos.y][tilePos.x - 1];
+	float4 c = shTex4[tilePos.y + 1][tilePos.x - 1];
+	float4 d = shTex4[tilePos.y - 1][tilePos.x];
+	float4 e = shTex4[tilePos.y][tilePos.x];
+	float4 f = shTex4[tilePos.y + 1][tilePos.x];
+	float4 g = shTex4[tilePos.y - 1][tilePos.x + 1];
+	float4 h = shTex4[tilePos.y][tilePos.x + 1];
+	float4 i = shTex4[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na = max(-a, 0);
 	float4 nb = max(-b, 0);
@@ -349,28 +394,44 @@ void Pass3(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 8
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex5[TILE_SIZE][TILE_SIZE];
+
 void Pass4(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint k = threadId.x; k < TILE_SIZE * TILE_SIZE; k += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(k % TILE_SIZE, k / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex5[tilePos.y][tilePos.x] = tex5.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
 	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [ a, d, g ]
 	// [ b, e, h ]
 	// [ c, f, i ]
-	float4 a = tex5.SampleLevel(sam, pos - inputPt, 0);
-	float4 b = tex5.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c = tex5.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d = tex5.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e = tex5.SampleLevel(sam, pos, 0);
-	float4 f = tex5.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g = tex5.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h = tex5.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i = tex5.SampleLevel(sam, pos + inputPt, 0);
+	float4 a = shTex5[tilePos.y - 1][tilePos.x - 1];
+	float4 b = shTex5[tilePos.y][tilePos.x - 1];
+	float4 c = shTex5[tilePos.y + 1][tilePos.x - 1];
+	float4 d = shTex5[tilePos.y - 1][tilePos.x];
+	float4 e = shTex5[tilePos.y][tilePos.x];
+	float4 f = shTex5[tilePos.y + 1][tilePos.x];
+	float4 g = shTex5[tilePos.y - 1][tilePos.x + 1];
+	float4 h = shTex5[tilePos.y][tilePos.x + 1];
+	float4 i = shTex5[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na = max(-a, 0);
 	float4 nb = max(-b, 0);
@@ -459,28 +520,44 @@ void Pass4(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 8
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex6[TILE_SIZE][TILE_SIZE];
+
 void Pass5(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint k = threadId.x; k < TILE_SIZE * TILE_SIZE; k += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(k % TILE_SIZE, k / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex6[tilePos.y][tilePos.x] = tex6.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
 	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [ a, d, g ]
 	// [ b, e, h ]
 	// [ c, f, i ]
-	float4 a = tex6.SampleLevel(sam, pos - inputPt, 0);
-	float4 b = tex6.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c = tex6.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d = tex6.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e = tex6.SampleLevel(sam, pos, 0);
-	float4 f = tex6.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g = tex6.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h = tex6.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i = tex6.SampleLevel(sam, pos + inputPt, 0);
+	float4 a = shTex6[tilePos.y - 1][tilePos.x - 1];
+	float4 b = shTex6[tilePos.y][tilePos.x - 1];
+	float4 c = shTex6[tilePos.y + 1][tilePos.x - 1];
+	float4 d = shTex6[tilePos.y - 1][tilePos.x];
+	float4 e = shTex6[tilePos.y][tilePos.x];
+	float4 f = shTex6[tilePos.y + 1][tilePos.x];
+	float4 g = shTex6[tilePos.y - 1][tilePos.x + 1];
+	float4 h = shTex6[tilePos.y][tilePos.x + 1];
+	float4 i = shTex6[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na = max(-a, 0);
 	float4 nb = max(-b, 0);
@@ -573,28 +650,44 @@ void Pass5(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 8
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shTex7[TILE_SIZE][TILE_SIZE];
+
 void Pass6(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint k = threadId.x; k < TILE_SIZE * TILE_SIZE; k += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(k % TILE_SIZE, k / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shTex7[tilePos.y][tilePos.x] = tex7.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
 	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [ a, d, g ]
 	// [ b, e, h ]
 	// [ c, f, i ]
-	float4 a = tex7.SampleLevel(sam, pos - inputPt, 0);
-	float4 b = tex7.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c = tex7.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d = tex7.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e = tex7.SampleLevel(sam, pos, 0);
-	float4 f = tex7.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g = tex7.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h = tex7.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i = tex7.SampleLevel(sam, pos + inputPt, 0);
+	float4 a = shTex7[tilePos.y - 1][tilePos.x - 1];
+	float4 b = shTex7[tilePos.y][tilePos.x - 1];
+	float4 c = shTex7[tilePos.y + 1][tilePos.x - 1];
+	float4 d = shTex7[tilePos.y - 1][tilePos.x];
+	float4 e = shTex7[tilePos.y][tilePos.x];
+	float4 f = shTex7[tilePos.y + 1][tilePos.x];
+	float4 g = shTex7[tilePos.y - 1][tilePos.x + 1];
+	float4 h = shTex7[tilePos.y][tilePos.x + 1];
+	float4 i = shTex7[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na = max(-a, 0);
 	float4 nb = max(-b, 0);
@@ -52,34 +52,49 @@ float4 A4KS1(float3 src[4][4], int i, int j) {
 	return result;
 }
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块和周围一圈像素，所有卷积核从这里读取
+groupshared float3 shSrc[TILE_SIZE][TILE_SIZE];
+
 void Pass1(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+	uint i, j;
+
+	// 每次 Gather 读取 2x2 个像素
+	for (i = threadId.x; i < (TILE_SIZE / 2) * (TILE_SIZE / 2); i += MP_NUM_THREADS_X) {
+		uint2 pos = uint2(i % (TILE_SIZE / 2), i / (TILE_SIZE / 2)) * 2;
+		float2 tpos = (blockStart + pos) * inputPt;
+		const float4 sr = INPUT.GatherRed(sam, tpos);
+		const float4 sg = INPUT.GatherGreen(sam, tpos);
+		const float4 sb = INPUT.GatherBlue(sam, tpos);
+
+		// w z
+		// x y
+		shSrc[pos.y][pos.x] = float3(sr.w, sg.w, sb.w);
+		shSrc[pos.y][pos.x + 1] = float3(sr.z, sg.z, sb.z);
+		shSrc[pos.y + 1][pos.x] = float3(sr.x, sg.x, sb.x);
+		shSrc[pos.y + 1][pos.x + 1] = float3(sr.y, sg.y, sb.y);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = (Rmp8x8(threadId.x) << 1) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-
+	uint2 tilePos = gxy - blockStart;
 	float3 src[4][4];
 	[unroll]
-	for (uint i = 0; i < 3; i += 2) {
+	for (i = 0; i < 4; ++i) {
 		[unroll]
-		for (uint j = 0; j < 3; j += 2) {
-			float2 tpos = (gxy + uint2(i, j)) * inputPt;
-			const float4 sr = INPUT.GatherRed(sam, tpos);
-			const float4 sg = INPUT.GatherGreen(sam, tpos);
-			const float4 sb = INPUT.GatherBlue(sam, tpos);
-
-			// w z
-			// x y
-			src[i][j] = float3(sr.w, sg.w, sb.w);
-			src[i][j + 1] = float3(sr.x, sg.x, sb.x);
-			src[i + 1][j] = float3(sr.z, sg.z, sb.z);
-			src[i + 1][j + 1] = float3(sr.y, sg.y, sb.y);
+		for (j = 0; j < 4; ++j) {
+			src[i][j] = shSrc[tilePos.y + j][tilePos.x + i];
 		}
 	}
-	
+
 	tex1[gxy] = A4KS1(src, 1, 1);
 	++gxy.x;
 	tex1[gxy] = A4KS1(src, 2, 1);
@@ -125,31 +140,47 @@ float4 A4KS2(float4 src[4][4], int i, int j) {
 }
 
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块和周围一圈像素，所有卷积核从这里读取
+groupshared float4 shSrc[TILE_SIZE][TILE_SIZE];
+
 void Pass2(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+	uint i, j;
+
+	// 每次 Gather 读取 2x2 个像素
+	for (i = threadId.x; i < (TILE_SIZE / 2) * (TILE_SIZE / 2); i += MP_NUM_THREADS_X) {
+		uint2 pos = uint2(i % (TILE_SIZE / 2), i / (TILE_SIZE / 2)) * 2;
+		float2 tpos = (blockStart + pos) * inputPt;
+		const float4 sr = tex1.GatherRed(sam, tpos);
+		const float4 sg = tex1.GatherGreen(sam, tpos);
+		const float4 sb = tex1.GatherBlue(sam, tpos);
+		const float4 sa = tex1.GatherAlpha(sam, tpos);
+
+		// w z
+		// x y
+		shSrc[pos.y][pos.x] = float4(sr.w, sg.w, sb.w, sa.w);
+		shSrc[pos.y][pos.x + 1] = float4(sr.z, sg.z, sb.z, sa.z);
+		shSrc[pos.y + 1][pos.x] = float4(sr.x, sg.x, sb.x, sa.x);
+		shSrc[pos.y + 1][pos.x + 1] = float4(sr.y, sg.y, sb.y, sa.y);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = (Rmp8x8(threadId.x) << 1) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
-	float2 inputPt = GetInputPt();
 
+	uint2 tilePos = gxy - blockStart;
 	float4 src[4][4];
 	[unroll]
-	for (uint i = 0; i < 3; i += 2) {
+	for (i = 0; i < 4; ++i) {
 		[unroll]
-		for (uint j = 0; j < 3; j += 2) {
-			float2 tpos = (gxy + uint2(i, j)) * inputPt;
-			const float4 sr = tex1.GatherRed(sam, tpos);
-			const float4 sg = tex1.GatherGreen(sam, tpos);
-			const float4 sb = tex1.GatherBlue(sam, tpos);
-			const float4 sa = tex1.GatherAlpha(sam, tpos);
-
-			// w z
-			// x y
-			src[i][j] = float4(sr.w, sg.w, sb.w, sa.w);
-			src[i][j + 1] = float4(sr.x, sg.x, sb.x, sa.x);
-			src[i + 1][j] = float4(sr.z, sg.z, sb.z, sa.z);
-			src[i + 1][j + 1] = float4(sr.y, sg.y, sb.y, sa.y);
+		for (j = 0; j < 4; ++j) {
+			src[i][j] = shSrc[tilePos.y + j][tilePos.x + i];
 		}
 	}
 
@@ -196,31 +227,47 @@ float4 A4KS3(float4 src[4][4], int i, int j) {
 	return result;
 }
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块和周围一圈像素，所有卷积核从这里读取
+groupshared float4 shSrc[TILE_SIZE][TILE_SIZE];
+
 void Pass3(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+	uint i, j;
+
+	// 每次 Gather 读取 2x2 个像素
+	for (i = threadId.x; i < (TILE_SIZE / 2) * (TILE_SIZE / 2); i += MP_NUM_THREADS_X) {
+		uint2 pos = uint2(i % (TILE_SIZE / 2), i / (TILE_SIZE / 2)) * 2;
+		float2 tpos = (blockStart + pos) * inputPt;
+		const float4 sr = tex2.GatherRed(sam, tpos);
+		const float4 sg = tex2.GatherGreen(sam, tpos);
+		const float4 sb = tex2.GatherBlue(sam, tpos);
+		const float4 sa = tex2.GatherAlpha(sam, tpos);
+
+		// w z
+		// x y
+		shSrc[pos.y][pos.x] = float4(sr.w, sg.w, sb.w, sa.w);
+		shSrc[pos.y][pos.x + 1] = float4(sr.z, sg.z, sb.z, sa.z);
+		shSrc[pos.y + 1][pos.x] = float4(sr.x, sg.x, sb.x, sa.x);
+		shSrc[pos.y + 1][pos.x + 1] = float4(sr.y, sg.y, sb.y, sa.y);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = (Rmp8x8(threadId.x) << 1) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
-	float2 inputPt = GetInputPt();
 
+	uint2 tilePos = gxy - blockStart;
 	float4 src[4][4];
 	[unroll]
-	for (uint i = 0; i < 3; i += 2) {
+	for (i = 0; i < 4; ++i) {
 		[unroll]
-		for (uint j = 0; j < 3; j += 2) {
-			float2 tpos = (gxy + uint2(i, j)) * inputPt;
-			const float4 sr = tex2.GatherRed(sam, tpos);
-			const float4 sg = tex2.GatherGreen(sam, tpos);
-			const float4 sb = tex2.GatherBlue(sam, tpos);
-			const float4 sa = tex2.GatherAlpha(sam, tpos);
-
-			// w z
-			// x y
-			src[i][j] = float4(sr.w, sg.w, sb.w, sa.w);
-			src[i][j + 1] = float4(sr.x, sg.x, sb.x, sa.x);
-			src[i + 1][j] = float4(sr.z, sg.z, sb.z, sa.z);
-			src[i + 1][j + 1] = float4(sr.y, sg.y, sb.y, sa.y);
+		for (j = 0; j < 4; ++j) {
+			src[i][j] = shSrc[tilePos.y + j][tilePos.x + i];
 		}
 	}
 
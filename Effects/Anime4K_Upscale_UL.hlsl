@@ -151,33 +151,46 @@ Texture2D conv2d_6_tf2;
 //!BLOCK_SIZE 16
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块和周围一圈像素，所有卷积核从这里读取
+groupshared float3 shSrc[TILE_SIZE][TILE_SIZE];
+
 void Pass1(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+	uint i, j;
+
+	// 每次 Gather 读取 2x2 个像素
+	for (i = threadId.x; i < (TILE_SIZE / 2) * (TILE_SIZE / 2); i += MP_NUM_THREADS_X) {
+		uint2 pos = uint2(i % (TILE_SIZE / 2), i / (TILE_SIZE / 2)) * 2;
+		float2 tpos = (blockStart + pos) * inputPt;
+		const float4 sr = INPUT.GatherRed(sam, tpos);
+		const float4 sg = INPUT.GatherGreen(sam, tpos);
+		const float4 sb = INPUT.GatherBlue(sam, tpos);
+
+		// w z
+		// x y
+		shSrc[pos.y][pos.x] = float3(sr.w, sg.w, sb.w);
+		shSrc[pos.y][pos.x + 1] = float3(sr.z, sg.z, sb.z);
+		shSrc[pos.y + 1][pos.x] = float3(sr.x, sg.x, sb.x);
+		shSrc[pos.y + 1][pos.x + 1] = float3(sr.y, sg.y, sb.y);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = (Rmp8x8(threadId.x) << 1) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	
-	uint i, j;
-
+	uint2 tilePos = gxy - blockStart;
 	float3 src[4][4];
 	[unroll]
-	for (i = 0; i <= 2; i += 2) {
+	for (i = 0; i < 4; ++i) {
 		[unroll]
-		for (j = 0; j <= 2; j += 2) {
-			float2 tpos = (gxy + uint2(i, j)) * inputPt;
-			const float4 sr = INPUT.GatherRed(sam, tpos);
-			const float4 sg = INPUT.GatherGreen(sam, tpos);
-			const float4 sb = INPUT.GatherBlue(sam, tpos);
-
-			// w z
-			// x y
-			src[i][j] = float3(sr.w, sg.w, sb.w);
-			src[i][j + 1] = float3(sr.x, sg.x, sb.x);
-			src[i + 1][j] = float3(sr.z, sg.z, sb.z);
-			src[i + 1][j + 1] = float3(sr.y, sg.y, sb.y);
+		for (j = 0; j < 4; ++j) {
+			src[i][j] = shSrc[tilePos.y + j][tilePos.x + i];
 		}
 	}
 
@@ -240,28 +253,47 @@ void Pass1(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 8
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shConv2d_tf[TILE_SIZE][TILE_SIZE];
+groupshared float4 shConv2d_tf1[TILE_SIZE][TILE_SIZE];
+groupshared float4 shConv2d_tf2[TILE_SIZE][TILE_SIZE];
+
 void Pass2(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shConv2d_tf[tilePos.y][tilePos.x] = conv2d_tf.SampleLevel(sam, tpos, 0);
+		shConv2d_tf1[tilePos.y][tilePos.x] = conv2d_tf1.SampleLevel(sam, tpos, 0);
+		shConv2d_tf2[tilePos.y][tilePos.x] = conv2d_tf2.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [ a, d, g ]
 	// [ b, e, h ]
 	// [ c, f, i ]
-	float4 a1 = conv2d_tf.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b1 = conv2d_tf.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c1 = conv2d_tf.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d1 = conv2d_tf.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e1 = conv2d_tf.SampleLevel(sam, pos, 0);
-	float4 f1 = conv2d_tf.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g1 = conv2d_tf.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h1 = conv2d_tf.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i1 = conv2d_tf.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a1 = shConv2d_tf[tilePos.y - 1][tilePos.x - 1];
+	float4 b1 = shConv2d_tf[tilePos.y][tilePos.x - 1];
+	float4 c1 = shConv2d_tf[tilePos.y + 1][tilePos.x - 1];
+	float4 d1 = shConv2d_tf[tilePos.y - 1][tilePos.x];
+	float4 e1 = shConv2d_tf[tilePos.y][tilePos.x];
+	float4 f1 = shConv2d_tf[tilePos.y + 1][tilePos.x];
+	float4 g1 = shConv2d_tf[tilePos.y - 1][tilePos.x + 1];
+	float4 h1 = shConv2d_tf[tilePos.y][tilePos.x + 1];
+	float4 i1 = shConv2d_tf[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na1 = max(-a1, 0);
 	float4 nb1 = max(-b1, 0);
@@ -283,15 +315,15 @@ void Pass2(uint2 blockStart, uint3 threadId) {
 	h1 = max(h1, 0);
 	i1 = max(i1, 0);
 
-	float4 a2 = conv2d_tf1.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b2 = conv2d_tf1.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c2 = conv2d_tf1.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d2 = conv2d_tf1.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e2 = conv2d_tf1.SampleLevel(sam, pos, 0);
-	float4 f2 = conv2d_tf1.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g2 = conv2d_tf1.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h2 = conv2d_tf1.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i2 = conv2d_tf1.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a2 = shConv2d_tf1[tilePos.y - 1][tilePos.x - 1];
+	float4 b2 = shConv2d_tf1[tilePos.y][tilePos.x - 1];
+	float4 c2 = shConv2d_tf1[tilePos.y + 1][tilePos.x - 1];
+	float4 d2 = shConv2d_tf1[tilePos.y - 1][tilePos.x];
+	float4 e2 = shConv2d_tf1[tilePos.y][tilePos.x];
+	float4 f2 = shConv2d_tf1[tilePos.y + 1][tilePos.x];
+	float4 g2 = shConv2d_tf1[tilePos.y - 1][tilePos.x + 1];
+	float4 h2 = shConv2d_tf1[tilePos.y][tilePos.x + 1];
+	float4 i2 = shConv2d_tf1[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na2 = max(-a2, 0);
 	float4 nb2 = max(-b2, 0);
@@ -313,15 +345,15 @@ void Pass2(uint2 blockStart, uint3 threadId) {
 	h2 = max(h2, 0);
 	i2 = max(i2, 0);
 
-	float4 a3 = conv2d_tf2.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b3 = conv2d_tf2.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c3 = conv2d_tf2.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d3 = conv2d_tf2.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e3 = conv2d_tf2.SampleLevel(sam, pos, 0);
-	float4 f3 = conv2d_tf2.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g3 = conv2d_tf2.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h3 = conv2d_tf2.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i3 = conv2d_tf2.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a3 = shConv2d_tf2[tilePos.y - 1][tilePos.x - 1];
+	float4 b3 = shConv2d_tf2[tilePos.y][tilePos.x - 1];
+	float4 c3 = shConv2d_tf2[tilePos.y + 1][tilePos.x - 1];
+	float4 d3 = shConv2d_tf2[tilePos.y - 1][tilePos.x];
+	float4 e3 = shConv2d_tf2[tilePos.y][tilePos.x];
+	float4 f3 = shConv2d_tf2[tilePos.y + 1][tilePos.x];
+	float4 g3 = shConv2d_tf2[tilePos.y - 1][tilePos.x + 1];
+	float4 h3 = shConv2d_tf2[tilePos.y][tilePos.x + 1];
+	float4 i3 = shConv2d_tf2[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na3 = max(-a3, 0);
 	float4 nb3 = max(-b3, 0);
@@ -522,28 +554,47 @@ void Pass2(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 8
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shConv2d_1_tf[TILE_SIZE][TILE_SIZE];
+groupshared float4 shConv2d_1_tf1[TILE_SIZE][TILE_SIZE];
+groupshared float4 shConv2d_1_tf2[TILE_SIZE][TILE_SIZE];
+
 void Pass3(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shConv2d_1_tf[tilePos.y][tilePos.x] = conv2d_1_tf.SampleLevel(sam, tpos, 0);
+		shConv2d_1_tf1[tilePos.y][tilePos.x] = conv2d_1_tf1.SampleLevel(sam, tpos, 0);
+		shConv2d_1_tf2[tilePos.y][tilePos.x] = conv2d_1_tf2.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [ a, d, g ]
 	// [ b, e, h ]
 	// [ c, f, i ]
-	float4 a1 = conv2d_1_tf.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b1 = conv2d_1_tf.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c1 = conv2d_1_tf.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d1 = conv2d_1_tf.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e1 = conv2d_1_tf.SampleLevel(sam, pos, 0);
-	float4 f1 = conv2d_1_tf.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g1 = conv2d_1_tf.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h1 = conv2d_1_tf.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i1 = conv2d_1_tf.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a1 = shConv2d_1_tf[tilePos.y - 1][tilePos.x - 1];
+	float4 b1 = shConv2d_1_tf[tilePos.y][tilePos.x - 1];
+	float4 c1 = shConv2d_1_tf[tilePos.y + 1][tilePos.x - 1];
+	float4 d1 = shConv2d_1_tf[tilePos.y - 1][tilePos.x];
+	float4 e1 = shConv2d_1_tf[tilePos.y][tilePos.x];
+	float4 f1 = shConv2d_1_tf[tilePos.y + 1][tilePos.x];
+	float4 g1 = shConv2d_1_tf[tilePos.y - 1][tilePos.x + 1];
+	float4 h1 = shConv2d_1_tf[tilePos.y][tilePos.x + 1];
+	float4 i1 = shConv2d_1_tf[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na1 = max(-a1, 0);
 	float4 nb1 = max(-b1, 0);
@@ -565,15 +616,15 @@ void Pass3(uint2 blockStart, uint3 threadId) {
 	h1 = max(h1, 0);
 	i1 = max(i1, 0);
 
-	float4 a2 = conv2d_1_tf1.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b2 = conv2d_1_tf1.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c2 = conv2d_1_tf1.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d2 = conv2d_1_tf1.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e2 = conv2d_1_tf1.SampleLevel(sam, pos, 0);
-	float4 f2 = conv2d_1_tf1.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g2 = conv2d_1_tf1.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h2 = conv2d_1_tf1.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i2 = conv2d_1_tf1.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a2 = shConv2d_1_tf1[tilePos.y - 1][tilePos.x - 1];
+	float4 b2 = shConv2d_1_tf1[tilePos.y][tilePos.x - 1];
+	float4 c2 = shConv2d_1_tf1[tilePos.y + 1][tilePos.x - 1];
+	float4 d2 = shConv2d_1_tf1[tilePos.y - 1][tilePos.x];
+	float4 e2 = shConv2d_1_tf1[tilePos.y][tilePos.x];
+	float4 f2 = shConv2d_1_tf1[tilePos.y + 1][tilePos.x];
+	float4 g2 = shConv2d_1_tf1[tilePos.y - 1][tilePos.x + 1];
+	float4 h2 = shConv2d_1_tf1[tilePos.y][tilePos.x + 1];
+	float4 i2 = shConv2d_1_tf1[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na2 = max(-a2, 0);
 	float4 nb2 = max(-b2, 0);
@@ -595,15 +646,15 @@ void Pass3(uint2 blockStart, uint3 threadId) {
 	h2 = max(h2, 0);
 	i2 = max(i2, 0);
 
-	float4 a3 = conv2d_1_tf2.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b3 = conv2d_1_tf2.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c3 = conv2d_1_tf2.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d3 = conv2d_1_tf2.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e3 = conv2d_1_tf2.SampleLevel(sam, pos, 0);
-	float4 f3 = conv2d_1_tf2.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g3 = conv2d_1_tf2.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h3 = conv2d_1_tf2.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i3 = conv2d_1_tf2.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a3 = shConv2d_1_tf2[tilePos.y - 1][tilePos.x - 1];
+	float4 b3 = shConv2d_1_tf2[tilePos.y][tilePos.x - 1];
+	float4 c3 = shConv2d_1_tf2[tilePos.y + 1][tilePos.x - 1];
+	float4 d3 = shConv2d_1_tf2[tilePos.y - 1][tilePos.x];
+	float4 e3 = shConv2d_1_tf2[tilePos.y][tilePos.x];
+	float4 f3 = shConv2d_1_tf2[tilePos.y + 1][tilePos.x];
+	float4 g3 = shConv2d_1_tf2[tilePos.y - 1][tilePos.x + 1];
+	float4 h3 = shConv2d_1_tf2[tilePos.y][tilePos.x + 1];
+	float4 i3 = shConv2d_1_tf2[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na3 = max(-a3, 0);
 	float4 nb3 = max(-b3, 0);
@@ -804,28 +855,47 @@ void Pass3(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 8
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shConv2d_2_tf[TILE_SIZE][TILE_SIZE];
+groupshared float4 shConv2d_2_tf1[TILE_SIZE][TILE_SIZE];
+groupshared float4 shConv2d_2_tf2[TILE_SIZE][TILE_SIZE];
+
 void Pass4(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shConv2d_2_tf[tilePos.y][tilePos.x] = conv2d_2_tf.SampleLevel(sam, tpos, 0);
+		shConv2d_2_tf1[tilePos.y][tilePos.x] = conv2d_2_tf1.SampleLevel(sam, tpos, 0);
+		shConv2d_2_tf2[tilePos.y][tilePos.x] = conv2d_2_tf2.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [ a, d, g ]
 	// [ b, e, h ]
 	// [ c, f, i ]
-	float4 a1 = conv2d_2_tf.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b1 = conv2d_2_tf.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c1 = conv2d_2_tf.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d1 = conv2d_2_tf.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e1 = conv2d_2_tf.SampleLevel(sam, pos, 0);
-	float4 f1 = conv2d_2_tf.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g1 = conv2d_2_tf.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h1 = conv2d_2_tf.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i1 = conv2d_2_tf.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a1 = shConv2d_2_tf[tilePos.y - 1][tilePos.x - 1];
+	float4 b1 = shConv2d_2_tf[tilePos.y][tilePos.x - 1];
+	float4 c1 = shConv2d_2_tf[tilePos.y + 1][tilePos.x - 1];
+	float4 d1 = shConv2d_2_tf[tilePos.y - 1][tilePos.x];
+	float4 e1 = shConv2d_2_tf[tilePos.y][tilePos.x];
+	float4 f1 = shConv2d_2_tf[tilePos.y + 1][tilePos.x];
+	float4 g1 = shConv2d_2_tf[tilePos.y - 1][tilePos.x + 1];
+	float4 h1 = shConv2d_2_tf[tilePos.y][tilePos.x + 1];
+	float4 i1 = shConv2d_2_tf[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na1 = max(-a1, 0);
 	float4 nb1 = max(-b1, 0);
@@ -847,15 +917,15 @@ void Pass4(uint2 blockStart, uint3 threadId) {
 	h1 = max(h1, 0);
 	i1 = max(i1, 0);
 
-	float4 a2 = conv2d_2_tf1.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b2 = conv2d_2_tf1.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c2 = conv2d_2_tf1.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d2 = conv2d_2_tf1.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e2 = conv2d_2_tf1.SampleLevel(sam, pos, 0);
-	float4 f2 = conv2d_2_tf1.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g2 = conv2d_2_tf1.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h2 = conv2d_2_tf1.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i2 = conv2d_2_tf1.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a2 = shConv2d_2_tf1[tilePos.y - 1][tilePos.x - 1];
+	float4 b2 = shConv2d_2_tf1[tilePos.y][tilePos.x - 1];
+	float4 c2 = shConv2d_2_tf1[tilePos.y + 1][tilePos.x - 1];
+	float4 d2 = shConv2d_2_tf1[tilePos.y - 1][tilePos.x];
+	float4 e2 = shConv2d_2_tf1[tilePos.y][tilePos.x];
+	float4 f2 = shConv2d_2_tf1[tilePos.y + 1][tilePos.x];
+	float4 g2 = shConv2d_2_tf1[tilePos.y - 1][tilePos.x + 1];
+	float4 h2 = shConv2d_2_tf1[tilePos.y][tilePos.x + 1];
+	float4 i2 = shConv2d_2_tf1[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na2 = max(-a2, 0);
 	float4 nb2 = max(-b2, 0);
@@ -877,15 +947,15 @@ void Pass4(uint2 blockStart, uint3 threadId) {
 	h2 = max(h2, 0);
 	i2 = max(i2, 0);
 
-	float4 a3 = conv2d_2_tf2.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b3 = conv2d_2_tf2.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c3 = conv2d_2_tf2.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d3 = conv2d_2_tf2.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e3 = conv2d_2_tf2.SampleLevel(sam, pos, 0);
-	float4 f3 = conv2d_2_tf2.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g3 = conv2d_2_tf2.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h3 = conv2d_2_tf2.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i3 = conv2d_2_tf2.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a3 = shConv2d_2_tf2[tilePos.y - 1][tilePos.x - 1];
+	float4 b3 = shConv2d_2_tf2[tilePos.y][tilePos.x - 1];
+	float4 c3 = shConv2d_2_tf2[tilePos.y + 1][tilePos.x - 1];
+	float4 d3 = shConv2d_2_tf2[tilePos.y - 1][tilePos.x];
+	float4 e3 = shConv2d_2_tf2[tilePos.y][tilePos.x];
+	float4 f3 = shConv2d_2_tf2[tilePos.y + 1][tilePos.x];
+	float4 g3 = shConv2d_2_tf2[tilePos.y - 1][tilePos.x + 1];
+	float4 h3 = shConv2d_2_tf2[tilePos.y][tilePos.x + 1];
+	float4 i3 = shConv2d_2_tf2[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na3 = max(-a3, 0);
 	float4 nb3 = max(-b3, 0);
@@ -1086,28 +1156,47 @@ void Pass4(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 8
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shConv2d_3_tf[TILE_SIZE][TILE_SIZE];
+groupshared float4 shConv2d_3_tf1[TILE_SIZE][TILE_SIZE];
+groupshared float4 shConv2d_3_tf2[TILE_SIZE][TILE_SIZE];
+
 void Pass5(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shConv2d_3_tf[tilePos.y][tilePos.x] = conv2d_3_tf.SampleLevel(sam, tpos, 0);
+		shConv2d_3_tf1[tilePos.y][tilePos.x] = conv2d_3_tf1.SampleLevel(sam, tpos, 0);
+		shConv2d_3_tf2[tilePos.y][tilePos.x] = conv2d_3_tf2.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [ a, d, g ]
 	// [ b, e, h ]
 	// [ c, f, i ]
-	float4 a1 = conv2d_3_tf.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b1 = conv2d_3_tf.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c1 = conv2d_3_tf.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d1 = conv2d_3_tf.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e1 = conv2d_3_tf.SampleLevel(sam, pos, 0);
-	float4 f1 = conv2d_3_tf.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g1 = conv2d_3_tf.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h1 = conv2d_3_tf.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i1 = conv2d_3_tf.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a1 = shConv2d_3_tf[tilePos.y - 1][tilePos.x - 1];
+	float4 b1 = shConv2d_3_tf[tilePos.y][tilePos.x - 1];
+	float4 c1 = shConv2d_3_tf[tilePos.y + 1][tilePos.x - 1];
+	float4 d1 = shConv2d_3_tf[tilePos.y - 1][tilePos.x];
+	float4 e1 = shConv2d_3_tf[tilePos.y][tilePos.x];
+	float4 f1 = shConv2d_3_tf[tilePos.y + 1][tilePos.x];
+	float4 g1 = shConv2d_3_tf[tilePos.y - 1][tilePos.x + 1];
+	float4 h1 = shConv2d_3_tf[tilePos.y][tilePos.x + 1];
+	float4 i1 = shConv2d_3_tf[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na1 = max(-a1, 0);
 	float4 nb1 = max(-b1, 0);
@@ -1129,15 +1218,15 @@ void Pass5(uint2 blockStart, uint3 threadId) {
 	h1 = max(h1, 0);
 	i1 = max(i1, 0);
 
-	float4 a2 = conv2d_3_tf1.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b2 = conv2d_3_tf1.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c2 = conv2d_3_tf1.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d2 = conv2d_3_tf1.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e2 = conv2d_3_tf1.SampleLevel(sam, pos, 0);
-	float4 f2 = conv2d_3_tf1.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g2 = conv2d_3_tf1.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h2 = conv2d_3_tf1.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i2 = conv2d_3_tf1.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a2 = shConv2d_3_tf1[tilePos.y - 1][tilePos.x - 1];
+	float4 b2 = shConv2d_3_tf1[tilePos.y][tilePos.x - 1];
+	float4 c2 = shConv2d_3_tf1[tilePos.y + 1][tilePos.x - 1];
+	float4 d2 = shConv2d_3_tf1[tilePos.y - 1][tilePos.x];
+	float4 e2 = shConv2d_3_tf1[tilePos.y][tilePos.x];
+	float4 f2 = shConv2d_3_tf1[tilePos.y + 1][tilePos.x];
+	float4 g2 = shConv2d_3_tf1[tilePos.y - 1][tilePos.x + 1];
+	float4 h2 = shConv2d_3_tf1[tilePos.y][tilePos.x + 1];
+	float4 i2 = shConv2d_3_tf1[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na2 = max(-a2, 0);
 	float4 nb2 = max(-b2, 0);
@@ -1159,15 +1248,15 @@ void Pass5(uint2 blockStart, uint3 threadId) {
 	h2 = max(h2, 0);
 	i2 = max(i2, 0);
 
-	float4 a3 = conv2d_3_tf2.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b3 = conv2d_3_tf2.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c3 = conv2d_3_tf2.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d3 = conv2d_3_tf2.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e3 = conv2d_3_tf2.SampleLevel(sam, pos, 0);
-	float4 f3 = conv2d_3_tf2.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g3 = conv2d_3_tf2.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h3 = conv2d_3_tf2.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i3 = conv2d_3_tf2.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a3 = shConv2d_3_tf2[tilePos.y - 1][tilePos.x - 1];
+	float4 b3 = shConv2d_3_tf2[tilePos.y][tilePos.x - 1];
+	float4 c3 = shConv2d_3_tf2[tilePos.y + 1][tilePos.x - 1];
+	float4 d3 = shConv2d_3_tf2[tilePos.y - 1][tilePos.x];
+	float4 e3 = shConv2d_3_tf2[tilePos.y][tilePos.x];
+	float4 f3 = shConv2d_3_tf2[tilePos.y + 1][tilePos.x];
+	float4 g3 = shConv2d_3_tf2[tilePos.y - 1][tilePos.x + 1];
+	float4 h3 = shConv2d_3_tf2[tilePos.y][tilePos.x + 1];
+	float4 i3 = shConv2d_3_tf2[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na3 = max(-a3, 0);
 	float4 nb3 = max(-b3, 0);
@@ -1368,28 +1457,47 @@ void Pass5(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 8
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shConv2d_4_tf[TILE_SIZE][TILE_SIZE];
+groupshared float4 shConv2d_4_tf1[TILE_SIZE][TILE_SIZE];
+groupshared float4 shConv2d_4_tf2[TILE_SIZE][TILE_SIZE];
+
 void Pass6(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shConv2d_4_tf[tilePos.y][tilePos.x] = conv2d_4_tf.SampleLevel(sam, tpos, 0);
+		shConv2d_4_tf1[tilePos.y][tilePos.x] = conv2d_4_tf1.SampleLevel(sam, tpos, 0);
+		shConv2d_4_tf2[tilePos.y][tilePos.x] = conv2d_4_tf2.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [ a, d, g ]
 	// [ b, e, h ]
 	// [ c, f, i ]
-	float4 a1 = conv2d_4_tf.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b1 = conv2d_4_tf.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c1 = conv2d_4_tf.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d1 = conv2d_4_tf.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e1 = conv2d_4_tf.SampleLevel(sam, pos, 0);
-	float4 f1 = conv2d_4_tf.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g1 = conv2d_4_tf.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h1 = conv2d_4_tf.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i1 = conv2d_4_tf.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a1 = shConv2d_4_tf[tilePos.y - 1][tilePos.x - 1];
+	float4 b1 = shConv2d_4_tf[tilePos.y][tilePos.x - 1];
+	float4 c1 = shConv2d_4_tf[tilePos.y + 1][tilePos.x - 1];
+	float4 d1 = shConv2d_4_tf[tilePos.y - 1][tilePos.x];
+	float4 e1 = shConv2d_4_tf[tilePos.y][tilePos.x];
+	float4 f1 = shConv2d_4_tf[tilePos.y + 1][tilePos.x];
+	float4 g1 = shConv2d_4_tf[tilePos.y - 1][tilePos.x + 1];
+	float4 h1 = shConv2d_4_tf[tilePos.y][tilePos.x + 1];
+	float4 i1 = shConv2d_4_tf[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na1 = max(-a1, 0);
 	float4 nb1 = max(-b1, 0);
@@ -1411,15 +1519,15 @@ void Pass6(uint2 blockStart, uint3 threadId) {
 	h1 = max(h1, 0);
 	i1 = max(i1, 0);
 
-	float4 a2 = conv2d_4_tf1.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b2 = conv2d_4_tf1.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c2 = conv2d_4_tf1.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d2 = conv2d_4_tf1.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e2 = conv2d_4_tf1.SampleLevel(sam, pos, 0);
-	float4 f2 = conv2d_4_tf1.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g2 = conv2d_4_tf1.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h2 = conv2d_4_tf1.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i2 = conv2d_4_tf1.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a2 = shConv2d_4_tf1[tilePos.y - 1][tilePos.x - 1];
+	float4 b2 = shConv2d_4_tf1[tilePos.y][tilePos.x - 1];
+	float4 c2 = shConv2d_4_tf1[tilePos.y + 1][tilePos.x - 1];
+	float4 d2 = shConv2d_4_tf1[tilePos.y - 1][tilePos.x];
+	float4 e2 = shConv2d_4_tf1[tilePos.y][tilePos.x];
+	float4 f2 = shConv2d_4_tf1[tilePos.y + 1][tilePos.x];
+	float4 g2 = shConv2d_4_tf1[tilePos.y - 1][tilePos.x + 1];
+	float4 h2 = shConv2d_4_tf1[tilePos.y][tilePos.x + 1];
+	float4 i2 = shConv2d_4_tf1[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na2 = max(-a2, 0);
 	float4 nb2 = max(-b2, 0);
@@ -1441,15 +1549,15 @@ void Pass6(uint2 blockStart, uint3 threadId) {
 	h2 = max(h2, 0);
 	i2 = max(i2, 0);
 
-	float4 a3 = conv2d_4_tf2.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b3 = conv2d_4_tf2.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c3 = conv2d_4_tf2.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d3 = conv2d_4_tf2.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e3 = conv2d_4_tf2.SampleLevel(sam, pos, 0);
-	float4 f3 = conv2d_4_tf2.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g3 = conv2d_4_tf2.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h3 = conv2d_4_tf2.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i3 = conv2d_4_tf2.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a3 = shConv2d_4_tf2[tilePos.y - 1][tilePos.x - 1];
+	float4 b3 = shConv2d_4_tf2[tilePos.y][tilePos.x - 1];
+	float4 c3 = shConv2d_4_tf2[tilePos.y + 1][tilePos.x - 1];
+	float4 d3 = shConv2d_4_tf2[tilePos.y - 1][tilePos.x];
+	float4 e3 = shConv2d_4_tf2[tilePos.y][tilePos.x];
+	float4 f3 = shConv2d_4_tf2[tilePos.y + 1][tilePos.x];
+	float4 g3 = shConv2d_4_tf2[tilePos.y - 1][tilePos.x + 1];
+	float4 h3 = shConv2d_4_tf2[tilePos.y][tilePos.x + 1];
+	float4 i3 = shConv2d_4_tf2[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na3 = max(-a3, 0);
 	float4 nb3 = max(-b3, 0);
@@ -1650,28 +1758,47 @@ void Pass6(uint2 blockStart, uint3 threadId) {
 //!BLOCK_SIZE 8
 //!NUM_THREADS 64
 
+#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行
+groupshared float4 shConv2d_5_tf[TILE_SIZE][TILE_SIZE];
+groupshared float4 shConv2d_5_tf1[TILE_SIZE][TILE_SIZE];
+groupshared float4 shConv2d_5_tf2[TILE_SIZE][TILE_SIZE];
+
 void Pass7(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint i = threadId.x; i < TILE_SIZE * TILE_SIZE; i += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2(i % TILE_SIZE, i / TILE_SIZE);
+		float2 tpos = (blockStart + tilePos - 0.5f) * inputPt;
+		shConv2d_5_tf[tilePos.y][tilePos.x] = conv2d_5_tf.SampleLevel(sam, tpos, 0);
+		shConv2d_5_tf1[tilePos.y][tilePos.x] = conv2d_5_tf1.SampleLevel(sam, tpos, 0);
+		shConv2d_5_tf2[tilePos.y][tilePos.x] = conv2d_5_tf2.SampleLevel(sam, tpos, 0);
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
 	uint2 gxy = Rmp8x8(threadId.x) + blockStart;
 	uint2 inputSize = GetInputSize();
 	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
 		return;
 	}
 
-	float2 inputPt = GetInputPt();
-	float2 pos = (gxy + 0.5f) * inputPt;
+	uint2 tilePos = gxy - blockStart + 1;
 
 	// [ a, d, g ]
 	// [ b, e, h ]
 	// [ c, f, i ]
-	float4 a1 = conv2d_5_tf.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b1 = conv2d_5_tf.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c1 = conv2d_5_tf.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d1 = conv2d_5_tf.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e1 = conv2d_5_tf.SampleLevel(sam, pos, 0);
-	float4 f1 = conv2d_5_tf.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g1 = conv2d_5_tf.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h1 = conv2d_5_tf.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i1 = conv2d_5_tf.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a1 = shConv2d_5_tf[tilePos.y - 1][tilePos.x - 1];
+	float4 b1 = shConv2d_5_tf[tilePos.y][tilePos.x - 1];
+	float4 c1 = shConv2d_5_tf[tilePos.y + 1][tilePos.x - 1];
+	float4 d1 = shConv2d_5_tf[tilePos.y - 1][tilePos.x];
+	float4 e1 = shConv2d_5_tf[tilePos.y][tilePos.x];
+	float4 f1 = shConv2d_5_tf[tilePos.y + 1][tilePos.x];
+	float4 g1 = shConv2d_5_tf[tilePos.y - 1][tilePos.x + 1];
+	float4 h1 = shConv2d_5_tf[tilePos.y][tilePos.x + 1];
+	float4 i1 = shConv2d_5_tf[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na1 = max(-a1, 0);
 	float4 nb1 = max(-b1, 0);
@@ -1693,15 +1820,15 @@ void Pass7(uint2 blockStart, uint3 threadId) {
 	h1 = max(h1, 0);
 	i1 = max(i1, 0);
 
-	float4 a2 = conv2d_5_tf1.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b2 = conv2d_5_tf1.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c2 = conv2d_5_tf1.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d2 = conv2d_5_tf1.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e2 = conv2d_5_tf1.SampleLevel(sam, pos, 0);
-	float4 f2 = conv2d_5_tf1.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g2 = conv2d_5_tf1.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h2 = conv2d_5_tf1.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i2 = conv2d_5_tf1.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a2 = shConv2d_5_tf1[tilePos.y - 1][tilePos.x - 1];
+	float4 b2 = shConv2d_5_tf1[tilePos.y][tilePos.x - 1];
+	float4 c2 = shConv2d_5_tf1[tilePos.y + 1][tilePos.x - 1];
+	float4 d2 = shConv2d_5_tf1[tilePos.y - 1][tilePos.x];
+	float4 e2 = shConv2d_5_tf1[tilePos.y][tilePos.x];
+	float4 f2 = shConv2d_5_tf1[tilePos.y + 1][tilePos.x];
+	float4 g2 = shConv2d_5_tf1[tilePos.y - 1][tilePos.x + 1];
+	float4 h2 = shConv2d_5_tf1[tilePos.y][tilePos.x + 1];
+	float4 i2 = shConv2d_5_tf1[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na2 = max(-a2, 0);
 	float4 nb2 = max(-b2, 0);
@@ -1723,15 +1850,15 @@ void Pass7(uint2 blockStart, uint3 threadId) {
 	h2 = max(h2, 0);
 	i2 = max(i2, 0);
 
-	float4 a3 = conv2d_5_tf2.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
-	float4 b3 = conv2d_5_tf2.SampleLevel(sam, pos + float2(-inputPt.x, 0), 0);
-	float4 c3 = conv2d_5_tf2.SampleLevel(sam, pos + float2(-inputPt.x, inputPt.y), 0);
-	float4 d3 = conv2d_5_tf2.SampleLevel(sam, pos + float2(0, -inputPt.y), 0);
-	float4 e3 = conv2d_5_tf2.SampleLevel(sam, pos, 0);
-	float4 f3 = conv2d_5_tf2.SampleLevel(sam, pos + float2(0, inputPt.y), 0);
-	float4 g3 = conv2d_5_tf2.SampleLevel(sam, pos + float2(inputPt.x, -inputPt.y), 0);
-	float4 h3 = conv2d_5_tf2.SampleLevel(sam, pos + float2(inputPt.x, 0), 0);
-	float4 i3 = conv2d_5_tf2.SampleLevel(sam, pos + float2(inputPt.x, inputPt.y), 0);
+	float4 a3 = shConv2d_5_tf2[tilePos.y - 1][tilePos.x - 1];
+	float4 b3 = shConv2d_5_tf2[tilePos.y][tilePos.x - 1];
+	float4 c3 = shConv2d_5_tf2[tilePos.y + 1][tilePos.x - 1];
+	float4 d3 = shConv2d_5_tf2[tilePos.y - 1][tilePos.x];
+	float4 e3 = shConv2d_5_tf2[tilePos.y][tilePos.x];
+	float4 f3 = shConv2d_5_tf2[tilePos.y + 1][tilePos.x];
+	float4 g3 = shConv2d_5_tf2[tilePos.y - 1][tilePos.x + 1];
+	float4 h3 = shConv2d_5_tf2[tilePos.y][tilePos.x + 1];
+	float4 i3 = shConv2d_5_tf2[tilePos.y + 1][tilePos.x + 1];
 
 	float4 na3 = max(-a3, 0);
 	float4 nb3 = max(-b3, 0);
@@ -50,7 +50,8 @@ namespace Magpie {
 			DisableEffectCache = 0x400,
 			DisableVSync = 0x800,
 			WarningsAreErrors = 0x1000,
-			ShowFPS = 0x2000
+			ShowFPS = 0x2000,
+			DisableEffectFusion = 0x4000
 		}
 
 		private readonly MagWindowParams magWindowParams = new();
@@ -14,6 +14,7 @@
 #include "Config.h"
 #include "StrUtils.h"
 #include "WindowsMessages.h"
+#include "EffectCacheManager.h"
 
 
 static constexpr const wchar_t* HOST_WINDOW_CLASS_NAME = L"Window_Magpie_967EB565-6F73-4E94-AE53-00CC42592A22";
@@ -434,6 +435,9 @@ LRESULT App::_HostWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 }
 
 void App::_OnQuit() {
+	// 确保编译的效果已写入缓存
+	EffectCacheManager::Get().Flush();
+
 	// 释放资源
 	_cursorManager = nullptr;
 	_renderer = nullptr;
@@ -17,7 +17,8 @@ enum class FlagMasks : UINT {
 	DisableEffectCache = 0x400,
 	DisableVSync = 0x800,
 	WarningsAreErrors = 0x1000,
-	ShowFPS = 0x2000
+	ShowFPS = 0x2000,
+	DisableEffectFusion = 0x4000
 };
 
 
@@ -28,20 +29,7 @@ bool Config::Initialize(float cursorZoomFactor, UINT cursorInterpolationMode, in
 	_multiMonitorUsage = multiMonitorUsage;
 	_cropBorders = cropBorders;
 
-	_isNoCursor = flags & (UINT)FlagMasks::NoCursor;
-	_isAdjustCursorSpeed = flags & (UINT)FlagMasks::AdjustCursorSpeed;
-	_isSaveEffectSources = flags & (UINT)FlagMasks::SaveEffectSources;
-	_isSimulateExclusiveFullscreen = flags & (UINT)FlagMasks::SimulateExclusiveFullscreen;
-	_isDisableLowLatency = flags & (UINT)FlagMasks::DisableLowLatency;
-	_isBreakpointMode = flags & (UINT)FlagMasks::BreakpointMode;
-	_isDisableWindowResizing = flags & (UINT)FlagMasks::DisableWindowResizing;
-	_isDisableDirectFlip = flags & (UINT)FlagMasks::DisableDirectFlip;
-	_is3DMode = flags & (UINT)FlagMasks::Is3DMode;
-	_isCropTitleBarOfUWP = flags & (UINT)FlagMasks::CropTitleBarOfUWP;
-	_isDisableEffectCache = flags & (UINT)FlagMasks::DisableEffectCache;
-	_isDisableVSync = flags & (UINT)FlagMasks::DisableVSync;
-	_isTreatWarningsAsErrors = flags & (UINT)FlagMasks::WarningsAreErrors;
-	_isShowFPS = flags & (UINT)FlagMasks::ShowFPS;
+	InitializeFlags(flags);
 
 	Logger::Get().Info(fmt::format(R"(运行时配置:
 	IsAdjustCursorSpeed: {}
@@ -55,6 +43,7 @@ bool Config::Initialize(float cursorZoomFactor, UINT cursorInterpolationMode, in
 	GetMultiMonitorUsage: {}
 	IsNoCursor: {}
 	IsDisableEffectCache: {}
+	IsDisableEffectFusion: {}
 	IsDisableVSync: {}
 	IsSimulateExclusiveFullscreen: {}
 	CursorInterpolationMode: {}
@@ -71,6 +60,7 @@ bool Config::Initialize(float cursorZoomFactor, UINT cursorInterpolationMode, in
 		GetMultiMonitorUsage(),
 		IsNoCursor(),
 		IsDisableEffectCache(),
+		IsDisableEffectFusion(),
 		IsDisableVSync(),
 		IsSimulateExclusiveFullscreen(),
 		GetCursorInterpolationMode(),
@@ -81,6 +71,24 @@ bool Config::Initialize(float cursorZoomFactor, UINT cursorInterpolationMode, in
 	return true;
 }
 
+void Config::InitializeFlags(UINT flags) noexcept {
+	_isNoCursor = flags & (UINT)FlagMasks::NoCursor;
+	_isAdjustCursorSpeed = flags & (UINT)FlagMasks::AdjustCursorSpeed;
+	_isSaveEffectSources = flags & (UINT)FlagMasks::SaveEffectSources;
+	_isSimulateExclusiveFullscreen = flags & (UINT)FlagMasks::SimulateExclusiveFullscreen;
+	_isDisableLowLatency = flags & (UINT)FlagMasks::DisableLowLatency;
+	_isBreakpointMode = flags & (UINT)FlagMasks::BreakpointMode;
+	_isDisableWindowResizing = flags & (UINT)FlagMasks::DisableWindowResizing;
+	_isDisableDirectFlip = flags & (UINT)FlagMasks::DisableDirectFlip;
+	_is3DMode = flags & (UINT)FlagMasks::Is3DMode;
+	_isCropTitleBarOfUWP = flags & (UINT)FlagMasks::CropTitleBarOfUWP;
+	_isDisableEffectCache = flags & (UINT)FlagMasks::DisableEffectCache;
+	_isDisableVSync = flags & (UINT)FlagMasks::DisableVSync;
+	_isTreatWarningsAsErrors = flags & (UINT)FlagMasks::WarningsAreErrors;
+	_isShowFPS = flags & (UINT)FlagMasks::ShowFPS;
+	_isDisableEffectFusion = flags & (UINT)FlagMasks::DisableEffectFusion;
+}
+
 void Config::SetShowFPS(bool value) noexcept {
 	if (value == _isShowFPS) {
 		return;
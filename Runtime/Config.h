@@ -20,6 +20,9 @@ public:
 		UINT flags
 	);
 
+	// 只解析标志位，用于不运行 App 时（如预编译）
+	void InitializeFlags(UINT flags) noexcept;
+
 	float GetCursorZoomFactor() const noexcept {
 		return _cursorZoomFactor;
 	}
@@ -96,6 +99,10 @@ public:
 		return _isTreatWarningsAsErrors;
 	}
 
+	bool IsDisableEffectFusion() const noexcept {
+		return _isDisableEffectFusion;
+	}
+
 	bool IsShowFPS() const noexcept {
 		return _isShowFPS;
 	}
@@ -132,6 +139,7 @@ private:
 	bool _isDisableEffectCache = false;
 	bool _isSaveEffectSources = false;
 	bool _isTreatWarningsAsErrors = false;
+	bool _isDisableEffectFusion = false;
 
 	std::vector<std::function<void()>> _showFPSCbs;
 
@@ -0,0 +1,199 @@
+#include "pch.h"
+#include "D3D11EffectBackend.h"
+#include "App.h"
+#include "DeviceResources.h"
+#include "CursorManager.h"
+#include "TextureLoader.h"
+#include "Logger.h"
+
+
+class D3D11Texture : public EffectBackend::Texture {
+public:
+	explicit D3D11Texture(winrt::com_ptr<ID3D11Texture2D> texture) : texture(std::move(texture)) {}
+
+	winrt::com_ptr<ID3D11Texture2D> texture;
+};
+
+class D3D11ComputeShader : public EffectBackend::ComputeShader {
+public:
+	winrt::com_ptr<ID3D11ComputeShader> shader;
+};
+
+class D3D11ConstantBuffer : public EffectBackend::ConstantBuffer {
+public:
+	winrt::com_ptr<ID3D11Buffer> buffer;
+};
+
+// 视图和采样器的句柄即为 D3D11 对象，由 DeviceResources 缓存
+static ID3D11Texture2D* ToD3D(EffectBackend::Texture* texture) noexcept {
+	return static_cast<D3D11Texture*>(texture)->texture.get();
+}
+
+static EffectBackend::ShaderResourceView* FromD3D(ID3D11ShaderResourceView* srv) noexcept {
+	return reinterpret_cast<EffectBackend::ShaderResourceView*>(srv);
+}
+
+static EffectBackend::UnorderedAccessView* FromD3D(ID3D11UnorderedAccessView* uav) noexcept {
+	return reinterpret_cast<EffectBackend::UnorderedAccessView*>(uav);
+}
+
+static EffectBackend::Sampler* FromD3D(ID3D11SamplerState* sampler) noexcept {
+	return reinterpret_cast<EffectBackend::Sampler*>(sampler);
+}
+
+std::shared_ptr<EffectBackend::Texture> D3D11EffectBackend::WrapTexture(ID3D11Texture2D* texture) {
+	winrt::com_ptr<ID3D11Texture2D> t;
+	t.copy_from(texture);
+	return std::make_shared<D3D11Texture>(std::move(t));
+}
+
+std::shared_ptr<EffectBackend::Texture> D3D11EffectBackend::CreateTexture(EffectIntermediateTextureFormat format, SIZE size) {
+	winrt::com_ptr<ID3D11Texture2D> texture = App::Get().GetDeviceResources().CreateTexture2D(
+		EffectIntermediateTextureDesc::FORMAT_DESCS[(UINT)format].dxgiFormat,
+		size.cx,
+		size.cy,
+		D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS
+	);
+	if (!texture) {
+		return nullptr;
+	}
+
+	return std::make_shared<D3D11Texture>(std::move(texture));
+}
+
+std::shared_ptr<EffectBackend::Texture> D3D11EffectBackend::LoadTexture(const wchar_t* fileName, EffectIntermediateTextureFormat format) {
+	winrt::com_ptr<ID3D11Texture2D> texture = TextureLoader::Load(fileName);
+	if (!texture) {
+		return nullptr;
+	}
+
+	if (format != EffectIntermediateTextureFormat::UNKNOWN) {
+		// 检查纹理格式是否匹配
+		D3D11_TEXTURE2D_DESC desc{};
+		texture->GetDesc(&desc);
+		if (desc.Format != EffectIntermediateTextureDesc::FORMAT_DESCS[(UINT)format].dxgiFormat) {
+			Logger::Get().Error("SOURCE 纹理格式不匹配");
+			return nullptr;
+		}
+	}
+
+	return std::make_shared<D3D11Texture>(std::move(texture));
+}
+
+std::shared_ptr<EffectBackend::Texture> D3D11EffectBackend::GetBackBuffer() {
+	return WrapTexture(App::Get().GetDeviceResources().GetBackBuffer());
+}
+
+EffectBackend::ShaderResourceView* D3D11EffectBackend::GetCursorShaderResourceView() {
+	CursorManager& cm = App::Get().GetCursorManager();
+	if (!cm.HasCursor()) {
+		return nullptr;
+	}
+
+	ID3D11Texture2D* cursorTex;
+	CursorManager::CursorType ct;
+	if (!cm.GetCursorTexture(&cursorTex, ct)) {
+		Logger::Get().Error("GetCursorTexture 出错");
+		return nullptr;
+	}
+
+	ID3D11ShaderResourceView* srv = nullptr;
+	if (!App::Get().GetDeviceResources().GetShaderResourceView(cursorTex, &srv)) {
+		Logger::Get().Error("GetShaderResourceView 出错");
+		return nullptr;
+	}
+
+	return FromD3D(srv);
+}
+
+EffectBackend::ShaderResourceView* D3D11EffectBackend::GetShaderResourceView(Texture* texture) {
+	ID3D11ShaderResourceView* srv = nullptr;
+	if (!App::Get().GetDeviceResources().GetShaderResourceView(ToD3D(texture), &srv)) {
+		return nullptr;
+	}
+	return FromD3D(srv);
+}
+
+EffectBackend::UnorderedAccessView* D3D11EffectBackend::GetUnorderedAccessView(Texture* texture) {
+	ID3D11UnorderedAccessView* uav = nullptr;
+	if (!App::Get().GetDeviceResources().GetUnorderedAccessView(ToD3D(texture), &uav)) {
+		return nullptr;
+	}
+	return FromD3D(uav);
+}
+
+EffectBackend::Sampler* D3D11EffectBackend::GetSampler(EffectSamplerFilterType filterType, EffectSamplerAddressType addressType) {
+	ID3D11SamplerState* sampler = nullptr;
+	if (!App::Get().GetDeviceResources().GetSampler(
+		filterType == EffectSamplerFilterType::Linear ? D3D11_FILTER_MIN_MAG_MIP_LINEAR : D3D11_FILTER_MIN_MAG_MIP_POINT,
+		addressType == EffectSamplerAddressType::Clamp ? D3D11_TEXTURE_ADDRESS_CLAMP : D3D11_TEXTURE_ADDRESS_WRAP,
+		&sampler)
+	) {
+		return nullptr;
+	}
+	return FromD3D(sampler);
+}
+
+std::unique_ptr<EffectBackend::ComputeShader> D3D11EffectBackend::CreateComputeShader(std::span<const BYTE> bytecode) {
+	auto result = std::make_unique<D3D11ComputeShader>();
+
+	HRESULT hr = App::Get().GetDeviceResources().GetD3DDevice()->CreateComputeShader(
+		bytecode.data(), bytecode.size(), nullptr, result->shader.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("创建计算着色器失败", hr);
+		return nullptr;
+	}
+
+	return result;
+}
+
+std::unique_ptr<EffectBackend::ConstantBuffer> D3D11EffectBackend::CreateConstantBuffer(std::span<const EffectConstant32> data) {
+	auto result = std::make_unique<D3D11ConstantBuffer>();
+
+	D3D11_BUFFER_DESC bd{};
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.ByteWidth = 4 * (UINT)data.size();
+	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	D3D11_SUBRESOURCE_DATA initData{};
+	initData.pSysMem = data.data();
+
+	HRESULT hr = App::Get().GetDeviceResources().GetD3DDevice()->CreateBuffer(&bd, &initData, result->buffer.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("CreateBuffer 失败", hr);
+		return nullptr;
+	}
+
+	return result;
+}
+
+void D3D11EffectBackend::BindEffectResources(ConstantBuffer* constantBuffer, std::span<Sampler* const> samplers) {
+	auto d3dDC = App::Get().GetDeviceResources().GetD3DDC();
+
+	ID3D11Buffer* t = static_cast<D3D11ConstantBuffer*>(constantBuffer)->buffer.get();
+	d3dDC->CSSetConstantBuffers(1, 1, &t);
+	d3dDC->CSSetSamplers(0, (UINT)samplers.size(), reinterpret_cast<ID3D11SamplerState* const*>(samplers.data()));
+}
+
+void D3D11EffectBackend::Dispatch(
+	ComputeShader* shader,
+	std::span<ShaderResourceView* const> inputs,
+	std::span<UnorderedAccessView* const> outputs,
+	UINT threadGroupCountX,
+	UINT threadGroupCountY
+) {
+	// 用于解绑输出
+	static ID3D11UnorderedAccessView* const NULL_UAVS[D3D11_PS_CS_UAV_REGISTER_COUNT]{};
+	assert(outputs.size() <= std::size(NULL_UAVS));
+
+	auto d3dDC = App::Get().GetDeviceResources().GetD3DDC();
+	d3dDC->CSSetShader(static_cast<D3D11ComputeShader*>(shader)->shader.get(), nullptr, 0);
+
+	d3dDC->CSSetShaderResources(0, (UINT)inputs.size(), reinterpret_cast<ID3D11ShaderResourceView* const*>(inputs.data()));
+	d3dDC->CSSetUnorderedAccessViews(0, (UINT)outputs.size(),
+		reinterpret_cast<ID3D11UnorderedAccessView* const*>(outputs.data()), nullptr);
+
+	d3dDC->Dispatch(threadGroupCountX, threadGroupCountY, 1);
+
+	d3dDC->CSSetUnorderedAccessViews(0, (UINT)outputs.size(), NULL_UAVS, nullptr);
+}
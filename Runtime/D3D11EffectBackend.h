@@ -0,0 +1,36 @@
+#pragma once
+#include "pch.h"
+#include "EffectBackend.h"
+
+
+// 基于 DeviceResources 的 D3D11 后端
+class D3D11EffectBackend : public EffectBackend {
+public:
+	// 用于将帧源的输出等外部的纹理作为效果的输入
+	std::shared_ptr<Texture> WrapTexture(ID3D11Texture2D* texture);
+
+	std::shared_ptr<Texture> CreateTexture(EffectIntermediateTextureFormat format, SIZE size) override;
+
+	std::shared_ptr<Texture> LoadTexture(const wchar_t* fileName, EffectIntermediateTextureFormat format) override;
+
+	std::shared_ptr<Texture> GetBackBuffer() override;
+
+	ShaderResourceView* GetCursorShaderResourceView() override;
+
+	ShaderResourceView* GetShaderResourceView(Texture* texture) override;
+	UnorderedAccessView* GetUnorderedAccessView(Texture* texture) override;
+	Sampler* GetSampler(EffectSamplerFilterType filterType, EffectSamplerAddressType addressType) override;
+
+	std::unique_ptr<ComputeShader> CreateComputeShader(std::span<const BYTE> bytecode) override;
+	std::unique_ptr<ConstantBuffer> CreateConstantBuffer(std::span<const EffectConstant32> data) override;
+
+	void BindEffectResources(ConstantBuffer* constantBuffer, std::span<Sampler* const> samplers) override;
+
+	void Dispatch(
+		ComputeShader* shader,
+		std::span<ShaderResourceView* const> inputs,
+		std::span<UnorderedAccessView* const> outputs,
+		UINT threadGroupCountX,
+		UINT threadGroupCountY
+	) override;
+};
@@ -395,43 +395,6 @@ bool DeviceResources::GetUnorderedAccessView(ID3D11Texture2D* texture, ID3D11Uno
 	}
 }
 
-bool DeviceResources::CompileShader(std::string_view hlsl, const char* entryPoint, ID3DBlob** blob, const char* sourceName, ID3DInclude* include, const std::vector<std::pair<std::string, std::string>>& macros) {
-	winrt::com_ptr<ID3DBlob> errorMsgs = nullptr;
-
-	UINT flags = D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_ALL_RESOURCES_BOUND;
-	if (App::Get().GetConfig().IsTreatWarningsAsErrors()) {
-		flags |= D3DCOMPILE_WARNINGS_ARE_ERRORS;
-	}
-
-#ifdef _DEBUG
-	flags |= D3DCOMPILE_SKIP_OPTIMIZATION | D3DCOMPILE_DEBUG;
-#else
-	flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3;
-#endif // _DEBUG
-
-	std::vector<D3D_SHADER_MACRO> mc(macros.size() + 1);
-	for (UINT i = 0; i < macros.size(); ++i) {
-		mc[i] = { macros[i].first.c_str(), macros[i].second.c_str() };
-	}
-	mc.back() = { nullptr,nullptr };
-
-	HRESULT hr = D3DCompile(hlsl.data(), hlsl.size(), sourceName, mc.data(), include,
-		entryPoint, "cs_5_0", flags, 0, blob, errorMsgs.put());
-	if (FAILED(hr)) {
-		if (errorMsgs) {
-			Logger::Get().ComError(StrUtils::Concat("编译计算着色器失败：", (const char*)errorMsgs->GetBufferPointer()), hr);
-		}
-		return false;
-	} else {
-		// 警告消息
-		if (errorMsgs) {
-			Logger::Get().Warn(StrUtils::Concat("编译计算着色器时产生警告：", (const char*)errorMsgs->GetBufferPointer()));
-		}
-	}
-
-	return true;
-}
-
 bool DeviceResources::GetRenderTargetView(ID3D11Texture2D* texture, ID3D11RenderTargetView** result) {
 	auto it = _rtvMap.find(texture);
 	if (it != _rtvMap.end()) {
@@ -31,9 +31,6 @@ public:
 
 	bool GetUnorderedAccessView(ID3D11Texture2D* texture, ID3D11UnorderedAccessView** result);
 
-	bool CompileShader(std::string_view hlsl, const char* entryPoint,
-		ID3DBlob** blob, const char* sourceName = nullptr, ID3DInclude* include = nullptr, const std::vector<std::pair<std::string, std::string>>& macros = {});
-
 	ID3D11Device3* GetD3DDevice() const noexcept { return _d3dDevice.get(); }
 	D3D_FEATURE_LEVEL GetFeatureLevel() const noexcept { return _featureLevel; }
 	ID3D11DeviceContext3* GetD3DDC() const noexcept { return _d3dDC.get(); }
@@ -19,6 +19,9 @@
 #include "Utils.h"
 #include "StrUtils.h"
 #include "Logger.h"
+#include "EffectCacheManager.h"
+#include "EffectPrecompiler.h"
+#include "EffectMetadataIndex.h"
 
 
 #define API_DECLSPEC extern "C" __declspec(dllexport)
@@ -52,6 +55,16 @@ API_DECLSPEC void WINAPI SetLogLevel(UINT logLevel) {
 	Logger::Get().SetLevel((spdlog::level::level_enum)logLevel);
 }
 
+// 每个效果保留的缓存特化变体数，内联参数不同的缓存为不同的特化变体
+API_DECLSPEC void WINAPI SetEffectCacheVariantCount(UINT count) {
+	EffectCacheManager::Get().SetMaxVariantCount(count);
+}
+
+// 是否在空闲时以较高的等级重新压缩缓存
+API_DECLSPEC void WINAPI SetEffectCacheRecompression(BOOL enable) {
+	EffectCacheManager::Get().SetRecompressionEnabled(enable);
+}
+
 
 API_DECLSPEC BOOL WINAPI Initialize(
 	UINT logLevel,
@@ -69,11 +82,6 @@ API_DECLSPEC BOOL WINAPI Initialize(
 		return FALSE;
 	}
 
-	// 初始化 Hasher
-	if (!Utils::Hasher::Get().Initialize()) {
-		return FALSE;
-	}
-
 	return TRUE;
 }
 
@@ -136,6 +144,47 @@ API_DECLSPEC const char* WINAPI Run(
 
 
 
+// 在后台编译 effectsJson 中的效果并写入缓存，不创建窗口，用于预热缓存
+// effectsJson 和 flags 和 Run 相同，callback 在后台线程上调用，可以为空
+// 返回任务 id，失败时返回 0
+API_DECLSPEC UINT WINAPI Precompile(
+	const char* effectsJson,
+	UINT flags,
+	EffectPrecompiler::ProgressCallback callback,
+	void* context
+) {
+	return EffectPrecompiler::Get().Start(effectsJson, flags, callback, context);
+}
+
+// 取消预编译，尚未开始编译的效果将被跳过
+API_DECLSPEC BOOL WINAPI CancelPrecompile(UINT taskId) {
+	return EffectPrecompiler::Get().Cancel(taskId);
+}
+
+// 查询效果的元数据，无需编译。返回 json 数组，格式见 EffectMetadataIndex::Query
+// effectName 为空时返回所有效果。返回值在下次调用前有效
+API_DECLSPEC const char* WINAPI GetEffectsMetadata(const char* effectName) {
+	static std::string result;
+	result = EffectMetadataIndex::Get().Query(effectName ? effectName : "");
+	return result.c_str();
+}
+
+// 不创建窗口和 D3D 设备，计算效果链中每个效果的尺寸和每个通道的线程组数量
+// effectsJson 和 flags 和 Run 相同，效果链按 Run 的方式融合相邻的效果
+// 返回 json，格式见 Renderer::DryRun，失败时返回空字符串。返回值在下次调用前有效
+API_DECLSPEC const char* WINAPI DryRunEffects(
+	const char* effectsJson,
+	UINT flags,
+	UINT inputWidth,
+	UINT inputHeight,
+	UINT hostWidth,
+	UINT hostHeight
+) {
+	static std::string result;
+	result = Renderer::DryRun(effectsJson, flags, { (LONG)inputWidth, (LONG)inputHeight }, { (LONG)hostWidth, (LONG)hostHeight });
+	return result.c_str();
+}
+
 API_DECLSPEC const char* WINAPI GetAllGraphicsAdapters(const char* delimiter) {
 	static std::string result;
 	result.clear();
@@ -0,0 +1,63 @@
+#pragma once
+#include "pch.h"
+#include "EffectDesc.h"
+
+
+// EffectDrawer 使用的图形 API 抽象，EffectDrawer 只通过它创建资源和调度计算着色器
+// 纹理、计算着色器和常量缓冲区由调用者通过智能指针持有；视图和采样器由后端缓存，
+// 在对应的纹理或后端销毁前有效，以不透明的指针表示
+class EffectBackend {
+public:
+	class Texture {
+	public:
+		virtual ~Texture() = default;
+	};
+
+	class ComputeShader {
+	public:
+		virtual ~ComputeShader() = default;
+	};
+
+	class ConstantBuffer {
+	public:
+		virtual ~ConstantBuffer() = default;
+	};
+
+	struct ShaderResourceView;
+	struct UnorderedAccessView;
+	struct Sampler;
+
+	virtual ~EffectBackend() = default;
+
+	// 可以被计算着色器读写的纹理
+	virtual std::shared_ptr<Texture> CreateTexture(EffectIntermediateTextureFormat format, SIZE size) = 0;
+
+	// 从文件加载纹理，format 不为 UNKNOWN 时检查格式是否匹配
+	virtual std::shared_ptr<Texture> LoadTexture(const wchar_t* fileName, EffectIntermediateTextureFormat format) = 0;
+
+	// 最后一个效果输出到的纹理
+	virtual std::shared_ptr<Texture> GetBackBuffer() = 0;
+
+	// 当前光标的纹理，没有光标时返回空
+	virtual ShaderResourceView* GetCursorShaderResourceView() = 0;
+
+	virtual ShaderResourceView* GetShaderResourceView(Texture* texture) = 0;
+	virtual UnorderedAccessView* GetUnorderedAccessView(Texture* texture) = 0;
+	virtual Sampler* GetSampler(EffectSamplerFilterType filterType, EffectSamplerAddressType addressType) = 0;
+
+	// bytecode 为编译后端产生的字节码，见 ShaderCompiler
+	virtual std::unique_ptr<ComputeShader> CreateComputeShader(std::span<const BYTE> bytecode) = 0;
+	virtual std::unique_ptr<ConstantBuffer> CreateConstantBuffer(std::span<const EffectConstant32> data) = 0;
+
+	// 绑定效果的常量缓冲区（b1）和采样器（从 s0 开始），之后的 Dispatch 共享它们
+	virtual void BindEffectResources(ConstantBuffer* constantBuffer, std::span<Sampler* const> samplers) = 0;
+
+	// 绑定输入（从 t0 开始）和输出（从 u0 开始）后调度，完成后解绑输出，之后的通道才能读取它们
+	virtual void Dispatch(
+		ComputeShader* shader,
+		std::span<ShaderResourceView* const> inputs,
+		std::span<UnorderedAccessView* const> outputs,
+		UINT threadGroupCountX,
+		UINT threadGroupCountY
+	) = 0;
+};
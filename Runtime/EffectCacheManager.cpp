@@ -7,57 +7,46 @@
 #include <yas/types/std/string.hpp>
 #include <yas/types/std/vector.hpp>
 #include "EffectCompiler.h"
-#include <regex>
+#include "StreamHasher.h"
 #include "App.h"
 #include "DeviceResources.h"
 #include "StrUtils.h"
 #include "Logger.h"
+#include <thread>
+#include <zstd.h>
+#include <zdict.h>
+#include <unordered_set>
 
 
-static constexpr const size_t MAX_CACHE_COUNT = 128;
+// 内存缓存的总预算（字节），平均分给各个分片
+static constexpr const size_t MEM_CACHE_BUDGET = 64 * 1024 * 1024;
 
 // 缓存版本
 // 当缓存文件结构有更改时更新它，使旧缓存失效
-static constexpr const UINT CACHE_VERSION = 8;
+static constexpr const UINT CACHE_VERSION = 13;
 
 // 缓存的压缩等级
+// 写入时使用较快的等级，后台线程空闲时再以较高的等级重新压缩
 static constexpr const int CACHE_COMPRESSION_LEVEL = 1;
+static constexpr const int CACHE_RECOMPRESSION_LEVEL = 19;
 
-static const wchar_t* CACHE_DIR = L".\\cache";
+// 最后一次写入后空闲多久开始回收字节码和重新压缩
+static constexpr const auto IDLE_WORK_DELAY = std::chrono::seconds(5);
 
+// 字节码在不同效果间高度重复，缓存数量达到 DICT_MIN_SAMPLES 时从中训练字典
+static constexpr const size_t DICT_MIN_SAMPLES = 16;
+static constexpr const size_t DICT_MAX_SIZE = 64 * 1024;
+// 训练使用的样本总大小上限
+static constexpr const size_t DICT_MAX_SAMPLES_SIZE = 16 * 1024 * 1024;
 
-std::wstring GetCacheFileName(std::string_view effectName, std::string_view hash, UINT flags) {
-	// 缓存文件的命名：{效果名}_{标志位（16进制）}{哈希}
-	return fmt::format(L"{}\\{}_{:02x}{}", CACHE_DIR, StrUtils::UTF8ToUTF16(effectName), flags, StrUtils::UTF8ToUTF16(hash));
-}
+static const wchar_t* CACHE_DIR = L".\\cache";
 
 
-template<typename Archive>
-void serialize(Archive& ar, winrt::com_ptr<ID3DBlob>& o) {
-	SIZE_T size = 0;
-	ar& size;
-	HRESULT hr = D3DCreateBlob(size, o.put());
-	if (FAILED(hr)) {
-		Logger::Get().ComError("D3DCreateBlob 失败", hr);
-		throw new std::exception();
-	}
-
-	BYTE* buf = (BYTE*)o->GetBufferPointer();
-	for (SIZE_T i = 0; i < size; ++i) {
-		ar& (*buf++);
-	}
+// 特化变体的键：{效果名}_{标志位（16进制）}
+static std::string GetVariantKey(std::string_view effectName, UINT flags) {
+	return fmt::format("{}_{:02x}", effectName, flags);
 }
 
-template<typename Archive>
-void serialize(Archive& ar, const winrt::com_ptr<ID3DBlob>& o) {
-	SIZE_T size = o->GetBufferSize();
-	ar& size;
-
-	BYTE* buf = (BYTE*)o->GetBufferPointer();
-	for (SIZE_T i = 0; i < size; ++i) {
-		ar& (*buf++);
-	}
-}
 
 template<typename Archive>
 void serialize(Archive& ar, const EffectParameterDesc& o) {
@@ -131,6 +120,20 @@ void serialize(Archive& ar, EffectParameterDesc& o) {
 	ar& o.name& o.type;
 }
 
+template<typename Archive>
+void serialize(Archive& ar, EffectExpr::Instruction& o) {
+	ar& o.op& o.var& o.value;
+}
+
+template<typename Archive>
+void serialize(Archive& ar, EffectExpr& o) {
+	ar& o._kind;
+	for (double& coef : o._coefs) {
+		ar& coef;
+	}
+	ar& o._code;
+}
+
 template<typename Archive>
 void serialize(Archive& ar, EffectIntermediateTextureDesc& o) {
 	ar& o.format& o.name & o.source & o.sizeExpr;
@@ -143,7 +146,8 @@ void serialize(Archive& ar, EffectSamplerDesc& o) {
 
 template<typename Archive>
 void serialize(Archive& ar, EffectPassDesc& o) {
-	ar& o.cso& o.inputs& o.outputs& o.numThreads[0] & o.numThreads[1] & o.numThreads[2] & o.blockSize& o.desc& o.isPSStyle;
+	// cso 按 hash 单独保存，见 EffectCacheManager::_blobIndex
+	ar& o.inputs& o.outputs& o.numThreads[0] & o.numThreads[1] & o.numThreads[2] & o.blockSize& o.desc& o.hash& o.isPSStyle;
 }
 
 template<typename Archive>
@@ -151,211 +155,982 @@ void serialize(Archive& ar, EffectDesc& o) {
 	ar& o.name& o.outSizeExpr& o.params& o.textures& o.samplers& o.passes& o.flags& o.isUseDynamic;
 }
 
-void EffectCacheManager::_AddToMemCache(const std::wstring& cacheFileName, const EffectDesc& desc) {
-	std::scoped_lock lk(_cs);
+// 缓存文件（解压后）的布局：CacheHeader | yas 序列化的 EffectDesc（不含字节码）
+struct CacheHeader {
+	UINT32 version;
+	UINT32 descSize;
+};
 
-	_memCache[cacheFileName] = { desc, ++_lastAccess };
+static bool SerializeDesc(const EffectDesc& desc, std::vector<BYTE>& result) {
+	std::vector<BYTE> descBuf;
+	descBuf.reserve(4096);
 
-	if (_memCache.size() > MAX_CACHE_COUNT) {
-		// 清理一半较旧的内存缓存
-		std::vector<UINT> access;
-		access.reserve(_memCache.size());
-		for (const auto& pair : _memCache) {
-			access.push_back(pair.second.second);
-		}
+	try {
+		yas::vector_ostream os(descBuf);
+		yas::binary_oarchive<yas::vector_ostream<BYTE>, yas::binary> oa(os);
+
+		oa& desc;
+	} catch (...) {
+		return false;
+	}
 
-		auto midIt = access.begin() + access.size() / 2;
-		std::nth_element(access.begin(), midIt, access.end());
-		UINT mid = *midIt;
+	result.resize(sizeof(CacheHeader) + descBuf.size());
 
-		for (auto it = _memCache.begin(); it != _memCache.end();) {
-			if (it->second.second < mid) {
-				it = _memCache.erase(it);
-			} else {
-				++it;
-			}
+	CacheHeader header{ CACHE_VERSION, (UINT32)descBuf.size() };
+	std::memcpy(result.data(), &header, sizeof(header));
+	std::memcpy(result.data() + sizeof(header), descBuf.data(), descBuf.size());
+	return true;
+}
+
+// 不读取字节码，通道的 cso 为空
+static bool DeserializeDesc(std::span<const BYTE> buf, EffectDesc& desc) {
+	CacheHeader header{};
+	if (buf.size() < sizeof(header)) {
+		return false;
+	}
+	std::memcpy(&header, buf.data(), sizeof(header));
+
+	if (header.version != CACHE_VERSION || buf.size() - sizeof(header) < header.descSize) {
+		return false;
+	}
+
+	try {
+		yas::mem_istream mi(buf.data() + sizeof(header), header.descSize);
+		yas::binary_iarchive<yas::mem_istream, yas::binary> ia(mi);
+
+		ia& desc;
+	} catch (...) {
+		return false;
+	}
+
+	return true;
+}
+
+// 字节码单独压缩保存，不含其他数据
+static bool DecompressBytecode(std::span<const BYTE> compressed, const ZSTD_DDict* dict, winrt::com_ptr<ID3DBlob>& result) {
+	std::vector<BYTE> buf;
+	if (!Utils::ZstdDecompress(compressed, buf, dict)) {
+		return false;
+	}
+
+	HRESULT hr = D3DCreateBlob(buf.size(), result.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("D3DCreateBlob 失败", hr);
+		return false;
+	}
+
+	std::memcpy(result->GetBufferPointer(), buf.data(), buf.size());
+	return true;
+}
+
+// 估算 EffectDesc 占用的内存，主要是字节码
+static size_t EstimateDescSize(const EffectDesc& desc) noexcept {
+	size_t size = sizeof(EffectDesc)
+		+ desc.params.size() * sizeof(EffectParameterDesc)
+		+ desc.textures.size() * sizeof(EffectIntermediateTextureDesc)
+		+ desc.samplers.size() * sizeof(EffectSamplerDesc);
+
+	for (const EffectPassDesc& pass : desc.passes) {
+		size += sizeof(EffectPassDesc) + pass.desc.size() + pass.hash.size();
+		if (pass.cso) {
+			size += pass.cso->GetBufferSize();
 		}
+	}
 
-		Logger::Get().Info("已清理内存缓存");
+	return size;
+}
+
+EffectCacheManager::_MemCacheShard& EffectCacheManager::_GetMemCacheShard(std::string_view cacheKey) noexcept {
+	return _memCacheShards[std::hash<std::string_view>()(cacheKey) % _memCacheShards.size()];
+}
+
+void EffectCacheManager::_AddToMemCache(const std::string& cacheKey, std::shared_ptr<const EffectDesc> desc) {
+	_MemCacheShard& shard = _GetMemCacheShard(cacheKey);
+	const size_t budget = MEM_CACHE_BUDGET / _memCacheShards.size();
+
+	std::scoped_lock lk(shard.cs);
+
+	auto it = shard.map.find(cacheKey);
+	if (it != shard.map.end()) {
+		shard.size -= it->second->size;
+		shard.lru.erase(it->second);
+		shard.map.erase(it);
+	}
+
+	size_t size = EstimateDescSize(*desc);
+	shard.lru.push_front({ cacheKey, std::move(desc), size });
+	shard.map.emplace(shard.lru.front().key, shard.lru.begin());
+	shard.size += size;
+
+	// 超出预算时淘汰最久未使用的，至少保留刚加入的
+	while (shard.size > budget && shard.lru.size() > 1) {
+		_MemCacheNode& node = shard.lru.back();
+		shard.size -= node.size;
+		shard.map.erase(node.key);
+		shard.lru.pop_back();
 	}
 }
 
-bool EffectCacheManager::_LoadFromMemCache(const std::wstring& cacheFileName, EffectDesc& desc) {
-	std::scoped_lock lk(_cs);
-	
-	auto it = _memCache.find(cacheFileName);
-	if (it != _memCache.end()) {
-		desc = it->second.first;
-		it->second.second = ++_lastAccess;
-		Logger::Get().Info(StrUtils::Concat("已读取缓存 ", StrUtils::UTF16ToUTF8(cacheFileName)));
-		return true;
+std::shared_ptr<const EffectDesc> EffectCacheManager::_LoadFromMemCache(const std::string& cacheKey) {
+	_MemCacheShard& shard = _GetMemCacheShard(cacheKey);
+
+	std::scoped_lock lk(shard.cs);
+
+	auto it = shard.map.find(cacheKey);
+	if (it == shard.map.end()) {
+		return nullptr;
 	}
-	return false;
+
+	// 移到最前
+	shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+	return it->second->desc;
 }
 
-bool EffectCacheManager::Load(std::string_view effectName, std::string_view hash, EffectDesc& desc) {
-	assert(!effectName.empty() && !hash.empty());
+void EffectCacheManager::_RemoveFromMemCache(const std::string& cacheKey) {
+	_MemCacheShard& shard = _GetMemCacheShard(cacheKey);
 
-	std::wstring cacheFileName = GetCacheFileName(effectName, hash, desc.flags);
+	std::scoped_lock lk(shard.cs);
 
-	if (_LoadFromMemCache(cacheFileName, desc)) {
-		return true;
+	auto it = shard.map.find(cacheKey);
+	if (it != shard.map.end()) {
+		shard.size -= it->second->size;
+		shard.lru.erase(it->second);
+		shard.map.erase(it);
 	}
+}
 
-	if (!Utils::FileExists(cacheFileName.c_str())) {
-		return false;
+struct EffectCacheManager::_CompressionDict {
+	~_CompressionDict() {
+		ZSTD_freeCDict(cdict);
+		ZSTD_freeCDict(highCDict);
+		ZSTD_freeDDict(ddict);
 	}
-	
-	std::vector<BYTE> buf;
+
+	// 压缩等级为 CACHE_COMPRESSION_LEVEL
+	ZSTD_CDict* cdict = nullptr;
+	// 压缩等级为 CACHE_RECOMPRESSION_LEVEL
+	ZSTD_CDict* highCDict = nullptr;
+	ZSTD_DDict* ddict = nullptr;
+};
+
+std::shared_ptr<const EffectCacheManager::_CompressionDict> EffectCacheManager::_CreateDict(std::span<const BYTE> data) {
+	auto dict = std::make_shared<_CompressionDict>();
+	dict->cdict = ZSTD_createCDict(data.data(), data.size(), CACHE_COMPRESSION_LEVEL);
+	dict->highCDict = ZSTD_createCDict(data.data(), data.size(), CACHE_RECOMPRESSION_LEVEL);
+	dict->ddict = ZSTD_createDDict(data.data(), data.size());
+
+	if (!dict->cdict || !dict->highCDict || !dict->ddict) {
+		Logger::Get().Error("创建压缩字典失败");
+		return nullptr;
+	}
+
+	return dict;
+}
+
+bool EffectCacheManager::_LoadVariant(const std::string& variantKey, std::string_view hash, EffectDesc& desc) {
+	std::string cacheKey = StrUtils::Concat(variantKey, hash);
+
+	// 内存缓存中的 EffectDesc 不可变，在锁外复制，字节码通过引用计数共享
+	if (std::shared_ptr<const EffectDesc> cached = _LoadFromMemCache(cacheKey)) {
+		desc = *cached;
+		Logger::Get().Info(StrUtils::Concat("已读取缓存 ", cacheKey));
+		return true;
+	}
+
+	std::vector<BYTE> compressedBuf;
+	std::shared_ptr<const _CompressionDict> dict;
 	{
-		std::vector<BYTE> compressedBuf;
-		if (!Utils::ReadFile(cacheFileName.c_str(), compressedBuf) || compressedBuf.empty()) {
+		std::scoped_lock lk(_cs);
+		dict = _dict;
+
+		// 压缩包文件会改变数据的位置，因此必须在锁内查找并读取
+		auto it = _variantIndex.find(variantKey);
+		if (it == _variantIndex.end()) {
 			return false;
 		}
-		
-		if (!Utils::ZstdDecompress(compressedBuf, buf)) {
-			Logger::Get().Error("解压缓存失败");
+
+		const std::vector<_Variant>& variants = it->second.variants;
+		auto variantIt = std::find_if(variants.begin(), variants.end(),
+			[hash](const _Variant& v) { return v.entry.hash == hash; });
+		if (variantIt == variants.end() || !_pack.Read(variantIt->entry, compressedBuf)) {
 			return false;
 		}
 	}
 
-	try {
-		yas::mem_istream mi(buf.data(), buf.size());
-		yas::binary_iarchive<yas::mem_istream, yas::binary> ia(mi);
+	// 在锁外解压和反序列化，不阻塞其他效果
+	std::vector<BYTE> buf;
+	if (!Utils::ZstdDecompress(compressedBuf, buf, dict ? dict->ddict : nullptr)) {
+		Logger::Get().Error("解压缓存失败");
+		return false;
+	}
 
-		ia& desc;
-	} catch (...) {
+	if (!DeserializeDesc(buf, desc)) {
 		Logger::Get().Error("反序列化失败");
 		desc = {};
 		return false;
 	}
 
-	_AddToMemCache(cacheFileName, desc);
+	if (!_LoadPassesBytecode(desc)) {
+		Logger::Get().Error("读取字节码失败");
+		desc = {};
+		return false;
+	}
+
+	_AddToMemCache(cacheKey, std::make_shared<const EffectDesc>(desc));
 	
-	Logger::Get().Info(StrUtils::Concat("已读取缓存 ", StrUtils::UTF16ToUTF8(cacheFileName)));
+	Logger::Get().Info(StrUtils::Concat("已读取缓存 ", cacheKey));
 	return true;
 }
 
-void EffectCacheManager::Save(std::string_view effectName, std::string_view hash, const EffectDesc& desc) {
+bool EffectCacheManager::_LoadPassesBytecode(EffectDesc& desc) {
+	std::vector<std::vector<BYTE>> compressedBufs(desc.passes.size());
+	std::shared_ptr<const _CompressionDict> dict;
+	{
+		std::scoped_lock lk(_cs);
+		dict = _dict;
+
+		for (size_t i = 0; i < desc.passes.size(); ++i) {
+			auto it = _blobIndex.find(desc.passes[i].hash);
+			if (it == _blobIndex.end() || !_pack.Read(it->second, compressedBufs[i])) {
+				return false;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < desc.passes.size(); ++i) {
+		if (!DecompressBytecode(compressedBufs[i], dict ? dict->ddict : nullptr, desc.passes[i].cso)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void EffectCacheManager::_OpenPack() {
+	if (_isPackOpened) {
+		return;
+	}
+	_isPackOpened = true;
+
+	std::vector<EffectCachePack::Entry> entries;
+	if (!_pack.Open(CACHE_DIR, entries)) {
+		Logger::Get().Error("打开缓存包文件失败");
+		return;
+	}
+
+	// 索引中的顺序即为 LRU 顺序
+	for (EffectCachePack::Entry& entry : entries) {
+		if (entry.key.empty()) {
+			std::string hash = entry.hash;
+			_blobIndex.emplace(std::move(hash), std::move(entry));
+		} else {
+			_variantIndex[entry.key].variants.push_back({ std::move(entry) });
+		}
+	}
+
+	std::vector<BYTE> dictData;
+	if (!_pack.ReadDictionary(dictData)) {
+		Logger::Get().Error("读取压缩字典失败");
+	} else if (!dictData.empty()) {
+		_dict = _CreateDict(dictData);
+		// 创建失败时不再训练，以免替换旧字典后已有的缓存无法解压
+		_isDictTrainingTried = true;
+	}
+}
+
+void EffectCacheManager::_EvictVariants(_VariantList& list) {
+	while (list.variants.size() > _maxVariantCount) {
+		const EffectCachePack::Entry& entry = list.variants.back().entry;
+		_pack.Discard(entry);
+		_RemoveFromMemCache(entry.key + entry.hash);
+		list.variants.pop_back();
+		_isBlobGCNeeded = true;
+	}
+}
+
+std::vector<EffectCachePack::Entry*> EffectCacheManager::_GetAllEntries() {
+	std::vector<EffectCachePack::Entry*> entries;
+	entries.reserve(_variantIndex.size() + _blobIndex.size());
+
+	for (auto& [variantKey, list] : _variantIndex) {
+		for (_Variant& variant : list.variants) {
+			entries.push_back(&variant.entry);
+		}
+	}
+	for (auto& [hash, entry] : _blobIndex) {
+		entries.push_back(&entry);
+	}
+
+	return entries;
+}
+
+EffectCachePack::Entry* EffectCacheManager::_FindEntry(const std::string& key, const std::string& hash) {
+	if (key.empty()) {
+		auto it = _blobIndex.find(hash);
+		return it == _blobIndex.end() ? nullptr : &it->second;
+	}
+
+	auto listIt = _variantIndex.find(key);
+	if (listIt == _variantIndex.end()) {
+		return nullptr;
+	}
+
+	std::vector<_Variant>& variants = listIt->second.variants;
+	auto it = std::find_if(variants.begin(), variants.end(),
+		[&](const _Variant& v) { return v.entry.hash == hash; });
+	return it == variants.end() ? nullptr : &it->entry;
+}
+
+void EffectCacheManager::_RemoveEntry(const std::string& key, const std::string& hash) {
+	if (key.empty()) {
+		auto it = _blobIndex.find(hash);
+		if (it != _blobIndex.end()) {
+			_pack.Discard(it->second);
+			_blobIndex.erase(it);
+		}
+		return;
+	}
+
+	auto listIt = _variantIndex.find(key);
+	if (listIt == _variantIndex.end()) {
+		return;
+	}
+
+	std::vector<_Variant>& variants = listIt->second.variants;
+	auto it = std::find_if(variants.begin(), variants.end(),
+		[&](const _Variant& v) { return v.entry.hash == hash; });
+	if (it != variants.end()) {
+		_pack.Discard(it->entry);
+		variants.erase(it);
+		_isBlobGCNeeded = true;
+	}
+}
+
+void EffectCacheManager::_CommitPack() {
+	_isIndexDirty = false;
+
+	std::vector<EffectCachePack::Entry*> entries = _GetAllEntries();
+
+	if (!_pack.CompactIfNeeded(entries)) {
+		Logger::Get().Error("压缩缓存包文件失败");
+	}
+
+	if (!_pack.Commit(std::vector<const EffectCachePack::Entry*>(entries.begin(), entries.end()))) {
+		Logger::Get().Error("提交缓存索引失败");
+	}
+}
+
+bool EffectCacheManager::Load(std::string_view effectName, std::string_view hash, EffectDesc& desc) {
+	assert(!effectName.empty() && !hash.empty());
+
+	std::string variantKey = GetVariantKey(effectName, desc.flags);
+
+	// 先查内存缓存，命中时不获取 _cs，以免等待后台线程的写入和压缩。
+	// 包括尚未写入的缓存，LRU 顺序和命中次数由后台线程更新
+	if (std::shared_ptr<const EffectDesc> cached = _LoadFromMemCache(StrUtils::Concat(variantKey, hash))) {
+		desc = *cached;
+		_AddTouch(std::move(variantKey), std::string(hash));
+		Logger::Get().Info(fmt::format("缓存命中 {} 的特化变体 {}（内存）", effectName, hash.substr(0, 8)));
+		return true;
+	}
+
+	// 读取缓存在渲染前的编译路径上，不在这里同步提交索引
+	bool isCommitNeeded = false;
+	{
+		std::scoped_lock lk(_cs);
+		_OpenPack();
+
+		_VariantList& list = _variantIndex[variantKey];
+		++list.lookups;
+
+		auto it = std::find_if(list.variants.begin(), list.variants.end(),
+			[hash](const _Variant& v) { return v.entry.hash == hash; });
+		if (it == list.variants.end()) {
+			Logger::Get().Info(fmt::format("缓存未命中，{} 现有 {} 个特化变体", effectName, list.variants.size()));
+			return false;
+		}
+
+		if (it != list.variants.begin()) {
+			// 移到最前，LRU 顺序由后台线程随下一次提交保存
+			std::rotate(list.variants.begin(), it, it + 1);
+			_isIndexDirty = true;
+			isCommitNeeded = true;
+		}
+
+		_Variant& variant = list.variants.front();
+		++variant.hits;
+
+		Logger::Get().Info(fmt::format("缓存命中 {} 的特化变体 {}，命中率 {}/{}",
+			effectName, hash.substr(0, 8), variant.hits, list.lookups));
+	}
+
+	if (isCommitNeeded) {
+		_RequestCommit();
+	}
+
+	if (_LoadVariant(variantKey, hash, desc)) {
+		return true;
+	}
+
+	// 数据已损坏，从索引中移除
+	{
+		std::scoped_lock lk(_cs);
+		_RemoveEntry(variantKey, std::string(hash));
+		_isIndexDirty = true;
+	}
+	_RequestCommit();
+
+	return false;
+}
+
+winrt::com_ptr<ID3DBlob> EffectCacheManager::LoadPassBytecode(std::string_view passHash) {
+	if (passHash.empty()) {
+		return nullptr;
+	}
+
+	std::string hash(passHash);
+
+	// 尚未写入的字节码
+	{
+		std::scoped_lock lk(_saveMutex);
+		auto it = _pendingBytecode.find(hash);
+		if (it != _pendingBytecode.end()) {
+			return it->second;
+		}
+	}
+
 	std::vector<BYTE> compressedBuf;
+	std::shared_ptr<const _CompressionDict> dict;
 	{
-		std::vector<BYTE> buf;
-		buf.reserve(4096);
+		std::scoped_lock lk(_cs);
+		_OpenPack();
+
+		auto it = _blobIndex.find(hash);
+		if (it == _blobIndex.end() || !_pack.Read(it->second, compressedBuf)) {
+			return nullptr;
+		}
+		dict = _dict;
+	}
+
+	winrt::com_ptr<ID3DBlob> result;
+	if (!DecompressBytecode(compressedBuf, dict ? dict->ddict : nullptr, result)) {
+		Logger::Get().Error("解压字节码失败");
+		return nullptr;
+	}
+
+	return result;
+}
+
+void EffectCacheManager::Save(std::string_view effectName, std::string_view hash, const EffectDesc& desc) {
+	// 立即加入内存缓存，写入前的 Load 也能命中
+	std::shared_ptr<const EffectDesc> sharedDesc = std::make_shared<const EffectDesc>(desc);
+	std::string cacheKey = StrUtils::Concat(GetVariantKey(effectName, desc.flags), hash);
+	_AddToMemCache(cacheKey, sharedDesc);
+
+	std::unique_lock lk(_saveMutex);
+	_StartWriter();
+
+	// 写入前其他效果也可以复用这些字节码
+	for (const EffectPassDesc& pass : desc.passes) {
+		if (!pass.hash.empty() && pass.cso) {
+			_pendingBytecode.emplace(pass.hash, pass.cso);
+		}
+	}
+
+	// 合并相同的缓存
+	auto it = std::find_if(_saveQueue.begin(), _saveQueue.end(),
+		[&](const _SaveTask& task) { return task.cacheKey == cacheKey; });
+	if (it != _saveQueue.end()) {
+		it->desc = std::move(sharedDesc);
+		return;
+	}
+
+	// 队列已满时等待，限制未写入的缓存占用的内存
+	_saveCV.wait(lk, [&]() { return _saveQueue.size() < MAX_PENDING_SAVES; });
+
+	_saveQueue.push_back({ std::string(effectName), std::string(hash), std::move(cacheKey), std::move(sharedDesc) });
+	_saveCV.notify_all();
+}
+
+void EffectCacheManager::Flush() {
+	std::unique_lock lk(_saveMutex);
+
+	// 提交空闲工作中尚未保存的修改和积累的命中
+	if (_isWriterStarted || !_pendingTouches.empty()) {
+		_StartWriter();
+		_isCommitRequested = true;
+		_saveCV.notify_all();
+	}
+
+	_saveCV.wait(lk, [&]() { return _saveQueue.empty() && !_isCommitRequested && !_isWriting; });
+}
+
+void EffectCacheManager::_StartWriter() {
+	if (!_isWriterStarted) {
+		_isWriterStarted = true;
+		// 进程退出时由系统结束，App 退出前调用 Flush 确保缓存已写入
+		std::thread(&EffectCacheManager::_WriterProc, this).detach();
+	}
+}
+
+void EffectCacheManager::_RequestCommit() {
+	std::scoped_lock lk(_saveMutex);
+	_StartWriter();
+
+	_isCommitRequested = true;
+	_saveCV.notify_all();
+}
+
+void EffectCacheManager::_AddTouch(std::string variantKey, std::string hash) {
+	std::scoped_lock lk(_saveMutex);
+	_pendingTouches.emplace_back(std::move(variantKey), std::move(hash));
+
+	// 命中次数不会保存，只有 LRU 顺序可能改变，因此不必每次都提交。
+	// 积累的命中随下一次提交应用，过多时才主动请求
+	if (_pendingTouches.size() >= MAX_PENDING_TOUCHES) {
+		_StartWriter();
+		_isCommitRequested = true;
+		_saveCV.notify_all();
+	}
+}
+
+void EffectCacheManager::_CommitIndex() {
+	std::vector<std::pair<std::string, std::string>> touches;
+	{
+		std::scoped_lock lk(_saveMutex);
+		touches.swap(_pendingTouches);
+	}
+
+	std::scoped_lock lk(_cs);
+
+	if (!touches.empty()) {
+		_OpenPack();
+
+		for (const auto& [variantKey, hash] : touches) {
+			_VariantList& list = _variantIndex[variantKey];
+			++list.lookups;
+
+			// 尚未写入的缓存只计入查找次数
+			auto it = std::find_if(list.variants.begin(), list.variants.end(),
+				[&](const _Variant& v) { return v.entry.hash == hash; });
+			if (it == list.variants.end()) {
+				continue;
+			}
+
+			// 已在最前时索引没有变化，无需提交
+			if (it != list.variants.begin()) {
+				std::rotate(list.variants.begin(), it, it + 1);
+				_isIndexDirty = true;
+			}
+			++list.variants.front().hits;
+		}
+	}
 
-		try {
-			yas::vector_ostream os(buf);
-			yas::binary_oarchive<yas::vector_ostream<BYTE>, yas::binary> oa(os);
+	if (_isIndexDirty) {
+		_CommitPack();
+	}
+}
+
+void EffectCacheManager::_WriterProc() {
+	// 是否可能还有需要在空闲时做的工作
+	bool hasIdleWork = true;
+	// 是否已空闲足够长的时间
+	bool isIdle = false;
+
+	while (true) {
+		_SaveTask task;
+		bool isCommitRequested = false;
+		{
+			std::unique_lock lk(_saveMutex);
+			auto hasTask = [&]() { return !_saveQueue.empty() || _isCommitRequested; };
+
+			if (hasIdleWork && !hasTask()) {
+				// 空闲一段时间后才开始，不和连续的保存竞争。每次只处理一项，以便及时响应新的保存
+				if (isIdle || !_saveCV.wait_for(lk, IDLE_WORK_DELAY, hasTask)) {
+					isIdle = true;
+					lk.unlock();
+
+					// 后台模式降低 CPU 和 IO 优先级，不影响前台的渲染
+					SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+					hasIdleWork = _CollectBlobs() || (_isRecompressionEnabled.load(std::memory_order_relaxed)
+						&& (_TrainDict() || _RecompressNext()));
+					SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+
+					// 空闲工作的修改在全部完成后统一提交，被保存打断时由 _Write 一并提交
+					if (!hasIdleWork) {
+						_CommitIndex();
+					}
+					continue;
+				}
+			}
+
+			_saveCV.wait(lk, hasTask);
+			isIdle = false;
+
+			isCommitRequested = std::exchange(_isCommitRequested, false);
+			if (!_saveQueue.empty()) {
+				task = std::move(_saveQueue.front());
+				_saveQueue.pop_front();
+			}
+			_isWriting = true;
+			// 唤醒等待队列空位的线程
+			_saveCV.notify_all();
+		}
+
+		if (task.desc) {
+			_Write(task.effectName, task.hash, *task.desc);
+			hasIdleWork = true;
+		}
+
+		// Load 中修改的索引（LRU 顺序和删除的条目）在这里保存，_Write 已提交时不再重复提交
+		if (isCommitRequested) {
+			_CommitIndex();
+		}
+
+		{
+			std::scoped_lock lk(_saveMutex);
+			_isWriting = false;
+			_saveCV.notify_all();
+		}
+	}
+}
+
+void EffectCacheManager::_Write(std::string_view effectName, std::string_view hash, const EffectDesc& desc) {
+	// 无论成功与否，之后都从包文件中读取字节码
+	Utils::ScopeExit se([&]() {
+		std::scoped_lock lk(_saveMutex);
+		for (const EffectPassDesc& pass : desc.passes) {
+			_pendingBytecode.erase(pass.hash);
+		}
+	});
+
+	// 字节码按通道的哈希保存
+	if (std::any_of(desc.passes.begin(), desc.passes.end(),
+		[](const EffectPassDesc& pass) { return pass.hash.empty() || !pass.cso; })) {
+		Logger::Get().Error("通道缺少哈希或字节码，无法保存缓存");
+		return;
+	}
+
+	// 只有后台线程会添加字节码，因此锁外的检查结果在写入时仍然有效
+	std::shared_ptr<const _CompressionDict> dict;
+	std::vector<const EffectPassDesc*> newPasses;
+	{
+		std::scoped_lock lk(_cs);
+		_OpenPack();
+		dict = _dict;
+
+		for (const EffectPassDesc& pass : desc.passes) {
+			if (!_blobIndex.contains(pass.hash) && std::none_of(newPasses.begin(), newPasses.end(),
+				[&](const EffectPassDesc* p) { return p->hash == pass.hash; })) {
+				newPasses.push_back(&pass);
+			}
+		}
+	}
 
-			oa& desc;
-		} catch (...) {
+	auto compress = [&](std::span<const BYTE> buf, std::vector<BYTE>& result) {
+		return dict
+			? Utils::ZstdCompress(buf, result, dict->cdict)
+			: Utils::ZstdCompress(buf, result, CACHE_COMPRESSION_LEVEL);
+	};
+
+	std::vector<BYTE> compressedBuf;
+	{
+		std::vector<BYTE> buf;
+		if (!SerializeDesc(desc, buf)) {
 			Logger::Get().Error("序列化失败");
 			return;
 		}
 
-		
-		if (!Utils::ZstdCompress(buf, compressedBuf, CACHE_COMPRESSION_LEVEL)) {
+		if (!compress(buf, compressedBuf)) {
 			Logger::Get().Error("压缩缓存失败");
 			return;
 		}
 	}
-	
-	if (!Utils::DirExists(CACHE_DIR)) {
-		if (!CreateDirectory(CACHE_DIR, nullptr)) {
-			Logger::Get().Win32Error("创建 cache 文件夹失败");
+
+	std::vector<std::vector<BYTE>> compressedBlobs(newPasses.size());
+	for (size_t i = 0; i < newPasses.size(); ++i) {
+		ID3DBlob* cso = newPasses[i]->cso.get();
+		if (!compress(std::span((const BYTE*)cso->GetBufferPointer(), cso->GetBufferSize()), compressedBlobs[i])) {
+			Logger::Get().Error("压缩字节码失败");
 			return;
 		}
-	} else {
-		// 删除所有该效果（flags 相同）的缓存
-		std::wregex regex(fmt::format(L"^{}_{:02x}[0-9,a-f]{{{}}}$", StrUtils::UTF8ToUTF16(effectName), desc.flags,
-				Utils::Hasher::Get().GetHashLength() * 2), std::wregex::optimize | std::wregex::nosubs);
-
-		WIN32_FIND_DATA findData{};
-		HANDLE hFind = Utils::SafeHandle(FindFirstFileEx(StrUtils::ConcatW(CACHE_DIR, L"\\*").c_str(),
-			FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
-		if (hFind) {
-			do {
-				if (StrUtils::StrLen(findData.cFileName) < 8) {
-					continue;
-				}
+	}
 
-				// 正则匹配文件名
-				if (!std::regex_match(findData.cFileName, regex)) {
-					continue;
-				}
+	std::string variantKey = GetVariantKey(effectName, desc.flags);
 
-				if (!DeleteFile(StrUtils::ConcatW(CACHE_DIR, L"\\", findData.cFileName).c_str())) {
-					Logger::Get().Win32Error(StrUtils::Concat("删除缓存文件 ",
-						StrUtils::UTF16ToUTF8(findData.cFileName), " 失败"));
-				}
-			} while (FindNextFile(hFind, &findData));
+	std::scoped_lock lk(_cs);
 
-			FindClose(hFind);
-		} else {
-			Logger::Get().Win32Error("查找缓存文件失败");
+	// 字节码条目的键为空，效果名不能为空，因此不会和特化变体冲突
+	for (size_t i = 0; i < newPasses.size(); ++i) {
+		EffectCachePack::Entry blobEntry{ std::string(), newPasses[i]->hash };
+		blobEntry.compressionLevel = CACHE_COMPRESSION_LEVEL;
+		if (!_pack.Append(compressedBlobs[i], blobEntry)) {
+			Logger::Get().Error("保存字节码失败");
+			return;
 		}
+		_blobIndex.emplace(newPasses[i]->hash, std::move(blobEntry));
 	}
-	
-	std::wstring cacheFileName = GetCacheFileName(effectName, hash, desc.flags);
-	if (!Utils::WriteFile(cacheFileName.c_str(), compressedBuf.data(), compressedBuf.size())) {
+
+	EffectCachePack::Entry entry{ variantKey, std::string(hash) };
+	entry.compressionLevel = CACHE_COMPRESSION_LEVEL;
+	if (!_pack.Append(compressedBuf, entry)) {
 		Logger::Get().Error("保存缓存失败");
+		return;
 	}
 
-	_AddToMemCache(cacheFileName, desc);
+	// 新的特化变体放在最前，超出数量时丢弃最久未使用的
+	_RemoveEntry(variantKey, entry.hash);
+	_VariantList& list = _variantIndex[variantKey];
+	list.variants.insert(list.variants.begin(), { std::move(entry) });
+	_EvictVariants(list);
 
-	Logger::Get().Info(StrUtils::Concat("已保存缓存 ", StrUtils::UTF16ToUTF8(cacheFileName)));
+	_CommitPack();
+
+	Logger::Get().Info(fmt::format("已保存缓存 {}{}，新增 {}/{} 个通道的字节码",
+		variantKey, hash, newPasses.size(), desc.passes.size()));
 }
 
-std::string EffectCacheManager::GetHash(
-	std::string_view source,
-	const std::map<std::string, std::variant<float, int>>* inlineParams
-) {
-	std::string str;
-	str.reserve(source.size() + 128);
-	str = source;
+bool EffectCacheManager::_CollectBlobs() {
+	std::vector<std::vector<BYTE>> compressedDescs;
+	std::shared_ptr<const _CompressionDict> dict;
+	{
+		std::scoped_lock lk(_cs);
+		_OpenPack();
 
-	str.append(fmt::format("CACHE_VERSION:{}\n", CACHE_VERSION));
-	if (inlineParams) {
-		for (const auto& pair : *inlineParams) {
-			if (pair.second.index() == 0) {
-				str.append(fmt::format("{}:{}\n", pair.first, std::get<0>(pair.second)));
-			} else {
-				str.append(fmt::format("{}:{}\n", pair.first, std::get<1>(pair.second)));
+		if (!_isBlobGCNeeded || !_pack.IsOpen()) {
+			return false;
+		}
+		_isBlobGCNeeded = false;
+		dict = _dict;
+
+		for (const auto& [variantKey, list] : _variantIndex) {
+			for (const _Variant& variant : list.variants) {
+				if (!_pack.Read(variant.entry, compressedDescs.emplace_back())) {
+					return true;
+				}
 			}
 		}
 	}
 
-	std::vector<BYTE> hashBytes;
-	if (!Utils::Hasher::Get().Hash(std::span((const BYTE*)source.data(), source.size()), hashBytes)) {
-		Logger::Get().Error("计算 hash 失败");
-		return "";
+	// 在锁外解析所有特化变体引用的字节码
+	// 只有后台线程会添加缓存，因此期间不会出现新的引用
+	std::unordered_set<std::string> liveHashes;
+	for (const std::vector<BYTE>& compressed : compressedDescs) {
+		std::vector<BYTE> buf;
+		EffectDesc desc;
+		if (!Utils::ZstdDecompress(compressed, buf, dict ? dict->ddict : nullptr) || !DeserializeDesc(buf, desc)) {
+			// 无法确定引用时保守地不回收
+			return true;
+		}
+
+		for (EffectPassDesc& pass : desc.passes) {
+			liveHashes.insert(std::move(pass.hash));
+		}
+	}
+
+	std::scoped_lock lk(_cs);
+
+	size_t count = std::erase_if(_blobIndex, [&](const auto& pair) {
+		if (liveHashes.contains(pair.first)) {
+			return false;
+		}
+
+		_pack.Discard(pair.second);
+		return true;
+	});
+
+	if (count > 0) {
+		_isIndexDirty = true;
+		Logger::Get().Info(fmt::format("已回收 {} 个不再使用的字节码", count));
 	}
 
-	return Utils::Bin2Hex(hashBytes);
+	return true;
 }
 
-std::string EffectCacheManager::GetHash(std::string& source, const std::map<std::string, std::variant<float, int>>* inlineParams) {
-	size_t originSize = source.size();
+bool EffectCacheManager::_TrainDict() {
+	std::vector<std::vector<BYTE>> compressedSamples;
+	{
+		std::scoped_lock lk(_cs);
+		_OpenPack();
 
-	source.reserve(originSize + 128);
+		if (_isDictTrainingTried || _dict || !_pack.IsOpen()) {
+			return false;
+		}
 
-	source.append(fmt::format("CACHE_VERSION:{}\n", CACHE_VERSION));
-	if (inlineParams) {
-		for (const auto& pair : *inlineParams) {
-			if (pair.second.index() == 0) {
-				source.append(fmt::format("{}:{}\n", pair.first, std::get<0>(pair.second)));
+		// 样本包括特化变体和字节码
+		std::vector<EffectCachePack::Entry*> entries = _GetAllEntries();
+		if (entries.size() < DICT_MIN_SAMPLES) {
+			return false;
+		}
+
+		_isDictTrainingTried = true;
+
+		// 压缩后的大小约为原始大小的 1/4，据此限制样本总大小
+		size_t totalSize = 0;
+		for (const EffectCachePack::Entry* entry : entries) {
+			if (totalSize * 4 >= DICT_MAX_SAMPLES_SIZE) {
+				break;
+			}
+
+			if (_pack.Read(*entry, compressedSamples.emplace_back())) {
+				totalSize += entry->size;
 			} else {
-				source.append(fmt::format("{}:{}\n", pair.first, std::get<1>(pair.second)));
+				compressedSamples.pop_back();
 			}
 		}
 	}
 
-	std::vector<BYTE> hashBytes;
-	bool success = Utils::Hasher::Get().Hash(std::span((const BYTE*)source.data(), source.size()), hashBytes);
+	// 训练前不存在字典，所有缓存都不使用字典
+	std::vector<BYTE> samples;
+	std::vector<size_t> sampleSizes;
+	for (const std::vector<BYTE>& compressed : compressedSamples) {
+		std::vector<BYTE> buf;
+		if (!Utils::ZstdDecompress(compressed, buf) || samples.size() + buf.size() > DICT_MAX_SAMPLES_SIZE) {
+			continue;
+		}
+
+		samples.insert(samples.end(), buf.begin(), buf.end());
+		sampleSizes.push_back(buf.size());
+	}
+
+	std::vector<BYTE> dictData(DICT_MAX_SIZE);
+	size_t dictSize = ZDICT_trainFromBuffer(dictData.data(), dictData.size(),
+		samples.data(), sampleSizes.data(), (unsigned)sampleSizes.size());
+	if (ZDICT_isError(dictSize)) {
+		Logger::Get().Error(StrUtils::Concat("训练压缩字典失败：", ZDICT_getErrorName(dictSize)));
+		return true;
+	}
+	dictData.resize(dictSize);
+
+	std::shared_ptr<const _CompressionDict> dict = _CreateDict(dictData);
+	if (!dict) {
+		return true;
+	}
+
+	std::scoped_lock lk(_cs);
+	if (!_pack.SetDictionary(dictData)) {
+		Logger::Get().Error("保存压缩字典失败");
+		return true;
+	}
+
+	_dict = std::move(dict);
+	_isIndexDirty = true;
+
+	Logger::Get().Info(fmt::format("已从 {} 个缓存训练压缩字典，大小 {} 字节", sampleSizes.size(), dictSize));
+	return true;
+}
+
+bool EffectCacheManager::_RecompressNext() {
+	EffectCachePack::Entry oldEntry;
+	std::vector<BYTE> compressedBuf;
+	std::shared_ptr<const _CompressionDict> dict;
+	{
+		std::scoped_lock lk(_cs);
+		_OpenPack();
+
+		std::vector<EffectCachePack::Entry*> entries = _GetAllEntries();
+		auto it = std::find_if(entries.begin(), entries.end(),
+			[](const EffectCachePack::Entry* entry) { return entry->compressionLevel < CACHE_RECOMPRESSION_LEVEL; });
+		if (it == entries.end()) {
+			return false;
+		}
+
+		oldEntry = **it;
+		dict = _dict;
+		if (!_pack.Read(oldEntry, compressedBuf)) {
+			compressedBuf.clear();
+		}
+	}
+
+	// 在锁外重新压缩，不阻塞读取
+	std::vector<BYTE> buf;
+	std::vector<BYTE> newBuf;
+	bool success = !compressedBuf.empty()
+		&& Utils::ZstdDecompress(compressedBuf, buf, dict ? dict->ddict : nullptr)
+		&& (dict
+			? Utils::ZstdCompress(buf, newBuf, dict->highCDict)
+			: Utils::ZstdCompress(buf, newBuf, CACHE_RECOMPRESSION_LEVEL));
+
+	std::scoped_lock lk(_cs);
+
+	// 期间可能已被淘汰
+	EffectCachePack::Entry* entry = _FindEntry(oldEntry.key, oldEntry.hash);
+	if (!entry) {
+		return true;
+	}
+
 	if (!success) {
-		Logger::Get().Error("计算 hash 失败");
+		// 数据已损坏，从索引中移除
+		_RemoveEntry(oldEntry.key, oldEntry.hash);
+	} else if (newBuf.size() >= compressedBuf.size()) {
+		// 没有收益，只标记为已处理
+		entry->compressionLevel = CACHE_RECOMPRESSION_LEVEL;
+	} else {
+		EffectCachePack::Entry newEntry{ oldEntry.key, oldEntry.hash };
+		newEntry.compressionLevel = CACHE_RECOMPRESSION_LEVEL;
+		if (!_pack.Append(newBuf, newEntry)) {
+			Logger::Get().Error("保存缓存失败");
+			return false;
+		}
+
+		_pack.Discard(*entry);
+		*entry = std::move(newEntry);
+
+		Logger::Get().Info(fmt::format("已重新压缩缓存 {}{}：{} 字节 -> {} 字节",
+			oldEntry.key, oldEntry.hash, compressedBuf.size(), newBuf.size()));
 	}
 
-	source.resize(originSize);
+	_isIndexDirty = true;
+	return true;
+}
+
+void EffectCacheManager::SetMaxVariantCount(UINT value) {
+	std::scoped_lock lk(_cs);
+	_OpenPack();
+
+	_maxVariantCount = std::max(value, 1u);
+	for (auto& [variantKey, list] : _variantIndex) {
+		_EvictVariants(list);
+	}
+
+	_CommitPack();
+}
+
+std::string EffectCacheManager::GetHash(
+	std::string_view source,
+	std::string_view compilerId,
+	const std::map<std::string, std::variant<float, int>>* inlineParams,
+	std::string_view dependencyHash
+) {
+	StreamHasher hasher;
+	hasher.Update(source).UpdateValue(CACHE_VERSION).Update(compilerId);
+
+	if (inlineParams) {
+		for (const auto& [name, value] : *inlineParams) {
+			hasher.Update(name).UpdateValue(value.index());
+			if (value.index() == 0) {
+				hasher.UpdateValue(std::get<0>(value));
+			} else {
+				hasher.UpdateValue(std::get<1>(value));
+			}
+		}
+	}
+
+	return hasher.Update(dependencyHash).Finish();
+}
+
+std::string EffectCacheManager::GetPassHash(
+	std::string_view source,
+	const D3D_SHADER_MACRO* macros,
+	std::string_view compilerId,
+	std::string_view dependencyHash
+) {
+	StreamHasher hasher;
+	hasher.Update(source).UpdateValue(CACHE_VERSION).Update(compilerId);
+
+	for (const D3D_SHADER_MACRO* macro = macros; macro && macro->Name; ++macro) {
+		hasher.Update(macro->Name).Update(macro->Definition);
+	}
 
-	return success ? Utils::Bin2Hex(hashBytes) : "";
+	return hasher.Update(dependencyHash).Finish();
 }
@@ -2,10 +2,17 @@
 #include "pch.h"
 #include "Utils.h"
 #include "EffectDesc.h"
+#include "EffectCachePack.h"
+#include <list>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 
 
 class EffectCacheManager {
 public:
+	static constexpr UINT DEFAULT_MAX_VARIANT_COUNT = 4;
+
 	static EffectCacheManager& Get() {
 		static EffectCacheManager instance;
 		return instance;
@@ -13,26 +20,166 @@ public:
 
 	bool Load(std::string_view effectName, std::string_view hash, EffectDesc& desc);
 
+	// 立即加入内存缓存，然后交给后台线程写入磁盘
 	void Save(std::string_view effectName, std::string_view hash, const EffectDesc& desc);
 
+	// 等待所有缓存写入磁盘
+	void Flush();
+
+	// 按通道的哈希读取字节码，不存在时返回空
+	// 字节码在所有效果间共享，源码改变后未改变的通道以及其他效果中相同的通道都可以复用
+	winrt::com_ptr<ID3DBlob> LoadPassBytecode(std::string_view passHash);
+
+	// 是否在后台线程空闲时以较高的等级重新压缩缓存，默认开启
+	void SetRecompressionEnabled(bool value) noexcept {
+		_isRecompressionEnabled.store(value, std::memory_order_relaxed);
+	}
+
+	// 每个效果（flags 相同）保留的特化变体数，内联参数不同的缓存为不同的特化变体
+	// 超出时删除最久未使用的
+	void SetMaxVariantCount(UINT value);
+
+	// compilerId 为编译后端的标识，见 ShaderCompiler::GetId
 	// inlineParams 为内联变量，可以为空
-	// 接受 std::string& 的重载速度更快，且保证不修改 source
+	// dependencyHash 为包含的头文件的哈希，见 EffectIncludeCache::GetDependencyHash
 	static std::string GetHash(
 		std::string_view source,
-		const std::map<std::string, std::variant<float, int>>* inlineParams = nullptr
+		std::string_view compilerId,
+		const std::map<std::string, std::variant<float, int>>* inlineParams = nullptr,
+		std::string_view dependencyHash = {}
 	);
-	static std::string GetHash(
-		std::string& source,
-		const std::map<std::string, std::variant<float, int>>* inlineParams = nullptr
+
+	// 通道的哈希，由生成的源码、宏、编译后端和包含的头文件计算
+	// macros 以空元素结尾
+	static std::string GetPassHash(
+		std::string_view source,
+		const D3D_SHADER_MACRO* macros,
+		std::string_view compilerId,
+		std::string_view dependencyHash = {}
 	);
 
 private:
-	void _AddToMemCache(const std::wstring& cacheFileName, const EffectDesc& desc);
-	bool _LoadFromMemCache(const std::wstring& cacheFileName, EffectDesc& desc);
+	struct _Variant {
+		EffectCachePack::Entry entry;
+		// 本次运行中命中的次数
+		UINT hits = 0;
+	};
+
+	struct _VariantList {
+		// 最近使用的在前
+		std::vector<_Variant> variants;
+		// 本次运行中查找的次数，用于计算命中率
+		UINT lookups = 0;
+	};
+
+	// 以下六个函数调用者需持有 _cs
+	void _OpenPack();
+	void _EvictVariants(_VariantList& list);
+	// 必要时压缩包文件，然后写入索引
+	void _CommitPack();
+	// 包括特化变体和字节码
+	std::vector<EffectCachePack::Entry*> _GetAllEntries();
+	// key 为空时查找字节码
+	EffectCachePack::Entry* _FindEntry(const std::string& key, const std::string& hash);
+	void _RemoveEntry(const std::string& key, const std::string& hash);
+
+	// 从缓存训练的 zstd 字典，创建后不可变
+	struct _CompressionDict;
+	static std::shared_ptr<const _CompressionDict> _CreateDict(std::span<const BYTE> data);
 
-	// 用于同步对 _memCache 的访问
+	// 不持有 _cs 时调用，耗时的解压在锁外进行
+	bool _LoadVariant(const std::string& variantKey, std::string_view hash, EffectDesc& desc);
+	bool _LoadPassesBytecode(EffectDesc& desc);
+
+	struct _MemCacheNode {
+		// {效果名}_{标志位}{哈希}
+		std::string key;
+		std::shared_ptr<const EffectDesc> desc;
+		// 估算的内存占用
+		size_t size = 0;
+	};
+
+	// 内存缓存分为多个分片，每个分片有独立的锁、LRU 链表和预算
+	// 并行读取不同效果时通常不会竞争同一个锁
+	struct _MemCacheShard {
+		Utils::CSMutex cs;
+		// 最近使用的在前
+		std::list<_MemCacheNode> lru;
+		// 键引用 lru 中节点的字符串
+		std::unordered_map<std::string_view, std::list<_MemCacheNode>::iterator> map;
+		size_t size = 0;
+	};
+
+	_MemCacheShard& _GetMemCacheShard(std::string_view cacheKey) noexcept;
+	void _AddToMemCache(const std::string& cacheKey, std::shared_ptr<const EffectDesc> desc);
+	std::shared_ptr<const EffectDesc> _LoadFromMemCache(const std::string& cacheKey);
+	void _RemoveFromMemCache(const std::string& cacheKey);
+
+	std::array<_MemCacheShard, 8> _memCacheShards;
+
+	struct _SaveTask {
+		std::string effectName;
+		std::string hash;
+		std::string cacheKey;
+		std::shared_ptr<const EffectDesc> desc;
+	};
+
+	// 最多允许多少个缓存等待写入
+	static constexpr size_t MAX_PENDING_SAVES = 32;
+	// 积累多少次内存缓存命中后请求提交索引
+	static constexpr size_t MAX_PENDING_TOUCHES = 64;
+
+	// 调用者需持有 _saveMutex
+	void _StartWriter();
+	// 请求后台线程提交索引，调用者不能持有 _cs
+	void _RequestCommit();
+	// 记录一次内存缓存命中，不请求提交。由后台线程在下一次提交索引时更新 LRU 顺序和命中次数
+	void _AddTouch(std::string variantKey, std::string hash);
+	// 索引有修改时提交，在后台线程调用
+	void _CommitIndex();
+
+	void _WriterProc();
+	void _Write(std::string_view effectName, std::string_view hash, const EffectDesc& desc);
+
+	// 以下三个函数在后台线程空闲时调用，返回 false 表示没有需要做的工作
+	// 修改只标记 _isIndexDirty，由 _WriterProc 在一轮空闲工作结束后统一提交
+	// 删除不再被任何特化变体引用的字节码
+	bool _CollectBlobs();
+	bool _TrainDict();
+	bool _RecompressNext();
+
+	// 用于同步对 _saveQueue 的访问，和其他锁无关
+	std::mutex _saveMutex;
+	std::condition_variable _saveCV;
+	std::deque<_SaveTask> _saveQueue;
+	bool _isWriting = false;
+	bool _isWriterStarted = false;
+	// 是否需要后台线程提交索引
+	bool _isCommitRequested = false;
+	// 内存缓存命中的 (variantKey, hash)，由 _CommitIndex 应用
+	std::vector<std::pair<std::string, std::string>> _pendingTouches;
+	// 等待写入的字节码，通道哈希 -> 字节码，由 _saveMutex 保护
+	std::unordered_map<std::string, winrt::com_ptr<ID3DBlob>> _pendingBytecode;
+	std::atomic<bool> _isRecompressionEnabled = true;
+
+	// 用于同步对 _variantIndex、_blobIndex 和 _pack 的访问，持有时可以获取分片的锁，反之不行
+	// 为可重入锁
 	Utils::CSMutex _cs;
-	// cacheFileName -> (EffectDesc, lastAccess)
-	std::unordered_map<std::wstring, std::pair<EffectDesc, UINT>> _memCache;
-	UINT _lastAccess = 0;
+
+	// 特化变体的索引，和包文件的索引一致
+	// {效果名}_{标志位} -> 特化变体
+	std::unordered_map<std::string, _VariantList> _variantIndex;
+	// 字节码的索引，通道哈希 -> 条目（键为空）
+	std::unordered_map<std::string, EffectCachePack::Entry> _blobIndex;
+	// 内存中的索引有尚未提交的修改，由 _CommitPack 清除
+	bool _isIndexDirty = false;
+	// 有特化变体被删除后需要回收字节码，启动时也检查一次
+	bool _isBlobGCNeeded = true;
+	EffectCachePack _pack;
+	bool _isPackOpened = false;
+	// 保存在包文件中，为空表示还未训练
+	std::shared_ptr<const _CompressionDict> _dict;
+	// 每次运行只尝试训练一次
+	bool _isDictTrainingTried = false;
+	UINT _maxVariantCount = DEFAULT_MAX_VARIANT_COUNT;
 };
@@ -0,0 +1,461 @@
+#include "pch.h"
+#include "EffectCachePack.h"
+#include "StrUtils.h"
+#include "Logger.h"
+
+
+// 包文件或索引的结构有更改时更新它
+static constexpr UINT32 PACK_VERSION = 2;
+// "MGPK" 和 "MGIX"
+static constexpr UINT32 PACK_MAGIC = 0x4B50474D;
+static constexpr UINT32 INDEX_MAGIC = 0x5849474D;
+
+// 无用数据超过 1MB 且超过包文件的一半时压缩
+static constexpr UINT64 COMPACT_MIN_GARBAGE_SIZE = 1024 * 1024;
+
+static const wchar_t* PACK_FILE_NAME = L"effects.pack";
+static const wchar_t* INDEX_FILE_NAME = L"effects.idx";
+
+struct PackHeader {
+	UINT32 magic;
+	UINT32 version;
+	UINT64 generation;
+};
+
+struct IndexHeader {
+	UINT32 magic;
+	UINT32 version;
+	UINT64 generation;
+	UINT64 packSize;
+	UINT64 garbageSize;
+	UINT32 entryCount;
+	UINT32 dictSize;
+	UINT64 dictOffset;
+};
+
+struct IndexEntry {
+	UINT64 offset;
+	UINT32 size;
+	UINT16 keySize;
+	UINT8 hashSize;
+	INT8 compressionLevel;
+};
+
+static UINT64 NewGeneration() noexcept {
+	LARGE_INTEGER counter{};
+	QueryPerformanceCounter(&counter);
+	return (UINT64)counter.QuadPart;
+}
+
+static HANDLE OpenFileForWrite(const std::wstring& path, DWORD disposition) {
+	CREATEFILE2_EXTENDED_PARAMETERS extendedParams = {};
+	extendedParams.dwSize = sizeof(CREATEFILE2_EXTENDED_PARAMETERS);
+	extendedParams.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+	extendedParams.dwSecurityQosFlags = SECURITY_ANONYMOUS;
+
+	return Utils::SafeHandle(CreateFile2(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+		FILE_SHARE_READ, disposition, &extendedParams));
+}
+
+static bool WriteAll(HANDLE hFile, const void* data, size_t size) {
+	const BYTE* cur = (const BYTE*)data;
+	while (size > 0) {
+		DWORD toWrite = (DWORD)std::min<size_t>(size, 0x40000000);
+		DWORD written = 0;
+		if (!WriteFile(hFile, cur, toWrite, &written, nullptr) || written == 0) {
+			return false;
+		}
+		cur += written;
+		size -= written;
+	}
+	return true;
+}
+
+EffectCachePack::~EffectCachePack() {
+	_Unmap();
+}
+
+void EffectCachePack::_Unmap() noexcept {
+	if (_mappedData) {
+		UnmapViewOfFile(_mappedData);
+		_mappedData = nullptr;
+	}
+	if (_hMapping) {
+		CloseHandle(_hMapping);
+		_hMapping = NULL;
+	}
+	_mappedSize = 0;
+}
+
+bool EffectCachePack::_Map() {
+	_Unmap();
+
+	// 无法映射空文件
+	if (_packSize == 0) {
+		return true;
+	}
+
+	_hMapping = CreateFileMapping(_hPack.get(), nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!_hMapping) {
+		Logger::Get().Win32Error("CreateFileMapping 失败");
+		return false;
+	}
+
+	_mappedData = (const BYTE*)MapViewOfFile(_hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (!_mappedData) {
+		Logger::Get().Win32Error("MapViewOfFile 失败");
+		CloseHandle(_hMapping);
+		_hMapping = NULL;
+		return false;
+	}
+
+	_mappedSize = _packSize;
+	return true;
+}
+
+bool EffectCachePack::_OpenPackFile() {
+	_hPack.reset(OpenFileForWrite(_packPath, OPEN_ALWAYS));
+	if (!_hPack) {
+		Logger::Get().Win32Error("打开缓存包文件失败");
+		return false;
+	}
+	return true;
+}
+
+// 删除 dir 中包文件和索引以外的文件，如旧版本每个效果一个文件的缓存
+static void DeleteStaleFiles(std::wstring_view dir) {
+	WIN32_FIND_DATA findData{};
+	HANDLE hFind = Utils::SafeHandle(FindFirstFileEx(StrUtils::ConcatW(dir, L"\\*").c_str(),
+		FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+	if (!hFind) {
+		return;
+	}
+
+	do {
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+			continue;
+		}
+
+		if (lstrcmpi(findData.cFileName, PACK_FILE_NAME) == 0 || lstrcmpi(findData.cFileName, INDEX_FILE_NAME) == 0) {
+			continue;
+		}
+
+		if (!DeleteFile(StrUtils::ConcatW(dir, L"\\", findData.cFileName).c_str())) {
+			Logger::Get().Win32Error(StrUtils::Concat("删除缓存文件 ", StrUtils::UTF16ToUTF8(findData.cFileName), " 失败"));
+		}
+	} while (FindNextFile(hFind, &findData));
+
+	FindClose(hFind);
+}
+
+bool EffectCachePack::_Reset() {
+	_Unmap();
+
+	_generation = NewGeneration();
+	_packSize = sizeof(PackHeader);
+	_garbageSize = 0;
+	_dict = {};
+
+	PackHeader header{ PACK_MAGIC, PACK_VERSION, _generation };
+
+	LARGE_INTEGER zero{};
+	if (!SetFilePointerEx(_hPack.get(), zero, nullptr, FILE_BEGIN)
+		|| !SetEndOfFile(_hPack.get())
+		|| !WriteAll(_hPack.get(), &header, sizeof(header))
+	) {
+		Logger::Get().Win32Error("重置缓存包文件失败");
+		_hPack.reset();
+		return false;
+	}
+
+	if (!Commit({}) || !_Map()) {
+		_hPack.reset();
+		return false;
+	}
+
+	DeleteStaleFiles(_packPath.substr(0, _packPath.find_last_of(L'\\')));
+
+	Logger::Get().Info("已重置缓存包文件");
+	return true;
+}
+
+bool EffectCachePack::Open(const wchar_t* dir, std::vector<Entry>& entries) {
+	entries.clear();
+
+	_packPath = StrUtils::ConcatW(dir, L"\\", PACK_FILE_NAME);
+	_indexPath = StrUtils::ConcatW(dir, L"\\", INDEX_FILE_NAME);
+
+	if (!Utils::DirExists(dir) && !CreateDirectory(dir, nullptr)) {
+		Logger::Get().Win32Error("创建 cache 文件夹失败");
+		return false;
+	}
+
+	if (!_OpenPackFile()) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(_hPack.get(), &fileSize)) {
+		Logger::Get().Win32Error("GetFileSizeEx 失败");
+		_hPack.reset();
+		return false;
+	}
+
+	// 读取并验证索引，任何不一致都将清空缓存
+	std::vector<BYTE> indexBuf;
+	if (!Utils::FileExists(_indexPath.c_str()) || !Utils::ReadFile(_indexPath.c_str(), indexBuf)
+		|| indexBuf.size() < sizeof(IndexHeader)) {
+		return _Reset();
+	}
+
+	IndexHeader indexHeader{};
+	std::memcpy(&indexHeader, indexBuf.data(), sizeof(indexHeader));
+
+	PackHeader packHeader{};
+	DWORD read = 0;
+	if (indexHeader.magic != INDEX_MAGIC || indexHeader.version != PACK_VERSION
+		|| (UINT64)fileSize.QuadPart < indexHeader.packSize || indexHeader.packSize < sizeof(PackHeader)
+		|| !::ReadFile(_hPack.get(), &packHeader, sizeof(packHeader), &read, nullptr) || read != sizeof(packHeader)
+		|| packHeader.magic != PACK_MAGIC || packHeader.version != PACK_VERSION
+		|| packHeader.generation != indexHeader.generation
+		|| (indexHeader.dictSize > 0 && (indexHeader.dictOffset < sizeof(PackHeader)
+			|| indexHeader.dictOffset > indexHeader.packSize || indexHeader.packSize - indexHeader.dictOffset < indexHeader.dictSize))
+	) {
+		Logger::Get().Info("缓存包文件和索引不匹配");
+		return _Reset();
+	}
+
+	size_t pos = sizeof(IndexHeader);
+	entries.reserve(indexHeader.entryCount);
+	for (UINT32 i = 0; i < indexHeader.entryCount; ++i) {
+		IndexEntry indexEntry{};
+		if (indexBuf.size() - pos < sizeof(indexEntry)) {
+			entries.clear();
+			return _Reset();
+		}
+		std::memcpy(&indexEntry, indexBuf.data() + pos, sizeof(indexEntry));
+		pos += sizeof(indexEntry);
+
+		if (indexBuf.size() - pos < (size_t)indexEntry.keySize + indexEntry.hashSize
+			|| indexEntry.offset < sizeof(PackHeader) || indexEntry.offset > indexHeader.packSize
+			|| indexHeader.packSize - indexEntry.offset < indexEntry.size
+		) {
+			entries.clear();
+			return _Reset();
+		}
+
+		Entry& entry = entries.emplace_back();
+		entry.key.assign((const char*)indexBuf.data() + pos, indexEntry.keySize);
+		pos += indexEntry.keySize;
+		entry.hash.assign((const char*)indexBuf.data() + pos, indexEntry.hashSize);
+		pos += indexEntry.hashSize;
+		entry.offset = indexEntry.offset;
+		entry.size = indexEntry.size;
+		entry.compressionLevel = indexEntry.compressionLevel;
+	}
+
+	_generation = indexHeader.generation;
+	_packSize = indexHeader.packSize;
+	_garbageSize = indexHeader.garbageSize;
+	_dict.offset = indexHeader.dictOffset;
+	_dict.size = indexHeader.dictSize;
+
+	// 丢弃崩溃前追加但未提交的数据
+	if ((UINT64)fileSize.QuadPart > _packSize) {
+		LARGE_INTEGER end{ .QuadPart = (LONGLONG)_packSize };
+		if (!SetFilePointerEx(_hPack.get(), end, nullptr, FILE_BEGIN) || !SetEndOfFile(_hPack.get())) {
+			Logger::Get().Win32Error("截断缓存包文件失败");
+		}
+	}
+
+	if (!_Map()) {
+		_hPack.reset();
+		return false;
+	}
+
+	return true;
+}
+
+bool EffectCachePack::Read(const Entry& entry, std::vector<BYTE>& result) {
+	if (!_hPack || entry.offset + entry.size > _packSize) {
+		return false;
+	}
+
+	// 映射后追加的数据需要重新映射
+	if (entry.offset + entry.size > _mappedSize && !_Map()) {
+		return false;
+	}
+
+	result.assign(_mappedData + entry.offset, _mappedData + entry.offset + entry.size);
+	return true;
+}
+
+bool EffectCachePack::ReadDictionary(std::vector<BYTE>& result) {
+	if (_dict.size == 0) {
+		result.clear();
+		return true;
+	}
+
+	return Read(_dict, result);
+}
+
+bool EffectCachePack::SetDictionary(std::span<const BYTE> data) {
+	Entry dict;
+	if (!Append(data, dict)) {
+		return false;
+	}
+
+	if (_dict.size > 0) {
+		Discard(_dict);
+	}
+	_dict = dict;
+	return true;
+}
+
+bool EffectCachePack::Append(std::span<const BYTE> data, Entry& entry) {
+	if (!_hPack) {
+		return false;
+	}
+
+	LARGE_INTEGER pos{ .QuadPart = (LONGLONG)_packSize };
+	if (!SetFilePointerEx(_hPack.get(), pos, nullptr, FILE_BEGIN) || !WriteAll(_hPack.get(), data.data(), data.size())) {
+		Logger::Get().Win32Error("写入缓存包文件失败");
+		return false;
+	}
+
+	entry.offset = _packSize;
+	entry.size = (UINT32)data.size();
+	_packSize += data.size();
+	return true;
+}
+
+bool EffectCachePack::CompactIfNeeded(const std::vector<Entry*>& entries) {
+	if (!_hPack || _garbageSize < COMPACT_MIN_GARBAGE_SIZE || _garbageSize * 2 < _packSize) {
+		return true;
+	}
+
+	// 字典和条目一同保留
+	std::vector<Entry*> kept = entries;
+	if (_dict.size > 0) {
+		kept.push_back(&_dict);
+	}
+
+	if (_mappedSize < _packSize && !_Map()) {
+		return false;
+	}
+
+	const UINT64 newGeneration = NewGeneration();
+	std::wstring tempPath = _packPath + L".tmp";
+	std::vector<UINT64> newOffsets;
+	newOffsets.reserve(kept.size());
+
+	{
+		Utils::ScopedHandle hTemp(OpenFileForWrite(tempPath, CREATE_ALWAYS));
+		if (!hTemp) {
+			Logger::Get().Win32Error("创建临时缓存包文件失败");
+			return false;
+		}
+
+		PackHeader header{ PACK_MAGIC, PACK_VERSION, newGeneration };
+		bool success = WriteAll(hTemp.get(), &header, sizeof(header));
+
+		UINT64 offset = sizeof(header);
+		for (const Entry* entry : kept) {
+			if (!success) {
+				break;
+			}
+
+			success = WriteAll(hTemp.get(), _mappedData + entry->offset, entry->size);
+			newOffsets.push_back(offset);
+			offset += entry->size;
+		}
+
+		if (!success || !FlushFileBuffers(hTemp.get())) {
+			Logger::Get().Win32Error("写入临时缓存包文件失败");
+			hTemp.reset();
+			DeleteFile(tempPath.c_str());
+			return false;
+		}
+	}
+
+	// 替换前必须关闭旧文件
+	const UINT64 oldPackSize = _packSize;
+	_Unmap();
+	_hPack.reset();
+
+	if (!MoveFileEx(tempPath.c_str(), _packPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+		Logger::Get().Win32Error("替换缓存包文件失败");
+		DeleteFile(tempPath.c_str());
+
+		// 继续使用旧文件
+		if (!_OpenPackFile()) {
+			return false;
+		}
+		return _Map();
+	}
+
+	if (!_OpenPackFile()) {
+		return false;
+	}
+
+	// 从此刻起索引和包文件不匹配，直到 Commit 完成
+	_generation = newGeneration;
+	_packSize = sizeof(PackHeader);
+	for (size_t i = 0; i < kept.size(); ++i) {
+		kept[i]->offset = newOffsets[i];
+		_packSize += kept[i]->size;
+	}
+	_garbageSize = 0;
+
+	Logger::Get().Info(fmt::format("已压缩缓存包文件：{} 字节 -> {} 字节", oldPackSize, _packSize));
+	return _Map();
+}
+
+bool EffectCachePack::Commit(const std::vector<const Entry*>& entries) {
+	if (!_hPack) {
+		return false;
+	}
+
+	// 确保数据先于索引落盘
+	if (!FlushFileBuffers(_hPack.get())) {
+		Logger::Get().Win32Error("FlushFileBuffers 失败");
+		return false;
+	}
+
+	std::vector<BYTE> buf;
+	buf.reserve(sizeof(IndexHeader) + entries.size() * (sizeof(IndexEntry) + 64));
+
+	auto append = [&buf](const void* data, size_t size) {
+		buf.insert(buf.end(), (const BYTE*)data, (const BYTE*)data + size);
+	};
+
+	IndexHeader header{ INDEX_MAGIC, PACK_VERSION, _generation, _packSize, _garbageSize,
+		(UINT32)entries.size(), _dict.size, _dict.offset };
+	append(&header, sizeof(header));
+
+	for (const Entry* entry : entries) {
+		assert(entry->key.size() <= UINT16_MAX && entry->hash.size() <= UINT8_MAX);
+		IndexEntry indexEntry{ entry->offset, entry->size, (UINT16)entry->key.size(),
+			(UINT8)entry->hash.size(), (INT8)entry->compressionLevel };
+		append(&indexEntry, sizeof(indexEntry));
+		append(entry->key.data(), entry->key.size());
+		append(entry->hash.data(), entry->hash.size());
+	}
+
+	std::wstring tempPath = _indexPath + L".tmp";
+	{
+		Utils::ScopedHandle hTemp(OpenFileForWrite(tempPath, CREATE_ALWAYS));
+		if (!hTemp || !WriteAll(hTemp.get(), buf.data(), buf.size()) || !FlushFileBuffers(hTemp.get())) {
+			Logger::Get().Win32Error("写入缓存索引失败");
+			return false;
+		}
+	}
+
+	if (!MoveFileEx(tempPath.c_str(), _indexPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+		Logger::Get().Win32Error("替换缓存索引失败");
+		DeleteFile(tempPath.c_str());
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "pch.h"
+#include "Utils.h"
+
+
+// 所有效果的缓存保存在一个只追加的包文件中，由单独的索引文件定位
+// 包文件：PackHeader | 数据 | 数据 | ...
+// 索引文件：IndexHeader | (IndexEntry | 键 | 哈希) ...
+// 包文件中还可以保存一个不属于任何条目的字典，位置记录在 IndexHeader 中
+// 索引通过临时文件和重命名原子地替换，程序崩溃时最多丢失未提交的缓存
+// 非线程安全，由调用者同步
+class EffectCachePack {
+public:
+	struct Entry {
+		// {效果名}_{标志位（16进制）}
+		std::string key;
+		std::string hash;
+		UINT64 offset = 0;
+		UINT32 size = 0;
+		// 数据的压缩等级，由调用者设置，随索引保存
+		int compressionLevel = 0;
+	};
+
+	EffectCachePack() = default;
+	EffectCachePack(const EffectCachePack&) = delete;
+	EffectCachePack(EffectCachePack&&) = delete;
+
+	~EffectCachePack();
+
+	// 打开或创建 dir 下的包文件，包文件或索引损坏时清空缓存
+	// entries 为索引中的条目，顺序和提交时相同
+	bool Open(const wchar_t* dir, std::vector<Entry>& entries);
+
+	bool IsOpen() const noexcept {
+		return (bool)_hPack;
+	}
+
+	// 从映射的包文件复制数据
+	bool Read(const Entry& entry, std::vector<BYTE>& result);
+
+	// 读取字典，没有字典时 result 为空
+	bool ReadDictionary(std::vector<BYTE>& result);
+
+	// 追加字典并替换旧字典，需随后调用 Commit
+	bool SetDictionary(std::span<const BYTE> data);
+
+	// 追加到包文件末尾，成功后设置 entry.offset 和 entry.size
+	// 提交前不会被索引引用
+	bool Append(std::span<const BYTE> data, Entry& entry);
+
+	// 标记不再被引用的数据，用于决定何时压缩
+	void Discard(const Entry& entry) noexcept {
+		_garbageSize += entry.size;
+	}
+
+	// 无用数据超过阈值时重写包文件，只保留 entries 引用的数据和字典，并更新它们的 offset
+	// 需随后调用 Commit
+	bool CompactIfNeeded(const std::vector<Entry*>& entries);
+
+	// 写入索引，entries 的顺序将被保留
+	bool Commit(const std::vector<const Entry*>& entries);
+
+private:
+	bool _Reset();
+	bool _OpenPackFile();
+	bool _Map();
+	void _Unmap() noexcept;
+
+	std::wstring _packPath;
+	std::wstring _indexPath;
+
+	Utils::ScopedHandle _hPack;
+	HANDLE _hMapping = NULL;
+	const BYTE* _mappedData = nullptr;
+	UINT64 _mappedSize = 0;
+
+	// 每次重写包文件时改变，索引和包文件的 generation 不同说明两者不匹配
+	UINT64 _generation = 0;
+	// 已提交的数据和正在追加的数据的总大小
+	UINT64 _packSize = 0;
+	UINT64 _garbageSize = 0;
+	// size 为 0 表示没有字典
+	Entry _dict;
+};
@@ -6,11 +6,13 @@
 #include <charconv>
 #include "EffectCacheManager.h"
 #include "StrUtils.h"
-#include "App.h"
-#include "DeviceResources.h"
 #include "Logger.h"
 #include <bit>	// std::has_single_bit
 #include "Config.h"
+#include "EffectIncludeCache.h"
+#include "TaskScheduler.h"
+#include "ShaderCompiler.h"
+#include "EffectFusionCache.h"
 
 
 static const char* META_INDICATOR = "//!";
@@ -18,6 +20,8 @@ static const char* META_INDICATOR = "//!";
 static const wchar_t* SAVE_SOURCE_DIR = L".\\sources";
 
 
+// 从 EffectIncludeCache 获取头文件，直接将映射的内存交给编译器
+// 每个编译任务使用单独的实例，保证编译期间头文件有效
 class PassInclude : public ID3DInclude {
 public:
 	HRESULT CALLBACK Open(
@@ -27,38 +31,154 @@ public:
 		LPCVOID* ppData,
 		UINT* pBytes
 	) override {
-		std::wstring relativePath = StrUtils::ConcatW(L"effects\\", StrUtils::UTF8ToUTF16(pFileName));
-
-		std::string file;
-		if (!Utils::ReadTextFile(relativePath.c_str(), file)) {
+		std::shared_ptr<const EffectIncludeCache::File> file = EffectIncludeCache::Get().Open(pFileName);
+		if (!file) {
 			return E_FAIL;
 		}
 
-		char* result = new char[file.size()];
-		std::memcpy(result, file.data(), file.size());
-
-		*ppData = result;
-		*pBytes = (UINT)file.size();
+		std::string_view content = file->GetContent();
+		*ppData = content.empty() ? "" : content.data();
+		*pBytes = (UINT)content.size();
 
+		_files.emplace_back(std::move(file));
 		return S_OK;
 	}
 
 	HRESULT CALLBACK Close(LPCVOID pData) override {
-		delete[](char*)pData;
+		// 析构时释放
 		return S_OK;
 	}
+
+private:
+	std::vector<std::shared_ptr<const EffectIncludeCache::File>> _files;
+};
+
+// MagpieFX 中所有的关键字，包括选项名和部分选项值
+enum class MetaKeyword {
+	Unknown,
+	Magpie,
+	Effect,
+	Version,
+	OutputWidth,
+	OutputHeight,
+	UseDynamic,
+	Parameter,
+	Default,
+	Label,
+	Min,
+	Max,
+	Texture,
+	Source,
+	Format,
+	Width,
+	Height,
+	Sampler,
+	Filter,
+	Address,
+	Common,
+	Pass,
+	In,
+	Out,
+	BlockSize,
+	NumThreads,
+	Style,
+	Desc,
+	Linear,
+	Point,
+	Clamp,
+	Wrap
+};
+
+static constexpr char ToUpperASCII(char c) noexcept {
+	return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+}
+
+// 关键字的完美哈希，仅使用长度和首尾字符
+// 参数改变时编译期的检查可以发现冲突
+static constexpr UINT HashMetaKeyword(std::string_view token) noexcept {
+	return ((UINT)token.size() * 2 + (UINT)ToUpperASCII(token.front()) * 19 + (UINT)ToUpperASCII(token.back()) * 12) & 63;
+}
+
+struct MetaKeywordEntry {
+	std::string_view name;
+	MetaKeyword keyword = MetaKeyword::Unknown;
 };
 
+static constexpr std::array<MetaKeywordEntry, 64> META_KEYWORD_TABLE = []() {
+	constexpr MetaKeywordEntry keywords[] = {
+		{"MAGPIE", MetaKeyword::Magpie},
+		{"EFFECT", MetaKeyword::Effect},
+		{"VERSION", MetaKeyword::Version},
+		{"OUTPUT_WIDTH", MetaKeyword::OutputWidth},
+		{"OUTPUT_HEIGHT", MetaKeyword::OutputHeight},
+		{"USE_DYNAMIC", MetaKeyword::UseDynamic},
+		{"PARAMETER", MetaKeyword::Parameter},
+		{"DEFAULT", MetaKeyword::Default},
+		{"LABEL", MetaKeyword::Label},
+		{"MIN", MetaKeyword::Min},
+		{"MAX", MetaKeyword::Max},
+		{"TEXTURE", MetaKeyword::Texture},
+		{"SOURCE", MetaKeyword::Source},
+		{"FORMAT", MetaKeyword::Format},
+		{"WIDTH", MetaKeyword::Width},
+		{"HEIGHT", MetaKeyword::Height},
+		{"SAMPLER", MetaKeyword::Sampler},
+		{"FILTER", MetaKeyword::Filter},
+		{"ADDRESS", MetaKeyword::Address},
+		{"COMMON", MetaKeyword::Common},
+		{"PASS", MetaKeyword::Pass},
+		{"IN", MetaKeyword::In},
+		{"OUT", MetaKeyword::Out},
+		{"BLOCK_SIZE", MetaKeyword::BlockSize},
+		{"NUM_THREADS", MetaKeyword::NumThreads},
+		{"STYLE", MetaKeyword::Style},
+		{"DESC", MetaKeyword::Desc},
+		{"LINEAR", MetaKeyword::Linear},
+		{"POINT", MetaKeyword::Point},
+		{"CLAMP", MetaKeyword::Clamp},
+		{"WRAP", MetaKeyword::Wrap}
+	};
+
+	std::array<MetaKeywordEntry, 64> result{};
+	for (const MetaKeywordEntry& entry : keywords) {
+		MetaKeywordEntry& slot = result[HashMetaKeyword(entry.name)];
+		if (slot.keyword != MetaKeyword::Unknown) {
+			// 哈希冲突，无法在编译期求值
+			throw "META_KEYWORD_TABLE 存在冲突";
+		}
+		slot = entry;
+	}
+	return result;
+}();
+
+// 不区分大小写地匹配关键字，不分配内存
+static MetaKeyword GetMetaKeyword(std::string_view token) noexcept {
+	if (token.empty()) {
+		return MetaKeyword::Unknown;
+	}
+
+	const MetaKeywordEntry& entry = META_KEYWORD_TABLE[HashMetaKeyword(token)];
+	if (entry.name.size() != token.size()) {
+		return MetaKeyword::Unknown;
+	}
+
+	for (size_t i = 0; i < token.size(); ++i) {
+		if (ToUpperASCII(token[i]) != entry.name[i]) {
+			return MetaKeyword::Unknown;
+		}
+	}
+
+	return entry.keyword;
+}
+
+// 原地删除注释，不分配新的内存
 UINT RemoveComments(std::string& source) {
 	// 确保以换行符结尾
 	if (source.back() != '\n') {
 		source.push_back('\n');
 	}
 
-	std::string result;
-	result.reserve(source.size());
-
-	int j = 0;
+	size_t j = 0;
 	// 单独处理最后两个字符
 	for (size_t i = 0, end = source.size() - 2; i < end; ++i) {
 		if (source[i] == '/') {
@@ -228,23 +348,19 @@ static UINT GetNextNumber(std::string_view& source, T& value) {
 	return 0;
 }
 
-UINT GetNextExpr(std::string_view& source, std::string& expr) {
+// 下一个表达式的原始文本，不消耗 source
+static std::string GetExprSource(std::string_view source) {
+	std::string_view expr = source.substr(0, source.find('\n'));
+	StrUtils::Trim(expr);
+	return std::string(expr);
+}
+
+// isOutputAllowed 为 false 时表达式中不能使用 OUTPUT_WIDTH 和 OUTPUT_HEIGHT
+UINT GetNextExpr(std::string_view& source, EffectExpr& expr, bool isOutputAllowed) {
 	RemoveLeadingBlanks<false>(source);
 	size_t size = std::min(source.find('\n') + 1, source.size());
 
-	// 移除空白字符
-	expr.resize(size);
-
-	size_t j = 0;
-	for (size_t i = 0; i < size; ++i) {
-		char c = source[i];
-		if (!isspace(c)) {
-			expr[j++] = c;
-		}
-	}
-	expr.resize(j);
-
-	if (expr.empty()) {
+	if (expr.Compile(source.substr(0, size), isOutputAllowed)) {
 		return 1;
 	}
 
@@ -252,7 +368,8 @@ UINT GetNextExpr(std::string_view& source, std::string& expr) {
 	return 0;
 }
 
-UINT ResolveHeader(std::string_view block, EffectDesc& desc) {
+// outSizeSource 不为空时返回 OUTPUT_WIDTH 和 OUTPUT_HEIGHT 的原始表达式
+UINT ResolveHeader(std::string_view block, EffectDesc& desc, std::pair<std::string, std::string>* outSizeSource) {
 	// 必需的选项：VERSION
 	// 可选的选项：OUTPUT_WIDTH，OUTPUT_HEIGHT，USE_DYNAMIC
 
@@ -268,9 +385,9 @@ UINT ResolveHeader(std::string_view block, EffectDesc& desc) {
 		if (GetNextToken<false>(block, token)) {
 			return 1;
 		}
-		std::string t = StrUtils::ToUpperCase(token);
+		MetaKeyword t = GetMetaKeyword(token);
 
-		if (t == "VERSION") {
+		if (t == MetaKeyword::Version) {
 			if (processed[0]) {
 				return 1;
 			}
@@ -288,25 +405,33 @@ UINT ResolveHeader(std::string_view block, EffectDesc& desc) {
 			if (GetNextToken<false>(block, token) != 2) {
 				return 1;
 			}
-		} else if (t == "OUTPUT_WIDTH") {
+		} else if (t == MetaKeyword::OutputWidth) {
 			if (processed[1]) {
 				return 1;
 			}
 			processed[1] = true;
 
-			if (GetNextExpr(block, desc.outSizeExpr.first)) {
+			if (outSizeSource) {
+				outSizeSource->first = GetExprSource(block);
+			}
+
+			if (GetNextExpr(block, desc.outSizeExpr.first, false)) {
 				return 1;
 			}
-		} else if (t == "OUTPUT_HEIGHT") {
+		} else if (t == MetaKeyword::OutputHeight) {
 			if (processed[2]) {
 				return 1;
 			}
 			processed[2] = true;
 
-			if (GetNextExpr(block, desc.outSizeExpr.second)) {
+			if (outSizeSource) {
+				outSizeSource->second = GetExprSource(block);
+			}
+
+			if (GetNextExpr(block, desc.outSizeExpr.second, false)) {
 				return 1;
 			}
-		} else if (t == "USE_DYNAMIC") {
+		} else if (t == MetaKeyword::UseDynamic) {
 			if (processed[3]) {
 				return 1;
 			}
@@ -368,9 +493,9 @@ UINT ResolveParameter(std::string_view block, EffectDesc& desc) {
 			return 1;
 		}
 
-		std::string t = StrUtils::ToUpperCase(token);
+		MetaKeyword t = GetMetaKeyword(token);
 
-		if (t == "DEFAULT") {
+		if (t == MetaKeyword::Default) {
 			if (processed[0]) {
 				return 1;
 			}
@@ -379,7 +504,7 @@ UINT ResolveParameter(std::string_view block, EffectDesc& desc) {
 			if (GetNextString(block, defaultValue)) {
 				return 1;
 			}
-		} else if (t == "LABEL") {
+		} else if (t == MetaKeyword::Label) {
 			if (processed[1]) {
 				return 1;
 			}
@@ -390,7 +515,7 @@ UINT ResolveParameter(std::string_view block, EffectDesc& desc) {
 				return 1;
 			}
 			paramDesc.label = t;
-		} else if (t == "MIN") {
+		} else if (t == MetaKeyword::Min) {
 			if (processed[2]) {
 				return 1;
 			}
@@ -399,7 +524,7 @@ UINT ResolveParameter(std::string_view block, EffectDesc& desc) {
 			if (GetNextString(block, minValue)) {
 				return 1;
 			}
-		} else if (t == "MAX") {
+		} else if (t == MetaKeyword::Max) {
 			if (processed[3]) {
 				return 1;
 			}
@@ -549,9 +674,9 @@ UINT ResolveTexture(std::string_view block, EffectDesc& desc) {
 			return 1;
 		}
 
-		std::string t = StrUtils::ToUpperCase(token);
+		MetaKeyword t = GetMetaKeyword(token);
 
-		if (t == "SOURCE") {
+		if (t == MetaKeyword::Source) {
 			if (processed[0] || processed[2] || processed[3]) {
 				return 1;
 			}
@@ -562,7 +687,7 @@ UINT ResolveTexture(std::string_view block, EffectDesc& desc) {
 			}
 
 			texDesc.source = token;
-		} else if (t == "FORMAT") {
+		} else if (t == MetaKeyword::Format) {
 			if (processed[1]) {
 				return 1;
 			}
@@ -575,7 +700,7 @@ UINT ResolveTexture(std::string_view block, EffectDesc& desc) {
 			using enum EffectIntermediateTextureFormat;
 
 			static auto formatMap = []() {
-				std::unordered_map<std::string, EffectIntermediateTextureFormat> result;
+				std::unordered_map<std::string_view, EffectIntermediateTextureFormat> result;
 				// UNKNOWN 不可用
 				for (UINT i = 0, end = (UINT)std::size(EffectIntermediateTextureDesc::FORMAT_DESCS) - 1; i < end; ++i) {
 					result.emplace(EffectIntermediateTextureDesc::FORMAT_DESCS[i].name, (EffectIntermediateTextureFormat)i);
@@ -583,28 +708,28 @@ UINT ResolveTexture(std::string_view block, EffectDesc& desc) {
 				return result;
 			}();
 
-			auto it = formatMap.find(std::string(token));
+			auto it = formatMap.find(token);
 			if (it == formatMap.end()) {
 				return 1;
 			}
 
 			texDesc.format = it->second;
-		} else if (t == "WIDTH") {
+		} else if (t == MetaKeyword::Width) {
 			if (processed[0] || processed[2]) {
 				return 1;
 			}
 			processed[2] = true;
 
-			if (GetNextExpr(block, texDesc.sizeExpr.first)) {
+			if (GetNextExpr(block, texDesc.sizeExpr.first, true)) {
 				return 1;
 			}
-		} else if (t == "HEIGHT") {
+		} else if (t == MetaKeyword::Height) {
 			if (processed[0] || processed[3]) {
 				return 1;
 			}
 			processed[3] = true;
 
-			if (GetNextExpr(block, texDesc.sizeExpr.second)) {
+			if (GetNextExpr(block, texDesc.sizeExpr.second, true)) {
 				return 1;
 			}
 		} else {
@@ -678,9 +803,9 @@ UINT ResolveSampler(std::string_view block, EffectDesc& desc) {
 			return 1;
 		}
 
-		std::string t = StrUtils::ToUpperCase(token);
+		MetaKeyword t = GetMetaKeyword(token);
 
-		if (t == "FILTER") {
+		if (t == MetaKeyword::Filter) {
 			if (processed[0]) {
 				return 1;
 			}
@@ -690,16 +815,16 @@ UINT ResolveSampler(std::string_view block, EffectDesc& desc) {
 				return 1;
 			}
 
-			std::string filter = StrUtils::ToUpperCase(token);
+			MetaKeyword filter = GetMetaKeyword(token);
 
-			if (filter == "LINEAR") {
+			if (filter == MetaKeyword::Linear) {
 				samDesc.filterType = EffectSamplerFilterType::Linear;
-			} else if (filter == "POINT") {
+			} else if (filter == MetaKeyword::Point) {
 				samDesc.filterType = EffectSamplerFilterType::Point;
 			} else {
 				return 1;
 			}
-		} else if (t == "ADDRESS") {
+		} else if (t == MetaKeyword::Address) {
 			if (processed[1]) {
 				return 1;
 			}
@@ -709,11 +834,11 @@ UINT ResolveSampler(std::string_view block, EffectDesc& desc) {
 				return 1;
 			}
 
-			std::string filter = StrUtils::ToUpperCase(token);
+			MetaKeyword filter = GetMetaKeyword(token);
 
-			if (filter == "CLAMP") {
+			if (filter == MetaKeyword::Clamp) {
 				samDesc.addressType = EffectSamplerAddressType::Clamp;
-			} else if (filter == "WRAP") {
+			} else if (filter == MetaKeyword::Wrap) {
 				samDesc.addressType = EffectSamplerAddressType::Wrap;
 			} else {
 				return 1;
@@ -844,9 +969,9 @@ UINT ResolvePasses(
 				return 1;
 			}
 
-			std::string t = StrUtils::ToUpperCase(token);
+			MetaKeyword t = GetMetaKeyword(token);
 
-			if (t == "IN") {
+			if (t == MetaKeyword::In) {
 				if (processed[0]) {
 					return 1;
 				}
@@ -870,7 +995,7 @@ UINT ResolvePasses(
 					passDesc.inputs.push_back(it->second);
 					texNames.erase(it);
 				}
-			} else if (t == "OUT") {
+			} else if (t == MetaKeyword::Out) {
 				if (processed[1]) {
 					return 1;
 				}
@@ -904,7 +1029,7 @@ UINT ResolvePasses(
 					passDesc.outputs.push_back(it->second);
 					texNames.erase(it);
 				}
-			} else if (t == "BLOCK_SIZE") {
+			} else if (t == MetaKeyword::BlockSize) {
 				if (processed[2]) {
 					return 1;
 				}
@@ -943,7 +1068,7 @@ UINT ResolvePasses(
 				}
 
 				passDesc.blockSize.second = num;
-			} else if (t == "NUM_THREADS") {
+			} else if (t == MetaKeyword::NumThreads) {
 				if (processed[3]) {
 					return 1;
 				}
@@ -973,7 +1098,7 @@ UINT ResolvePasses(
 
 					passDesc.numThreads[i] = num;
 				}
-			} else if (t == "STYLE") {
+			} else if (t == MetaKeyword::Style) {
 				if (processed[4]) {
 					return 1;
 				}
@@ -992,7 +1117,7 @@ UINT ResolvePasses(
 				} else if (val != "CS") {
 					return 1;
 				}
-			} else if (t == "DESC") {
+			} else if (t == MetaKeyword::Desc) {
 				if (processed[5]) {
 					return 1;
 				}
@@ -1029,146 +1154,176 @@ UINT ResolvePasses(
 }
 
 
-UINT GeneratePassSource(
+// 用于在 FP32 和 FP16 间切换的宏
+#define MF_MACROS(T) \
+	{"MF", #T}, \
+	{"MF1", #T "1"}, {"MF1x1", #T "1x1"}, {"MF1x2", #T "1x2"}, {"MF1x3", #T "1x3"}, {"MF1x4", #T "1x4"}, \
+	{"MF2", #T "2"}, {"MF2x1", #T "2x1"}, {"MF2x2", #T "2x2"}, {"MF2x3", #T "2x3"}, {"MF2x4", #T "2x4"}, \
+	{"MF3", #T "3"}, {"MF3x1", #T "3x1"}, {"MF3x2", #T "3x2"}, {"MF3x3", #T "3x3"}, {"MF3x4", #T "3x4"}, \
+	{"MF4", #T "4"}, {"MF4x1", #T "4x1"}, {"MF4x2", #T "4x2"}, {"MF4x3", #T "4x3"}, {"MF4x4", #T "4x4"}
+
+static constexpr D3D_SHADER_MACRO FP32_MACROS[] = { MF_MACROS(float) };
+static constexpr D3D_SHADER_MACRO FP16_MACROS[] = { {"MP_FP16", ""}, MF_MACROS(min16float) };
+
+#undef MF_MACROS
+
+// 所有通道共用的代码和宏，每个效果只生成一次
+struct EffectPreamble {
+	// 常量缓冲区和采样器
+	std::string head;
+	// 内置函数和 COMMON 块
+	std::string tail;
+	// 内联常量的值，macros 引用其中的字符串
+	std::vector<std::string> inlineParamValues;
+	// 所有通道共用的宏，不含结尾的空元素
+	std::vector<D3D_SHADER_MACRO> macros;
+};
+
+// 每个通道独有的宏
+struct PassMacros {
+	// MP_BLOCK_WIDTH 等数值宏的值
+	std::array<std::array<char, 12>, 5> numbers{};
+	// 以空元素结尾，可直接传给 D3DCompile
+	std::vector<D3D_SHADER_MACRO> macros;
+};
+
+UINT GeneratePreamble(
 	const EffectDesc& desc,
-	UINT passIdx,
-	std::string_view cbHlsl,
 	const std::vector<std::string_view>& commonBlocks,
-	std::string_view passBlock,
 	const std::map<std::string, std::variant<float, int>>& inlineParams,
-	std::string& result,
-	std::vector<std::pair<std::string, std::string>>& macros
+	EffectPreamble& preamble
 ) {
 	bool isLastEffect = desc.flags & EFFECT_FLAG_LAST_EFFECT;
-	bool isLastPass = passIdx == desc.passes.size();
 	bool isInlineParams = desc.flags & EFFECT_FLAG_INLINE_PARAMETERS;
 
-	const EffectPassDesc& passDesc = desc.passes[(size_t)passIdx - 1];
-
-	{
-		// 估算需要的空间
-		size_t reservedSize = 2048 + cbHlsl.size() + passBlock.size();
-		for (std::string_view commonBlock : commonBlocks) {
-			reservedSize += commonBlock.size();
-		}
-
-		result.reserve(reservedSize);
-	}
-
-	// 常量缓冲区
-	result.append(cbHlsl);
-
 	////////////////////////////////////////////////////////////////////////////////////////////////////////
 	//
-	// SRV、UAV 和采样器
+	// 常量缓冲区和采样器
 	// 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////
-	
-	// SRV
-	for (int i = 0; i < passDesc.inputs.size(); ++i) {
-		auto& texDesc = desc.textures[passDesc.inputs[i]];
-		result.append(fmt::format("Texture2D<{}> {} : register(t{});\n", EffectIntermediateTextureDesc::FORMAT_DESCS[(UINT)texDesc.format].srvTexelType, texDesc.name, i));
-	}
 
-	if (isLastEffect && isLastPass) {
-		result.append(fmt::format("Texture2D<float4> __CURSOR : register(t{});\n", passDesc.inputs.size()));
-	}
+	std::string& head = preamble.head;
+	head.reserve(1024);
 
-	// UAV
-	if (passDesc.outputs.empty()) {
-		if (!isLastPass) {
-			return 1;
-		}
+	head.append(R"(cbuffer __CB1 : register(b0) {
+	int4 __cursorRect;
+	float2 __cursorPt;
+	uint2 __cursorPos;
+	uint __cursorType;
+	uint __frameCount;
+};
+cbuffer __CB2 : register(b1) {
+	uint2 __inputSize;
+	uint2 __outputSize;
+	float2 __inputPt;
+	float2 __outputPt;
+	float2 __scale;
+	int2 __viewport;
+)");
 
-		result.append("RWTexture2D<unorm float4> __OUTPUT : register(u0);\n");
-	} else {
-		if (isLastPass) {
-			return 1;
-		}
+	if (isLastEffect) {
+		// 指定输出到屏幕的位置
+		head.append("\tint4 __offset;\n");
+	}
 
-		for (int i = 0; i < passDesc.outputs.size(); ++i) {
-			auto& texDesc = desc.textures[passDesc.outputs[i]];
-			result.append(fmt::format("RWTexture2D<{}> {} : register(u{});\n", EffectIntermediateTextureDesc::FORMAT_DESCS[(UINT)texDesc.format].uavTexelType, texDesc.name, i));
+	// PS 样式需要获知输出纹理的尺寸
+	// 最后一个通道不需要
+	for (UINT i = 0, end = (UINT)desc.passes.size() - 1; i < end; ++i) {
+		if (desc.passes[i].isPSStyle) {
+			fmt::format_to(std::back_inserter(head), "\tuint2 __pass{0}OutputSize;\n\tfloat2 __pass{0}OutputPt;\n", i + 1);
 		}
 	}
 
-	if (!desc.samplers.empty()) {
-		// 采样器
-		for (int i = 0; i < desc.samplers.size(); ++i) {
-			result.append(fmt::format("SamplerState {} : register(s{});\n", desc.samplers[i].name, i));
+	if (!isInlineParams) {
+		for (const auto& d : desc.params) {
+			head.append("\t")
+				.append(d.type == EffectConstantType::Int ? "int " : "float ")
+				.append(d.name)
+				.append(";\n");
 		}
 	}
 
+	head.append("};\n\n");
+
+	for (int i = 0; i < desc.samplers.size(); ++i) {
+		fmt::format_to(std::back_inserter(head), "SamplerState {} : register(s{});\n", desc.samplers[i].name, i);
+	}
+
 	if (isLastEffect) {
 		// 绘制光标使用的采样器
-		result.append(fmt::format("SamplerState __CURSOR_SAMPLER : register(s{});\n", desc.samplers.size()));
+		fmt::format_to(std::back_inserter(head), "SamplerState __CURSOR_SAMPLER : register(s{});\n", desc.samplers.size());
 	}
 
-	result.push_back('\n');
-
 	////////////////////////////////////////////////////////////////////////////////////////////////////////
 	//
-	// 内置宏
+	// 内置函数和 COMMON 块
 	// 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////
-	macros.reserve(64);
-	macros.emplace_back("MP_BLOCK_WIDTH", std::to_string(passDesc.blockSize.first));
-	macros.emplace_back("MP_BLOCK_HEIGHT", std::to_string(passDesc.blockSize.second));
-	macros.emplace_back("MP_NUM_THREADS_X", std::to_string(passDesc.numThreads[0]));
-	macros.emplace_back("MP_NUM_THREADS_Y", std::to_string(passDesc.numThreads[1]));
-	macros.emplace_back("MP_NUM_THREADS_Z", std::to_string(passDesc.numThreads[2]));
 
-	if (passDesc.isPSStyle) {
-		macros.emplace_back("MP_PS_STYLE", "");
+	std::string& tail = preamble.tail;
+	{
+		size_t reservedSize = 1024;
+		for (std::string_view commonBlock : commonBlocks) {
+			reservedSize += commonBlock.size() + 1;
+		}
+		tail.reserve(reservedSize);
 	}
 
-	if (isInlineParams) {
-		macros.emplace_back("MP_INLINE_PARAMS", "");
-	}
+	tail.append(R"(uint __Bfe(uint src, uint off, uint bits) { uint mask = (1u << bits) - 1; return (src >> off) & mask; }
+uint __BfiM(uint src, uint ins, uint bits) { uint mask = (1u << bits) - 1; return (ins & mask) | (src & (~mask)); }
+uint2 Rmp8x8(uint a) { return uint2(__Bfe(a, 1u, 3u), __BfiM(__Bfe(a, 3u, 3u), a, 1u)); }
+uint2 GetInputSize() { return __inputSize; }
+float2 GetInputPt() { return __inputPt; }
+uint2 GetOutputSize() { return __outputSize; }
+float2 GetOutputPt() { return __outputPt; }
+float2 GetScale() { return __scale; }
+)");
 
-	if (isLastPass) {
-		macros.emplace_back("MP_LAST_PASS", "");
-	}
+	if (desc.isUseDynamic) {
+		tail.append(R"(uint GetFrameCount() { return __frameCount; }
+uint2 GetCursorPos() { return __cursorPos; }
 
-	if (isLastEffect) {
-		macros.emplace_back("MP_LAST_EFFECT", "");
+)");
+	} else {
+		tail.push_back('\n');
 	}
 
-#ifdef _DEBUG
-	macros.emplace_back("MP_DEBUG", "");
-#endif
+	for (std::string_view commonBlock : commonBlocks) {
+		tail.append(commonBlock);
+		tail.push_back('\n');
+	}
 
-	// 用于在 FP32 和 FP16 间切换的宏
-	static const char* numbers[] = { "1","2","3","4" };
-	if (desc.flags & EFFECT_FLAG_FP16) {
-		macros.emplace_back("MP_FP16", "");
-		macros.emplace_back("MF", "min16float");
+	////////////////////////////////////////////////////////////////////////////////////////////////////////
+	//
+	// 所有通道共用的宏
+	// 
+	////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-		for (UINT i = 0; i < 4; ++i) {
-			macros.emplace_back(StrUtils::Concat("MF", numbers[i]), StrUtils::Concat("min16float", numbers[i]));
+	std::vector<D3D_SHADER_MACRO>& macros = preamble.macros;
+	macros.reserve(std::size(FP16_MACROS) + desc.params.size() + 3);
 
-			for (UINT j = 0; j < 4; ++j) {
-				macros.emplace_back(StrUtils::Concat("MF", numbers[i], "x", numbers[j]), StrUtils::Concat("min16float", numbers[i], "x", numbers[j]));
-			}
-		}
+	if (desc.flags & EFFECT_FLAG_FP16) {
+		macros.insert(macros.end(), std::begin(FP16_MACROS), std::end(FP16_MACROS));
 	} else {
-		macros.emplace_back("MF", "float");
-
-		for (UINT i = 0; i < 4; ++i) {
-			macros.emplace_back(StrUtils::Concat("MF", numbers[i]), StrUtils::Concat("float", numbers[i]));
+		macros.insert(macros.end(), std::begin(FP32_MACROS), std::end(FP32_MACROS));
+	}
 
-			for (UINT j = 0; j < 4; ++j) {
-				macros.emplace_back(StrUtils::Concat("MF", numbers[i], "x", numbers[j]), StrUtils::Concat("float", numbers[i], "x", numbers[j]));
-			}
-		}
+	if (isLastEffect) {
+		macros.push_back({ "MP_LAST_EFFECT", "" });
 	}
 
-	////////////////////////////////////////////////////////////////////////////////////////////////////////
-	//
-	// 内联常量
-	// 
-	////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifdef _DEBUG
+	macros.push_back({ "MP_DEBUG", "" });
+#endif
+
 	if (isInlineParams) {
+		macros.push_back({ "MP_INLINE_PARAMS", "" });
+
+		// 内联常量
+		// 先保存所有的值，确保 macros 引用的字符串不会失效
+		std::vector<std::string>& values = preamble.inlineParamValues;
+		values.reserve(desc.params.size());
+
 		std::unordered_set<std::string_view> paramNames;
 		for (const auto& d : desc.params) {
 			paramNames.emplace(d.name);
@@ -1176,19 +1331,19 @@ UINT GeneratePassSource(
 			auto it = inlineParams.find(d.name);
 			if (it == inlineParams.end()) {
 				if (d.type == EffectConstantType::Float) {
-					macros.emplace_back(d.name, std::to_string(std::get<float>(d.defaultValue)));
+					values.emplace_back(std::to_string(std::get<float>(d.defaultValue)));
 				} else {
-					macros.emplace_back(d.name, std::to_string(std::get<int>(d.defaultValue)));
+					values.emplace_back(std::to_string(std::get<int>(d.defaultValue)));
 				}
 			} else {
 				if (it->second.index() == 1) {
-					macros.emplace_back(d.name, std::to_string(std::get<int>(it->second)));
+					values.emplace_back(std::to_string(std::get<int>(it->second)));
 				} else {
 					if (d.type == EffectConstantType::Int) {
 						return 1;
 					}
 
-					macros.emplace_back(d.name, std::to_string(std::get<float>(it->second)));
+					values.emplace_back(std::to_string(std::get<float>(it->second)));
 				}
 			}
 		}
@@ -1199,9 +1354,106 @@ UINT GeneratePassSource(
 			}
 		}
 
-		result.push_back('\n');
+		for (size_t i = 0; i < desc.params.size(); ++i) {
+			macros.push_back({ desc.params[i].name.c_str(), values[i].c_str() });
+		}
+	}
+
+	return 0;
+}
+
+// fusedBlock 不为空时为融合到最后一个通道的后一个效果，见 EffectCompiler::CompileFused
+UINT GeneratePassSource(
+	const EffectDesc& desc,
+	UINT passIdx,
+	const EffectPreamble& preamble,
+	std::string_view passBlock,
+	std::string_view fusedBlock,
+	std::string& result,
+	PassMacros& passMacros
+) {
+	bool isLastEffect = desc.flags & EFFECT_FLAG_LAST_EFFECT;
+	bool isLastPass = passIdx == desc.passes.size();
+
+	const EffectPassDesc& passDesc = desc.passes[(size_t)passIdx - 1];
+
+	// 除前导代码和 PASS 块外，生成的代码不超过 4096 字节
+	// 因此只需分配一次内存
+	result.reserve(4096 + preamble.head.size() + preamble.tail.size() + passBlock.size() + fusedBlock.size());
+	auto out = std::back_inserter(result);
+
+	// 常量缓冲区和采样器
+	result.append(preamble.head);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////
+	//
+	// SRV 和 UAV
+	// 
+	////////////////////////////////////////////////////////////////////////////////////////////////////////
+	
+	// SRV
+	for (int i = 0; i < passDesc.inputs.size(); ++i) {
+		auto& texDesc = desc.textures[passDesc.inputs[i]];
+		fmt::format_to(out, "Texture2D<{}> {} : register(t{});\n", EffectIntermediateTextureDesc::FORMAT_DESCS[(UINT)texDesc.format].srvTexelType, texDesc.name, i);
+	}
+
+	if (isLastEffect && isLastPass) {
+		fmt::format_to(out, "Texture2D<float4> __CURSOR : register(t{});\n", passDesc.inputs.size());
+	}
+
+	// UAV
+	if (passDesc.outputs.empty()) {
+		if (!isLastPass) {
+			return 1;
+		}
+
+		result.append("RWTexture2D<unorm float4> __OUTPUT : register(u0);\n");
+	} else {
+		if (isLastPass) {
+			return 1;
+		}
+
+		for (int i = 0; i < passDesc.outputs.size(); ++i) {
+			auto& texDesc = desc.textures[passDesc.outputs[i]];
+			fmt::format_to(out, "RWTexture2D<{}> {} : register(u{});\n", EffectIntermediateTextureDesc::FORMAT_DESCS[(UINT)texDesc.format].uavTexelType, texDesc.name, i);
+		}
+	}
+
+	result.push_back('\n');
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////
+	//
+	// 内置宏
+	// 
+	////////////////////////////////////////////////////////////////////////////////////////////////////////
+	std::vector<D3D_SHADER_MACRO>& macros = passMacros.macros;
+	macros.reserve(preamble.macros.size() + 9);
+	macros.assign(preamble.macros.begin(), preamble.macros.end());
+
+	static constexpr const char* NUMBER_MACRO_NAMES[] = {
+		"MP_BLOCK_WIDTH", "MP_BLOCK_HEIGHT", "MP_NUM_THREADS_X", "MP_NUM_THREADS_Y", "MP_NUM_THREADS_Z"
+	};
+	const UINT numberMacroValues[] = {
+		passDesc.blockSize.first, passDesc.blockSize.second,
+		passDesc.numThreads[0], passDesc.numThreads[1], passDesc.numThreads[2]
+	};
+	for (size_t i = 0; i < std::size(NUMBER_MACRO_NAMES); ++i) {
+		std::array<char, 12>& value = passMacros.numbers[i];
+		// value 已初始化为 0，结果以 0 结尾
+		std::to_chars(value.data(), value.data() + value.size() - 1, numberMacroValues[i]);
+		macros.push_back({ NUMBER_MACRO_NAMES[i], value.data() });
+	}
+
+	if (passDesc.isPSStyle) {
+		macros.push_back({ "MP_PS_STYLE", "" });
+	}
+
+	if (isLastPass) {
+		macros.push_back({ "MP_LAST_PASS", "" });
 	}
 
+	macros.push_back({ nullptr, nullptr });
+
 	////////////////////////////////////////////////////////////////////////////////////////////////////////
 	//
 	// 内置函数
@@ -1210,9 +1462,11 @@ UINT GeneratePassSource(
 	if (isLastPass) {
 		result.append("bool CheckViewport(int2 pos) { return pos.x < __viewport.x && pos.y < __viewport.y; }\n");
 
+		// 融合时 WriteToOutput 先执行后一个效果，再调用 __WriteToOutput 写入输出
 		if (isLastEffect) {
 			// 255.001953 的由来见 https://stackoverflow.com/questions/52103720/why-does-d3dcolortoubyte4-multiplies-components-by-255-001953f
-			result.append(R"(void WriteToOutput(uint2 pos, float3 color) {
+			result.append(fusedBlock.empty() ? "void WriteToOutput" : "void __WriteToOutput");
+			result.append(R"((uint2 pos, float3 color) {
 	color = saturate(color);
 	pos += __offset.zw;
 	if ((int)pos.x >= __cursorRect.x && (int)pos.y >= __cursorRect.y && (int)pos.x < __cursorRect.z && (int)pos.y < __cursorRect.w) {
@@ -1243,33 +1497,25 @@ UINT GeneratePassSource(
 }
 )");
 		} else {
-			result.append("#define WriteToOutput(pos,color) __OUTPUT[pos] = float4(color, 1)\n");
+			result.append(fusedBlock.empty() ? "#define WriteToOutput" : "#define __WriteToOutput");
+			result.append("(pos,color) __OUTPUT[pos] = float4(color, 1)\n");
 		}
 	}
 
-	result.append(R"(uint __Bfe(uint src, uint off, uint bits) { uint mask = (1u << bits) - 1; return (src >> off) & mask; }
-uint __BfiM(uint src, uint ins, uint bits) { uint mask = (1u << bits) - 1; return (ins & mask) | (src & (~mask)); }
-uint2 Rmp8x8(uint a) { return uint2(__Bfe(a, 1u, 3u), __BfiM(__Bfe(a, 3u, 3u), a, 1u)); }
-uint2 GetInputSize() { return __inputSize; }
-float2 GetInputPt() { return __inputPt; }
-uint2 GetOutputSize() { return __outputSize; }
-float2 GetOutputPt() { return __outputPt; }
-float2 GetScale() { return __scale; }
-)");
+	// 其他内置函数和 COMMON 块
+	result.append(preamble.tail);
 
-	if (desc.isUseDynamic) {
-		result.append(R"(uint GetFrameCount() { return __frameCount; }
-uint2 GetCursorPos() { return __cursorPos; }
+	if (isLastPass && !fusedBlock.empty()) {
+		// 后一个效果的输入尺寸和输出尺寸都和本效果的输出尺寸相同
+		// 不融合时中间纹理为 R8G8B8A8_UNORM 格式，这里按同样的方式量化，使输出和不融合时完全相同
+		result.append(fusedBlock);
+		result.append(R"(
+void WriteToOutput(uint2 pos, float3 color) {
+	__fusedInput = float4(round(saturate(color) * 255) / 255, 1);
+	__WriteToOutput(pos, __FusedPass1((pos + 0.5f) * __outputPt).rgb);
+}
 
 )");
-	} else {
-		result.push_back('\n');
-	}
-
-
-	for (std::string_view commonBlock : commonBlocks) {
-		result.append(commonBlock);
-		result.push_back('\n');
 	}
 
 	result.append(passBlock);
@@ -1287,7 +1533,7 @@ uint2 GetCursorPos() { return __cursorPos; }
 	if (passDesc.isPSStyle) {
 		if (passDesc.outputs.size() <= 1) {
 			if (isLastPass) {
-				result.append(fmt::format(R"([numthreads(64, 1, 1)]
+				fmt::format_to(out, R"([numthreads(64, 1, 1)]
 void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
 	uint2 gxy = Rmp8x8(tid.x) + (gid.xy << 4u){0};
 	float2 pos = (gxy + 0.5f) * __outputPt;
@@ -1317,9 +1563,9 @@ void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
 		WriteToOutput(gxy, Pass{1}(pos).rgb);
 	}};
 }}
-)", isLastEffect ? " + __offset.xy" : "", passIdx));
+)", isLastEffect ? " + __offset.xy" : "", passIdx);
 			} else {
-				result.append(fmt::format(R"([numthreads(64, 1, 1)]
+				fmt::format_to(out, R"([numthreads(64, 1, 1)]
 void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
 	uint2 gxy = Rmp8x8(tid.x) + (gid.xy << 4u);
 	if (gxy.x >= __pass{0}OutputSize.x || gxy.y >= __pass{0}OutputSize.y) {{
@@ -1348,7 +1594,7 @@ void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
 		{1}[gxy] = Pass{0}(pos);
 	}}
 }}
-)", passIdx, desc.textures[passDesc.outputs[0]].name));
+)", passIdx, desc.textures[passDesc.outputs[0]].name);
 			}
 		} else {
 			// 多渲染目标
@@ -1356,7 +1602,7 @@ void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
 				return 1;
 			}
 
-			result.append(fmt::format(R"([numthreads(64, 1, 1)]
+			fmt::format_to(out, R"([numthreads(64, 1, 1)]
 void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
 	uint2 gxy = Rmp8x8(tid.x) + (gid.xy << 4u);
 	if (gxy.x >= __pass{0}OutputSize.x || gxy.y >= __pass{0}OutputSize.y) {{
@@ -1364,11 +1610,11 @@ void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
 	}}
 	float2 pos = (gxy + 0.5f) * __pass{0}OutputPt;
 	float2 step = 8 * __pass{0}OutputPt;
-)", passIdx));
+)", passIdx);
 			for (int i = 0; i < passDesc.outputs.size(); ++i) {
 				auto& texDesc = desc.textures[passDesc.outputs[i]];
-				result.append(fmt::format("\t{} c{};\n",
-					EffectIntermediateTextureDesc::FORMAT_DESCS[(UINT)texDesc.format].srvTexelType, i));
+				fmt::format_to(out, "\t{} c{};\n",
+					EffectIntermediateTextureDesc::FORMAT_DESCS[(UINT)texDesc.format].srvTexelType, i);
 			}
 
 			std::string callPass = fmt::format("\tPass{}(pos, ", passIdx);
@@ -1381,7 +1627,7 @@ void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
 				callPass.append(fmt::format("\t\t\t{}[gxy] = c{};\n", desc.textures[passDesc.outputs[i]].name, i));
 			}
 
-			result.append(fmt::format(R"({0}
+			fmt::format_to(out, R"({0}
 	gxy.x += 8u;
 	pos.x += step.x;
 	if (gxy.x < __pass{1}OutputSize.x && gxy.y < __pass{1}OutputSize.y) {{
@@ -1400,7 +1646,7 @@ void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
 		{0}
 	}}
 }}
-)", callPass, passIdx));
+)", callPass, passIdx);
 		}
 	} else {
 		// 大部分情况下 BLOCK_SIZE 都是 2 的整数次幂，这时将乘法转换为位移
@@ -1412,11 +1658,11 @@ void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
 			blockStartExpr = fmt::format("gid.xy * uint2({}, {})", passDesc.blockSize.first, passDesc.blockSize.second);
 		}
 
-		result.append(fmt::format(R"([numthreads({}, {}, {})]
+		fmt::format_to(out, R"([numthreads({}, {}, {})]
 void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
 	Pass{}({}{}, tid);
 }}
-)", passDesc.numThreads[0], passDesc.numThreads[1], passDesc.numThreads[2], passIdx, blockStartExpr, isLastEffect && isLastPass ? " + __offset.xy" : ""));
+)", passDesc.numThreads[0], passDesc.numThreads[1], passDesc.numThreads[2], passIdx, blockStartExpr, isLastEffect && isLastPass ? " + __offset.xy" : "");
 	}
 
 	return 0;
@@ -1426,70 +1672,34 @@ UINT CompilePasses(
 	EffectDesc& desc,
 	const std::vector<std::string_view>& commonBlocks,
 	const std::vector<std::string_view>& passBlocks,
-	const std::map<std::string, std::variant<float, int>>& inlineParams
+	const std::map<std::string, std::variant<float, int>>& inlineParams,
+	std::string_view dependencyHash,
+	const ShaderCompiler& compiler,
+	const Config& config,
+	std::string_view fusedBlock = {}
 ) {
-	////////////////////////////////////////////////////////////////////////////////////////////////////////
-	//
-	// 所有通道共用的常量缓冲区
-	// 
-	////////////////////////////////////////////////////////////////////////////////////////////////////////
-	
-	std::string cbHlsl = R"(cbuffer __CB1 : register(b0) {
-	int4 __cursorRect;
-	float2 __cursorPt;
-	uint2 __cursorPos;
-	uint __cursorType;
-	uint __frameCount;
-};
-cbuffer __CB2 : register(b1) {
-	uint2 __inputSize;
-	uint2 __outputSize;
-	float2 __inputPt;
-	float2 __outputPt;
-	float2 __scale;
-	int2 __viewport;
-)";
-
-	if (desc.flags & EFFECT_FLAG_LAST_EFFECT) {
-		// 指定输出到屏幕的位置
-		cbHlsl.append("\tint4 __offset;\n");
-	}
-
-	// PS 样式需要获知输出纹理的尺寸
-	// 最后一个通道不需要
-	for (UINT i = 0, end = (UINT)desc.passes.size() - 1; i < end; ++i) {
-		if (desc.passes[i].isPSStyle) {
-			cbHlsl.append(fmt::format("\tuint2 __pass{0}OutputSize;\n\tfloat2 __pass{0}OutputPt;\n", i + 1));
-		}
-	}
-
-	if (!(desc.flags & EFFECT_FLAG_INLINE_PARAMETERS)) {
-		for (const auto& d : desc.params) {
-			cbHlsl.append("\t")
-				.append(d.type == EffectConstantType::Int ? "int " : "float ")
-				.append(d.name)
-				.append(";\n");
-		}
+	EffectPreamble preamble;
+	if (GeneratePreamble(desc, commonBlocks, inlineParams, preamble)) {
+		Logger::Get().Error("生成前导代码失败");
+		return 1;
 	}
 
-	cbHlsl.append("};\n\n");
-
-	if (App::Get().GetConfig().IsSaveEffectSources() && !Utils::DirExists(SAVE_SOURCE_DIR)) {
+	if (config.IsSaveEffectSources() && !Utils::DirExists(SAVE_SOURCE_DIR)) {
 		if (!CreateDirectory(SAVE_SOURCE_DIR, nullptr)) {
 			Logger::Get().Win32Error("创建 sources 文件夹失败");
 		}
 	}
 
-	// 并行生成代码和编译
-	Utils::RunParallel([&](UINT id) {
+	auto compilePass = [&](UINT id) {
 		std::string source;
-		std::vector<std::pair<std::string, std::string>> macros;
-		if (GeneratePassSource(desc, id + 1, cbHlsl, commonBlocks, passBlocks[id], inlineParams, source, macros)) {
+		PassMacros passMacros;
+		std::string_view passFusedBlock = id + 1 == passBlocks.size() ? fusedBlock : std::string_view();
+		if (GeneratePassSource(desc, id + 1, preamble, passBlocks[id], passFusedBlock, source, passMacros)) {
 			Logger::Get().Error(fmt::format("生成 Pass{} 失败", id + 1));
 			return;
 		}
 
-		if (App::Get().GetConfig().IsSaveEffectSources()) {
+		if (config.IsSaveEffectSources()) {
 			std::wstring fileName = desc.passes.size() == 1
 				? fmt::format(L"{}\\{}.hlsl", SAVE_SOURCE_DIR, StrUtils::UTF8ToUTF16(desc.name))
 				: fmt::format(L"{}\\{}_Pass{}.hlsl", SAVE_SOURCE_DIR, StrUtils::UTF8ToUTF16(desc.name), id + 1);
@@ -1499,14 +1709,36 @@ cbuffer __CB2 : register(b1) {
 			}
 		}
 
-		static PassInclude passInclude;
+		if (!config.IsDisableEffectCache()) {
+			desc.passes[id].hash = EffectCacheManager::GetPassHash(source, passMacros.macros.data(), compiler.GetId(), dependencyHash);
+
+			// 生成的源码和宏相同的通道（可能来自其他效果）已编译过则复用字节码
+			desc.passes[id].cso = EffectCacheManager::Get().LoadPassBytecode(desc.passes[id].hash);
+			if (desc.passes[id].cso) {
+				Logger::Get().Info(fmt::format("Pass{} 已编译过，跳过编译", id + 1));
+				return;
+			}
+		}
 
-		if (!App::Get().GetDeviceResources().CompileShader(source, "__M", desc.passes[id].cso.put(),
-			fmt::format("{}_Pass{}.hlsl", desc.name, id + 1).c_str(), &passInclude, macros)
+		PassInclude passInclude;
+
+		if (!compiler.Compile(source, "__M", fmt::format("{}_Pass{}.hlsl", desc.name, id + 1).c_str(),
+			&passInclude, passMacros.macros.data(), config.IsTreatWarningsAsErrors(), desc.passes[id].cso.put())
 		) {
 			Logger::Get().Error(fmt::format("编译 Pass{} 失败", id + 1));
 		}
-	}, (UINT)passBlocks.size());
+	};
+
+	if (GetThreadPriority(GetCurrentThread()) < THREAD_PRIORITY_NORMAL) {
+		// 调用者降低了优先级（如预编译）时在当前线程依次编译，
+		// 工作线程为正常优先级，不应让后台任务占用它们和前台的缩放竞争
+		for (UINT i = 0; i < (UINT)passBlocks.size(); ++i) {
+			compilePass(i);
+		}
+	} else {
+		// 并行生成代码和编译
+		TaskScheduler::Get().ParallelFor((UINT)passBlocks.size(), compilePass);
+	}
 
 	// 检查编译结果
 	for (const EffectPassDesc& d : desc.passes) {
@@ -1519,48 +1751,266 @@ cbuffer __CB2 : register(b1) {
 }
 
 
-UINT EffectCompiler::Compile(
-	std::string_view effectName,
-	UINT flags,
-	const std::map<std::string, std::variant<float, int>>& inlineParams,
-	EffectDesc& desc
-) {
-	desc = {};
-	desc.name = effectName;
-	desc.flags = flags;
+static bool IsWordChar(char c) noexcept {
+	return StrUtils::isalnum(c) || c == '_' || c == '.';
+}
 
-	std::wstring fileName = (L"effects\\" + StrUtils::UTF8ToUTF16(effectName) + L".hlsl");
+static bool IsOperatorChar(char c) noexcept {
+	return std::string_view("+-*/%&|^!~<>=?:#").find(c) != std::string_view::npos;
+}
 
-	std::string source;
-	if (!Utils::ReadTextFile(fileName.c_str(), source)) {
-		Logger::Get().Error("读取源文件失败");
-		return 1;
+// 删除两个字符间的空白是否会改变词法分析的结果
+static bool IsSpaceNeeded(char left, char right) noexcept {
+	return (IsWordChar(left) && IsWordChar(right)) || (IsOperatorChar(left) && IsOperatorChar(right));
+}
+
+// 删除多余的空白字符，字符串原样保留
+// isDirective 为 true 表示预处理指令的首行，宏名和参数列表间的空白决定了是否为函数宏，需保留
+// 返回是否需要保留行尾的换行符
+static bool CanonicalizeCodeLine(std::string_view line, bool isDirective, std::string& result) {
+	bool isSpacePending = false;
+	bool isFirstParen = isDirective;
+
+	for (size_t i = 0; i < line.size(); ++i) {
+		char c = line[i];
+
+		if (StrUtils::isspace(c)) {
+			isSpacePending = true;
+			continue;
+		}
+
+		if (isSpacePending && !result.empty()) {
+			if (IsSpaceNeeded(result.back(), c) || (isFirstParen && c == '(' && IsWordChar(result.back()))) {
+				result.push_back(' ');
+			}
+		}
+		isSpacePending = false;
+		if (c == '(') {
+			isFirstParen = false;
+		}
+
+		if (c == '"') {
+			size_t end = i + 1;
+			while (end < line.size() && line[end] != '"') {
+				// 跳过转义字符
+				end += line[end] == '\\' ? 2 : 1;
+			}
+			end = std::min(end + 1, line.size());
+
+			result.append(line.substr(i, end - i));
+			i = end - 1;
+			continue;
+		}
+
+		if (c == '/' && i + 1 < line.size() && line[i + 1] == '/') {
+			// 删除注释后只剩下 //!，HLSL 编译器将其视为行注释
+			std::string_view rest = line.substr(i);
+			StrUtils::Trim(rest);
+			result.append(rest);
+			return true;
+		}
+
+		result.push_back(c);
+	}
+
+	return isDirective;
+}
+
+// 规范化源码，用于计算缓存的哈希，使只改变格式的修改不会使缓存失效
+// 1. 删除空行和不影响词法分析的空白字符，只有预处理指令和 MagpieFX 选项独占一行
+// 2. 块首行之后紧邻的选项按字典序排列，解析时它们的顺序无关紧要
+// 3. 块按类型分组，同类的块保持原有顺序，PASS 块按序号排列
+// source 需已删除注释
+static std::string CanonicalizeSource(std::string_view source) {
+	struct Line {
+		std::string text;
+		bool isMeta = false;
+		// 是否需要从新的一行开始
+		bool isLineStart = false;
+		bool isNewLineKept = false;
+	};
+
+	struct Block {
+		// 为 Unknown 时是 Header 块
+		MetaKeyword type = MetaKeyword::Unknown;
+		UINT passIndex = 0;
+		std::vector<Line> lines;
+	};
+
+	std::vector<Block> blocks(1);
+	// 上一行以 \ 结尾的预处理指令
+	bool isInDirective = false;
+
+	while (!source.empty()) {
+		size_t pos = source.find('\n');
+		std::string_view line = source.substr(0, pos);
+		source.remove_prefix(pos == std::string_view::npos ? source.size() : pos + 1);
+
+		StrUtils::Trim(line);
+		if (line.empty() && !isInDirective) {
+			continue;
+		}
+
+		Line cur;
+
+		if (isInDirective || line.starts_with('#')) {
+			CanonicalizeCodeLine(line, !isInDirective, cur.text);
+			cur.isLineStart = true;
+			cur.isNewLineKept = true;
+			isInDirective = line.ends_with('\\');
+		} else if (line.starts_with(META_INDICATOR)) {
+			cur.isMeta = true;
+			cur.isLineStart = true;
+			cur.isNewLineKept = true;
+
+			// 选项的值原样保留
+			std::string_view t = line.substr(std::char_traits<char>::length(META_INDICATOR));
+			std::string_view token;
+			cur.text = META_INDICATOR;
+			if (GetNextToken<false>(t, token) == 0) {
+				cur.text.append(token);
+			}
+			StrUtils::Trim(t);
+			if (!t.empty()) {
+				cur.text.push_back(' ');
+				cur.text.append(t);
+			}
+
+			MetaKeyword keyword = GetMetaKeyword(token);
+			if (keyword == MetaKeyword::Parameter || keyword == MetaKeyword::Texture || keyword == MetaKeyword::Sampler
+				|| keyword == MetaKeyword::Common || keyword == MetaKeyword::Pass) {
+				Block& block = blocks.emplace_back();
+				block.type = keyword;
+
+				// 序号无效时解析会失败，这里无需处理
+				if (keyword == MetaKeyword::Pass) {
+					GetNextNumber(t, block.passIndex);
+				}
+			}
+		} else {
+			cur.isNewLineKept = CanonicalizeCodeLine(line, false, cur.text);
+		}
+
+		blocks.back().lines.push_back(std::move(cur));
+	}
+
+	auto getBlockOrder = [](const Block& block) {
+		switch (block.type) {
+		case MetaKeyword::Parameter:
+			return 0;
+		case MetaKeyword::Texture:
+			return 1;
+		case MetaKeyword::Sampler:
+			return 2;
+		case MetaKeyword::Common:
+			return 3;
+		default:
+			return 4;
+		}
+	};
+
+	// 第一个块始终是 Header 块
+	std::stable_sort(blocks.begin() + 1, blocks.end(), [&](const Block& l, const Block& r) {
+		int lOrder = getBlockOrder(l);
+		int rOrder = getBlockOrder(r);
+		return lOrder != rOrder ? lOrder < rOrder : l.passIndex < r.passIndex;
+	});
+
+	std::string result;
+	bool isNewLineKept = false;
+
+	for (Block& block : blocks) {
+		std::vector<Line>& lines = block.lines;
+
+		if (!lines.empty() && lines[0].isMeta) {
+			auto optionsEnd = std::find_if(lines.begin() + 1, lines.end(), [](const Line& l) { return !l.isMeta; });
+			std::sort(lines.begin() + 1, optionsEnd, [](const Line& l, const Line& r) { return l.text < r.text; });
+		}
+
+		for (const Line& line : lines) {
+			if (!result.empty()) {
+				if (isNewLineKept || line.isLineStart) {
+					result.push_back('\n');
+				} else if (!line.text.empty() && IsSpaceNeeded(result.back(), line.text.front())) {
+					result.push_back(' ');
+				}
+			}
+
+			result.append(line.text);
+			isNewLineKept = line.isNewLineKept;
+		}
 	}
 
+	return result;
+}
+
+// 删除注释，失败时记录日志
+static UINT PrepareSource(std::string& source) {
 	if (source.empty()) {
 		Logger::Get().Error("源文件为空");
 		return 1;
 	}
 
-	// 移除注释
 	if (RemoveComments(source)) {
 		Logger::Get().Error("删除注释失败");
 		return 1;
 	}
 
-	std::string hash;
-	if (!App::Get().GetConfig().IsDisableEffectCache()) {
-		hash = EffectCacheManager::GetHash(source, flags & EFFECT_FLAG_INLINE_PARAMETERS ? &inlineParams : nullptr);
-		if (!hash.empty()) {
-			if (EffectCacheManager::Get().Load(effectName, hash, desc)) {
-				// 已从缓存中读取
-				return 0;
-			}
+	return 0;
+}
+
+// 源码是否受 EFFECT_FLAG_FP16 影响，即是否引用了 MF 系列类型或 MP_FP16
+// source 需已删除注释。头文件中也可能使用，因此包含头文件时总是返回 true
+static bool IsFP16Sensitive(std::string_view source) noexcept {
+	if (source.find("#include") != std::string_view::npos) {
+		return true;
+	}
+
+	for (size_t i = 0; i < source.size();) {
+		if (!StrUtils::isalnum(source[i]) && source[i] != '_') {
+			++i;
+			continue;
+		}
+
+		size_t end = i + 1;
+		while (end < source.size() && (StrUtils::isalnum(source[end]) || source[end] == '_')) {
+			++end;
+		}
+		std::string_view token = source.substr(i, end - i);
+		i = end;
+
+		if (token == "MP_FP16") {
+			return true;
+		}
+
+		// MF、MFn 或 MFnxm
+		if (!token.starts_with("MF")) {
+			continue;
+		}
+		token.remove_prefix(2);
+		if (token.empty()) {
+			return true;
+		}
+		if (token[0] < '1' || token[0] > '4') {
+			continue;
+		}
+		if (token.size() == 1 || (token.size() == 3 && token[1] == 'x' && token[2] >= '1' && token[2] <= '4')) {
+			return true;
 		}
 	}
 
-	std::string_view sourceView(source);
+	return false;
+}
 
+// 编译器前端：解析所有块，不生成和编译着色器
+// sourceView 需已删除注释，commonBlocks 和 passBlocks 引用其中的内容
+static UINT ParseEffect(
+	std::string_view sourceView,
+	EffectDesc& desc,
+	std::vector<std::string_view>& commonBlocks,
+	std::vector<std::string_view>& passBlocks,
+	std::pair<std::string, std::string>* outSizeSource
+) {
 	// 检查头
 	if (!CheckMagic(sourceView)) {
 		Logger::Get().Error("检查 MagpieFX 头失败");
@@ -1580,8 +2030,6 @@ UINT EffectCompiler::Compile(
 	std::vector<std::string_view> paramBlocks;
 	std::vector<std::string_view> textureBlocks;
 	std::vector<std::string_view> samplerBlocks;
-	std::vector<std::string_view> commonBlocks;
-	std::vector<std::string_view> passBlocks;
 
 	BlockType curBlockType = BlockType::Header;
 	size_t curBlockOff = 0;
@@ -1615,41 +2063,42 @@ UINT EffectCompiler::Compile(
 		curBlockOff += len;
 	};
 
-	bool newLine = true;
-	std::string_view t = sourceView;
-	while (t.size() > 5) {
-		if (newLine) {
-			// 包含换行符
-			size_t len = t.data() - sourceView.data() - curBlockOff + 1;
+	// 只在行首检查块的起始，使用 find 跳过行内的字符
+	size_t lineStart = sourceView.find('\n');
+	while (lineStart != std::string_view::npos && sourceView.size() - lineStart > 5) {
+		// 包含换行符
+		size_t len = lineStart - curBlockOff + 1;
 
-			if (CheckNextToken<true>(t, META_INDICATOR)) {
-				std::string_view token;
-				if (GetNextToken<false>(t, token)) {
-					return 1;
-				}
-				std::string blockType = StrUtils::ToUpperCase(token);
-
-				if (blockType == "PARAMETER") {
-					completeCurrentBlock(len, BlockType::Constant);
-				} else if (blockType == "TEXTURE") {
-					completeCurrentBlock(len, BlockType::Texture);
-				} else if (blockType == "SAMPLER") {
-					completeCurrentBlock(len, BlockType::Sampler);
-				} else if (blockType == "COMMON") {
-					completeCurrentBlock(len, BlockType::Common);
-				} else if (blockType == "PASS") {
-					completeCurrentBlock(len, BlockType::Pass);
-				}
+		std::string_view t = sourceView.substr(lineStart);
+		if (CheckNextToken<true>(t, META_INDICATOR)) {
+			std::string_view token;
+			if (GetNextToken<false>(t, token)) {
+				return 1;
 			}
 
-			if (t.size() <= 5) {
+			switch (GetMetaKeyword(token)) {
+			case MetaKeyword::Parameter:
+				completeCurrentBlock(len, BlockType::Constant);
+				break;
+			case MetaKeyword::Texture:
+				completeCurrentBlock(len, BlockType::Texture);
+				break;
+			case MetaKeyword::Sampler:
+				completeCurrentBlock(len, BlockType::Sampler);
+				break;
+			case MetaKeyword::Common:
+				completeCurrentBlock(len, BlockType::Common);
+				break;
+			case MetaKeyword::Pass:
+				completeCurrentBlock(len, BlockType::Pass);
+				break;
+			default:
 				break;
 			}
-		} else {
-			t.remove_prefix(1);
 		}
 
-		newLine = t[0] == '\n';
+		// CheckNextToken 已跳过空白字符，从当前位置查找下一行
+		lineStart = sourceView.find('\n', t.data() - sourceView.data());
 	}
 
 	completeCurrentBlock(sourceView.size() - curBlockOff, BlockType::Header);
@@ -1660,7 +2109,7 @@ UINT EffectCompiler::Compile(
 		return 1;
 	}
 
-	if (ResolveHeader(headerBlock, desc)) {
+	if (ResolveHeader(headerBlock, desc, outSizeSource)) {
 		Logger::Get().Error("解析 Header 块失败");
 		return 1;
 	}
@@ -1677,8 +2126,8 @@ UINT EffectCompiler::Compile(
 		auto& texDesc = desc.textures.emplace_back();
 		texDesc.name = "INPUT";
 		texDesc.format = EffectIntermediateTextureFormat::R8G8B8A8_UNORM;
-		texDesc.sizeExpr.first = "INPUT_WIDTH";
-		texDesc.sizeExpr.second = "INPUT_HEIGHT";
+		texDesc.sizeExpr.first.Compile("INPUT_WIDTH", false);
+		texDesc.sizeExpr.second.Compile("INPUT_HEIGHT", false);
 	}
 	
 	for (size_t i = 0; i < textureBlocks.size(); ++i) {
@@ -1733,14 +2182,533 @@ UINT EffectCompiler::Compile(
 		return 1;
 	}
 
-	if (CompilePasses(desc, commonBlocks, passBlocks, inlineParams)) {
+	return 0;
+}
+
+UINT EffectCompiler::Compile(
+	std::string_view effectName,
+	UINT flags,
+	const std::map<std::string, std::variant<float, int>>& inlineParams,
+	EffectDesc& desc,
+	const Config& config
+) {
+	desc = {};
+	desc.name = effectName;
+	desc.flags = flags;
+
+	std::wstring fileName = (L"effects\\" + StrUtils::UTF8ToUTF16(effectName) + L".hlsl");
+
+	std::string source;
+	if (!Utils::ReadTextFile(fileName.c_str(), source)) {
+		Logger::Get().Error("读取源文件失败");
+		return 1;
+	}
+
+	if (PrepareSource(source)) {
+		return 1;
+	}
+
+	// FXC 没有真正的 16 位类型，EFFECT_FLAG_FP16 只影响 MF 系列宏。未使用它们的效果
+	// 在两种模式下字节码相同，忽略该标志以和 FP32 共享缓存
+	if ((flags & EFFECT_FLAG_FP16) && !IsFP16Sensitive(source)) {
+		flags &= ~EFFECT_FLAG_FP16;
+		desc.flags = flags;
+		Logger::Get().Info("效果未使用 MF 类型，忽略 FP16 标志");
+	}
+
+	const ShaderCompiler& compiler = ShaderCompiler::Get(flags);
+
+	std::string hash;
+	// 包含的头文件也是缓存键的一部分
+	std::string dependencyHash;
+	if (!config.IsDisableEffectCache()) {
+		dependencyHash = EffectIncludeCache::Get().GetDependencyHash(source);
+#ifdef _DEBUG
+		// 调试信息包含行号，源码的任何改变都需要重新编译
+		std::string_view hashSource = source;
+#else
+		std::string hashSource = CanonicalizeSource(source);
+#endif // _DEBUG
+		hash = EffectCacheManager::GetHash(hashSource, compiler.GetId(),
+			flags & EFFECT_FLAG_INLINE_PARAMETERS ? &inlineParams : nullptr, dependencyHash);
+		if (!hash.empty()) {
+			if (EffectCacheManager::Get().Load(effectName, hash, desc)) {
+				// 已从缓存中读取
+				return 0;
+			}
+		}
+	}
+
+	std::vector<std::string_view> commonBlocks;
+	std::vector<std::string_view> passBlocks;
+	UINT resultCode = ParseEffect(source, desc, commonBlocks, passBlocks, nullptr);
+	if (resultCode) {
+		return resultCode;
+	}
+
+	if (CompilePasses(desc, commonBlocks, passBlocks, inlineParams, dependencyHash, compiler, config)) {
 		Logger::Get().Error("编译着色器失败");
 		return 1;
 	}
 
-	if (!App::Get().GetConfig().IsDisableEffectCache() && !hash.empty()) {
+	if (!config.IsDisableEffectCache() && !hash.empty()) {
 		EffectCacheManager::Get().Save(effectName, hash, desc);
 	}
 
 	return 0;
 }
+
+UINT EffectCompiler::Parse(std::string& source, EffectDesc& desc, std::pair<std::string, std::string>* outSizeSource) {
+	desc = {};
+
+	if (PrepareSource(source)) {
+		return 1;
+	}
+
+	std::vector<std::string_view> commonBlocks;
+	std::vector<std::string_view> passBlocks;
+	return ParseEffect(source, desc, commonBlocks, passBlocks, outSizeSource);
+}
+
+// 查找完整的标识符，不包括成员访问，未找到时返回 npos
+static size_t FindIdentifier(std::string_view source, std::string_view name, size_t offset = 0) noexcept {
+	auto isIdentifierChar = [](char c) {
+		return StrUtils::isalnum(c) || c == '_';
+	};
+
+	while (true) {
+		offset = source.find(name, offset);
+		if (offset == std::string_view::npos) {
+			return offset;
+		}
+
+		size_t end = offset + name.size();
+		if ((offset == 0 || (!isIdentifierChar(source[offset - 1]) && source[offset - 1] != '.'))
+			&& (end == source.size() || !isIdentifierChar(source[end]))
+		) {
+			return offset;
+		}
+
+		offset = end;
+	}
+}
+
+// 计算融合效果的哈希时分隔两个效果的源码
+// 融合代码的生成方式改变时更新它，使旧的融合缓存失效
+static constexpr std::string_view FUSION_SEPARATOR = "\n//!FUSE 2\n";
+
+// 参与融合的效果。commonBlocks 和 passBlocks 引用 source 中的内容
+struct FusionSource {
+	std::string source;
+	EffectDesc desc;
+	std::vector<std::string_view> commonBlocks;
+	std::vector<std::string_view> passBlocks;
+	std::pair<std::string, std::string> outSizeSource;
+};
+
+// 读取源文件并删除注释
+static UINT ReadFusionSource(std::string_view effectName, std::string& source) {
+	std::wstring fileName = (L"effects\\" + StrUtils::UTF8ToUTF16(effectName) + L".hlsl");
+	if (!Utils::ReadTextFile(fileName.c_str(), source)) {
+		Logger::Get().Error("读取源文件失败");
+		return 1;
+	}
+
+	return PrepareSource(source);
+}
+
+// result.source 需已由 ReadFusionSource 读取
+static UINT ParseFusionSource(std::string_view effectName, FusionSource& result) {
+	result.desc.name = effectName;
+	return ParseEffect(result.source, result.desc, result.commonBlocks, result.passBlocks, &result.outSizeSource);
+}
+
+// 将 block 中所有 #define 定义的宏名添加到 result 中
+static void CollectDefines(std::string_view block, std::vector<std::string_view>& result) {
+	while (!block.empty()) {
+		size_t lineEnd = block.find('\n');
+		std::string_view line = block.substr(0, lineEnd);
+		block.remove_prefix(lineEnd == std::string_view::npos ? block.size() : lineEnd + 1);
+
+		StrUtils::Trim(line);
+		if (!line.starts_with('#')) {
+			continue;
+		}
+		line.remove_prefix(1);
+		StrUtils::Trim(line);
+
+		if (!line.starts_with("define") || line.size() == 6 || !StrUtils::isspace(line[6])) {
+			continue;
+		}
+		line.remove_prefix(6);
+		StrUtils::Trim(line);
+
+		size_t len = 0;
+		while (len < line.size() && (StrUtils::isalnum(line[len]) || line[len] == '_')) {
+			++len;
+		}
+		if (len > 0) {
+			result.push_back(line.substr(0, len));
+		}
+	}
+}
+
+// 检查 consumer 能否融合到 producer 的最后一个通道中，可以时返回空，否则返回原因
+// inputReads 返回 consumer 的通道中所有读取 INPUT 的表达式的范围
+static std::string CheckFusionSources(
+	const FusionSource& producer,
+	const FusionSource& consumer,
+	bool isInlineParams,
+	std::vector<std::pair<size_t, size_t>>& inputReads
+) {
+	const EffectDesc& desc = consumer.desc;
+
+	if (desc.passes.size() != 1) {
+		return fmt::format("{} 有多个通道", desc.name);
+	}
+	if (!desc.passes[0].isPSStyle) {
+		return fmt::format("{} 的通道不是 PS 样式", desc.name);
+	}
+	if (desc.textures.size() != 1) {
+		return fmt::format("{} 使用了中间纹理", desc.name);
+	}
+	if (consumer.outSizeSource.first != "INPUT_WIDTH" || consumer.outSizeSource.second != "INPUT_HEIGHT") {
+		return fmt::format("{} 的输出尺寸和输入尺寸不同", desc.name);
+	}
+	if (consumer.source.find("#include") != std::string::npos) {
+		return fmt::format("{} 包含头文件", desc.name);
+	}
+
+	// 融合后输入尺寸和缩放比例变为前一个效果的值
+	static constexpr std::string_view INPUT_SIZE_FUNCS[] = { "GetInputSize", "GetInputPt", "GetScale" };
+	for (std::string_view func : INPUT_SIZE_FUNCS) {
+		if (FindIdentifier(consumer.source, func) != std::string_view::npos) {
+			return fmt::format("{} 使用了 {}", desc.name, func);
+		}
+	}
+
+	for (std::string_view commonBlock : consumer.commonBlocks) {
+		if (FindIdentifier(commonBlock, "INPUT") != std::string_view::npos) {
+			return fmt::format("{} 在 COMMON 块中读取 INPUT", desc.name);
+		}
+	}
+
+	// 找到 float4 Pass1(float2 pos) 的参数名和函数体
+	std::string_view passBlock = consumer.passBlocks[0];
+	std::string_view posName;
+	size_t bodyStart = std::string_view::npos;
+	size_t bodyEnd = std::string_view::npos;
+	{
+		size_t offset = FindIdentifier(passBlock, "Pass1");
+		if (offset == std::string_view::npos) {
+			return fmt::format("{} 中未找到 Pass1", desc.name);
+		}
+
+		std::string_view t = passBlock.substr(offset + 5);
+		if (!CheckNextToken<true>(t, "(") || !CheckNextToken<true>(t, "float2")
+			|| GetNextToken<true>(t, posName) || !CheckNextToken<true>(t, ")")
+			|| !CheckNextToken<true>(t, "{")
+		) {
+			return fmt::format("{} 中 Pass1 的格式非法", desc.name);
+		}
+
+		bodyStart = t.data() - passBlock.data();
+		UINT depth = 1;
+		for (size_t i = bodyStart; i < passBlock.size(); ++i) {
+			if (passBlock[i] == '{') {
+				++depth;
+			} else if (passBlock[i] == '}' && --depth == 0) {
+				bodyEnd = i;
+				break;
+			}
+		}
+
+		if (bodyEnd == std::string_view::npos) {
+			return fmt::format("{} 中 Pass1 的格式非法", desc.name);
+		}
+	}
+
+	// 只能以 INPUT.SampleLevel(sam, pos, 0) 的形式在 Pass1 中读取 INPUT
+	for (size_t offset = FindIdentifier(passBlock, "INPUT"); offset != std::string_view::npos;
+		offset = FindIdentifier(passBlock, "INPUT", offset + 5)
+	) {
+		std::string_view t = passBlock.substr(offset + 5);
+		std::string_view token;
+		if (offset < bodyStart || offset > bodyEnd
+			|| !CheckNextToken<true>(t, ".") || !CheckNextToken<true>(t, "SampleLevel")
+			|| !CheckNextToken<true>(t, "(") || GetNextToken<true>(t, token)
+			|| !CheckNextToken<true>(t, ",") || GetNextToken<true>(t, token) || token != posName
+			|| !CheckNextToken<true>(t, ",") || !CheckNextToken<true>(t, "0")
+			|| !CheckNextToken<true>(t, ")")
+		) {
+			return fmt::format("{} 在当前像素以外读取 INPUT", desc.name);
+		}
+
+		inputReads.emplace_back(offset, t.data() - passBlock.data());
+	}
+
+	// pos 不能被修改
+	std::string_view body = passBlock.substr(bodyStart, bodyEnd - bodyStart);
+	for (size_t offset = FindIdentifier(body, posName); offset != std::string_view::npos;
+		offset = FindIdentifier(body, posName, offset + posName.size())
+	) {
+		std::string_view t = body.substr(offset + posName.size());
+		std::string_view swizzle;
+		if (CheckNextToken<true>(t, ".")) {
+			GetNextToken<true>(t, swizzle);
+		}
+		RemoveLeadingBlanks<true>(t);
+
+		std::string_view before = body.substr(0, offset);
+		while (!before.empty() && StrUtils::isspace(before.back())) {
+			before.remove_suffix(1);
+		}
+
+		if ((t.starts_with("=") && !t.starts_with("=="))
+			|| t.starts_with("+=") || t.starts_with("-=") || t.starts_with("*=") || t.starts_with("/=")
+			|| t.starts_with("++") || t.starts_with("--") || before.ends_with("++") || before.ends_with("--")
+		) {
+			return fmt::format("{} 修改了 {}", desc.name, posName);
+		}
+	}
+
+	// 融合后两个效果的参数和采样器位于同一个作用域
+	{
+		std::unordered_set<std::string_view> names;
+		for (const EffectParameterDesc& d : producer.desc.params) {
+			names.emplace(d.name);
+		}
+		for (const EffectIntermediateTextureDesc& d : producer.desc.textures) {
+			names.emplace(d.name);
+		}
+		for (const EffectSamplerDesc& d : producer.desc.samplers) {
+			names.emplace(d.name);
+		}
+
+		for (const EffectParameterDesc& d : desc.params) {
+			if (names.contains(d.name)) {
+				return fmt::format("参数 {} 重名", d.name);
+			}
+		}
+		for (const EffectSamplerDesc& d : desc.samplers) {
+			if (names.contains(d.name)) {
+				return fmt::format("采样器 {} 重名", d.name);
+			}
+		}
+	}
+
+	// 融合后 producer 的 COMMON 块位于 consumer 的代码之前，consumer 的代码位于 producer 的最后一个通道之前，
+	// 一方定义的宏会静默地改写另一方中的同名标识符，不会产生编译错误，因此无法依赖编译失败时的回退
+	{
+		std::vector<std::string_view> producerDefines;
+		for (std::string_view commonBlock : producer.commonBlocks) {
+			CollectDefines(commonBlock, producerDefines);
+		}
+		for (std::string_view passBlock : producer.passBlocks) {
+			CollectDefines(passBlock, producerDefines);
+		}
+
+		for (std::string_view name : producerDefines) {
+			if (FindIdentifier(consumer.source, name) != std::string_view::npos) {
+				return fmt::format("{} 中的宏 {} 和 {} 中的标识符冲突", producer.desc.name, name, desc.name);
+			}
+		}
+
+		std::vector<std::string_view> consumerDefines;
+		for (std::string_view commonBlock : consumer.commonBlocks) {
+			CollectDefines(commonBlock, consumerDefines);
+		}
+		CollectDefines(consumer.passBlocks[0], consumerDefines);
+
+		for (std::string_view name : consumerDefines) {
+			if (FindIdentifier(producer.source, name) != std::string_view::npos) {
+				return fmt::format("{} 中的宏 {} 和 {} 中的标识符冲突", desc.name, name, producer.desc.name);
+			}
+		}
+	}
+
+	// 内联的参数是所有通道共用的宏，不能和另一个效果中的任何标识符相同
+	if (isInlineParams) {
+		for (const EffectParameterDesc& d : desc.params) {
+			if (FindIdentifier(producer.source, d.name) != std::string_view::npos) {
+				return fmt::format("内联参数 {} 和 {} 中的标识符冲突", d.name, producer.desc.name);
+			}
+		}
+		for (const EffectParameterDesc& d : producer.desc.params) {
+			if (FindIdentifier(consumer.source, d.name) != std::string_view::npos) {
+				return fmt::format("内联参数 {} 和 {} 中的标识符冲突", d.name, desc.name);
+			}
+		}
+	}
+
+	return {};
+}
+
+static bool IsParamsValid(const std::vector<std::string>& paramNames, const std::map<std::string, std::variant<float, int>>& params) {
+	return std::all_of(params.begin(), params.end(), [&](const auto& pair) {
+		return std::find(paramNames.begin(), paramNames.end(), pair.first) != paramNames.end();
+	});
+}
+
+static std::vector<std::string> GetParamNames(const EffectDesc& desc) {
+	std::vector<std::string> result;
+	result.reserve(desc.params.size());
+	for (const EffectParameterDesc& d : desc.params) {
+		result.push_back(d.name);
+	}
+	return result;
+}
+
+std::string EffectCompiler::CheckFusion(
+	std::string_view producerName,
+	const std::map<std::string, std::variant<float, int>>& producerParams,
+	std::string_view consumerName,
+	const std::map<std::string, std::variant<float, int>>& consumerParams,
+	UINT flags
+) {
+	FusionSource producer;
+	if (ReadFusionSource(producerName, producer.source)) {
+		return fmt::format("读取 {} 失败", producerName);
+	}
+
+	FusionSource consumer;
+	if (ReadFusionSource(consumerName, consumer.source)) {
+		return fmt::format("读取 {} 失败", consumerName);
+	}
+
+	const bool isInlineParams = flags & EFFECT_FLAG_INLINE_PARAMETERS;
+
+	// 源码未改变时使用上次的结果，无需解析
+	std::string key = EffectFusionCache::GetKey(producer.source, consumer.source, isInlineParams);
+	EffectFusionCache::Decision decision;
+	if (!EffectFusionCache::Get().Load(key, decision)) {
+		if (ParseFusionSource(producerName, producer)) {
+			return fmt::format("解析 {} 失败", producerName);
+		}
+		if (ParseFusionSource(consumerName, consumer)) {
+			return fmt::format("解析 {} 失败", consumerName);
+		}
+
+		std::vector<std::pair<size_t, size_t>> inputReads;
+		decision.reason = CheckFusionSources(producer, consumer, isInlineParams, inputReads);
+		decision.producerParams = GetParamNames(producer.desc);
+		decision.consumerParams = GetParamNames(consumer.desc);
+
+		EffectFusionCache::Get().Save(key, decision);
+	}
+
+	// 由分别编译的效果报告参数错误
+	if (!IsParamsValid(decision.producerParams, producerParams) || !IsParamsValid(decision.consumerParams, consumerParams)) {
+		return "存在非法参数";
+	}
+
+	return std::move(decision.reason);
+}
+
+UINT EffectCompiler::CompileFused(
+	std::string_view producerName,
+	std::string_view consumerName,
+	UINT flags,
+	const std::map<std::string, std::variant<float, int>>& inlineParams,
+	EffectDesc& desc,
+	const Config& config
+) {
+	desc = {};
+	desc.name = StrUtils::Concat(producerName, "+", consumerName);
+	desc.flags = flags;
+
+	FusionSource producer;
+	FusionSource consumer;
+	if (ReadFusionSource(producerName, producer.source) || ReadFusionSource(consumerName, consumer.source)) {
+		return 1;
+	}
+
+	if ((flags & EFFECT_FLAG_FP16) && !IsFP16Sensitive(producer.source) && !IsFP16Sensitive(consumer.source)) {
+		flags &= ~EFFECT_FLAG_FP16;
+		desc.flags = flags;
+		Logger::Get().Info("效果未使用 MF 类型，忽略 FP16 标志");
+	}
+
+	const ShaderCompiler& compiler = ShaderCompiler::Get(flags);
+
+	std::string hash;
+	// 后一个效果不能包含头文件
+	std::string dependencyHash;
+	if (!config.IsDisableEffectCache()) {
+		dependencyHash = EffectIncludeCache::Get().GetDependencyHash(producer.source);
+#ifdef _DEBUG
+		std::string hashSource = StrUtils::Concat(producer.source, FUSION_SEPARATOR, consumer.source);
+#else
+		std::string hashSource = StrUtils::Concat(
+			CanonicalizeSource(producer.source), FUSION_SEPARATOR, CanonicalizeSource(consumer.source));
+#endif // _DEBUG
+		hash = EffectCacheManager::GetHash(hashSource, compiler.GetId(),
+			flags & EFFECT_FLAG_INLINE_PARAMETERS ? &inlineParams : nullptr, dependencyHash);
+		if (!hash.empty()) {
+			if (EffectCacheManager::Get().Load(desc.name, hash, desc)) {
+				return 0;
+			}
+		}
+	}
+
+	// 缓存未命中时才解析
+	if (ParseFusionSource(producerName, producer) || ParseFusionSource(consumerName, consumer)) {
+		return 1;
+	}
+
+	std::vector<std::pair<size_t, size_t>> inputReads;
+	std::string reason = CheckFusionSources(producer, consumer, flags & EFFECT_FLAG_INLINE_PARAMETERS, inputReads);
+	if (!reason.empty()) {
+		Logger::Get().Error(StrUtils::Concat("无法融合：", reason));
+		return 1;
+	}
+
+	// 融合后的效果由前一个效果和后一个效果的参数、采样器组成
+	{
+		std::string name = std::move(desc.name);
+		desc = std::move(producer.desc);
+		desc.name = std::move(name);
+		desc.flags = flags;
+	}
+	desc.params.insert(desc.params.end(), consumer.desc.params.begin(), consumer.desc.params.end());
+	desc.samplers.insert(desc.samplers.end(), consumer.desc.samplers.begin(), consumer.desc.samplers.end());
+	desc.isUseDynamic |= consumer.desc.isUseDynamic;
+
+	// 后一个效果的 COMMON 块和通道，读取 INPUT 的表达式替换为 __fusedInput，Pass1 重命名为 __FusedPass1
+	std::string fusedBlock;
+	for (std::string_view commonBlock : consumer.commonBlocks) {
+		fusedBlock.append(commonBlock);
+		fusedBlock.push_back('\n');
+	}
+	fusedBlock.append("static float4 __fusedInput;\n\n");
+	{
+		std::string_view passBlock = consumer.passBlocks[0];
+		std::string pass;
+		size_t last = 0;
+		for (const auto& [start, end] : inputReads) {
+			pass.append(passBlock.substr(last, start - last));
+			pass.append("__fusedInput");
+			last = end;
+		}
+		pass.append(passBlock.substr(last));
+
+		size_t offset = FindIdentifier(pass, "Pass1");
+		assert(offset != std::string::npos);
+		pass.replace(offset, 5, "__FusedPass1");
+
+		fusedBlock.append(pass);
+	}
+
+	if (CompilePasses(desc, producer.commonBlocks, producer.passBlocks, inlineParams,
+		dependencyHash, compiler, config, fusedBlock)
+	) {
+		Logger::Get().Error("编译着色器失败");
+		return 1;
+	}
+
+	if (!config.IsDisableEffectCache() && !hash.empty()) {
+		EffectCacheManager::Get().Save(desc.name, hash, desc);
+	}
+
+	return 0;
+}
@@ -2,16 +2,51 @@
 #include "pch.h"
 #include "EffectDesc.h"
 
+class Config;
+
 
 class EffectCompiler {
 public:
 	EffectCompiler() = default;
 
+	// 不依赖 App，可以在 Run 之外调用，如预编译
 	static UINT Compile(
 		std::string_view effectName,
 		UINT flags,
 		const std::map<std::string, std::variant<float, int>>& inlineParams,
-		EffectDesc& desc
+		EffectDesc& desc,
+		const Config& config
+	);
+
+	// 只运行编译器前端，解析所有选项但不生成和编译着色器，desc 中通道的 cso 和 hash 为空
+	// source 为源文件的内容，解析时会被修改。desc.name 需由调用者设置
+	// outSizeSource 不为空时返回 OUTPUT_WIDTH 和 OUTPUT_HEIGHT 的原始表达式，未指定时为空
+	static UINT Parse(
+		std::string& source,
+		EffectDesc& desc,
+		std::pair<std::string, std::string>* outSizeSource = nullptr
+	);
+
+	// 检查能否将 consumer 作为逐像素的后处理融合到 producer 的最后一个通道中，以省去中间纹理的读写
+	// consumer 需只有一个 PS 样式的通道，输出尺寸和输入相同，且只在当前像素读取 INPUT
+	// params 为 effectsJson 中指定的参数，flags 为两个效果共同的 EFFECT_FLAG_*。可以融合时返回空，否则返回原因
+	static std::string CheckFusion(
+		std::string_view producerName,
+		const std::map<std::string, std::variant<float, int>>& producerParams,
+		std::string_view consumerName,
+		const std::map<std::string, std::variant<float, int>>& consumerParams,
+		UINT flags
+	);
+
+	// 将 consumer 融合到 producer 的最后一个通道中，desc 包含两个效果的参数和采样器，名字为 "producer+consumer"
+	// flags 和 inlineParams 为两个效果合并后的值
+	static UINT CompileFused(
+		std::string_view producerName,
+		std::string_view consumerName,
+		UINT flags,
+		const std::map<std::string, std::variant<float, int>>& inlineParams,
+		EffectDesc& desc,
+		const Config& config
 	);
 
 	// 当前 MagpieFX 版本
@@ -1,6 +1,7 @@
 #pragma once
 #include "pch.h"
 #include <variant>
+#include "EffectExpr.h"
 
 
 enum class EffectIntermediateTextureFormat {
@@ -36,7 +37,7 @@ struct EffectIntermediateTextureFormatDesc {
 };
 
 struct EffectIntermediateTextureDesc {
-	std::pair<std::string, std::string> sizeExpr;
+	std::pair<EffectExpr, EffectExpr> sizeExpr;
 	EffectIntermediateTextureFormat format = EffectIntermediateTextureFormat::UNKNOWN;
 	std::string name;
 	std::string source;
@@ -103,6 +104,8 @@ struct EffectPassDesc {
 	std::array<UINT, 3> numThreads{};
 	std::pair<UINT, UINT> blockSize{};
 	std::string desc;
+	// 生成的源码和宏的哈希，用于增量编译
+	std::string hash;
 	bool isPSStyle = false;
 };
 
@@ -116,7 +119,7 @@ struct EffectDesc {
 	std::string name;
 
 	// 用于计算效果的输出，空值表示支持任意大小的输出
-	std::pair<std::string, std::string> outSizeExpr;
+	std::pair<EffectExpr, EffectExpr> outSizeExpr;
 
 	std::vector<EffectParameterDesc> params;
 	std::vector<EffectIntermediateTextureDesc> textures;
@@ -3,53 +3,47 @@
 #include "Logger.h"
 #include "Utils.h"
 #include "App.h"
-#include "DeviceResources.h"
-#include "TextureLoader.h"
 #include "StrUtils.h"
 #include "Renderer.h"
-#include "CursorManager.h"
 #include <unordered_set>
 #include "Config.h"
 #include "GPUTimer.h"
 
-#pragma push_macro("_UNICODE")
-#undef _UNICODE
-// Conan 的 muparser 不含 UNICODE 支持
-#include <muParser.h>
-#pragma pop_macro("_UNICODE")
 
+// 计算尺寸表达式，结果不是有限值时返回 false
+static bool EvaluateSizeExpr(
+	const std::pair<EffectExpr, EffectExpr>& expr,
+	SIZE inputSize,
+	SIZE outputSize,
+	SIZE& result
+) {
+	double width = expr.first.Evaluate(inputSize, outputSize);
+	double height = expr.second.Evaluate(inputSize, outputSize);
+	if (!std::isfinite(width) || !std::isfinite(height)) {
+		return false;
+	}
 
-bool EffectDrawer::Initialize(
+	result.cx = std::lround(width);
+	result.cy = std::lround(height);
+	return true;
+}
+
+
+bool EffectDrawer::CreatePlan(
 	const EffectDesc& desc,
 	const EffectParams& params,
-	ID3D11Texture2D* inputTex,
-	ID3D11Texture2D** outputTex,
-	RECT* outputRect,
-	RECT* virtualOutputRect
+	SIZE inputSize,
+	SIZE hostSize,
+	Plan& plan
 ) {
-	_desc = desc;
+	plan = {};
 
-	SIZE inputSize{};
-	{
-		D3D11_TEXTURE2D_DESC inputDesc;
-		inputTex->GetDesc(&inputDesc);
-		inputSize = { (LONG)inputDesc.Width, (LONG)inputDesc.Height };
-	}
-
-	const SIZE hostSize = Utils::GetSizeOfRect(App::Get().GetHostWndRect());;
 	bool isLastEffect = desc.flags & EFFECT_FLAG_LAST_EFFECT;
 	bool isInlineParams = desc.flags & EFFECT_FLAG_INLINE_PARAMETERS;
 
-	DeviceResources& dr = App::Get().GetDeviceResources();
-	auto d3dDevice = dr.GetD3DDevice();
-
-	static mu::Parser exprParser;
-	exprParser.DefineConst("INPUT_WIDTH", inputSize.cx);
-	exprParser.DefineConst("INPUT_HEIGHT", inputSize.cy);
+	SIZE& outputSize = plan.outputSize;
 
-	SIZE outputSize{};
-
-	if (desc.outSizeExpr.first.empty()) {
+	if (desc.outSizeExpr.first.IsEmpty()) {
 		if (params.scale.has_value()) {
 			outputSize = hostSize;
 
@@ -80,21 +74,16 @@ bool EffectDrawer::Initialize(
 			outputSize = inputSize;
 		}
 	} else {
-		assert(!desc.outSizeExpr.second.empty());
+		assert(!desc.outSizeExpr.second.IsEmpty());
 
 		if (params.scale.has_value()) {
 			Logger::Get().Error("无法指定缩放");
 			return false;
 		}
 
-		try {
-			exprParser.SetExpr(desc.outSizeExpr.first);
-			outputSize.cx = std::lround(exprParser.Eval());
-
-			exprParser.SetExpr(desc.outSizeExpr.second);
-			outputSize.cy = std::lround(exprParser.Eval());
-		} catch (const mu::ParserError& e) {
-			Logger::Get().Error(fmt::format("计算输出尺寸 {} 失败：{}", e.GetExpr(), e.GetMsg()));
+		// 输出尺寸的表达式中不含 OUTPUT_WIDTH 和 OUTPUT_HEIGHT
+		if (!EvaluateSizeExpr(desc.outSizeExpr, inputSize, {}, outputSize)) {
+			Logger::Get().Error("计算输出尺寸失败");
 			return false;
 		}
 	}
@@ -104,162 +93,43 @@ bool EffectDrawer::Initialize(
 		return false;
 	}
 
-	exprParser.DefineConst("OUTPUT_WIDTH", outputSize.cx);
-	exprParser.DefineConst("OUTPUT_HEIGHT", outputSize.cy);
-
-	_samplers.resize(desc.samplers.size());
-	for (UINT i = 0; i < _samplers.size(); ++i) {
-		const EffectSamplerDesc& samDesc = desc.samplers[i];
-		if (!dr.GetSampler(
-			samDesc.filterType == EffectSamplerFilterType::Linear ? D3D11_FILTER_MIN_MAG_MIP_LINEAR : D3D11_FILTER_MIN_MAG_MIP_POINT,
-			samDesc.addressType == EffectSamplerAddressType::Clamp ? D3D11_TEXTURE_ADDRESS_CLAMP : D3D11_TEXTURE_ADDRESS_WRAP,
-			&_samplers[i])
-		) {
-			Logger::Get().Error(fmt::format("创建采样器 {} 失败", samDesc.name));
-			return false;
-		}
-	}
-
-	// 创建中间纹理
-	// 第一个为 INPUT，最后一个为 OUTPUT
-	_textures.resize(desc.textures.size() + 1);
-	_textures[0].copy_from(inputTex);
+	// 中间纹理的尺寸，INPUT 和从文件加载的纹理为 0
+	plan.textureSizes.resize(desc.textures.size());
 	for (size_t i = 1; i < desc.textures.size(); ++i) {
 		const EffectIntermediateTextureDesc& texDesc = desc.textures[i];
-
 		if (!texDesc.source.empty()) {
-			// 从文件加载纹理
-			_textures[i] = TextureLoader::Load((L"effects\\" + StrUtils::UTF8ToUTF16(texDesc.source)).c_str());
-			if (!_textures[i]) {
-				Logger::Get().Error(fmt::format("加载纹理 {} 失败", texDesc.source));
-				return false;
-			}
-
-			if (texDesc.format != EffectIntermediateTextureFormat::UNKNOWN) {
-				// 检查纹理格式是否匹配
-				D3D11_TEXTURE2D_DESC desc{};
-				_textures[i]->GetDesc(&desc);
-				if (desc.Format != EffectIntermediateTextureDesc::FORMAT_DESCS[(UINT)texDesc.format].dxgiFormat) {
-					Logger::Get().Error("SOURCE 纹理格式不匹配");
-					return false;
-				}
-			}
-			
-		} else {
-			SIZE texSize{};
-			try {
-				exprParser.SetExpr(texDesc.sizeExpr.first);
-				texSize.cx = std::lround(exprParser.Eval());
-				exprParser.SetExpr(texDesc.sizeExpr.second);
-				texSize.cy = std::lround(exprParser.Eval());
-			} catch (const mu::ParserError& e) {
-				Logger::Get().Error(fmt::format("计算中间纹理尺寸 {} 失败：{}", e.GetExpr(), e.GetMsg()));
-				return false;
-			}
-
-			if (texSize.cx <= 0 || texSize.cy <= 0) {
-				Logger::Get().Error("非法的中间纹理尺寸");
-				return false;
-			}
-
-			_textures[i] = dr.CreateTexture2D(
-				EffectIntermediateTextureDesc::FORMAT_DESCS[(UINT)texDesc.format].dxgiFormat,
-				texSize.cx,
-				texSize.cy,
-				D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS
-			);
-			if (!_textures[i]) {
-				Logger::Get().Error("创建纹理失败");
-				return false;
-			}
+			continue;
 		}
-	}
 
-	if (!isLastEffect) {
-		// 创建输出纹理
-		_textures.back() = dr.CreateTexture2D(
-			DXGI_FORMAT_R8G8B8A8_UNORM,
-			outputSize.cx,
-			outputSize.cy,
-			D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS
-		);
-		
-		if (!_textures.back()) {
-			Logger::Get().Error("创建纹理失败");
+		SIZE& texSize = plan.textureSizes[i];
+		if (!EvaluateSizeExpr(texDesc.sizeExpr, inputSize, outputSize, texSize)) {
+			Logger::Get().Error(fmt::format("计算中间纹理 {} 的尺寸失败", texDesc.name));
 			return false;
 		}
-	} else {
-		_textures.back().copy_from(dr.GetBackBuffer());
-	}
 
-	*outputTex = _textures.back().get();
-
-	_shaders.resize(desc.passes.size());
-	_srvs.resize(desc.passes.size());
-	_uavs.resize(desc.passes.size());
-	for (UINT i = 0; i < _shaders.size(); ++i) {
-		const EffectPassDesc& passDesc = desc.passes[i];
-
-		HRESULT hr = d3dDevice->CreateComputeShader(
-			passDesc.cso->GetBufferPointer(), passDesc.cso->GetBufferSize(), nullptr, _shaders[i].put());
-		if (FAILED(hr)) {
-			Logger::Get().ComError("创建计算着色器失败", hr);
+		if (texSize.cx <= 0 || texSize.cy <= 0) {
+			Logger::Get().Error("非法的中间纹理尺寸");
 			return false;
 		}
+	}
 
-		_srvs[i].resize(passDesc.inputs.size());
-		for (UINT j = 0; j < passDesc.inputs.size(); ++j) {
-			if (!dr.GetShaderResourceView(_textures[passDesc.inputs[j]].get(), &_srvs[i][j])) {
-				Logger::Get().Error("GetShaderResourceView 失败");
-				return false;
-			}
-		}
-		
-		if (!passDesc.outputs.empty()) {
-			_uavs[i].resize(passDesc.outputs.size() * 2);
-			for (UINT j = 0; j < passDesc.outputs.size(); ++j) {
-				if (!dr.GetUnorderedAccessView(_textures[passDesc.outputs[j]].get(), &_uavs[i][j])) {
-					Logger::Get().Error("GetUnorderedAccessView 失败");
-					return false;
-				}
-			}
+	// 通道不能输出到 INPUT 和从文件加载的纹理，最后一个效果输出到后缓冲区，它的尺寸和主窗口相同
+	const SIZE outputTexSize = isLastEffect ? hostSize : outputSize;
 
-			D3D11_TEXTURE2D_DESC desc;
-			_textures[passDesc.outputs[0]]->GetDesc(&desc);
-			_dispatches.emplace_back(
-				(desc.Width + passDesc.blockSize.first - 1) / passDesc.blockSize.first,
-				(desc.Height + passDesc.blockSize.second - 1) / passDesc.blockSize.second
-			);
+	plan.dispatches.reserve(desc.passes.size());
+	for (const EffectPassDesc& passDesc : desc.passes) {
+		SIZE size;
+		if (!passDesc.outputs.empty()) {
+			size = plan.textureSizes[passDesc.outputs[0]];
 		} else {
 			// 最后一个 pass 输出到 OUTPUT
-			_uavs[i].resize(2);
-			if (!dr.GetUnorderedAccessView(_textures.back().get(), &_uavs[i][0])) {
-				Logger::Get().Error("GetUnorderedAccessView 失败");
-				return false;
-			}
-
-			D3D11_TEXTURE2D_DESC desc;
-			_textures.back()->GetDesc(&desc);
-
-			_dispatches.emplace_back(
-				(std::min(desc.Width, (UINT)outputSize.cx) + passDesc.blockSize.first - 1) / passDesc.blockSize.first,
-				(std::min(desc.Height, (UINT)outputSize.cy) + passDesc.blockSize.second - 1) / passDesc.blockSize.second
-			);
+			size = { std::min(outputTexSize.cx, outputSize.cx), std::min(outputTexSize.cy, outputSize.cy) };
 		}
-	}
-
-	if (isLastEffect) {
-		// 为光标渲染预留空间
-		_srvs.back().push_back(nullptr);
 
-		if (!dr.GetSampler(
-			App::Get().GetConfig().GetCursorInterpolationMode() == 0 ? D3D11_FILTER_MIN_MAG_MIP_POINT : D3D11_FILTER_MIN_MAG_MIP_LINEAR,
-			D3D11_TEXTURE_ADDRESS_CLAMP,
-			&_samplers.emplace_back(nullptr)
-		)) {
-			Logger::Get().Error("GetSampler 失败");
-			return false;
-		}
+		plan.dispatches.emplace_back(
+			((UINT)size.cx + passDesc.blockSize.first - 1) / passDesc.blockSize.first,
+			((UINT)size.cy + passDesc.blockSize.second - 1) / passDesc.blockSize.second
+		);
 	}
 
 	// 大小必须为 4 的倍数
@@ -270,7 +140,9 @@ bool EffectDrawer::Initialize(
 			psStylePassParams += 4;
 		}
 	}
-	_constants.resize((builtinConstantCount + psStylePassParams + (isInlineParams ? 0 : desc.params.size()) + 3) / 4 * 4);
+
+	std::vector<EffectConstant32>& constants = plan.constants;
+	constants.resize((builtinConstantCount + psStylePassParams + (isInlineParams ? 0 : desc.params.size()) + 3) / 4 * 4);
 	// cbuffer __CB2 : register(b1) {
 	//     uint2 __inputSize;
 	//     uint2 __outputSize;
@@ -281,69 +153,61 @@ bool EffectDrawer::Initialize(
 	//     [uint4 __offset;]
 	//     [PARAMETERS...]
 	// );
-	_constants[0].uintVal = inputSize.cx;
-	_constants[1].uintVal = inputSize.cy;
-	_constants[2].uintVal = outputSize.cx;
-	_constants[3].uintVal = outputSize.cy;
-	_constants[4].floatVal = 1.0f / inputSize.cx;
-	_constants[5].floatVal = 1.0f / inputSize.cy;
-	_constants[6].floatVal = 1.0f / outputSize.cx;
-	_constants[7].floatVal = 1.0f / outputSize.cy;
-	_constants[8].floatVal = outputSize.cx / (FLOAT)inputSize.cx;
-	_constants[9].floatVal = outputSize.cy / (FLOAT)inputSize.cy;
+	constants[0].uintVal = inputSize.cx;
+	constants[1].uintVal = inputSize.cy;
+	constants[2].uintVal = outputSize.cx;
+	constants[3].uintVal = outputSize.cy;
+	constants[4].floatVal = 1.0f / inputSize.cx;
+	constants[5].floatVal = 1.0f / inputSize.cy;
+	constants[6].floatVal = 1.0f / outputSize.cx;
+	constants[7].floatVal = 1.0f / outputSize.cy;
+	constants[8].floatVal = outputSize.cx / (FLOAT)inputSize.cx;
+	constants[9].floatVal = outputSize.cy / (FLOAT)inputSize.cy;
 
 	// 输出尺寸可能比主窗口更大
-	RECT virtualOutputRect1{};
-	RECT outputRect1{};
+	RECT& virtualOutputRect = plan.virtualOutputRect;
+	RECT& outputRect = plan.outputRect;
 
 	if (isLastEffect) {
-		virtualOutputRect1.left = (hostSize.cx - outputSize.cx) / 2;
-		virtualOutputRect1.top = (hostSize.cy - outputSize.cy) / 2;
-		virtualOutputRect1.right = virtualOutputRect1.left + outputSize.cx;
-		virtualOutputRect1.bottom = virtualOutputRect1.top + outputSize.cy;
-
-		outputRect1 = RECT{
-			std::max(0L, virtualOutputRect1.left),
-			std::max(0L, virtualOutputRect1.top),
-			std::min(hostSize.cx, virtualOutputRect1.right),
-			std::min(hostSize.cy, virtualOutputRect1.bottom)
+		virtualOutputRect.left = (hostSize.cx - outputSize.cx) / 2;
+		virtualOutputRect.top = (hostSize.cy - outputSize.cy) / 2;
+		virtualOutputRect.right = virtualOutputRect.left + outputSize.cx;
+		virtualOutputRect.bottom = virtualOutputRect.top + outputSize.cy;
+
+		outputRect = RECT{
+			std::max(0L, virtualOutputRect.left),
+			std::max(0L, virtualOutputRect.top),
+			std::min(hostSize.cx, virtualOutputRect.right),
+			std::min(hostSize.cy, virtualOutputRect.bottom)
 		};
 
-		_constants[12].intVal = -std::min(0L, virtualOutputRect1.left);
-		_constants[13].intVal = -std::min(0L, virtualOutputRect1.top);
-		_constants[10].intVal = outputRect1.right - outputRect1.left + _constants[12].intVal;
-		_constants[11].intVal = outputRect1.bottom - outputRect1.top + _constants[13].intVal;
-		_constants[14].intVal = outputRect1.left - _constants[12].intVal;
-		_constants[15].intVal = outputRect1.top - _constants[13].intVal;
+		constants[12].intVal = -std::min(0L, virtualOutputRect.left);
+		constants[13].intVal = -std::min(0L, virtualOutputRect.top);
+		constants[10].intVal = outputRect.right - outputRect.left + constants[12].intVal;
+		constants[11].intVal = outputRect.bottom - outputRect.top + constants[13].intVal;
+		constants[14].intVal = outputRect.left - constants[12].intVal;
+		constants[15].intVal = outputRect.top - constants[13].intVal;
 	} else {
-		outputRect1 = RECT{ 0, 0, outputSize.cx, outputSize.cy };
-		virtualOutputRect1 = outputRect1;
+		outputRect = RECT{ 0, 0, outputSize.cx, outputSize.cy };
+		virtualOutputRect = outputRect;
 
-		_constants[10].intVal = outputSize.cx;
-		_constants[11].intVal = outputSize.cy;
-	}
-
-	if (outputRect) {
-		*outputRect = outputRect1;
-	}
-	if (virtualOutputRect) {
-		*virtualOutputRect = virtualOutputRect1;
+		constants[10].intVal = outputSize.cx;
+		constants[11].intVal = outputSize.cy;
 	}
 
 	// PS 样式的通道需要的参数
-	EffectConstant32* pCurParam = _constants.data() + builtinConstantCount;
+	EffectConstant32* pCurParam = constants.data() + builtinConstantCount;
 	if (psStylePassParams > 0) {
 		for (UINT i = 0, end = (UINT)desc.passes.size() - 1; i < end; ++i) {
 			if (desc.passes[i].isPSStyle) {
-				D3D11_TEXTURE2D_DESC outputDesc;
-				_textures[desc.passes[i].outputs[0]]->GetDesc(&outputDesc);
-				pCurParam->uintVal = outputDesc.Width;
+				SIZE passOutputSize = plan.textureSizes[desc.passes[i].outputs[0]];
+				pCurParam->uintVal = passOutputSize.cx;
 				++pCurParam;
-				pCurParam->uintVal = outputDesc.Height;
+				pCurParam->uintVal = passOutputSize.cy;
 				++pCurParam;
-				pCurParam->floatVal = 1.0f / outputDesc.Width;
+				pCurParam->floatVal = 1.0f / passOutputSize.cx;
 				++pCurParam;
-				pCurParam->floatVal = 1.0f / outputDesc.Height;
+				pCurParam->floatVal = 1.0f / passOutputSize.cy;
 				++pCurParam;
 			}
 		}
@@ -414,17 +278,123 @@ bool EffectDrawer::Initialize(
 		}
 	}
 
-	D3D11_BUFFER_DESC bd{};
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = 4 * (UINT)_constants.size();
-	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	return true;
+}
+
+bool EffectDrawer::Initialize(
+	const EffectDesc& desc,
+	const Plan& plan,
+	EffectBackend& backend,
+	std::shared_ptr<EffectBackend::Texture> inputTex,
+	std::shared_ptr<EffectBackend::Texture>& outputTex
+) {
+	_desc = desc;
+	_backend = &backend;
+	_dispatches = plan.dispatches;
+	_constants = plan.constants;
+
+	bool isLastEffect = desc.flags & EFFECT_FLAG_LAST_EFFECT;
+
+	_samplers.resize(desc.samplers.size());
+	for (UINT i = 0; i < _samplers.size(); ++i) {
+		const EffectSamplerDesc& samDesc = desc.samplers[i];
+		_samplers[i] = backend.GetSampler(samDesc.filterType, samDesc.addressType);
+		if (!_samplers[i]) {
+			Logger::Get().Error(fmt::format("创建采样器 {} 失败", samDesc.name));
+			return false;
+		}
+	}
+
+	// 创建中间纹理
+	// 第一个为 INPUT，最后一个为 OUTPUT
+	_textures.resize(desc.textures.size() + 1);
+	_textures[0] = std::move(inputTex);
+	for (size_t i = 1; i < desc.textures.size(); ++i) {
+		const EffectIntermediateTextureDesc& texDesc = desc.textures[i];
+
+		if (!texDesc.source.empty()) {
+			// 从文件加载纹理
+			_textures[i] = backend.LoadTexture((L"effects\\" + StrUtils::UTF8ToUTF16(texDesc.source)).c_str(), texDesc.format);
+			if (!_textures[i]) {
+				Logger::Get().Error(fmt::format("加载纹理 {} 失败", texDesc.source));
+				return false;
+			}
+		} else {
+			_textures[i] = backend.CreateTexture(texDesc.format, plan.textureSizes[i]);
+			if (!_textures[i]) {
+				Logger::Get().Error("创建纹理失败");
+				return false;
+			}
+		}
+	}
+
+	if (!isLastEffect) {
+		// 创建输出纹理
+		_textures.back() = backend.CreateTexture(EffectIntermediateTextureFormat::R8G8B8A8_UNORM, plan.outputSize);
+		if (!_textures.back()) {
+			Logger::Get().Error("创建纹理失败");
+			return false;
+		}
+	} else {
+		_textures.back() = backend.GetBackBuffer();
+	}
+
+	outputTex = _textures.back();
+
+	_shaders.resize(desc.passes.size());
+	_srvs.resize(desc.passes.size());
+	_uavs.resize(desc.passes.size());
+	for (UINT i = 0; i < _shaders.size(); ++i) {
+		const EffectPassDesc& passDesc = desc.passes[i];
+
+		_shaders[i] = backend.CreateComputeShader(
+			std::span((const BYTE*)passDesc.cso->GetBufferPointer(), passDesc.cso->GetBufferSize()));
+		if (!_shaders[i]) {
+			return false;
+		}
 
-	D3D11_SUBRESOURCE_DATA initData{};
-	initData.pSysMem = _constants.data();
+		_srvs[i].resize(passDesc.inputs.size());
+		for (UINT j = 0; j < passDesc.inputs.size(); ++j) {
+			_srvs[i][j] = backend.GetShaderResourceView(_textures[passDesc.inputs[j]].get());
+			if (!_srvs[i][j]) {
+				Logger::Get().Error("GetShaderResourceView 失败");
+				return false;
+			}
+		}
+
+		// 最后一个 pass 输出到 OUTPUT
+		if (!passDesc.outputs.empty()) {
+			_uavs[i].resize(passDesc.outputs.size());
+			for (UINT j = 0; j < passDesc.outputs.size(); ++j) {
+				_uavs[i][j] = backend.GetUnorderedAccessView(_textures[passDesc.outputs[j]].get());
+			}
+		} else {
+			_uavs[i].push_back(backend.GetUnorderedAccessView(_textures.back().get()));
+		}
 
-	HRESULT hr = dr.GetD3DDevice()->CreateBuffer(&bd, &initData, _constantBuffer.put());
-	if (FAILED(hr)) {
-		Logger::Get().ComError("CreateBuffer 失败", hr);
+		if (std::find(_uavs[i].begin(), _uavs[i].end(), nullptr) != _uavs[i].end()) {
+			Logger::Get().Error("GetUnorderedAccessView 失败");
+			return false;
+		}
+	}
+
+	if (isLastEffect) {
+		// 为光标渲染预留空间
+		_srvs.back().push_back(nullptr);
+
+		EffectBackend::Sampler* cursorSampler = backend.GetSampler(
+			App::Get().GetConfig().GetCursorInterpolationMode() == 0 ? EffectSamplerFilterType::Point : EffectSamplerFilterType::Linear,
+			EffectSamplerAddressType::Clamp
+		);
+		if (!cursorSampler) {
+			Logger::Get().Error("GetSampler 失败");
+			return false;
+		}
+		_samplers.push_back(cursorSampler);
+	}
+
+	_constantBuffer = backend.CreateConstantBuffer(_constants);
+	if (!_constantBuffer) {
 		return false;
 	}
 	
@@ -432,14 +402,9 @@ bool EffectDrawer::Initialize(
 }
 
 void EffectDrawer::Draw(UINT& idx, bool noUpdate) {
-	auto d3dDC = App::Get().GetDeviceResources().GetD3DDC();
 	auto& gpuTimer = App::Get().GetRenderer().GetGPUTimer();
 
-	{
-		ID3D11Buffer* t = _constantBuffer.get();
-		d3dDC->CSSetConstantBuffers(1, 1, &t);
-	}
-	d3dDC->CSSetSamplers(0, (UINT)_samplers.size(), _samplers.data());
+	_backend->BindEffectResources(_constantBuffer.get(), _samplers);
 
 	for (UINT i = 0; i < _dispatches.size(); ++i) {
 		// noUpdate 为真则只渲染最后一个通道
@@ -453,32 +418,12 @@ void EffectDrawer::Draw(UINT& idx, bool noUpdate) {
 }
 
 void EffectDrawer::_DrawPass(UINT i) {
-	auto d3dDC = App::Get().GetDeviceResources().GetD3DDC();
-	d3dDC->CSSetShader(_shaders[i].get(), nullptr, 0);
-
 	if ((_desc.flags & EFFECT_FLAG_LAST_EFFECT) && i == _dispatches.size() - 1) {
 		// 最后一个效果的最后一个通道负责渲染光标
-
-		// 光标纹理
-		CursorManager& cm = App::Get().GetCursorManager();
-		if (cm.HasCursor()) {
-			ID3D11Texture2D* cursorTex;
-			CursorManager::CursorType ct;
-			if (cm.GetCursorTexture(&cursorTex, ct)) {
-				if (!App::Get().GetDeviceResources().GetShaderResourceView(cursorTex, &_srvs[i].back())) {
-					Logger::Get().Error("GetShaderResourceView 出错");
-				}
-			} else {
-				Logger::Get().Error("GetCursorTexture 出错");
-			}
+		if (EffectBackend::ShaderResourceView* cursorSrv = _backend->GetCursorShaderResourceView()) {
+			_srvs[i].back() = cursorSrv;
 		}
 	}
 
-	d3dDC->CSSetShaderResources(0, (UINT)_srvs[i].size(), _srvs[i].data());
-	UINT uavCount = (UINT)_uavs[i].size() / 2;
-	d3dDC->CSSetUnorderedAccessViews(0, uavCount, _uavs[i].data(), nullptr);
-
-	d3dDC->Dispatch(_dispatches[i].first, _dispatches[i].second, 1);
-
-	d3dDC->CSSetUnorderedAccessViews(0, uavCount, _uavs[i].data() + uavCount, nullptr);
+	_backend->Dispatch(_shaders[i].get(), _srvs[i], _uavs[i], _dispatches[i].first, _dispatches[i].second);
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include "pch.h"
 #include "EffectDesc.h"
+#include "EffectBackend.h"
 
 
 class EffectDrawer {
@@ -9,13 +10,35 @@ public:
 	EffectDrawer(const EffectDrawer&) = delete;
 	EffectDrawer(EffectDrawer&&) = delete;
 
-	bool Initialize(
+	// 初始化中不依赖 D3D 资源的部分，只由效果、参数、输入尺寸和主窗口尺寸决定
+	struct Plan {
+		SIZE outputSize{};
+		// 和 EffectDesc::textures 对应，INPUT 和从文件加载的纹理为 0
+		std::vector<SIZE> textureSizes;
+		std::vector<std::pair<UINT, UINT>> dispatches;
+		std::vector<EffectConstant32> constants;
+		// 只有最后一个效果的输出可能超出主窗口
+		RECT outputRect{};
+		RECT virtualOutputRect{};
+	};
+
+	// 计算尺寸、线程组数量和常量，检查参数，不创建任何资源
+	static bool CreatePlan(
 		const EffectDesc& desc,
 		const EffectParams& params,
-		ID3D11Texture2D* inputTex,
-		ID3D11Texture2D** outputTex,
-		RECT* outputRect = nullptr,
-		RECT* virtualOutputRect = nullptr
+		SIZE inputSize,
+		SIZE hostSize,
+		Plan& plan
+	);
+
+	// inputTex 的尺寸需和 CreatePlan 的 inputSize 相同
+	// 所有资源通过 backend 创建，它需在 EffectDrawer 销毁前保持有效
+	bool Initialize(
+		const EffectDesc& desc,
+		const Plan& plan,
+		EffectBackend& backend,
+		std::shared_ptr<EffectBackend::Texture> inputTex,
+		std::shared_ptr<EffectBackend::Texture>& outputTex
 	);
 
 	void Draw(UINT& idx, bool noUpdate = false);
@@ -33,16 +56,18 @@ private:
 
 	EffectDesc _desc;
 
-	std::vector<ID3D11SamplerState*> _samplers;
-	std::vector<winrt::com_ptr<ID3D11Texture2D>> _textures;
-	std::vector<std::vector<ID3D11ShaderResourceView*>> _srvs;
-	// 后半部分为空，用于解绑
-	std::vector<std::vector<ID3D11UnorderedAccessView*>> _uavs;
+	EffectBackend* _backend = nullptr;
+
+	std::vector<EffectBackend::Sampler*> _samplers;
+	// 第一个为 INPUT，最后一个为 OUTPUT
+	std::vector<std::shared_ptr<EffectBackend::Texture>> _textures;
+	std::vector<std::vector<EffectBackend::ShaderResourceView*>> _srvs;
+	std::vector<std::vector<EffectBackend::UnorderedAccessView*>> _uavs;
 
 	std::vector<EffectConstant32> _constants;
-	winrt::com_ptr<ID3D11Buffer> _constantBuffer;
+	std::unique_ptr<EffectBackend::ConstantBuffer> _constantBuffer;
 
-	std::vector<winrt::com_ptr<ID3D11ComputeShader>> _shaders;
+	std::vector<std::unique_ptr<EffectBackend::ComputeShader>> _shaders;
 
 	std::vector<std::pair<UINT, UINT>> _dispatches;
 };
@@ -0,0 +1,497 @@
+#include "pch.h"
+#include "EffectExpr.h"
+#include "StrUtils.h"
+#include <charconv>
+
+
+using OpCode = EffectExpr::OpCode;
+using Variable = EffectExpr::Variable;
+using Instruction = EffectExpr::Instruction;
+
+static constexpr bool IsUnaryOp(OpCode op) {
+	return op >= OpCode::Neg;
+}
+
+static double ApplyUnaryOp(OpCode op, double a) {
+	switch (op) {
+	case OpCode::Neg:
+		return -a;
+	case OpCode::Abs:
+		return std::abs(a);
+	case OpCode::Sqrt:
+		return std::sqrt(a);
+	case OpCode::Rint:
+		// 和 muParser 相同
+		return std::floor(a + 0.5);
+	case OpCode::Sign:
+		return a > 0 ? 1.0 : (a < 0 ? -1.0 : 0.0);
+	case OpCode::Exp:
+		return std::exp(a);
+	case OpCode::Ln:
+		return std::log(a);
+	case OpCode::Log2:
+		return std::log2(a);
+	case OpCode::Log10:
+		return std::log10(a);
+	default:
+		assert(false);
+		return 0;
+	}
+}
+
+static double ApplyBinaryOp(OpCode op, double a, double b) {
+	switch (op) {
+	case OpCode::Add:
+		return a + b;
+	case OpCode::Sub:
+		return a - b;
+	case OpCode::Mul:
+		return a * b;
+	case OpCode::Div:
+		return a / b;
+	case OpCode::Pow:
+		return std::pow(a, b);
+	case OpCode::Min:
+		return std::min(a, b);
+	case OpCode::Max:
+		return std::max(a, b);
+	default:
+		assert(false);
+		return 0;
+	}
+}
+
+// 递归下降解析，直接生成后缀形式的字节码
+// 优先级和 muParser 相同：^ 高于一元负号，且为右结合
+class ExprParser {
+public:
+	ExprParser(std::string_view expr, bool isOutputAllowed, std::vector<Instruction>& code)
+		: _expr(expr), _isOutputAllowed(isOutputAllowed), _code(code) {}
+
+	UINT Parse() {
+		if (_ParseExpr()) {
+			return 1;
+		}
+
+		_SkipBlanks();
+		if (!_expr.empty()) {
+			return 1;
+		}
+
+		assert(_depth == 1);
+		return _maxDepth <= EffectExpr::MAX_STACK_DEPTH ? 0 : 1;
+	}
+
+private:
+	// 限制括号和函数的嵌套层数
+	static constexpr UINT MAX_NESTING = 64;
+
+	void _SkipBlanks() {
+		while (!_expr.empty() && StrUtils::isspace(_expr.front())) {
+			_expr.remove_prefix(1);
+		}
+	}
+
+	// 跳过空白后如果下一个字符为 c 则消耗它
+	bool _Consume(char c) {
+		_SkipBlanks();
+		if (_expr.empty() || _expr.front() != c) {
+			return false;
+		}
+		_expr.remove_prefix(1);
+		return true;
+	}
+
+	void _Emit(OpCode op, Variable var = Variable::InputWidth, double value = 0) {
+		_code.push_back({ op, var, value });
+
+		if (op == OpCode::Const || op == OpCode::Var) {
+			_maxDepth = std::max(_maxDepth, ++_depth);
+		} else if (!IsUnaryOp(op)) {
+			--_depth;
+		}
+	}
+
+	// expr := term (('+' | '-') term)*
+	UINT _ParseExpr() {
+		if (++_nesting > MAX_NESTING) {
+			return 1;
+		}
+
+		if (_ParseTerm()) {
+			return 1;
+		}
+
+		while (true) {
+			OpCode op;
+			if (_Consume('+')) {
+				op = OpCode::Add;
+			} else if (_Consume('-')) {
+				op = OpCode::Sub;
+			} else {
+				break;
+			}
+
+			if (_ParseTerm()) {
+				return 1;
+			}
+			_Emit(op);
+		}
+
+		--_nesting;
+		return 0;
+	}
+
+	// term := unary (('*' | '/') unary)*
+	UINT _ParseTerm() {
+		if (_ParseUnary()) {
+			return 1;
+		}
+
+		while (true) {
+			OpCode op;
+			if (_Consume('*')) {
+				op = OpCode::Mul;
+			} else if (_Consume('/')) {
+				op = OpCode::Div;
+			} else {
+				break;
+			}
+
+			if (_ParseUnary()) {
+				return 1;
+			}
+			_Emit(op);
+		}
+
+		return 0;
+	}
+
+	// unary := ('-' | '+') unary | power
+	UINT _ParseUnary() {
+		if (_Consume('-')) {
+			if (++_nesting > MAX_NESTING || _ParseUnary()) {
+				return 1;
+			}
+			--_nesting;
+
+			_Emit(OpCode::Neg);
+			return 0;
+		}
+
+		if (_Consume('+')) {
+			if (++_nesting > MAX_NESTING || _ParseUnary()) {
+				return 1;
+			}
+			--_nesting;
+			return 0;
+		}
+
+		return _ParsePower();
+	}
+
+	// power := primary ('^' unary)?
+	UINT _ParsePower() {
+		if (_ParsePrimary()) {
+			return 1;
+		}
+
+		if (_Consume('^')) {
+			// 右结合，和 _ParseUnary 一样限制递归深度
+			if (++_nesting > MAX_NESTING || _ParseUnary()) {
+				return 1;
+			}
+			--_nesting;
+			_Emit(OpCode::Pow);
+		}
+
+		return 0;
+	}
+
+	// primary := number | variable | function '(' expr (',' expr)* ')' | '(' expr ')'
+	UINT _ParsePrimary() {
+		_SkipBlanks();
+		if (_expr.empty()) {
+			return 1;
+		}
+
+		char c = _expr.front();
+
+		if (c == '(') {
+			_expr.remove_prefix(1);
+			if (_ParseExpr()) {
+				return 1;
+			}
+			return _Consume(')') ? 0 : 1;
+		}
+
+		if (StrUtils::isdigit(c) || c == '.') {
+			double value = 0;
+			auto [ptr, ec] = std::from_chars(_expr.data(), _expr.data() + _expr.size(), value);
+			if (ec != std::errc()) {
+				return 1;
+			}
+
+			_expr.remove_prefix(ptr - _expr.data());
+			_Emit(OpCode::Const, Variable::InputWidth, value);
+			return 0;
+		}
+
+		if (!StrUtils::isalpha(c) && c != '_') {
+			return 1;
+		}
+
+		size_t len = 1;
+		while (len < _expr.size() && (StrUtils::isalnum(_expr[len]) || _expr[len] == '_')) {
+			++len;
+		}
+		std::string_view name = _expr.substr(0, len);
+		_expr.remove_prefix(len);
+
+		static constexpr std::pair<std::string_view, Variable> VARIABLES[] = {
+			{ "INPUT_WIDTH", Variable::InputWidth },
+			{ "INPUT_HEIGHT", Variable::InputHeight },
+			{ "OUTPUT_WIDTH", Variable::OutputWidth },
+			{ "OUTPUT_HEIGHT", Variable::OutputHeight }
+		};
+
+		for (const auto& [varName, var] : VARIABLES) {
+			if (name == varName) {
+				if (!_isOutputAllowed && var >= Variable::OutputWidth) {
+					return 1;
+				}
+
+				_Emit(OpCode::Var, var);
+				return 0;
+			}
+		}
+
+		static constexpr std::pair<std::string_view, OpCode> FUNCTIONS[] = {
+			{ "min", OpCode::Min },
+			{ "max", OpCode::Max },
+			{ "abs", OpCode::Abs },
+			{ "sqrt", OpCode::Sqrt },
+			{ "rint", OpCode::Rint },
+			{ "sign", OpCode::Sign },
+			{ "exp", OpCode::Exp },
+			{ "ln", OpCode::Ln },
+			{ "log2", OpCode::Log2 },
+			{ "log10", OpCode::Log10 }
+		};
+
+		for (const auto& [funcName, op] : FUNCTIONS) {
+			if (name == funcName) {
+				return _ParseCall(op);
+			}
+		}
+
+		return 1;
+	}
+
+	UINT _ParseCall(OpCode op) {
+		if (!_Consume('(')) {
+			return 1;
+		}
+
+		if (_ParseExpr()) {
+			return 1;
+		}
+
+		if (IsUnaryOp(op)) {
+			_Emit(op);
+		} else {
+			// min 和 max 接受任意数量的参数，展开为二元运算
+			while (_Consume(',')) {
+				if (_ParseExpr()) {
+					return 1;
+				}
+				_Emit(op);
+			}
+		}
+
+		return _Consume(')') ? 0 : 1;
+	}
+
+	std::string_view _expr;
+	bool _isOutputAllowed;
+	std::vector<Instruction>& _code;
+
+	UINT _depth = 0;
+	UINT _maxDepth = 0;
+	UINT _nesting = 0;
+};
+
+// 尝试将字节码折叠为线性组合，不是线性组合时返回 false
+// 重新结合和分配会改变舍入，因此只在每一步的系数都足够“整齐”时折叠：所有系数都是 2^-10 的整数倍，
+// 常数项的绝对值不超过 2^40，变量的系数不超过 2^8。变量为不超过 2^31 的尺寸，这时直接计算和
+// 线性组合的所有中间结果都能用 double 精确表示，两者的结果完全相同
+template<size_t N>
+static bool FoldAffine(const std::vector<Instruction>& code, std::array<double, N>& coefs) {
+	struct Affine {
+		std::array<double, N> coefs{};
+
+		bool IsExact() const {
+			for (size_t i = 0; i < N; ++i) {
+				double scaled = std::ldexp(coefs[i], 10);
+				if (!std::isfinite(scaled) || scaled != std::trunc(scaled)
+					|| std::abs(coefs[i]) > (i == 0 ? 0x1p40 : 0x1p8)
+				) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool IsConst() const {
+			return std::all_of(coefs.begin() + 1, coefs.end(), [](double c) { return c == 0; });
+		}
+
+		void Scale(double s) {
+			for (double& c : coefs) {
+				c *= s;
+			}
+		}
+	};
+
+	std::array<Affine, EffectExpr::MAX_STACK_DEPTH> stack;
+	size_t top = 0;
+
+	for (const Instruction& ins : code) {
+		if (ins.op == OpCode::Const) {
+			stack[top] = {};
+			stack[top].coefs[0] = ins.value;
+			if (!stack[top++].IsExact()) {
+				return false;
+			}
+			continue;
+		}
+
+		if (ins.op == OpCode::Var) {
+			stack[top] = {};
+			stack[top++].coefs[(size_t)ins.var + 1] = 1;
+			continue;
+		}
+
+		if (IsUnaryOp(ins.op)) {
+			Affine& a = stack[top - 1];
+			if (ins.op == OpCode::Neg) {
+				a.Scale(-1);
+			} else if (a.IsConst()) {
+				a.coefs[0] = ApplyUnaryOp(ins.op, a.coefs[0]);
+			} else {
+				return false;
+			}
+
+			if (!a.IsExact()) {
+				return false;
+			}
+			continue;
+		}
+
+		Affine& a = stack[top - 2];
+		const Affine& b = stack[top - 1];
+		--top;
+
+		if (ins.op == OpCode::Add || ins.op == OpCode::Sub) {
+			double s = ins.op == OpCode::Add ? 1.0 : -1.0;
+			for (size_t i = 0; i < N; ++i) {
+				a.coefs[i] += s * b.coefs[i];
+			}
+		} else if (a.IsConst() && b.IsConst()) {
+			a.coefs[0] = ApplyBinaryOp(ins.op, a.coefs[0], b.coefs[0]);
+		} else if (ins.op == OpCode::Mul && b.IsConst()) {
+			a.Scale(b.coefs[0]);
+		} else if (ins.op == OpCode::Mul && a.IsConst()) {
+			double s = a.coefs[0];
+			a = b;
+			a.Scale(s);
+		} else if (ins.op == OpCode::Div && b.IsConst()) {
+			int exp = 0;
+			double mantissa = std::frexp(b.coefs[0], &exp);
+			if (mantissa != 0.5 && mantissa != -0.5) {
+				return false;
+			}
+			a.Scale(1.0 / b.coefs[0]);
+		} else {
+			return false;
+		}
+
+		if (!a.IsExact()) {
+			return false;
+		}
+	}
+
+	assert(top == 1);
+	coefs = stack[0].coefs;
+	return true;
+}
+
+UINT EffectExpr::Compile(std::string_view expr, bool isOutputAllowed) {
+	_kind = Kind::Empty;
+	_coefs = {};
+	_code.clear();
+
+	if (ExprParser(expr, isOutputAllowed, _code).Parse()) {
+		_code.clear();
+		return 1;
+	}
+
+	if (FoldAffine(_code, _coefs)) {
+		_kind = Kind::Affine;
+		_code.clear();
+		_code.shrink_to_fit();
+	} else {
+		_kind = Kind::Bytecode;
+		_coefs = {};
+	}
+
+	return 0;
+}
+
+double EffectExpr::Evaluate(SIZE inputSize, SIZE outputSize) const noexcept {
+	assert(!IsEmpty());
+
+	const double vars[] = {
+		(double)inputSize.cx,
+		(double)inputSize.cy,
+		(double)outputSize.cx,
+		(double)outputSize.cy
+	};
+
+	if (_kind == Kind::Affine) {
+		double result = _coefs[0];
+		for (size_t i = 0; i < std::size(vars); ++i) {
+			result += _coefs[i + 1] * vars[i];
+		}
+		return result;
+	}
+
+	return _EvaluateBytecode(vars);
+}
+
+double EffectExpr::_EvaluateBytecode(const double* vars) const noexcept {
+	// 编译时已确保栈深度不超过 MAX_STACK_DEPTH
+	std::array<double, MAX_STACK_DEPTH> stack;
+	size_t top = 0;
+
+	for (const Instruction& ins : _code) {
+		switch (ins.op) {
+		case OpCode::Const:
+			stack[top++] = ins.value;
+			break;
+		case OpCode::Var:
+			stack[top++] = vars[(size_t)ins.var];
+			break;
+		default:
+			if (IsUnaryOp(ins.op)) {
+				stack[top - 1] = ApplyUnaryOp(ins.op, stack[top - 1]);
+			} else {
+				--top;
+				stack[top - 1] = ApplyBinaryOp(ins.op, stack[top - 1], stack[top]);
+			}
+			break;
+		}
+	}
+
+	return stack[0];
+}
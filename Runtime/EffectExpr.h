@@ -0,0 +1,83 @@
+#pragma once
+#include "pch.h"
+
+
+// 编译后的尺寸表达式，如 OUTPUT_WIDTH 和中间纹理的 WIDTH
+// 编译时尽可能折叠为 INPUT_WIDTH、INPUT_HEIGHT、OUTPUT_WIDTH 和 OUTPUT_HEIGHT 的线性组合，
+// 无法折叠时保存为后缀形式的字节码
+// 求值不分配内存，不修改状态，可以在多个线程同时调用
+class EffectExpr {
+public:
+	enum class Variable : UINT8 {
+		InputWidth,
+		InputHeight,
+		OutputWidth,
+		OutputHeight,
+		COUNT
+	};
+
+	enum class OpCode : UINT8 {
+		Const,
+		Var,
+		Add,
+		Sub,
+		Mul,
+		Div,
+		Pow,
+		Min,
+		Max,
+		// 以下为一元运算
+		Neg,
+		Abs,
+		Sqrt,
+		Rint,
+		Sign,
+		Exp,
+		Ln,
+		Log2,
+		Log10
+	};
+
+	struct Instruction {
+		OpCode op = OpCode::Const;
+		Variable var = Variable::InputWidth;
+		double value = 0;
+	};
+
+	// 字节码求值时栈的最大深度
+	static constexpr UINT MAX_STACK_DEPTH = 16;
+
+	// 语法为 muParser 的子集：+ - * / ^、括号、数字以及
+	// min max abs sqrt rint sign exp ln log2 log10 函数
+	// isOutputAllowed 为 false 时不允许使用 OUTPUT_WIDTH 和 OUTPUT_HEIGHT
+	UINT Compile(std::string_view expr, bool isOutputAllowed);
+
+	bool IsEmpty() const noexcept {
+		return _kind == Kind::Empty;
+	}
+
+	// 线性组合形式时返回 true
+	bool IsAffine() const noexcept {
+		return _kind == Kind::Affine;
+	}
+
+	// 不允许使用 OUTPUT_WIDTH 和 OUTPUT_HEIGHT 时 outputSize 被忽略
+	double Evaluate(SIZE inputSize, SIZE outputSize) const noexcept;
+
+private:
+	template<typename Archive>
+	friend void serialize(Archive& ar, EffectExpr& o);
+
+	enum class Kind : UINT8 {
+		Empty,
+		Affine,
+		Bytecode
+	};
+
+	double _EvaluateBytecode(const double* vars) const noexcept;
+
+	Kind _kind = Kind::Empty;
+	// 线性组合的系数：_coefs[0] + Σ _coefs[i + 1] * vars[i]
+	std::array<double, (size_t)Variable::COUNT + 1> _coefs{};
+	std::vector<Instruction> _code;
+};
@@ -0,0 +1,192 @@
+#include "pch.h"
+#include "EffectFusionCache.h"
+#include "EffectCompiler.h"
+#include "StreamHasher.h"
+#include "StrUtils.h"
+#include "Logger.h"
+#include <rapidjson/document.h>
+#include <rapidjson/writer.h>
+#include <rapidjson/stringbuffer.h>
+
+
+// 检查规则或文件格式有更改时更新它，使旧的检查结果失效
+static constexpr const UINT CACHE_VERSION = 1;
+
+// 和效果元数据索引位于同一个子文件夹，EffectCachePack 会删除缓存文件夹中的其他文件
+static const wchar_t* CACHE_DIR = L".\\cache";
+static const wchar_t* INDEX_DIR = L".\\cache\\metadata";
+static const wchar_t* CACHE_PATH = L".\\cache\\metadata\\fusions.json";
+
+using JsonWriter = rapidjson::Writer<rapidjson::StringBuffer>;
+
+static void WriteString(JsonWriter& writer, std::string_view str) {
+	writer.String(str.data(), (rapidjson::SizeType)str.size());
+}
+
+static void WriteStrings(JsonWriter& writer, const std::vector<std::string>& strs) {
+	writer.StartArray();
+	for (const std::string& str : strs) {
+		WriteString(writer, str);
+	}
+	writer.EndArray();
+}
+
+static bool ReadStrings(const rapidjson::Value& value, std::vector<std::string>& result) {
+	if (!value.IsArray()) {
+		return false;
+	}
+
+	for (const auto& str : value.GetArray()) {
+		if (!str.IsString()) {
+			return false;
+		}
+		result.emplace_back(str.GetString(), str.GetStringLength());
+	}
+
+	return true;
+}
+
+bool EffectFusionCache::Load(std::string_view key, Decision& decision) {
+	std::scoped_lock lk(_cs);
+
+	if (!_isLoaded) {
+		_isLoaded = true;
+		_Load();
+	}
+
+	auto it = std::find_if(_decisions.begin(), _decisions.end(),
+		[key](const auto& pair) { return pair.first == key; });
+	if (it == _decisions.end()) {
+		return false;
+	}
+
+	// 移到最后，只在下次保存时写入
+	std::rotate(it, it + 1, _decisions.end());
+	decision = _decisions.back().second;
+	return true;
+}
+
+void EffectFusionCache::Save(std::string_view key, const Decision& decision) {
+	std::scoped_lock lk(_cs);
+
+	if (!_isLoaded) {
+		_isLoaded = true;
+		_Load();
+	}
+
+	auto it = std::find_if(_decisions.begin(), _decisions.end(),
+		[key](const auto& pair) { return pair.first == key; });
+	if (it != _decisions.end()) {
+		_decisions.erase(it);
+	} else if (_decisions.size() >= MAX_DECISIONS) {
+		_decisions.erase(_decisions.begin());
+	}
+
+	_decisions.emplace_back(std::string(key), decision);
+	_Save();
+}
+
+std::string EffectFusionCache::GetKey(std::string_view producerSource, std::string_view consumerSource, bool isInlineParams) {
+	return StreamHasher()
+		.Update(producerSource)
+		.Update(consumerSource)
+		.UpdateValue(isInlineParams)
+		.UpdateValue(CACHE_VERSION)
+		.UpdateValue(EffectCompiler::VERSION)
+		.Finish();
+}
+
+void EffectFusionCache::_Load() {
+	if (!Utils::FileExists(CACHE_PATH)) {
+		return;
+	}
+
+	std::string json;
+	if (!Utils::ReadTextFile(CACHE_PATH, json)) {
+		Logger::Get().Error("读取融合检查缓存失败");
+		return;
+	}
+
+	rapidjson::Document doc;
+	if (doc.Parse(json.c_str(), json.size()).HasParseError() || !doc.IsObject()) {
+		Logger::Get().Error("解析融合检查缓存失败");
+		return;
+	}
+
+	auto version = doc.FindMember("version");
+	auto decisions = doc.FindMember("decisions");
+	if (version == doc.MemberEnd() || !version->value.IsUint() || version->value.GetUint() != CACHE_VERSION
+		|| decisions == doc.MemberEnd() || !decisions->value.IsArray()
+	) {
+		// 版本不同，重新生成
+		return;
+	}
+
+	for (const auto& item : decisions->value.GetArray()) {
+		if (!item.IsObject()) {
+			continue;
+		}
+
+		auto key = item.FindMember("key");
+		auto reason = item.FindMember("reason");
+		auto producerParams = item.FindMember("producerParams");
+		auto consumerParams = item.FindMember("consumerParams");
+		if (key == item.MemberEnd() || !key->value.IsString()
+			|| reason == item.MemberEnd() || !reason->value.IsString()
+			|| producerParams == item.MemberEnd() || consumerParams == item.MemberEnd()
+		) {
+			continue;
+		}
+
+		Decision decision;
+		decision.reason.assign(reason->value.GetString(), reason->value.GetStringLength());
+		if (!ReadStrings(producerParams->value, decision.producerParams)
+			|| !ReadStrings(consumerParams->value, decision.consumerParams)
+		) {
+			continue;
+		}
+
+		_decisions.emplace_back(std::string(key->value.GetString(), key->value.GetStringLength()), std::move(decision));
+		if (_decisions.size() == MAX_DECISIONS) {
+			break;
+		}
+	}
+
+	Logger::Get().Info(fmt::format("已读取融合检查缓存，共 {} 项", _decisions.size()));
+}
+
+void EffectFusionCache::_Save() {
+	rapidjson::StringBuffer buf;
+	JsonWriter writer(buf);
+
+	writer.StartObject();
+	writer.Key("version");
+	writer.Uint(CACHE_VERSION);
+	writer.Key("decisions");
+	writer.StartArray();
+	for (const auto& [key, decision] : _decisions) {
+		writer.StartObject();
+		writer.Key("key");
+		WriteString(writer, key);
+		writer.Key("reason");
+		WriteString(writer, decision.reason);
+		writer.Key("producerParams");
+		WriteStrings(writer, decision.producerParams);
+		writer.Key("consumerParams");
+		WriteStrings(writer, decision.consumerParams);
+		writer.EndObject();
+	}
+	writer.EndArray();
+	writer.EndObject();
+
+	for (const wchar_t* dir : { CACHE_DIR, INDEX_DIR }) {
+		if (!Utils::DirExists(dir) && !CreateDirectory(dir, nullptr)) {
+			Logger::Get().Win32Error("创建效果元数据文件夹失败");
+			return;
+		}
+	}
+
+	if (!Utils::WriteFile(CACHE_PATH, buf.GetString(), buf.GetSize())) {
+		Logger::Get().Error("保存融合检查缓存失败");
+	}
+}
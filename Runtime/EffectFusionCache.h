@@ -0,0 +1,43 @@
+#pragma once
+#include "pch.h"
+#include "Utils.h"
+
+
+// 相邻效果能否融合的检查结果的持久化缓存
+// 检查需要解析两个效果，结果只取决于它们的源码和是否内联参数，因此按源码的哈希缓存，
+// 效果链已全部缓存时 Run 无需再运行编译器前端
+class EffectFusionCache {
+public:
+	static EffectFusionCache& Get() {
+		static EffectFusionCache instance;
+		return instance;
+	}
+
+	struct Decision {
+		// 为空表示可以融合
+		std::string reason;
+		// 两个效果的参数名，用于检查 effectsJson 中的参数
+		std::vector<std::string> producerParams;
+		std::vector<std::string> consumerParams;
+	};
+
+	// key 由 GetKey 计算
+	bool Load(std::string_view key, Decision& decision);
+
+	void Save(std::string_view key, const Decision& decision);
+
+	static std::string GetKey(std::string_view producerSource, std::string_view consumerSource, bool isInlineParams);
+
+private:
+	void _Load();
+	void _Save();
+
+	// 最多保存多少个检查结果，超出时删除最久未使用的
+	static constexpr size_t MAX_DECISIONS = 256;
+
+	// 用于同步对 _decisions 的访问
+	Utils::CSMutex _cs;
+	// 按最近使用的顺序排列，最后一个为最近使用的
+	std::vector<std::pair<std::string, Decision>> _decisions;
+	bool _isLoaded = false;
+};
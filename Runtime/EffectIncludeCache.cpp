@@ -0,0 +1,108 @@
+#include "pch.h"
+#include "EffectIncludeCache.h"
+#include <unordered_set>
+#include "StreamHasher.h"
+#include "StrUtils.h"
+#include "Logger.h"
+
+
+// 查找 source 中所有 #include "xxx" 的文件名
+static void FindIncludes(std::string_view source, std::vector<std::string>& result) {
+	static constexpr std::string_view INCLUDE_DIRECTIVE = "#include";
+
+	size_t pos = 0;
+	while ((pos = source.find(INCLUDE_DIRECTIVE, pos)) != std::string_view::npos) {
+		pos += INCLUDE_DIRECTIVE.size();
+
+		while (pos < source.size() && (source[pos] == ' ' || source[pos] == '\t')) {
+			++pos;
+		}
+
+		if (pos >= source.size() || source[pos] != '"') {
+			continue;
+		}
+
+		size_t end = source.find('"', pos + 1);
+		if (end == std::string_view::npos) {
+			return;
+		}
+
+		std::string_view fileName = source.substr(pos + 1, end - pos - 1);
+		pos = end + 1;
+
+		// 文件名不能跨行
+		if (fileName.empty() || fileName.find('\n') != std::string_view::npos) {
+			continue;
+		}
+
+		if (std::find(result.begin(), result.end(), fileName) == result.end()) {
+			result.emplace_back(fileName);
+		}
+	}
+}
+
+std::shared_ptr<EffectIncludeCache::File> EffectIncludeCache::_Load(const std::wstring& path, const FILETIME& lastWriteTime) {
+	std::shared_ptr<File> file = std::make_shared<File>();
+	file->_lastWriteTime = lastWriteTime;
+
+	// 读取期间文件被修改时修改时间也会改变，下次 Open 时将重新读取
+	if (!Utils::ReadTextFile(path.c_str(), file->_content)) {
+		return nullptr;
+	}
+
+	file->_hash = StreamHasher().Update(file->_content).Finish();
+
+	FindIncludes(file->_content, file->_includes);
+
+	Logger::Get().Info(StrUtils::Concat("已读取头文件 ", StrUtils::UTF16ToUTF8(path)));
+	return file;
+}
+
+std::shared_ptr<const EffectIncludeCache::File> EffectIncludeCache::Open(std::string_view fileName) {
+	std::wstring path = StrUtils::ConcatW(L"effects\\", StrUtils::UTF8ToUTF16(fileName));
+
+	WIN32_FILE_ATTRIBUTE_DATA attrs{};
+	if (!GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &attrs)) {
+		// 文件不存在，由调用者处理
+		return nullptr;
+	}
+
+	// 持有锁读取文件，确保每个文件只读取一次
+	std::scoped_lock lk(_cs);
+
+	std::shared_ptr<File>& file = _files[std::string(fileName)];
+	if (file && CompareFileTime(&file->_lastWriteTime, &attrs.ftLastWriteTime) == 0) {
+		return file;
+	}
+
+	// 文件被修改，仍在使用旧文件的编译不受影响
+	file = _Load(path, attrs.ftLastWriteTime);
+	return file;
+}
+
+std::string EffectIncludeCache::GetDependencyHash(std::string_view source) {
+	std::vector<std::string> fileNames;
+	FindIncludes(source, fileNames);
+
+	std::string result;
+	std::unordered_set<std::string> visited;
+
+	// fileNames 在遍历时增长，包含间接包含的头文件
+	for (size_t i = 0; i < fileNames.size(); ++i) {
+		std::string fileName = fileNames[i];
+		if (!visited.emplace(fileName).second) {
+			continue;
+		}
+
+		// 不存在的文件由编译器报错，这里忽略
+		std::shared_ptr<const File> file = Open(fileName);
+		if (!file) {
+			continue;
+		}
+
+		result.append(fileName).append(":").append(file->_hash).append("\n");
+		fileNames.insert(fileNames.end(), file->_includes.begin(), file->_includes.end());
+	}
+
+	return result;
+}
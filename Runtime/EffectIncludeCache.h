@@ -0,0 +1,55 @@
+#pragma once
+#include "pch.h"
+#include "Utils.h"
+
+
+// 进程内共享的 #include 文件缓存
+// 每个头文件只读取一次，文件被修改后自动重新读取
+class EffectIncludeCache {
+public:
+	static EffectIncludeCache& Get() {
+		static EffectIncludeCache instance;
+		return instance;
+	}
+
+	// 读入内存的头文件，只读。不保持文件打开，以免阻止编辑器修改头文件
+	class File {
+	public:
+		File() = default;
+		File(const File&) = delete;
+		File(File&&) = delete;
+
+		std::string_view GetContent() const noexcept {
+			return _content;
+		}
+
+		// 文件内容的哈希
+		const std::string& GetHash() const noexcept {
+			return _hash;
+		}
+
+	private:
+		friend class EffectIncludeCache;
+
+		std::string _content;
+		std::string _hash;
+		FILETIME _lastWriteTime{};
+		// 该文件包含的其他头文件
+		std::vector<std::string> _includes;
+	};
+
+	// fileName 相对于 effects 文件夹
+	// 返回的文件在引用计数归零前一直有效
+	std::shared_ptr<const File> Open(std::string_view fileName);
+
+	// 计算 source 包含的所有头文件（包括间接包含的）的哈希，用于缓存的键
+	// 没有包含头文件时返回空
+	std::string GetDependencyHash(std::string_view source);
+
+private:
+	std::shared_ptr<File> _Load(const std::wstring& path, const FILETIME& lastWriteTime);
+
+	// 用于同步对 _files 的访问
+	Utils::CSMutex _cs;
+	std::unordered_map<std::string, std::shared_ptr<File>> _files;
+};
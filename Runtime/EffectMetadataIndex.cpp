@@ -0,0 +1,357 @@
+#include "pch.h"
+#include "EffectMetadataIndex.h"
+#include "EffectCompiler.h"
+#include "StreamHasher.h"
+#include "TaskScheduler.h"
+#include "StrUtils.h"
+#include "Logger.h"
+#include <rapidjson/document.h>
+#include <rapidjson/writer.h>
+#include <rapidjson/stringbuffer.h>
+
+
+// 索引格式或编译器前端的输出有更改时更新它，使旧索引失效
+static constexpr const UINT INDEX_VERSION = 1;
+
+// 放在缓存文件夹的子文件夹中，EffectCachePack 会删除缓存文件夹中的其他文件
+static const wchar_t* CACHE_DIR = L".\\cache";
+static const wchar_t* INDEX_DIR = L".\\cache\\metadata";
+static const wchar_t* INDEX_PATH = L".\\cache\\metadata\\effects.json";
+
+using JsonWriter = rapidjson::Writer<rapidjson::StringBuffer>;
+
+static void WriteString(JsonWriter& writer, std::string_view str) {
+	writer.String(str.data(), (rapidjson::SizeType)str.size());
+}
+
+static void WriteValue(JsonWriter& writer, const std::variant<float, int>& value) {
+	if (value.index() == 0) {
+		writer.Double(std::get<0>(value));
+	} else {
+		writer.Int(std::get<1>(value));
+	}
+}
+
+// 元数据的格式：
+// {
+//   "valid": 前端能否解析该效果，为 false 时没有其他字段
+//   "outputWidth", "outputHeight": OUTPUT_WIDTH 和 OUTPUT_HEIGHT 的表达式，为空表示支持任意大小的输出
+//   "useDynamic": 是否使用 USE_DYNAMIC
+//   "params": [{"name", "label", "type": "float" 或 "int", "default", "min"（可选）, "max"（可选）}]
+//   "textures": [{"name", "format", "source"}]，不包括 INPUT
+//   "samplers": [{"name", "filter": "LINEAR" 或 "POINT", "address": "CLAMP" 或 "WRAP"}]
+//   "passes": [{"desc", "style": "PS" 或 "CS"}]
+// }
+static std::string BuildMetadata(std::string& source) {
+	EffectDesc desc;
+	std::pair<std::string, std::string> outSizeSource;
+	bool success = !EffectCompiler::Parse(source, desc, &outSizeSource);
+
+	rapidjson::StringBuffer buf;
+	JsonWriter writer(buf);
+
+	writer.StartObject();
+	writer.Key("valid");
+	writer.Bool(success);
+
+	if (success) {
+		writer.Key("outputWidth");
+		WriteString(writer, outSizeSource.first);
+		writer.Key("outputHeight");
+		WriteString(writer, outSizeSource.second);
+		writer.Key("useDynamic");
+		writer.Bool(desc.isUseDynamic);
+
+		writer.Key("params");
+		writer.StartArray();
+		for (const EffectParameterDesc& param : desc.params) {
+			writer.StartObject();
+			writer.Key("name");
+			WriteString(writer, param.name);
+			writer.Key("label");
+			WriteString(writer, param.label);
+			writer.Key("type");
+			writer.String(param.type == EffectConstantType::Float ? "float" : "int");
+			writer.Key("default");
+			WriteValue(writer, param.defaultValue);
+
+			if (param.minValue.index() == 1) {
+				writer.Key("min");
+				writer.Double(std::get<1>(param.minValue));
+			} else if (param.minValue.index() == 2) {
+				writer.Key("min");
+				writer.Int(std::get<2>(param.minValue));
+			}
+
+			if (param.maxValue.index() == 1) {
+				writer.Key("max");
+				writer.Double(std::get<1>(param.maxValue));
+			} else if (param.maxValue.index() == 2) {
+				writer.Key("max");
+				writer.Int(std::get<2>(param.maxValue));
+			}
+			writer.EndObject();
+		}
+		writer.EndArray();
+
+		writer.Key("textures");
+		writer.StartArray();
+		// 第一个元素为 INPUT
+		for (size_t i = 1; i < desc.textures.size(); ++i) {
+			const EffectIntermediateTextureDesc& texture = desc.textures[i];
+			writer.StartObject();
+			writer.Key("name");
+			WriteString(writer, texture.name);
+			writer.Key("format");
+			writer.String(EffectIntermediateTextureDesc::FORMAT_DESCS[(UINT)texture.format].name);
+			writer.Key("source");
+			WriteString(writer, texture.source);
+			writer.EndObject();
+		}
+		writer.EndArray();
+
+		writer.Key("samplers");
+		writer.StartArray();
+		for (const EffectSamplerDesc& sampler : desc.samplers) {
+			writer.StartObject();
+			writer.Key("name");
+			WriteString(writer, sampler.name);
+			writer.Key("filter");
+			writer.String(sampler.filterType == EffectSamplerFilterType::Linear ? "LINEAR" : "POINT");
+			writer.Key("address");
+			writer.String(sampler.addressType == EffectSamplerAddressType::Clamp ? "CLAMP" : "WRAP");
+			writer.EndObject();
+		}
+		writer.EndArray();
+
+		writer.Key("passes");
+		writer.StartArray();
+		for (const EffectPassDesc& pass : desc.passes) {
+			writer.StartObject();
+			writer.Key("desc");
+			WriteString(writer, pass.desc);
+			writer.Key("style");
+			writer.String(pass.isPSStyle ? "PS" : "CS");
+			writer.EndObject();
+		}
+		writer.EndArray();
+	}
+
+	writer.EndObject();
+
+	return std::string(buf.GetString(), buf.GetSize());
+}
+
+static UINT64 FileTimeToUINT64(const FILETIME& fileTime) noexcept {
+	return ((UINT64)fileTime.dwHighDateTime << 32) | fileTime.dwLowDateTime;
+}
+
+template<typename Writer>
+void EffectMetadataIndex::_WriteRecord(Writer& writer, const std::string& name, const _Record& record) {
+	writer.StartObject();
+	writer.Key("name");
+	WriteString(writer, name);
+	writer.Key("lastWriteTime");
+	writer.Uint64(record.lastWriteTime);
+	writer.Key("hash");
+	WriteString(writer, record.hash);
+	writer.Key("metadata");
+	writer.RawValue(record.metadata.c_str(), record.metadata.size(), rapidjson::kObjectType);
+	writer.EndObject();
+}
+
+std::string EffectMetadataIndex::Query(std::string_view effectName) {
+	std::scoped_lock lk(_cs);
+
+	if (!_isLoaded) {
+		_isLoaded = true;
+		_Load();
+	}
+
+	if (_Refresh()) {
+		_Save();
+	}
+
+	rapidjson::StringBuffer buf;
+	JsonWriter writer(buf);
+
+	writer.StartArray();
+	if (effectName.empty()) {
+		for (const auto& [name, record] : _records) {
+			_WriteRecord(writer, name, record);
+		}
+	} else {
+		auto it = _records.find(effectName);
+		if (it != _records.end()) {
+			_WriteRecord(writer, it->first, it->second);
+		}
+	}
+	writer.EndArray();
+
+	return std::string(buf.GetString(), buf.GetSize());
+}
+
+void EffectMetadataIndex::_Load() {
+	if (!Utils::FileExists(INDEX_PATH)) {
+		return;
+	}
+
+	std::string json;
+	if (!Utils::ReadTextFile(INDEX_PATH, json)) {
+		Logger::Get().Error("读取效果元数据索引失败");
+		return;
+	}
+
+	rapidjson::Document doc;
+	if (doc.Parse(json.c_str(), json.size()).HasParseError() || !doc.IsObject()) {
+		Logger::Get().Error("解析效果元数据索引失败");
+		return;
+	}
+
+	auto version = doc.FindMember("version");
+	auto compilerVersion = doc.FindMember("compilerVersion");
+	auto effects = doc.FindMember("effects");
+	if (version == doc.MemberEnd() || !version->value.IsUint() || version->value.GetUint() != INDEX_VERSION
+		|| compilerVersion == doc.MemberEnd() || !compilerVersion->value.IsUint()
+		|| compilerVersion->value.GetUint() != EffectCompiler::VERSION
+		|| effects == doc.MemberEnd() || !effects->value.IsArray()
+	) {
+		// 版本不同，重新生成
+		return;
+	}
+
+	for (const auto& effect : effects->value.GetArray()) {
+		if (!effect.IsObject()) {
+			continue;
+		}
+
+		auto name = effect.FindMember("name");
+		auto lastWriteTime = effect.FindMember("lastWriteTime");
+		auto hash = effect.FindMember("hash");
+		auto metadata = effect.FindMember("metadata");
+		if (name == effect.MemberEnd() || !name->value.IsString()
+			|| lastWriteTime == effect.MemberEnd() || !lastWriteTime->value.IsUint64()
+			|| hash == effect.MemberEnd() || !hash->value.IsString()
+			|| metadata == effect.MemberEnd() || !metadata->value.IsObject()
+		) {
+			continue;
+		}
+
+		_Record& record = _records[std::string(name->value.GetString(), name->value.GetStringLength())];
+		record.lastWriteTime = lastWriteTime->value.GetUint64();
+		record.hash.assign(hash->value.GetString(), hash->value.GetStringLength());
+
+		rapidjson::StringBuffer buf;
+		JsonWriter writer(buf);
+		metadata->value.Accept(writer);
+		record.metadata.assign(buf.GetString(), buf.GetSize());
+	}
+
+	Logger::Get().Info(fmt::format("已读取效果元数据索引，共 {} 个效果", _records.size()));
+}
+
+bool EffectMetadataIndex::_Refresh() {
+	struct Source {
+		std::string name;
+		UINT64 lastWriteTime = 0;
+		// 修改时间改变前的记录，可能为空
+		const _Record* oldRecord = nullptr;
+		_Record record;
+		bool success = false;
+	};
+
+	std::map<std::string, _Record, std::less<>> records;
+	std::vector<Source> changedSources;
+
+	WIN32_FIND_DATA findData{};
+	HANDLE hFind = Utils::SafeHandle(FindFirstFileEx(L"effects\\*.hlsl",
+		FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+	if (hFind) {
+		do {
+			if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+				continue;
+			}
+
+			std::wstring_view fileName(findData.cFileName);
+			std::string name = StrUtils::UTF16ToUTF8(fileName.substr(0, fileName.size() - 5));
+			UINT64 lastWriteTime = FileTimeToUINT64(findData.ftLastWriteTime);
+
+			auto it = _records.find(name);
+			if (it != _records.end() && it->second.lastWriteTime == lastWriteTime) {
+				records.emplace(std::move(name), std::move(it->second));
+			} else {
+				changedSources.push_back({ std::move(name), lastWriteTime, it == _records.end() ? nullptr : &it->second });
+			}
+		} while (FindNextFile(hFind, &findData));
+
+		FindClose(hFind);
+	}
+
+	// 有效果被修改、添加或删除
+	bool isChanged = !changedSources.empty() || records.size() != _records.size();
+
+	// 解析耗时较长，并行处理修改过的效果
+	TaskScheduler::Get().ParallelFor((UINT)changedSources.size(), [&](UINT id) {
+		Source& src = changedSources[id];
+
+		std::string source;
+		if (!Utils::ReadTextFile(StrUtils::ConcatW(L"effects\\", StrUtils::UTF8ToUTF16(src.name), L".hlsl").c_str(), source)) {
+			Logger::Get().Error(StrUtils::Concat("读取效果 ", src.name, " 失败"));
+			return;
+		}
+
+		src.record.lastWriteTime = src.lastWriteTime;
+		src.record.hash = StreamHasher().Update(source).Finish();
+
+		if (src.oldRecord && src.oldRecord->hash == src.record.hash) {
+			// 只有修改时间改变
+			src.record.metadata = src.oldRecord->metadata;
+		} else {
+			src.record.metadata = BuildMetadata(source);
+		}
+
+		src.success = true;
+	});
+
+	for (Source& src : changedSources) {
+		if (src.success) {
+			records.emplace(std::move(src.name), std::move(src.record));
+		}
+	}
+
+	if (!changedSources.empty()) {
+		Logger::Get().Info(fmt::format("已更新 {} 个效果的元数据", changedSources.size()));
+	}
+
+	_records = std::move(records);
+	return isChanged;
+}
+
+void EffectMetadataIndex::_Save() {
+	rapidjson::StringBuffer buf;
+	JsonWriter writer(buf);
+
+	writer.StartObject();
+	writer.Key("version");
+	writer.Uint(INDEX_VERSION);
+	writer.Key("compilerVersion");
+	writer.Uint(EffectCompiler::VERSION);
+	writer.Key("effects");
+	writer.StartArray();
+	for (const auto& [name, record] : _records) {
+		_WriteRecord(writer, name, record);
+	}
+	writer.EndArray();
+	writer.EndObject();
+
+	for (const wchar_t* dir : { CACHE_DIR, INDEX_DIR }) {
+		if (!Utils::DirExists(dir) && !CreateDirectory(dir, nullptr)) {
+			Logger::Get().Win32Error("创建效果元数据文件夹失败");
+			return;
+		}
+	}
+
+	if (!Utils::WriteFile(INDEX_PATH, buf.GetString(), buf.GetSize())) {
+		Logger::Get().Error("保存效果元数据索引失败");
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "pch.h"
+#include "Utils.h"
+
+
+// 所有效果的元数据（参数、纹理、输出尺寸等）的持久化索引
+// 只运行编译器前端，根据源文件的修改时间增量更新
+// 用户界面和工具无需编译即可枚举效果和它们的参数
+class EffectMetadataIndex {
+public:
+	static EffectMetadataIndex& Get() {
+		static EffectMetadataIndex instance;
+		return instance;
+	}
+
+	// 返回 json 数组，每个元素为一个效果：
+	// {"name", "lastWriteTime", "hash", "metadata"}，metadata 的格式见 EffectMetadataIndex.cpp 中的 BuildMetadata
+	// effectName 为空时返回所有效果，否则只包含该效果，不存在时为空数组
+	// 每次查询前检查源文件的修改时间，必要时更新索引
+	std::string Query(std::string_view effectName = {});
+
+private:
+	struct _Record {
+		// 源文件的修改时间
+		UINT64 lastWriteTime = 0;
+		// 源文件内容的哈希，只有修改时间改变时无需重新解析
+		std::string hash;
+		// 序列化的 json 对象
+		std::string metadata;
+	};
+
+	void _Load();
+	// 返回索引是否改变
+	bool _Refresh();
+	void _Save();
+
+	template<typename Writer>
+	static void _WriteRecord(Writer& writer, const std::string& name, const _Record& record);
+
+	// 用于同步对 _records 的访问
+	Utils::CSMutex _cs;
+	// 效果名 -> 元数据，按效果名排序
+	std::map<std::string, _Record, std::less<>> _records;
+	bool _isLoaded = false;
+};
@@ -0,0 +1,115 @@
+#include "pch.h"
+#include "EffectPrecompiler.h"
+#include "EffectCompiler.h"
+#include "EffectCacheManager.h"
+#include "Renderer.h"
+#include "Config.h"
+#include "StrUtils.h"
+#include "Logger.h"
+#include <thread>
+
+
+struct EffectPrecompiler::_Task {
+	UINT id = 0;
+	// 融合前的效果
+	std::vector<Renderer::EffectOption> effectOptions;
+	// 和 Run 相同，可以融合的相邻效果合并为一个效果
+	std::vector<Renderer::EffectOption> options;
+	std::vector<UINT> fusedIdx;
+	Config config;
+	ProgressCallback callback = nullptr;
+	void* context = nullptr;
+	std::atomic<bool> isCancelled = false;
+};
+
+UINT EffectPrecompiler::Start(const std::string& effectsJson, UINT flags, ProgressCallback callback, void* context) {
+	std::shared_ptr<_Task> task = std::make_shared<_Task>();
+	if (!Renderer::ParseEffectsJson(effectsJson, task->effectOptions)) {
+		Logger::Get().Error("预编译失败：解析 json 失败");
+		return 0;
+	}
+
+	task->config.InitializeFlags(flags);
+	// 编译 Run 将使用的效果，否则预热的缓存无法命中
+	Renderer::FuseEffectOptions(task->effectOptions, task->config.IsDisableEffectFusion(), task->options, task->fusedIdx);
+	task->callback = callback;
+	task->context = context;
+
+	{
+		std::scoped_lock lk(_cs);
+		task->id = _nextTaskId++;
+		_tasks.emplace(task->id, task);
+	}
+
+	Logger::Get().Info(fmt::format("开始预编译任务 #{}，共 {} 个效果", task->id, task->options.size()));
+
+	// 进程退出时由系统结束
+	std::thread(&EffectPrecompiler::_Run, this, task).detach();
+	return task->id;
+}
+
+bool EffectPrecompiler::Cancel(UINT taskId) {
+	std::scoped_lock lk(_cs);
+
+	auto it = _tasks.find(taskId);
+	if (it == _tasks.end()) {
+		return false;
+	}
+
+	it->second->isCancelled.store(true, std::memory_order_relaxed);
+	Logger::Get().Info(fmt::format("已取消预编译任务 #{}", taskId));
+	return true;
+}
+
+void EffectPrecompiler::_Run(std::shared_ptr<_Task> task) {
+	// 预编译不应和前台的缩放竞争。低于正常优先级时 EffectCompiler 在当前线程依次编译通道，
+	// 不会把任务分发到正常优先级的工作线程上
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+
+	const UINT effectCount = (UINT)task->options.size();
+	UINT successCount = 0;
+
+	// 依次编译各个效果，这样取消可以尽快生效
+	for (UINT i = 0; i < effectCount; ++i) {
+		const Renderer::EffectOption& option = task->options[i];
+
+		bool success = false;
+		if (!task->isCancelled.load(std::memory_order_relaxed)) {
+			EffectDesc desc;
+			success = !Renderer::CompileEffectOption(task->effectOptions, option, task->fusedIdx[i], desc, task->config);
+
+			if (!success && task->fusedIdx[i] != UINT_MAX) {
+				// 和 Run 相同，融合失败时回退到分别编译
+				Logger::Get().Info(fmt::format("融合失败，分别编译 {}", option.name));
+
+				UINT producerIdx = task->fusedIdx[i];
+				success = std::all_of(task->effectOptions.begin() + producerIdx, task->effectOptions.begin() + producerIdx + 2,
+					[&](const Renderer::EffectOption& o) {
+						EffectDesc d;
+						return !EffectCompiler::Compile(o.name, o.flags, o.params.params, d, task->config);
+					});
+			}
+
+			if (success) {
+				++successCount;
+			} else {
+				Logger::Get().Error(StrUtils::Concat("预编译 ", option.name, " 失败"));
+			}
+		}
+
+		// 最后一次回调前移除任务，回调返回后再次 Cancel 将返回 false
+		if (i + 1 == effectCount) {
+			// 回调通知任务结束时缓存应已写入，之后 Run 可以直接读取
+			EffectCacheManager::Get().Flush();
+
+			std::scoped_lock lk(_cs);
+			_tasks.erase(task->id);
+		}
+
+		if (task->callback) {
+			task->callback(task->id, i + 1, effectCount, option.name.c_str(), success, task->context);
+		}
+	}
+
+	Logger::Get().Info(fmt::format("预编译任务 #{} 结束，成功编译 {}/{} 个效果", task->id, successCount, effectCount));
+}
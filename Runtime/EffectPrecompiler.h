@@ -0,0 +1,45 @@
+#pragma once
+#include "pch.h"
+#include "Utils.h"
+
+
+// 在后台线程编译效果并写入缓存，不创建窗口和交换链
+// 用户界面可以在空闲时预热缓存，首次缩放时无需等待编译
+class EffectPrecompiler {
+public:
+	// 每个效果处理完毕后在后台线程上调用，processedCount 等于 totalCount 表示任务结束
+	// 效果的数量和名字为融合相邻效果后的值，融合的效果名字为 "producer+consumer"
+	// 编译失败或被取消的效果 success 为 FALSE
+	using ProgressCallback = void(WINAPI*)(
+		UINT taskId,
+		UINT processedCount,
+		UINT totalCount,
+		const char* effectName,
+		BOOL success,
+		void* context
+	);
+
+	static EffectPrecompiler& Get() {
+		static EffectPrecompiler instance;
+		return instance;
+	}
+
+	// effectsJson 和 flags 的格式和 Run 相同，只使用和编译有关的标志
+	// 返回任务 id，解析 effectsJson 失败时返回 0
+	UINT Start(const std::string& effectsJson, UINT flags, ProgressCallback callback, void* context);
+
+	// 跳过尚未开始编译的效果，正在编译的效果不会被中断
+	// 任务不存在或已结束时返回 false
+	bool Cancel(UINT taskId);
+
+private:
+	struct _Task;
+
+	void _Run(std::shared_ptr<_Task> task);
+
+	// 同步对 _tasks 的访问
+	Utils::CSMutex _cs;
+	// 未结束的任务
+	std::unordered_map<UINT, std::shared_ptr<_Task>> _tasks;
+	UINT _nextTaskId = 1;
+};
@@ -8,15 +8,19 @@
 #include "DeviceResources.h"
 #include "GPUTimer.h"
 #include "EffectDrawer.h"
+#include "D3D11EffectBackend.h"
 #include "OverlayDrawer.h"
 #include "Logger.h"
 #include "CursorManager.h"
 #include "Config.h"
 #include "WindowsMessages.h"
+#include "TaskScheduler.h"
 
 #pragma push_macro("GetObject")
 #undef GetObject
 #include <rapidjson/document.h>
+#include <rapidjson/writer.h>
+#include <rapidjson/stringbuffer.h>
 
 
 static std::optional<LRESULT> WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
@@ -283,7 +287,9 @@ bool Renderer::_CheckSrcState() {
 	return true;
 }
 
-bool Renderer::_ResolveEffectsJson(const std::string& effectsJson) {
+bool Renderer::ParseEffectsJson(const std::string& effectsJson, std::vector<EffectOption>& result) {
+	result.clear();
+
 	rapidjson::Document doc;
 	if (doc.Parse(effectsJson.c_str(), effectsJson.size()).HasParseError()) {
 		// 解析 json 失败
@@ -304,122 +310,451 @@ bool Renderer::_ResolveEffectsJson(const std::string& effectsJson) {
 		return false;
 	}
 
-	// 并行编译所有效果
-
 	UINT effectCount = effectsArr.Size();
-	std::vector<const char*> effectNames(effectCount);
-	std::vector<EffectParams> effectParams(effectCount);
-	std::vector<EffectDesc> effectDescs(effectCount);
-	std::atomic<bool> allSuccess = true;
+	result.resize(effectCount);
 
-	int duration = Utils::Measure([&]() {
-		Utils::RunParallel([&](UINT id) {
-			const auto& effectJson = effectsArr[id];
-			UINT effectFlag = (id == effectCount - 1) ? EFFECT_FLAG_LAST_EFFECT : 0;
-			EffectParams& params = effectParams[id];
+	for (UINT id = 0; id < effectCount; ++id) {
+		const auto& effectJson = effectsArr[id];
+		EffectOption& option = result[id];
+		option.flags = (id == effectCount - 1) ? EFFECT_FLAG_LAST_EFFECT : 0;
 
-			if (!effectJson.IsObject()) {
-				Logger::Get().Error("解析 json 失败：根数组中存在非法成员");
-				allSuccess = false;
-				return;
+		if (!effectJson.IsObject()) {
+			Logger::Get().Error("解析 json 失败：根数组中存在非法成员");
+			return false;
+		}
+
+		{
+			auto effectName = effectJson.FindMember("effect");
+			if (effectName == effectJson.MemberEnd() || !effectName->value.IsString()) {
+				Logger::Get().Error(fmt::format("解析效果#{}失败：未找到 effect 属性或该属性的值不合法", id));
+				return false;
 			}
+			option.name = effectName->value.GetString();
+		}
 
-			{
-				auto effectName = effectJson.FindMember("effect");
-				if (effectName == effectJson.MemberEnd() || !effectName->value.IsString()) {
-					Logger::Get().Error(fmt::format("解析效果#{}失败：未找到 effect 属性或该属性的值不合法", id));
-					allSuccess = false;
-					return;
-				}
-				effectNames[id] = effectName->value.GetString();
+		for (const auto& prop : effectJson.GetObject()) {
+			if (!prop.name.IsString()) {
+				Logger::Get().Error(fmt::format("解析效果#{}失败：非法的效果名", id));
+				return false;
 			}
 
-			for (const auto& prop : effectJson.GetObject()) {
-				if (!prop.name.IsString()) {
-					Logger::Get().Error(fmt::format("解析效果#{}失败：非法的效果名", id));
-					allSuccess = false;
-					return;
+			std::string_view name = prop.name.GetString();
+
+			if (name == "effect") {
+				continue;
+			} else if (name == "inlineParams") {
+				if (!prop.value.IsBool()) {
+					Logger::Get().Error(fmt::format("解析效果#{}（{}）失败：成员 inlineParams 必须为 bool 类型", id, option.name));
+					return false;
 				}
 
-				std::string_view name = prop.name.GetString();
+				if (prop.value.GetBool()) {
+					option.flags |= EFFECT_FLAG_INLINE_PARAMETERS;
+				}
+				continue;
+			} else if (name == "fp16") {
+				if (!prop.value.IsBool()) {
+					Logger::Get().Error(fmt::format("解析效果#{}（{}）失败：成员 fp16 必须为 bool 类型", id, option.name));
+					return false;
+				}
 
-				if (name == "effect") {
-					continue;
-				} else if (name == "inlineParams") {
-					if (!prop.value.IsBool()) {
-						Logger::Get().Error(fmt::format("解析效果#{}（{}）失败：成员 inlineParams 必须为 bool 类型", id, effectNames[id]));
-						allSuccess = false;
-						return;
+				if (prop.value.GetBool()) {
+					option.flags |= EFFECT_FLAG_FP16;
+				}
+				continue;
+			} else if (name == "scale") {
+				auto scaleProp = effectJson.FindMember("scale");
+				if (scaleProp != effectJson.MemberEnd()) {
+					if (!scaleProp->value.IsArray()) {
+						Logger::Get().Error(fmt::format("解析效果#{}（{}）失败：成员 scale 必须为数组类型", id, option.name));
+						return false;
 					}
 
-					if (prop.value.GetBool()) {
-						effectFlag |= EFFECT_FLAG_INLINE_PARAMETERS;
-					}
-					continue;
-				} else if (name == "fp16") {
-					if (!prop.value.IsBool()) {
-						Logger::Get().Error(fmt::format("解析效果#{}（{}）失败：成员 fp16 必须为 bool 类型", id, effectNames[id]));
-						allSuccess = false;
-						return;
+					const auto& scale = scaleProp->value.GetArray();
+					if (scale.Size() != 2 || !scale[0].IsNumber() || !scale[1].IsNumber()) {
+						Logger::Get().Error(fmt::format("解析效果#{}（{}）失败：成员 scale 格式非法", id, option.name));
+						return false;
 					}
 
-					if (prop.value.GetBool()) {
-						effectFlag |= EFFECT_FLAG_FP16;
-					}
-					continue;
-				} else if (name == "scale") {
-					auto scaleProp = effectJson.FindMember("scale");
-					if (scaleProp != effectJson.MemberEnd()) {
-						if (!scaleProp->value.IsArray()) {
-							Logger::Get().Error(fmt::format("解析效果#{}（{}）失败：成员 scale 必须为数组类型", id, effectNames[id]));
-							allSuccess = false;
-							return;
-						}
-
-						const auto& scale = scaleProp->value.GetArray();
-						if (scale.Size() != 2 || !scale[0].IsNumber() || !scale[1].IsNumber()) {
-							Logger::Get().Error(fmt::format("解析效果#{}（{}）失败：成员 scale 格式非法", id, effectNames[id]));
-							allSuccess = false;
-							return;
-						}
-
-						params.scale = std::make_pair(scale[0].GetFloat(), scale[1].GetFloat());
-					}
+					option.params.scale = std::make_pair(scale[0].GetFloat(), scale[1].GetFloat());
+				}
+			} else {
+				auto& paramValue = option.params.params[std::string(name)];
+
+				if (prop.value.IsFloat()) {
+					paramValue = prop.value.GetFloat();
+				} else if (prop.value.IsInt()) {
+					paramValue = prop.value.GetInt();
+				} else if (prop.value.IsBool()) {
+					// bool 值视为 int
+					paramValue = (int)prop.value.GetBool();
 				} else {
-					auto& paramValue = params.params[std::string(name)];
-
-					if (prop.value.IsFloat()) {
-						paramValue = prop.value.GetFloat();
-					} else if (prop.value.IsInt()) {
-						paramValue = prop.value.GetInt();
-					} else if (prop.value.IsBool()) {
-						// bool 值视为 int
-						paramValue = (int)prop.value.GetBool();
-					} else {
-						Logger::Get().Error(fmt::format("解析效果#{}（{}）失败：成员 {} 的类型非法", id, effectNames[id], name));
-						allSuccess = false;
-						return;
-					}
+					Logger::Get().Error(fmt::format("解析效果#{}（{}）失败：成员 {} 的类型非法", id, option.name, name));
+					return false;
 				}
 			}
+		}
+	}
+
+	return true;
+}
+
+// 计算整个效果链的尺寸和常量，每个效果的输入尺寸为上一个效果的输出尺寸
+static bool PlanEffectChain(
+	const std::vector<Renderer::EffectOption>& options,
+	const std::vector<EffectDesc>& effectDescs,
+	SIZE inputSize,
+	SIZE hostSize,
+	std::vector<EffectDrawer::Plan>& plans
+) {
+	plans.resize(options.size());
+
+	for (size_t i = 0; i < options.size(); ++i) {
+		if (!EffectDrawer::CreatePlan(effectDescs[i], options[i].params, inputSize, hostSize, plans[i])) {
+			Logger::Get().Error(fmt::format("计算效果#{} ({}) 的尺寸失败", i, options[i].name));
+			return false;
+		}
+
+		inputSize = plans[i].outputSize;
+	}
+
+	return true;
+}
+
+// 从前往后检查每对相邻的效果，每个效果最多参与一次融合
+static std::vector<Renderer::EffectFusionDecision> PlanEffectFusion(const std::vector<Renderer::EffectOption>& options) {
+	std::vector<Renderer::EffectFusionDecision> result;
+	if (options.size() < 2) {
+		return result;
+	}
+	result.reserve(options.size() - 1);
+
+	for (UINT i = 0; i + 1 < (UINT)options.size(); ++i) {
+		const Renderer::EffectOption& producer = options[i];
+		const Renderer::EffectOption& consumer = options[i + 1];
+
+		Renderer::EffectFusionDecision& decision = result.emplace_back();
+		decision.producer = i;
+
+		if (i > 0 && result[i - 1].reason.empty()) {
+			decision.reason = fmt::format("{} 已和前一个效果融合", producer.name);
+		} else if ((producer.flags ^ consumer.flags) & (EFFECT_FLAG_INLINE_PARAMETERS | EFFECT_FLAG_FP16)) {
+			decision.reason = "inlineParams 或 fp16 选项不同";
+		} else if (consumer.params.scale.has_value()) {
+			decision.reason = fmt::format("{} 指定了 scale", consumer.name);
+		} else {
+			decision.reason = EffectCompiler::CheckFusion(
+				producer.name, producer.params.params, consumer.name, consumer.params.params, producer.flags);
+		}
+	}
+
+	return result;
+}
+
+void Renderer::FuseEffectOptions(
+	const std::vector<EffectOption>& options,
+	bool isFusionDisabled,
+	std::vector<EffectOption>& result,
+	std::vector<UINT>& fusedIdx,
+	std::vector<EffectFusionDecision>* decisions
+) {
+	result.clear();
+	fusedIdx.clear();
+
+	std::vector<EffectFusionDecision> plan;
+	if (!isFusionDisabled) {
+		plan = PlanEffectFusion(options);
+	}
+
+	std::vector<bool> isFused(options.size());
+	for (const EffectFusionDecision& decision : plan) {
+		const std::string& producerName = options[decision.producer].name;
+		const std::string& consumerName = options[decision.producer + 1].name;
+
+		if (decision.reason.empty()) {
+			Logger::Get().Info(fmt::format("融合效果 {} 和 {}", producerName, consumerName));
+			isFused[decision.producer] = true;
+		} else {
+			Logger::Get().Info(fmt::format("不融合效果 {} 和 {}：{}", producerName, consumerName, decision.reason));
+		}
+	}
+
+	for (UINT i = 0; i < options.size(); ++i) {
+		if (!isFused[i]) {
+			result.push_back(options[i]);
+			fusedIdx.push_back(UINT_MAX);
+			continue;
+		}
+
+		const EffectOption& producer = options[i];
+		const EffectOption& consumer = options[i + 1];
+
+		EffectOption& option = result.emplace_back();
+		option.name = StrUtils::Concat(producer.name, "+", consumer.name);
+		option.flags = (producer.flags & ~EFFECT_FLAG_LAST_EFFECT) | consumer.flags;
+		option.params.scale = producer.params.scale;
+		option.params.params = producer.params.params;
+		option.params.params.insert(consumer.params.params.begin(), consumer.params.params.end());
+		fusedIdx.push_back(i);
+
+		++i;
+	}
+
+	if (decisions) {
+		*decisions = std::move(plan);
+	}
+}
+
+UINT Renderer::CompileEffectOption(
+	const std::vector<EffectOption>& options,
+	const EffectOption& option,
+	UINT fusedIdx,
+	EffectDesc& desc,
+	const Config& config
+) {
+	if (fusedIdx == UINT_MAX) {
+		return EffectCompiler::Compile(option.name, option.flags, option.params.params, desc, config);
+	} else {
+		return EffectCompiler::CompileFused(options[fusedIdx].name, options[fusedIdx + 1].name,
+			option.flags, option.params.params, desc, config);
+	}
+}
+
+static void WriteRect(rapidjson::Writer<rapidjson::StringBuffer>& writer, const RECT& rect) {
+	writer.StartArray();
+	writer.Int(rect.left);
+	writer.Int(rect.top);
+	writer.Int(rect.right);
+	writer.Int(rect.bottom);
+	writer.EndArray();
+}
+
+// 返回的 json 格式：
+// {
+//   "outputRect": [left, top, right, bottom],
+//   "virtualOutputRect": [left, top, right, bottom],
+//   "effects": [{
+//     "name", "outputWidth", "outputHeight",
+//     "textures": [{"name", "width", "height"}]，只包括尺寸由表达式决定的中间纹理
+//     "passes": [{"desc", "dispatchX", "dispatchY"}]
+//   }],
+//   "fusions": [{"producer", "consumer", "fused", "reason"}]，相邻效果能否融合，禁用融合时为空
+// }
+// effects 为融合后的效果链，和 Run 相同，融合的效果名字为 "producer+consumer"。fusions 中的序号为融合前的
+std::string Renderer::DryRun(const std::string& effectsJson, UINT flags, SIZE inputSize, SIZE hostSize) {
+	std::vector<EffectOption> effectOptions;
+	if (!ParseEffectsJson(effectsJson, effectOptions)) {
+		return {};
+	}
+
+	std::vector<EffectDesc> parsedDescs(effectOptions.size());
+	for (size_t i = 0; i < effectOptions.size(); ++i) {
+		std::wstring fileName = (L"effects\\" + StrUtils::UTF8ToUTF16(effectOptions[i].name) + L".hlsl");
+
+		std::string source;
+		if (!Utils::ReadTextFile(fileName.c_str(), source)) {
+			Logger::Get().Error(StrUtils::Concat("读取 ", StrUtils::UTF16ToUTF8(fileName), " 失败"));
+			return {};
+		}
+
+		EffectDesc& desc = parsedDescs[i];
+		if (EffectCompiler::Parse(source, desc)) {
+			Logger::Get().Error(StrUtils::Concat("解析 ", StrUtils::UTF16ToUTF8(fileName), " 失败"));
+			return {};
+		}
+		desc.name = effectOptions[i].name;
+		desc.flags = effectOptions[i].flags;
+	}
+
+	Config config;
+	config.InitializeFlags(flags);
+
+	std::vector<EffectOption> options;
+	std::vector<UINT> fusedIdx;
+	std::vector<EffectFusionDecision> decisions;
+	FuseEffectOptions(effectOptions, config.IsDisableEffectFusion(), options, fusedIdx, &decisions);
+
+	// 和 CompileFused 相同，融合后的效果由前一个效果和后一个效果的参数、采样器组成，
+	// 通道和输出尺寸来自前一个效果
+	std::vector<EffectDesc> effectDescs(options.size());
+	// parsedDescs 中的下一个效果
+	UINT srcIdx = 0;
+	for (size_t i = 0; i < options.size(); ++i) {
+		EffectDesc& desc = effectDescs[i];
+
+		if (fusedIdx[i] == UINT_MAX) {
+			desc = std::move(parsedDescs[srcIdx++]);
+			continue;
+		}
+
+		const EffectDesc& consumer = parsedDescs[srcIdx + 1];
+
+		desc = std::move(parsedDescs[srcIdx]);
+		desc.name = options[i].name;
+		desc.flags = options[i].flags;
+		desc.params.insert(desc.params.end(), consumer.params.begin(), consumer.params.end());
+		desc.samplers.insert(desc.samplers.end(), consumer.samplers.begin(), consumer.samplers.end());
+		desc.isUseDynamic |= consumer.isUseDynamic;
+
+		srcIdx += 2;
+	}
+
+	std::vector<EffectDrawer::Plan> plans;
+	if (!PlanEffectChain(options, effectDescs, inputSize, hostSize, plans)) {
+		return {};
+	}
+
+	rapidjson::StringBuffer buf;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buf);
+
+	writer.StartObject();
+	writer.Key("outputRect");
+	WriteRect(writer, plans.back().outputRect);
+	writer.Key("virtualOutputRect");
+	WriteRect(writer, plans.back().virtualOutputRect);
+
+	writer.Key("effects");
+	writer.StartArray();
+	for (size_t i = 0; i < plans.size(); ++i) {
+		const EffectDesc& desc = effectDescs[i];
+		const EffectDrawer::Plan& plan = plans[i];
+
+		writer.StartObject();
+		writer.Key("name");
+		writer.String(desc.name.c_str(), (rapidjson::SizeType)desc.name.size());
+		writer.Key("outputWidth");
+		writer.Int(plan.outputSize.cx);
+		writer.Key("outputHeight");
+		writer.Int(plan.outputSize.cy);
+
+		writer.Key("textures");
+		writer.StartArray();
+		for (size_t j = 0; j < desc.textures.size(); ++j) {
+			const SIZE& size = plan.textureSizes[j];
+			if (size.cx == 0) {
+				continue;
+			}
+
+			writer.StartObject();
+			writer.Key("name");
+			writer.String(desc.textures[j].name.c_str(), (rapidjson::SizeType)desc.textures[j].name.size());
+			writer.Key("width");
+			writer.Int(size.cx);
+			writer.Key("height");
+			writer.Int(size.cy);
+			writer.EndObject();
+		}
+		writer.EndArray();
+
+		writer.Key("passes");
+		writer.StartArray();
+		for (size_t j = 0; j < desc.passes.size(); ++j) {
+			writer.StartObject();
+			writer.Key("desc");
+			writer.String(desc.passes[j].desc.c_str(), (rapidjson::SizeType)desc.passes[j].desc.size());
+			writer.Key("dispatchX");
+			writer.Uint(plan.dispatches[j].first);
+			writer.Key("dispatchY");
+			writer.Uint(plan.dispatches[j].second);
+			writer.EndObject();
+		}
+		writer.EndArray();
+
+		writer.EndObject();
+	}
+	writer.EndArray();
+
+	writer.Key("fusions");
+	writer.StartArray();
+	for (const EffectFusionDecision& decision : decisions) {
+		writer.StartObject();
+		writer.Key("producer");
+		writer.Uint(decision.producer);
+		writer.Key("consumer");
+		writer.Uint(decision.producer + 1);
+		writer.Key("fused");
+		writer.Bool(decision.reason.empty());
+		writer.Key("reason");
+		writer.String(decision.reason.c_str(), (rapidjson::SizeType)decision.reason.size());
+		writer.EndObject();
+	}
+	writer.EndArray();
+	writer.EndObject();
+
+	return buf.GetString();
+}
+
+bool Renderer::_ResolveEffectsJson(const std::string& effectsJson) {
+	std::vector<EffectOption> effectOptions;
+	if (!ParseEffectsJson(effectsJson, effectOptions)) {
+		return false;
+	}
+
+	// 将可以融合的相邻效果合并为一个效果
+	std::vector<EffectOption> options;
+	std::vector<UINT> fusedIdx;
+	FuseEffectOptions(effectOptions, App::Get().GetConfig().IsDisableEffectFusion(), options, fusedIdx);
 
-			std::wstring fileName = (L"effects\\" + StrUtils::UTF8ToUTF16(effectNames[id]) + L".hlsl");
+	// 并行编译所有效果
+
+	UINT effectCount = (UINT)options.size();
+	std::vector<EffectDesc> effectDescs(effectCount);
+	// 在多个线程中写入，因此不使用 std::vector<bool>
+	std::vector<BYTE> compiled(effectCount);
+
+	auto compileEffects = [&]() {
+		TaskScheduler::Get().ParallelFor(effectCount, [&](UINT id) {
+			if (compiled[id]) {
+				return;
+			}
+
+			const EffectOption& option = options[id];
 
 			bool success = true;
 			int duration = Utils::Measure([&]() {
-				success = !EffectCompiler::Compile(effectNames[id], effectFlag, effectParams[id].params, effectDescs[id]);
+				success = !CompileEffectOption(effectOptions, option, fusedIdx[id], effectDescs[id], App::Get().GetConfig());
 			});
 
 			if (success) {
-				Logger::Get().Info(fmt::format("编译 {} 用时 {} 毫秒", StrUtils::UTF16ToUTF8(fileName), duration / 1000.0f));
+				Logger::Get().Info(fmt::format("编译 {} 用时 {} 毫秒", option.name, duration / 1000.0f));
+				compiled[id] = TRUE;
 			} else {
-				Logger::Get().Error(StrUtils::Concat("编译 ", StrUtils::UTF16ToUTF8(fileName), " 失败"));
-				allSuccess = false;
+				Logger::Get().Error(StrUtils::Concat("编译 ", option.name, " 失败"));
 			}
-		}, effectCount);
-	});
+		});
+	};
+
+	int duration = Utils::Measure(compileEffects);
+
+	// 融合后编译失败的效果回退到分别编译，如两个效果中的函数重名
+	if (std::find(compiled.begin(), compiled.end(), FALSE) != compiled.end()) {
+		bool hasFallback = false;
+
+		for (UINT i = 0; i < effectCount; ++i) {
+			if (compiled[i] || fusedIdx[i] == UINT_MAX) {
+				continue;
+			}
+
+			Logger::Get().Info(fmt::format("融合失败，分别编译 {}", options[i].name));
+			UINT producerIdx = fusedIdx[i];
+
+			options[i] = effectOptions[producerIdx];
+			fusedIdx[i] = UINT_MAX;
+			options.insert(options.begin() + i + 1, effectOptions[producerIdx + 1]);
+			fusedIdx.insert(fusedIdx.begin() + i + 1, UINT_MAX);
+			effectDescs.insert(effectDescs.begin() + i + 1, EffectDesc());
+			compiled.insert(compiled.begin() + i + 1, FALSE);
+
+			++effectCount;
+			hasFallback = true;
+		}
+
+		if (hasFallback) {
+			duration += Utils::Measure(compileEffects);
+		}
+	}
 
-	if (allSuccess) {
+	if (std::find(compiled.begin(), compiled.end(), FALSE) == compiled.end()) {
 		if (effectCount > 1) {
 			Logger::Get().Info(fmt::format("编译着色器总计用时 {} 毫秒", duration / 1000.0f));
 		}
@@ -427,23 +762,55 @@ bool Renderer::_ResolveEffectsJson(const std::string& effectsJson) {
 		return false;
 	}
 
-	ID3D11Texture2D* effectInput = App::Get().GetFrameSource().GetOutput();
+	ID3D11Texture2D* frameSourceOutput = App::Get().GetFrameSource().GetOutput();
+
+	// 先计算整个效果链的尺寸和常量，参数或尺寸非法时不创建任何资源
+	std::vector<EffectDrawer::Plan> plans;
+	{
+		D3D11_TEXTURE2D_DESC inputDesc;
+		frameSourceOutput->GetDesc(&inputDesc);
+
+		bool success = true;
+		int planDuration = Utils::Measure([&]() {
+			success = PlanEffectChain(options, effectDescs, { (LONG)inputDesc.Width, (LONG)inputDesc.Height },
+				Utils::GetSizeOfRect(App::Get().GetHostWndRect()), plans);
+		});
+		if (!success) {
+			return false;
+		}
+
+		// 用于判断是否值得持久化计划：如果计算用时远小于创建资源，从缓存读取计划没有收益
+		Logger::Get().Info(fmt::format("计算效果链的尺寸和常量用时 {} 毫秒", planDuration / 1000.0f));
+
+		_outputRect = plans.back().outputRect;
+		_virtualOutputRect = plans.back().virtualOutputRect;
+	}
+
+	if (!_effectBackend) {
+		_effectBackend = std::make_unique<D3D11EffectBackend>();
+	}
+
 	_effects.resize(effectCount);
 
-	for (UINT i = 0; i < effectCount; ++i) {
-		bool isLastEffect = i == effectCount - 1;
+	bool success = true;
+	int initDuration = Utils::Measure([&]() {
+		// 每个效果的输出是下一个效果的输入
+		std::shared_ptr<EffectBackend::Texture> effectInput = _effectBackend->WrapTexture(frameSourceOutput);
 
-		_effects[i].reset(new EffectDrawer());
-		if (!_effects[i]->Initialize(
-			effectDescs[i], effectParams[i], effectInput, &effectInput,
-			isLastEffect ? &_outputRect : nullptr,
-			isLastEffect ? &_virtualOutputRect : nullptr
-		)) {
-			Logger::Get().Error(fmt::format("初始化效果#{} ({}) 失败", i, effectNames[i]));
-			return false;
+		for (UINT i = 0; i < effectCount; ++i) {
+			_effects[i].reset(new EffectDrawer());
+			if (!_effects[i]->Initialize(effectDescs[i], plans[i], *_effectBackend, effectInput, effectInput)) {
+				Logger::Get().Error(fmt::format("初始化效果#{} ({}) 失败", i, options[i].name));
+				success = false;
+				return;
+			}
 		}
+	});
+	if (!success) {
+		return false;
 	}
 
+	Logger::Get().Info(fmt::format("创建效果链的资源用时 {} 毫秒", initDuration / 1000.0f));
 	return true;
 }
 
@@ -3,9 +3,11 @@
 #include "EffectDesc.h"
 
 class EffectDrawer;
+class D3D11EffectBackend;
 class GPUTimer;
 class OverlayDrawer;
 class CursorManager;
+class Config;
 
 
 class Renderer {
@@ -47,6 +49,49 @@ public:
 
 	const EffectDesc& GetEffectDesc(UINT idx) const noexcept;
 
+	// effectsJson 中的一个效果
+	struct EffectOption {
+		std::string name;
+		// EFFECT_FLAG_*，最后一个效果包含 EFFECT_FLAG_LAST_EFFECT
+		UINT flags = 0;
+		EffectParams params;
+	};
+
+	// 解析并验证 effectsJson，不编译效果
+	static bool ParseEffectsJson(const std::string& effectsJson, std::vector<EffectOption>& result);
+
+	// 相邻的两个效果 producer 和 producer + 1 能否融合，reason 为空表示可以融合
+	struct EffectFusionDecision {
+		UINT producer = 0;
+		std::string reason;
+	};
+
+	// 将可以融合的相邻效果合并为一个效果，名字为 "producer+consumer"，参数为两者的并集
+	// fusedIdx[i] 为 result[i] 中融合的第一个效果在 options 中的位置，未融合时为 UINT_MAX
+	// isFusionDisabled 为 true 时不融合。decisions 不为空时返回每对相邻效果的检查结果
+	static void FuseEffectOptions(
+		const std::vector<EffectOption>& options,
+		bool isFusionDisabled,
+		std::vector<EffectOption>& result,
+		std::vector<UINT>& fusedIdx,
+		std::vector<EffectFusionDecision>* decisions = nullptr
+	);
+
+	// 编译 FuseEffectOptions 返回的一个效果，融合的效果使用 EffectCompiler::CompileFused
+	// options 为融合前的效果，fusedIdx 为此效果对应的值
+	static UINT CompileEffectOption(
+		const std::vector<EffectOption>& options,
+		const EffectOption& option,
+		UINT fusedIdx,
+		EffectDesc& desc,
+		const Config& config
+	);
+
+	// 只运行编译器前端并计算整个效果链的尺寸和线程组数量，不需要窗口和 GPU
+	// flags 和 Run 相同，用于决定是否融合相邻的效果
+	// inputSize 为源窗口的尺寸，hostSize 为主窗口的尺寸。返回 json，失败时返回空
+	static std::string DryRun(const std::string& effectsJson, UINT flags, SIZE inputSize, SIZE hostSize);
+
 private:
 	bool _CheckSrcState();
 
@@ -61,6 +106,8 @@ private:
 
 	bool _waitingForNextFrame = false;
 
+	// 需在 _effects 之后销毁
+	std::unique_ptr<D3D11EffectBackend> _effectBackend;
 	std::vector<std::unique_ptr<EffectDrawer>> _effects;
 	std::array<EffectConstant32, 12> _dynamicConstants;
 	winrt::com_ptr<ID3D11Buffer> _dynamicCB;
@@ -0,0 +1,243 @@
+#include "pch.h"
+#include "ShaderCompiler.h"
+#include "Logger.h"
+#include "StrUtils.h"
+#include <dxcapi.h>
+
+
+// 基于 D3DCompile 的后端，产生 D3D11 可以加载的 DXBC
+class FxcShaderCompiler : public ShaderCompiler {
+public:
+	std::string_view GetId() const noexcept override {
+#ifdef _DEBUG
+		// 调试版本关闭了优化，不能和发布版本共享字节码
+		return "fxc:cs_5_0:debug";
+#else
+		return "fxc:cs_5_0";
+#endif // _DEBUG
+	}
+
+	bool Compile(
+		std::string_view hlsl,
+		const char* entryPoint,
+		const char* sourceName,
+		ID3DInclude* include,
+		const D3D_SHADER_MACRO* macros,
+		bool treatWarningsAsErrors,
+		ID3DBlob** blob
+	) const override {
+		winrt::com_ptr<ID3DBlob> errorMsgs = nullptr;
+
+		UINT flags = D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_ALL_RESOURCES_BOUND;
+		if (treatWarningsAsErrors) {
+			flags |= D3DCOMPILE_WARNINGS_ARE_ERRORS;
+		}
+
+#ifdef _DEBUG
+		flags |= D3DCOMPILE_SKIP_OPTIMIZATION | D3DCOMPILE_DEBUG;
+#else
+		flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3;
+#endif // _DEBUG
+
+		HRESULT hr = D3DCompile(hlsl.data(), hlsl.size(), sourceName, macros, include,
+			entryPoint, "cs_5_0", flags, 0, blob, errorMsgs.put());
+		if (FAILED(hr)) {
+			if (errorMsgs) {
+				Logger::Get().ComError(StrUtils::Concat("编译计算着色器失败：", (const char*)errorMsgs->GetBufferPointer()), hr);
+			}
+			return false;
+		} else {
+			// 警告消息
+			if (errorMsgs) {
+				Logger::Get().Warn(StrUtils::Concat("编译计算着色器时产生警告：", (const char*)errorMsgs->GetBufferPointer()));
+			}
+		}
+
+		return true;
+	}
+};
+
+// 通过 ID3DInclude 为 DXC 读取头文件
+class DxcIncludeHandler : public winrt::implements<DxcIncludeHandler, IDxcIncludeHandler> {
+public:
+	DxcIncludeHandler(IDxcUtils* utils, ID3DInclude* include) : _utils(utils), _include(include) {}
+
+	HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR pFilename, IDxcBlob** ppIncludeSource) noexcept override {
+		if (!_include) {
+			return E_FAIL;
+		}
+
+		// DXC 传入的是相对于源文件的路径，以 .\ 或 ./ 开头
+		std::wstring_view fileName(pFilename);
+		if (fileName.starts_with(L".\\") || fileName.starts_with(L"./")) {
+			fileName.remove_prefix(2);
+		}
+
+		LPCVOID data = nullptr;
+		UINT size = 0;
+		HRESULT hr = _include->Open(D3D_INCLUDE_LOCAL, StrUtils::UTF16ToUTF8(fileName).c_str(), nullptr, &data, &size);
+		if (FAILED(hr)) {
+			return hr;
+		}
+
+		// CreateBlob 复制内容，之后即可关闭
+		winrt::com_ptr<IDxcBlobEncoding> blob;
+		hr = _utils->CreateBlob(data, size, DXC_CP_UTF8, blob.put());
+		_include->Close(data);
+		if (FAILED(hr)) {
+			return hr;
+		}
+
+		*ppIncludeSource = blob.detach();
+		return S_OK;
+	}
+
+private:
+	IDxcUtils* _utils;
+	ID3DInclude* _include;
+};
+
+// 基于 DXC 的后端，动态加载 dxcompiler.dll
+class DxcShaderCompiler : public ShaderCompiler {
+public:
+	bool Initialize() {
+		HMODULE hDxc = LoadLibrary(L"dxcompiler.dll");
+		if (!hDxc) {
+			Logger::Get().Win32Error("加载 dxcompiler.dll 失败");
+			return false;
+		}
+
+		_createInstance = (DxcCreateInstanceProc)GetProcAddress(hDxc, "DxcCreateInstance");
+		if (!_createInstance) {
+			Logger::Get().Win32Error("获取 DxcCreateInstance 失败");
+			return false;
+		}
+
+		return true;
+	}
+
+	std::string_view GetId() const noexcept override {
+#ifdef _DEBUG
+		return "dxc:cs_6_0:debug";
+#else
+		return "dxc:cs_6_0";
+#endif // _DEBUG
+	}
+
+	bool Compile(
+		std::string_view hlsl,
+		const char* entryPoint,
+		const char* sourceName,
+		ID3DInclude* include,
+		const D3D_SHADER_MACRO* macros,
+		bool treatWarningsAsErrors,
+		ID3DBlob** blob
+	) const override {
+		// 编译器对象不保证线程安全，每次编译单独创建
+		winrt::com_ptr<IDxcUtils> utils;
+		winrt::com_ptr<IDxcCompiler3> compiler;
+		HRESULT hr = _createInstance(CLSID_DxcUtils, IID_PPV_ARGS(utils.put()));
+		if (SUCCEEDED(hr)) {
+			hr = _createInstance(CLSID_DxcCompiler, IID_PPV_ARGS(compiler.put()));
+		}
+		if (FAILED(hr)) {
+			Logger::Get().ComError("创建 DXC 实例失败", hr);
+			return false;
+		}
+
+		// 和 FxcShaderCompiler 的编译选项对应。效果为 FXC 编写，使用 HLSL 2018 以保持语义相同
+		std::vector<std::wstring> args = {
+			StrUtils::UTF8ToUTF16(sourceName),
+			L"-E", StrUtils::UTF8ToUTF16(entryPoint),
+			L"-T", L"cs_6_0",
+			L"-HV", L"2018",
+			L"-Ges",
+			L"-all_resources_bound"
+		};
+		if (treatWarningsAsErrors) {
+			args.emplace_back(L"-WX");
+		}
+#ifdef _DEBUG
+		args.emplace_back(L"-Od");
+		args.emplace_back(L"-Zi");
+		args.emplace_back(L"-Qembed_debug");
+#else
+		args.emplace_back(L"-O3");
+#endif // _DEBUG
+
+		for (const D3D_SHADER_MACRO* macro = macros; macro && macro->Name; ++macro) {
+			args.emplace_back(L"-D");
+			args.emplace_back(StrUtils::UTF8ToUTF16(macro->Definition
+				? StrUtils::Concat(macro->Name, "=", macro->Definition)
+				: std::string(macro->Name)));
+		}
+
+		std::vector<LPCWSTR> argPtrs;
+		argPtrs.reserve(args.size());
+		for (const std::wstring& arg : args) {
+			argPtrs.push_back(arg.c_str());
+		}
+
+		winrt::com_ptr<DxcIncludeHandler> includeHandler = winrt::make_self<DxcIncludeHandler>(utils.get(), include);
+
+		DxcBuffer source{ hlsl.data(), hlsl.size(), DXC_CP_UTF8 };
+		winrt::com_ptr<IDxcResult> result;
+		hr = compiler->Compile(&source, argPtrs.data(), (UINT32)argPtrs.size(),
+			includeHandler.get(), IID_PPV_ARGS(result.put()));
+		if (FAILED(hr)) {
+			Logger::Get().ComError("IDxcCompiler3::Compile 失败", hr);
+			return false;
+		}
+
+		winrt::com_ptr<IDxcBlobUtf8> errorMsgs;
+		result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(errorMsgs.put()), nullptr);
+		const bool hasMessages = errorMsgs && errorMsgs->GetStringLength() > 0;
+
+		HRESULT status = E_FAIL;
+		result->GetStatus(&status);
+		if (FAILED(status)) {
+			if (hasMessages) {
+				Logger::Get().ComError(StrUtils::Concat("编译计算着色器失败：", errorMsgs->GetStringPointer()), status);
+			}
+			return false;
+		} else if (hasMessages) {
+			// 警告消息
+			Logger::Get().Warn(StrUtils::Concat("编译计算着色器时产生警告：", errorMsgs->GetStringPointer()));
+		}
+
+		winrt::com_ptr<IDxcBlob> object;
+		hr = result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(object.put()), nullptr);
+		if (FAILED(hr) || !object) {
+			Logger::Get().ComError("获取 DXIL 失败", hr);
+			return false;
+		}
+
+		// 转换为和 FXC 相同的 ID3DBlob
+		hr = D3DCreateBlob(object->GetBufferSize(), blob);
+		if (FAILED(hr)) {
+			Logger::Get().ComError("D3DCreateBlob 失败", hr);
+			return false;
+		}
+		std::memcpy((*blob)->GetBufferPointer(), object->GetBufferPointer(), object->GetBufferSize());
+
+		return true;
+	}
+
+private:
+	DxcCreateInstanceProc _createInstance = nullptr;
+};
+
+const ShaderCompiler& ShaderCompiler::Get(UINT /*effectFlags*/) noexcept {
+	// ID3D11Device::CreateComputeShader 只接受 DXBC，DXC 产生的 DXIL（cs_6_x）无法使用，
+	// 因此所有效果都使用 FXC。将来支持 D3D12 时可在此按效果选择其他后端
+	static FxcShaderCompiler fxc;
+	return fxc;
+}
+
+const ShaderCompiler* ShaderCompiler::GetDxc() noexcept {
+	static DxcShaderCompiler* dxc = []() -> DxcShaderCompiler* {
+		static DxcShaderCompiler instance;
+		return instance.Initialize() ? &instance : nullptr;
+	}();
+	return dxc;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "pch.h"
+
+
+// 着色器编译后端
+// 效果编译器只负责生成 HLSL，字节码由后端产生。后端、目标以及影响字节码的编译选项
+// 都体现在 GetId 中，它是缓存键的一部分，因此不同后端的缓存互不干扰
+class ShaderCompiler {
+public:
+	virtual ~ShaderCompiler() = default;
+
+	// 在所有后端中唯一，如 "fxc:cs_5_0"
+	virtual std::string_view GetId() const noexcept = 0;
+
+	// macros 以空元素结尾，include 可以为空
+	// 可以在多个线程中同时调用
+	virtual bool Compile(
+		std::string_view hlsl,
+		const char* entryPoint,
+		const char* sourceName,
+		ID3DInclude* include,
+		const D3D_SHADER_MACRO* macros,
+		bool treatWarningsAsErrors,
+		ID3DBlob** blob
+	) const = 0;
+
+	// 为效果选择编译后端，flags 为 EFFECT_FLAG_*
+	static const ShaderCompiler& Get(UINT effectFlags) noexcept;
+
+	// 基于 DXC 的后端，产生 cs_6_0 的 DXIL。D3D11 无法加载，目前只用于离线验证效果
+	// 需要 dxcompiler.dll，加载失败时返回空
+	static const ShaderCompiler* GetDxc() noexcept;
+};
@@ -48,6 +48,10 @@ struct StrUtils {
 		return std::isalnum(static_cast<unsigned char>(c));
 	}
 
+	static int isdigit(char c) {
+		return std::isdigit(static_cast<unsigned char>(c));
+	}
+
 	static char toupper(char c) {
 		return std::toupper(static_cast<unsigned char>(c));
 	}
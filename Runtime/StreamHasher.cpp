@@ -0,0 +1,22 @@
+#include "pch.h"
+#include "StreamHasher.h"
+#include "Utils.h"
+
+
+StreamHasher::StreamHasher() noexcept {
+	XXH3_128bits_reset(&_state);
+}
+
+StreamHasher& StreamHasher::Update(std::span<const BYTE> data) noexcept {
+	UINT64 size = data.size();
+	XXH3_128bits_update(&_state, &size, sizeof(size));
+	XXH3_128bits_update(&_state, data.data(), data.size());
+	return *this;
+}
+
+std::string StreamHasher::Finish() noexcept {
+	// 使用规范的大端序表示，结果和平台无关
+	XXH128_canonical_t canonical;
+	XXH128_canonicalFromHash(&canonical, XXH3_128bits_digest(&_state));
+	return Utils::Bin2Hex(std::span(canonical.digest, sizeof(canonical.digest)));
+}
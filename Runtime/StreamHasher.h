@@ -0,0 +1,33 @@
+#pragma once
+#include "pch.h"
+#define XXH_STATIC_LINKING_ONLY
+#include <xxhash.h>
+
+
+// 128 位非加密的流式哈希（XXH3），用于缓存的键
+// 状态保存在对象中，每次计算使用各自的对象，因此不需要同步
+// 每段数据以长度为前缀，分段输入时不需要拼接，也不会因段的边界不同而产生相同的结果
+class StreamHasher {
+public:
+	StreamHasher() noexcept;
+	StreamHasher(const StreamHasher&) = delete;
+	StreamHasher(StreamHasher&&) = delete;
+
+	StreamHasher& Update(std::span<const BYTE> data) noexcept;
+
+	StreamHasher& Update(std::string_view str) noexcept {
+		return Update(std::span((const BYTE*)str.data(), str.size()));
+	}
+
+	template<typename T>
+	requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+	StreamHasher& UpdateValue(T value) noexcept {
+		return Update(std::span((const BYTE*)&value, sizeof(value)));
+	}
+
+	// 返回 32 个字符的 16 进制字符串
+	std::string Finish() noexcept;
+
+private:
+	XXH3_state_t _state;
+};
@@ -0,0 +1,163 @@
+#include "pch.h"
+#include "TaskScheduler.h"
+
+
+// 当前线程在 TaskScheduler 中的序号，非工作线程为 -1
+static thread_local int curWorkerIdx = -1;
+
+TaskScheduler::TaskScheduler() {
+	// 调用者也参与执行，因此工作线程比逻辑核心少一个
+	UINT workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+	_queues.reset(new _Queue[workerCount + 1]);
+
+	_workers.reserve(workerCount);
+	for (UINT i = 0; i < workerCount; ++i) {
+		_workers.emplace_back(&TaskScheduler::_WorkerProc, this, i);
+		_workers.back().detach();
+	}
+}
+
+UINT TaskScheduler::_GetCurrentQueueIdx() const noexcept {
+	return curWorkerIdx >= 0 ? (UINT)curWorkerIdx : (UINT)_workers.size();
+}
+
+void TaskScheduler::_WorkerProc(UINT workerIdx) {
+	curWorkerIdx = (int)workerIdx;
+
+	while (true) {
+		if (_Job* job = _TryPop(workerIdx)) {
+			_Run(job);
+			continue;
+		}
+
+		std::unique_lock lk(_mutex);
+		_cv.wait(lk, [&]() { return _taskCount.load(std::memory_order_acquire) > 0; });
+	}
+}
+
+TaskScheduler::_Job* TaskScheduler::_TryPop(UINT queueIdx) {
+	if (_taskCount.load(std::memory_order_acquire) == 0) {
+		return nullptr;
+	}
+
+	const UINT queueCount = (UINT)_workers.size() + 1;
+
+	// 先从自己的队列尾部取，局部性更好
+	for (UINT i = 0; i < queueCount; ++i) {
+		_Queue& queue = _queues[(queueIdx + i) % queueCount];
+
+		std::scoped_lock lk(queue.mutex);
+		if (queue.jobs.empty()) {
+			continue;
+		}
+
+		_Job* job;
+		if (i == 0) {
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+		} else {
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+		}
+
+		// 必须在持有锁时增加，否则调用者可能在此之前返回
+		job->runners.fetch_add(1, std::memory_order_relaxed);
+		_taskCount.fetch_sub(1, std::memory_order_relaxed);
+		return job;
+	}
+
+	return nullptr;
+}
+
+void TaskScheduler::_Run(_Job* job) {
+	UINT id;
+	while ((id = job->next.fetch_add(1, std::memory_order_relaxed)) < job->count) {
+		job->func(job->context, id);
+
+		if (job->finished.fetch_add(1, std::memory_order_acq_rel) + 1 == job->count) {
+			// 唤醒等待的调用者
+			std::scoped_lock lk(_mutex);
+			_cv.notify_all();
+		}
+	}
+
+	// 此后不能再访问 job
+	job->runners.fetch_sub(1, std::memory_order_release);
+}
+
+void TaskScheduler::_ParallelFor(UINT times, void (*func)(void*, UINT), void* context) {
+#ifdef _DEBUG
+	// 为了便于调试，DEBUG 模式下不使用多线程
+	for (UINT i = 0; i < times; ++i) {
+		func(context, i);
+	}
+#else
+	if (times == 0) {
+		return;
+	}
+
+	if (times == 1 || _workers.empty()) {
+		for (UINT i = 0; i < times; ++i) {
+			func(context, i);
+		}
+		return;
+	}
+
+	_Job job;
+	job.func = func;
+	job.context = context;
+	job.count = times;
+
+	const UINT queueIdx = _GetCurrentQueueIdx();
+	_Queue& queue = _queues[queueIdx];
+
+	// 每个引用可以被一个线程领取，多于工作线程数没有意义
+	const UINT shareCount = std::min(times - 1, (UINT)_workers.size());
+	{
+		std::scoped_lock lk(queue.mutex);
+		for (UINT i = 0; i < shareCount; ++i) {
+			queue.jobs.push_back(&job);
+		}
+	}
+
+	_taskCount.fetch_add(shareCount, std::memory_order_release);
+	{
+		std::scoped_lock lk(_mutex);
+		_cv.notify_all();
+	}
+
+	// 调用者也参与执行
+	job.runners.fetch_add(1, std::memory_order_relaxed);
+	_Run(&job);
+
+	// 等待其他线程执行完毕，期间帮助执行其他任务（如嵌套的 ParallelFor）
+	while (job.finished.load(std::memory_order_acquire) < times) {
+		if (_Job* other = _TryPop(queueIdx)) {
+			_Run(other);
+			continue;
+		}
+
+		std::unique_lock lk(_mutex);
+		_cv.wait(lk, [&]() {
+			return job.finished.load(std::memory_order_acquire) == times
+				|| _taskCount.load(std::memory_order_acquire) > 0;
+		});
+	}
+
+	// 移除还未被领取的引用
+	const UINT queueCount = (UINT)_workers.size() + 1;
+	for (UINT i = 0; i < queueCount; ++i) {
+		_Queue& q = _queues[i];
+
+		std::scoped_lock lk(q.mutex);
+		size_t removed = std::erase(q.jobs, &job);
+		_taskCount.fetch_sub((UINT)removed, std::memory_order_relaxed);
+	}
+
+	// 已领取引用的线程发现没有序号可领后立即退出
+	while (job.runners.load(std::memory_order_acquire) > 0) {
+		std::this_thread::yield();
+	}
+#endif // _DEBUG
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "pch.h"
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+
+// 工作窃取的任务调度器，只依赖标准库
+// 每个工作线程有自己的任务队列，空闲时从其他队列窃取任务
+// ParallelFor 可以嵌套调用，等待时当前线程会帮助执行其他任务，不会阻塞工作线程
+class TaskScheduler {
+public:
+	// 工作线程在进程退出时由系统结束，不在 DLL 卸载时等待它们
+	static TaskScheduler& Get() {
+		static TaskScheduler* instance = new TaskScheduler();
+		return *instance;
+	}
+
+	TaskScheduler(const TaskScheduler&) = delete;
+	TaskScheduler(TaskScheduler&&) = delete;
+
+	// 并行执行 func(0) 到 func(times - 1)，全部执行完毕后返回
+	// func 的生命周期由调用者保证，提交任务时不分配内存
+	template<typename Fn>
+	void ParallelFor(UINT times, const Fn& func) {
+		_ParallelFor(times, [](void* context, UINT id) {
+			(*(const Fn*)context)(id);
+		}, (void*)&func);
+	}
+
+	UINT GetWorkerCount() const noexcept {
+		return (UINT)_workers.size();
+	}
+
+private:
+	// 一次 ParallelFor 调用，位于调用者的栈上
+	// 队列中保存的是它的引用，执行时不断领取下一个序号直到领完
+	struct _Job {
+		void (*func)(void* context, UINT id) = nullptr;
+		void* context = nullptr;
+		UINT count = 0;
+		// 下一个待领取的序号
+		std::atomic<UINT> next = 0;
+		// 已执行完毕的序号数
+		std::atomic<UINT> finished = 0;
+		// 正在执行此任务的线程数，为 0 时调用者才能返回
+		std::atomic<UINT> runners = 0;
+	};
+
+	struct _Queue {
+		std::mutex mutex;
+		std::deque<_Job*> jobs;
+	};
+
+	TaskScheduler();
+
+	void _ParallelFor(UINT times, void (*func)(void*, UINT), void* context);
+
+	void _WorkerProc(UINT workerIdx);
+
+	// 从自己的队列尾部取任务，失败时从其他队列头部窃取
+	// 返回的任务的 runners 已加一
+	_Job* _TryPop(UINT queueIdx);
+
+	// 执行任务直到序号领完
+	void _Run(_Job* job);
+
+	// 最后一个队列由非工作线程共享
+	UINT _GetCurrentQueueIdx() const noexcept;
+
+	std::vector<std::thread> _workers;
+	std::unique_ptr<_Queue[]> _queues;
+
+	// 所有队列中的任务数
+	std::atomic<UINT> _taskCount = 0;
+
+	// 用于唤醒空闲的线程
+	std::mutex _mutex;
+	std::condition_variable _cv;
+};
@@ -167,58 +167,30 @@ std::string Utils::Bin2Hex(std::span<const BYTE> data) {
 }
 
 
-struct TPContext {
-	std::function<void(UINT)> func;
-	std::atomic<UINT> id;
-};
-
-static void CALLBACK TPCallback(PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) {
-	TPContext* ctxt = (TPContext*)context;
-	UINT id = ++ctxt->id;
-	ctxt->func(id);
+// 复用上下文可以避免每次压缩和解压时分配内部缓冲区
+static ZSTD_CCtx* GetThreadCCtx() {
+	struct Deleter { void operator()(ZSTD_CCtx* cctx) noexcept { ZSTD_freeCCtx(cctx); } };
+	static thread_local std::unique_ptr<ZSTD_CCtx, Deleter> cctx(ZSTD_createCCtx());
+	return cctx.get();
 }
 
-void Utils::RunParallel(std::function<void(UINT)> func, UINT times) {
-#ifdef _DEBUG
-	// 为了便于调试，DEBUG 模式下不使用线程池
-	for (UINT i = 0; i < times; ++i) {
-		func(i);
-	}
-#else
-	if (times == 0) {
-		return;
-	}
-
-	if (times == 1) {
-		return func(0);
-	}
-
-	TPContext ctxt = { func, 0 };
-	PTP_WORK work = CreateThreadpoolWork(TPCallback, &ctxt, nullptr);
-	if (work) {
-		// 在线程池中执行 times - 1 次
-		for (UINT i = 1; i < times; ++i) {
-			SubmitThreadpoolWork(work);
-		}
-
-		func(0);
-
-		WaitForThreadpoolWorkCallbacks(work, FALSE);
-		CloseThreadpoolWork(work);
-	} else {
-		Logger::Get().Win32Error("CreateThreadpoolWork 失败，回退到单线程");
+static ZSTD_DCtx* GetThreadDCtx() {
+	struct Deleter { void operator()(ZSTD_DCtx* dctx) noexcept { ZSTD_freeDCtx(dctx); } };
+	static thread_local std::unique_ptr<ZSTD_DCtx, Deleter> dctx(ZSTD_createDCtx());
+	return dctx.get();
+}
 
-		// 回退到单线程
-		for (UINT i = 0; i < times; ++i) {
-			func(i);
-		}
+static bool ZstdCompressImpl(std::span<const BYTE> src, std::vector<BYTE>& dest, int compressionLevel, const ZSTD_CDict* dict) {
+	ZSTD_CCtx* cctx = GetThreadCCtx();
+	if (!cctx) {
+		Logger::Get().Error("ZSTD_createCCtx 失败");
+		return false;
 	}
-#endif // _DEBUG
-}
 
-bool Utils::ZstdCompress(std::span<const BYTE> src, std::vector<BYTE>& dest, int compressionLevel) {
 	dest.resize(ZSTD_compressBound(src.size()));
-	size_t size = ZSTD_compress(dest.data(), dest.size(), src.data(), src.size(), compressionLevel);
+	size_t size = dict
+		? ZSTD_compress_usingCDict(cctx, dest.data(), dest.size(), src.data(), src.size(), dict)
+		: ZSTD_compressCCtx(cctx, dest.data(), dest.size(), src.data(), src.size(), compressionLevel);
 
 	if (ZSTD_isError(size)) {
 		Logger::Get().Error(StrUtils::Concat("压缩失败：", ZSTD_getErrorName(size)));
@@ -229,15 +201,37 @@ bool Utils::ZstdCompress(std::span<const BYTE> src, std::vector<BYTE>& dest, int
 	return true;
 }
 
-bool Utils::ZstdDecompress(std::span<const BYTE> src, std::vector<BYTE>& dest) {
+bool Utils::ZstdCompress(std::span<const BYTE> src, std::vector<BYTE>& dest, int compressionLevel) {
+	return ZstdCompressImpl(src, dest, compressionLevel, nullptr);
+}
+
+bool Utils::ZstdCompress(std::span<const BYTE> src, std::vector<BYTE>& dest, const ZSTD_CDict* dict) {
+	assert(dict);
+	return ZstdCompressImpl(src, dest, 0, dict);
+}
+
+bool Utils::ZstdDecompress(std::span<const BYTE> src, std::vector<BYTE>& dest, const ZSTD_DDict* dict) {
 	auto size = ZSTD_getFrameContentSize(src.data(), src.size());
 	if (size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR) {
 		Logger::Get().Error("ZSTD_getFrameContentSize 失败");
 		return false;
 	}
 
+	ZSTD_DCtx* dctx = GetThreadDCtx();
+	if (!dctx) {
+		Logger::Get().Error("ZSTD_createDCtx 失败");
+		return false;
+	}
+
+	// 训练字典前写入的帧不使用字典，它们的 dictID 为 0。不能依赖 zstd 对这种帧忽略字典
+	if (dict && ZSTD_getDictID_fromFrame(src.data(), src.size()) == 0) {
+		dict = nullptr;
+	}
+
 	dest.resize(size);
-	size = ZSTD_decompress(dest.data(), dest.size(), src.data(), src.size());
+	size = dict
+		? ZSTD_decompress_usingDDict(dctx, dest.data(), dest.size(), src.data(), src.size(), dict)
+		: ZSTD_decompressDCtx(dctx, dest.data(), dest.size(), src.data(), src.size());
 	if (ZSTD_isError(size)) {
 		Logger::Get().Error(StrUtils::Concat("解压失败：", ZSTD_getErrorName(size)));
 		return false;
@@ -349,73 +343,3 @@ bool Utils::ShowSystemCursor(bool value) {
 	}
 	return result;
 }
-
-Utils::Hasher::~Hasher() {
-	if (_hAlg) {
-		BCryptCloseAlgorithmProvider(_hAlg, 0);
-	}
-	if (_hashObj) {
-		HeapFree(GetProcessHeap(), 0, _hashObj);
-	}
-	if (_hHash) {
-		BCryptDestroyHash(_hHash);
-	}
-}
-
-bool Utils::Hasher::Initialize() {
-	NTSTATUS status = BCryptOpenAlgorithmProvider(&_hAlg, BCRYPT_SHA1_ALGORITHM, NULL, 0);
-	if (!NT_SUCCESS(status)) {
-		Logger::Get().Error(fmt::format("BCryptOpenAlgorithmProvider 失败\n\tNTSTATUS={}", status));
-		return false;
-	}
-
-	ULONG result;
-
-	status = BCryptGetProperty(_hAlg, BCRYPT_OBJECT_LENGTH, (PBYTE)&_hashObjLen, sizeof(_hashObjLen), &result, 0);
-	if (!NT_SUCCESS(status)) {
-		Logger::Get().Error(fmt::format("BCryptGetProperty 失败\n\tNTSTATUS={}", status));
-		return false;
-	}
-
-	_hashObj = HeapAlloc(GetProcessHeap(), 0, _hashObjLen);
-	if (!_hashObj) {
-		Logger::Get().Error("HeapAlloc 失败");
-		return false;
-	}
-
-	status = BCryptGetProperty(_hAlg, BCRYPT_HASH_LENGTH, (PBYTE)&_hashLen, sizeof(_hashLen), &result, 0);
-	if (!NT_SUCCESS(status)) {
-		Logger::Get().Error(fmt::format("BCryptGetProperty 失败\n\tNTSTATUS={}", status));
-		return false;
-	}
-
-	status = BCryptCreateHash(_hAlg, &_hHash, (PUCHAR)_hashObj, _hashObjLen, NULL, 0, BCRYPT_HASH_REUSABLE_FLAG);
-	if (!NT_SUCCESS(status)) {
-		Logger::Get().Error(fmt::format("BCryptCreateHash 失败\n\tNTSTATUS={}", status));
-		return false;
-	}
-
-	Logger::Get().Info("Utils::Hasher 初始化成功");
-	return true;
-}
-
-bool Utils::Hasher::Hash(std::span<const BYTE> data, std::vector<BYTE>& result) {
-	// BCrypt API 内部保存状态，因此需要同步对它们访问
-	std::scoped_lock lk(_cs);
-
-	result.resize(_hashLen);
-
-	NTSTATUS status = BCryptHashData(_hHash, (PUCHAR)data.data(), (ULONG)data.size(), 0);
-	if (!NT_SUCCESS(status)) {
-		Logger::Get().Error(fmt::format("BCryptCreateHash 失败\n\tNTSTATUS={}", status));
-		return false;
-	}
-
-	status = BCryptFinishHash(_hHash, result.data(), (ULONG)result.size(), 0);
-	if (!NT_SUCCESS(status)) {
-		Logger::Get().Error(fmt::format("BCryptFinishHash 失败\n\tNTSTATUS={}", status));
-		return false;
-	}
-
-	return true;
-}
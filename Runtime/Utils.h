@@ -1,8 +1,11 @@
 #pragma once
 #include "pch.h"
-#include <bcrypt.h>
 
 
+// 和 zstd.h 中的声明相同，避免在此包含 zstd.h
+typedef struct ZSTD_CDict_s ZSTD_CDict;
+typedef struct ZSTD_DDict_s ZSTD_DDict;
+
 struct Utils {
 	static UINT GetWindowShowCmd(HWND hwnd);
 
@@ -90,32 +93,6 @@ struct Utils {
 		CRITICAL_SECTION _cs{};
 	};
 
-	class Hasher {
-	public:
-		static Hasher& Get() noexcept {
-			static Hasher instance;
-			return instance;
-		}
-
-		bool Initialize();
-
-		bool Hash(std::span<const BYTE> data, std::vector<BYTE>& result);
-
-		DWORD GetHashLength() noexcept {
-			return _hashLen;
-		}
-	private:
-		~Hasher();
-
-		CSMutex _cs;	// 同步对 Hash() 的访问
-
-		BCRYPT_ALG_HANDLE _hAlg = NULL;
-		DWORD _hashObjLen = 0;		// hash 对象的大小
-		void* _hashObj = nullptr;	// 存储 hash 对象
-		DWORD _hashLen = 0;			// 哈希结果的大小
-		BCRYPT_HASH_HANDLE _hHash = NULL;
-	};
-
 	template<typename T>
 	class ScopeExit {
 	public:
@@ -135,12 +112,12 @@ struct Utils {
 
 	static HANDLE SafeHandle(HANDLE h) noexcept { return (h == INVALID_HANDLE_VALUE) ? nullptr : h; }
 
-	// 并行执行 times 次 func，并行失败时回退到单线程
-	// 执行完毕后返回
-	static void RunParallel(std::function<void(UINT)> func, UINT times);
-
+	// 每个线程复用自己的压缩和解压上下文
 	static bool ZstdCompress(std::span<const BYTE> src, std::vector<BYTE>& dest, int compressionLevel);
-	static bool ZstdDecompress(std::span<const BYTE> src, std::vector<BYTE>& dest);
+	// 使用字典压缩，压缩等级由字典创建时指定
+	static bool ZstdCompress(std::span<const BYTE> src, std::vector<BYTE>& dest, const ZSTD_CDict* dict);
+	// 使用字典压缩的数据必须提供相同的字典。帧头中没有 dictID 的数据不使用 dict
+	static bool ZstdDecompress(std::span<const BYTE> src, std::vector<BYTE>& dest, const ZSTD_DDict* dict = nullptr);
 
 	static bool IsStartMenu(HWND hwnd);
 
@@ -0,0 +1,85 @@
+#include "pch.h"
+#include "Benchmark.h"
+#include "Utils.h"
+#include "StrUtils.h"
+#include "EffectCompiler.h"
+#include "TaskScheduler.h"
+#include "Config.h"
+#include <atomic>
+
+
+// 和 Config.cpp 中的 FlagMasks::DisableEffectCache 相同
+static constexpr UINT FLAG_DISABLE_EFFECT_CACHE = 0x400;
+
+// 替换全局的 operator new 以统计分配次数，new[] 和各种 delete 的默认实现会转发到这两个函数
+static std::atomic<size_t> allocCount = 0;
+
+void* operator new(size_t size) {
+	allocCount.fetch_add(1, std::memory_order_relaxed);
+
+	void* p = malloc(size ? size : 1);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+size_t Benchmark::GetAllocCount() noexcept {
+	return allocCount.load(std::memory_order_relaxed);
+}
+
+std::vector<std::string> Benchmark::GetEffectNames() {
+	std::vector<std::string> result;
+
+	WIN32_FIND_DATA findData{};
+	HANDLE hFind = Utils::SafeHandle(FindFirstFileEx(L"effects\\*.hlsl",
+		FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+	if (!hFind) {
+		return result;
+	}
+
+	do {
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+			continue;
+		}
+
+		std::wstring_view fileName(findData.cFileName);
+		result.push_back(StrUtils::UTF16ToUTF8(fileName.substr(0, fileName.size() - 5)));
+	} while (FindNextFile(hFind, &findData));
+
+	FindClose(hFind);
+
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+bool Benchmark::ReadEffectSource(std::string_view name, std::string& source) {
+	return Utils::ReadTextFile(StrUtils::ConcatW(L"effects\\", StrUtils::UTF8ToUTF16(name), L".hlsl").c_str(), source);
+}
+
+bool Benchmark::CompileEffects(const std::vector<std::string>& names, std::vector<EffectDesc>& descs) {
+	Config config;
+	config.InitializeFlags(FLAG_DISABLE_EFFECT_CACHE);
+
+	static const std::map<std::string, std::variant<float, int>> inlineParams;
+
+	descs.clear();
+	descs.resize(names.size());
+	std::atomic<bool> success = true;
+	TaskScheduler::Get().ParallelFor((UINT)names.size(), [&](UINT id) {
+		if (EffectCompiler::Compile(names[id], 0, inlineParams, descs[id], config)) {
+			success = false;
+		}
+	});
+
+	if (!success) {
+		fmt::print("编译效果失败，见 benchmark.log\n");
+		return false;
+	}
+
+	return true;
+}
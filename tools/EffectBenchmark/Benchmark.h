@@ -0,0 +1,79 @@
+#pragma once
+#include "pch.h"
+#include "EffectDesc.h"
+#include <chrono>
+
+
+// 子命令的入口，args 为子命令之后的参数，返回进程的退出码
+using BenchmarkFunc = int(*)(const std::vector<std::wstring>& args);
+
+// 比较 StreamHasher 和原先的 BCrypt SHA1 哈希所有效果源码的速度
+int HashBenchmark(const std::vector<std::wstring>& args);
+
+// 测量编译器前端的吞吐量，并对比 MagpieFX 选项扫描改为查表前后的实现
+int ParseBenchmark(const std::vector<std::wstring>& args);
+
+// 生成所有效果的所有通道的源码，统计用时和内存分配次数
+int CodegenBenchmark(const std::vector<std::wstring>& args);
+
+// 检查规范化源码对所有效果的格式修改不变、对语义修改敏感，并测量其吞吐量
+int CanonicalizeBenchmark(const std::vector<std::wstring>& args);
+
+// 用 DXC（或 FXC）编译所有效果，有效果编译失败时返回 1
+int ValidateBenchmark(const std::vector<std::wstring>& args);
+
+// 分别以 FP32 和 FP16 编译所有效果，比较字节码和用时
+int FP16Benchmark(const std::vector<std::wstring>& args);
+
+// 编译两个效果，比较编译用时、字节码大小和指令数
+int CompareBenchmark(const std::vector<std::wstring>& args);
+
+// 禁用缓存，分别以串行、通道并行和效果并行的方式编译所有效果，测量吞吐量
+int CompileThroughputBenchmark(const std::vector<std::wstring>& args);
+
+// 保存所有效果的缓存，然后分别从内存和磁盘读取
+int CacheBenchmark(const std::vector<std::wstring>& args);
+// cache 在新进程中运行它，以测量冷启动时从磁盘读取
+int CacheLoadBenchmark(const std::vector<std::wstring>& args);
+
+// 比较每个效果的字节码在不同压缩等级、有无字典时的大小和解压速度
+int CompressionBenchmark(const std::vector<std::wstring>& args);
+
+
+struct Benchmark {
+	// effects 文件夹中所有效果的名字，不含扩展名，按字典序排列
+	static std::vector<std::string> GetEffectNames();
+
+	// 读取 effects\{name}.hlsl
+	static bool ReadEffectSource(std::string_view name, std::string& source);
+
+	// 禁用缓存并行编译效果，编译失败时返回 false
+	static bool CompileEffects(const std::vector<std::string>& names, std::vector<EffectDesc>& descs);
+
+	// 重复运行 func 至少 minRepeat 次且总用时不少于 minSeconds，返回平均每次的用时（秒）
+	template<typename Fn>
+	static double Measure(Fn&& func, UINT minRepeat = 3, double minSeconds = 0.5) {
+		using clock = std::chrono::steady_clock;
+
+		// 预热，使文件缓存、单例和线程池就绪
+		func();
+
+		UINT repeat = 0;
+		auto start = clock::now();
+		std::chrono::duration<double> elapsed{};
+		do {
+			func();
+			++repeat;
+			elapsed = clock::now() - start;
+		} while (repeat < minRepeat || elapsed.count() < minSeconds);
+
+		return elapsed.count() / repeat;
+	}
+
+	// 进程启动以来调用 operator new 的次数，包括所有线程
+	static size_t GetAllocCount() noexcept;
+
+	static double ToMB(size_t bytes) noexcept {
+		return bytes / 1024.0 / 1024.0;
+	}
+};
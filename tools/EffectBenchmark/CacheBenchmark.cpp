@@ -0,0 +1,198 @@
+#include "pch.h"
+#include "Benchmark.h"
+#include "EffectCacheManager.h"
+#include "ShaderCompiler.h"
+#include "StrUtils.h"
+#include <filesystem>
+
+
+// 缓存写入临时文件夹中，不影响 Magpie 目录中的缓存
+static std::wstring GetCacheWorkDir() {
+	wchar_t tempPath[MAX_PATH];
+	GetTempPath((DWORD)std::size(tempPath), tempPath);
+	return StrUtils::ConcatW(tempPath, L"MagpieEffectBenchmark");
+}
+
+struct CachedEffect {
+	std::string name;
+	std::string hash;
+	EffectDesc desc;
+};
+
+// 读取所有效果并计算缓存的键，isCompile 为 true 时还会禁用缓存编译它们
+static bool LoadEffects(bool isCompile, std::vector<CachedEffect>& effects) {
+	std::vector<std::string> names = Benchmark::GetEffectNames();
+	if (names.empty()) {
+		fmt::print("没有找到效果\n");
+		return false;
+	}
+
+	effects.resize(names.size());
+	for (size_t i = 0; i < names.size(); ++i) {
+		std::string source;
+		if (!Benchmark::ReadEffectSource(names[i], source)) {
+			fmt::print("读取 {} 失败\n", names[i]);
+			return false;
+		}
+
+		effects[i].name = std::move(names[i]);
+		// 只需和读取时一致，不必和 EffectCompiler 计算的相同
+		effects[i].hash = EffectCacheManager::GetHash(source, ShaderCompiler::Get(0).GetId());
+	}
+
+	if (!isCompile) {
+		return true;
+	}
+
+	std::vector<std::string> effectNames;
+	for (const CachedEffect& effect : effects) {
+		effectNames.push_back(effect.name);
+	}
+
+	std::vector<EffectDesc> descs;
+	if (!Benchmark::CompileEffects(effectNames, descs)) {
+		return false;
+	}
+
+	for (size_t i = 0; i < effects.size(); ++i) {
+		effects[i].desc = std::move(descs[i]);
+	}
+
+	return true;
+}
+
+static UINT64 GetFileSize(const wchar_t* fileName) {
+	WIN32_FILE_ATTRIBUTE_DATA attrs{};
+	if (!GetFileAttributesEx(fileName, GetFileExInfoStandard, &attrs)) {
+		return 0;
+	}
+	return ((UINT64)attrs.nFileSizeHigh << 32) | attrs.nFileSizeLow;
+}
+
+// 读取所有缓存，返回读取第一个和全部的用时（秒）
+static bool LoadAll(const std::vector<CachedEffect>& effects, double& firstSeconds, double& totalSeconds) {
+	using clock = std::chrono::steady_clock;
+
+	auto start = clock::now();
+	for (size_t i = 0; i < effects.size(); ++i) {
+		EffectDesc desc;
+		if (!EffectCacheManager::Get().Load(effects[i].name, effects[i].hash, desc)) {
+			fmt::print("读取 {} 的缓存失败\n", effects[i].name);
+			return false;
+		}
+
+		if (i == 0) {
+			firstSeconds = std::chrono::duration<double>(clock::now() - start).count();
+		}
+	}
+	totalSeconds = std::chrono::duration<double>(clock::now() - start).count();
+
+	return true;
+}
+
+// 用法：cache [冷启动次数]
+// 1. 禁用缓存编译所有效果
+// 2. 在临时文件夹中保存所有缓存并等待写入磁盘
+// 3. 从内存缓存读取所有缓存
+// 4. 多次启动新进程从磁盘读取所有缓存，第一次读取包括打开包文件和索引
+int CacheBenchmark(const std::vector<std::wstring>& args) {
+	UINT coldRuns = args.empty() ? 5 : std::max((UINT)std::stoul(args[0]), 1u);
+
+	std::vector<CachedEffect> effects;
+	if (!LoadEffects(true, effects)) {
+		return 1;
+	}
+
+	UINT passCount = 0;
+	for (const CachedEffect& effect : effects) {
+		passCount += (UINT)effect.desc.passes.size();
+	}
+
+	wchar_t magpieDir[MAX_PATH];
+	GetCurrentDirectory((DWORD)std::size(magpieDir), magpieDir);
+
+	std::wstring workDir = GetCacheWorkDir();
+	std::error_code ec;
+	std::filesystem::remove_all(workDir, ec);
+	if (!CreateDirectory(workDir.c_str(), nullptr) || !SetCurrentDirectory(workDir.c_str())) {
+		fmt::print("创建临时文件夹失败\n");
+		return 1;
+	}
+
+	// 空闲时的重新压缩会和读取竞争
+	EffectCacheManager::Get().SetRecompressionEnabled(false);
+
+	fmt::print("{} 个效果，共 {} 个通道，缓存位于 {}\n\n", effects.size(), passCount, StrUtils::UTF16ToUTF8(workDir));
+
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (const CachedEffect& effect : effects) {
+			EffectCacheManager::Get().Save(effect.name, effect.hash, effect.desc);
+		}
+		double enqueueSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		EffectCacheManager::Get().Flush();
+		double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		fmt::print("保存：Save 返回 {:.2f} ms，写入磁盘 {:.2f} ms\n", enqueueSeconds * 1000, totalSeconds * 1000);
+		fmt::print("包文件 {:.1f} KB，索引 {:.1f} KB\n",
+			GetFileSize(L"cache\\effects.pack") / 1024.0, GetFileSize(L"cache\\effects.idx") / 1024.0);
+	}
+
+	{
+		double firstSeconds = 0;
+		double totalSeconds = 0;
+		if (!LoadAll(effects, firstSeconds, totalSeconds)) {
+			return 1;
+		}
+		fmt::print("读取（内存缓存）：全部 {:.3f} ms\n", totalSeconds * 1000);
+	}
+
+	// 在新进程中从磁盘读取
+	wchar_t exePath[MAX_PATH];
+	GetModuleFileName(NULL, exePath, (DWORD)std::size(exePath));
+	std::wstring cmdLine = fmt::format(L"\"{}\" cache-load \"{}\"", exePath, magpieDir);
+
+	for (UINT i = 0; i < coldRuns; ++i) {
+		STARTUPINFO si{};
+		si.cb = sizeof(si);
+		PROCESS_INFORMATION pi{};
+		if (!CreateProcess(exePath, cmdLine.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &si, &pi)) {
+			fmt::print("启动子进程失败\n");
+			return 1;
+		}
+
+		WaitForSingleObject(pi.hProcess, INFINITE);
+		DWORD exitCode = 1;
+		GetExitCodeProcess(pi.hProcess, &exitCode);
+		CloseHandle(pi.hThread);
+		CloseHandle(pi.hProcess);
+
+		if (exitCode != 0) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// 由 cache 在新进程中运行，从磁盘读取 cache 保存的所有缓存
+int CacheLoadBenchmark(const std::vector<std::wstring>&) {
+	std::vector<CachedEffect> effects;
+	if (!LoadEffects(false, effects)) {
+		return 1;
+	}
+
+	if (!SetCurrentDirectory(GetCacheWorkDir().c_str())) {
+		fmt::print("缓存不存在\n");
+		return 1;
+	}
+
+	double firstSeconds = 0;
+	double totalSeconds = 0;
+	if (!LoadAll(effects, firstSeconds, totalSeconds)) {
+		return 1;
+	}
+
+	fmt::print("读取（磁盘）：第一个 {:.2f} ms（包括打开包文件），全部 {:.2f} ms\n", firstSeconds * 1000, totalSeconds * 1000);
+	return 0;
+}
@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "Benchmark.h"
+#include "EffectCompiler.h"
+#include "TaskScheduler.h"
+#include "Config.h"
+#include "StrUtils.h"
+
+
+// 和 Config.cpp 中的 FlagMasks::DisableEffectCache 相同。禁用缓存使每次都完整编译
+static constexpr UINT FLAG_DISABLE_EFFECT_CACHE = 0x400;
+
+enum class CompileMode {
+	// 降低线程优先级，CompilePasses 在当前线程依次编译通道，和预编译相同
+	Serial,
+	// 依次编译效果，每个效果的通道并行编译，和 Run 相同
+	ParallelPasses,
+	// 效果和通道都并行编译，ParallelFor 嵌套调用
+	ParallelEffects
+};
+
+// 返回编译失败的效果数
+static UINT CompileAll(const std::vector<std::string>& names, CompileMode mode, const Config& config) {
+	static const std::map<std::string, std::variant<float, int>> inlineParams;
+
+	std::atomic<UINT> failedCount = 0;
+	auto compileEffect = [&](UINT id) {
+		EffectDesc desc;
+		if (EffectCompiler::Compile(names[id], 0, inlineParams, desc, config)) {
+			failedCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	};
+
+	if (mode == CompileMode::ParallelEffects) {
+		TaskScheduler::Get().ParallelFor((UINT)names.size(), compileEffect);
+	} else {
+		HANDLE hThread = GetCurrentThread();
+		int priority = GetThreadPriority(hThread);
+		if (mode == CompileMode::Serial) {
+			SetThreadPriority(hThread, THREAD_PRIORITY_BELOW_NORMAL);
+		}
+
+		for (UINT i = 0; i < (UINT)names.size(); ++i) {
+			compileEffect(i);
+		}
+
+		SetThreadPriority(hThread, priority);
+	}
+
+	return failedCount;
+}
+
+// 用法：compile [效果名...]
+// 禁用缓存，测量用 FXC 编译所有效果的吞吐量。编译较慢，每种方式只在预热后计时一次
+int CompileThroughputBenchmark(const std::vector<std::wstring>& args) {
+	std::vector<std::string> names;
+	if (args.empty()) {
+		names = Benchmark::GetEffectNames();
+	} else {
+		for (const std::wstring& arg : args) {
+			names.push_back(StrUtils::UTF16ToUTF8(arg));
+		}
+	}
+
+	if (names.empty()) {
+		fmt::print("没有找到效果\n");
+		return 1;
+	}
+
+	Config config;
+	config.InitializeFlags(FLAG_DISABLE_EFFECT_CACHE);
+
+	// 统计通道数
+	UINT passCount = 0;
+	for (const std::string& name : names) {
+		std::string source;
+		EffectDesc desc;
+		if (!Benchmark::ReadEffectSource(name, source) || EffectCompiler::Parse(source, desc)) {
+			fmt::print("解析 {} 失败\n", name);
+			return 1;
+		}
+		passCount += (UINT)desc.passes.size();
+	}
+
+	fmt::print("{} 个效果，共 {} 个通道，{} 个工作线程\n\n", names.size(), passCount, TaskScheduler::Get().GetWorkerCount());
+	fmt::print("{:<20}{:>10}{:>12}{:>12}\n", "", "用时 s", "效果/s", "通道/s");
+
+	auto printRow = [&](const char* name, CompileMode mode) {
+		UINT failedCount = 0;
+		double seconds = Benchmark::Measure([&]() {
+			failedCount = CompileAll(names, mode, config);
+		}, 1, 0);
+
+		fmt::print("{:<20}{:>10.2f}{:>12.2f}{:>12.2f}", name, seconds, names.size() / seconds, passCount / seconds);
+		if (failedCount > 0) {
+			fmt::print("（{} 个效果编译失败，见 benchmark.log）", failedCount);
+		}
+		fmt::print("\n");
+	};
+	printRow("串行", CompileMode::Serial);
+	printRow("通道并行", CompileMode::ParallelPasses);
+	printRow("效果和通道并行", CompileMode::ParallelEffects);
+
+	return 0;
+}
@@ -0,0 +1,743 @@
+#include "pch.h"
+#include "Benchmark.h"
+
+// 需要访问编译器内部的函数，因此直接包含源文件，项目中不再单独编译它
+#include "EffectCompiler.cpp"
+
+
+// 一组效果的源码，已删除注释的副本用于只测量部分前端的基准
+struct EffectSet {
+	std::string name;
+	std::vector<std::string> sources;
+	std::vector<std::string> preparedSources;
+	size_t totalSize = 0;
+};
+
+static bool LoadEffectSet(std::string_view name, const std::vector<std::string>& effectNames, EffectSet& result) {
+	result.name = name;
+
+	for (const std::string& effectName : effectNames) {
+		std::string& source = result.sources.emplace_back();
+		if (!Benchmark::ReadEffectSource(effectName, source)) {
+			fmt::print("读取 {} 失败\n", effectName);
+			return false;
+		}
+		result.totalSize += source.size();
+
+		std::string& prepared = result.preparedSources.emplace_back(source);
+		if (PrepareSource(prepared)) {
+			fmt::print("{} 删除注释失败\n", effectName);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// 默认测量 ACNet、Anime4K_Upscale_UL 和所有效果，也可以在参数中指定效果
+static bool LoadEffectSets(const std::vector<std::wstring>& args, std::vector<EffectSet>& result) {
+	std::vector<std::string> allNames = Benchmark::GetEffectNames();
+	if (allNames.empty()) {
+		fmt::print("没有找到效果\n");
+		return false;
+	}
+
+	std::vector<std::string> names;
+	if (args.empty()) {
+		names = { "ACNet", "Anime4K_Upscale_UL" };
+	} else {
+		for (const std::wstring& arg : args) {
+			names.push_back(StrUtils::UTF16ToUTF8(arg));
+		}
+	}
+
+	for (const std::string& name : names) {
+		if (!LoadEffectSet(name, { name }, result.emplace_back())) {
+			return false;
+		}
+	}
+
+	if (args.empty()) {
+		return LoadEffectSet(fmt::format("全部 {} 个效果", allNames.size()), allNames, result.emplace_back());
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// parse：编译器前端
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// 改为查表前识别 MagpieFX 关键字的方式：每个词元转为大写的 std::string 后依次比较
+static constexpr std::string_view LEGACY_KEYWORDS[] = {
+	"MAGPIE", "EFFECT", "VERSION", "OUTPUT_WIDTH", "OUTPUT_HEIGHT", "USE_DYNAMIC", "PARAMETER",
+	"DEFAULT", "LABEL", "MIN", "MAX", "TEXTURE", "SOURCE", "FORMAT", "WIDTH", "HEIGHT", "SAMPLER",
+	"FILTER", "ADDRESS", "COMMON", "PASS", "IN", "OUT", "BLOCK_SIZE", "NUM_THREADS", "STYLE", "DESC",
+	"LINEAR", "POINT", "CLAMP", "WRAP"
+};
+
+static UINT LegacyMatchKeyword(std::string_view token) {
+	std::string t = StrUtils::ToUpperCase(token);
+	for (UINT i = 0; i < (UINT)std::size(LEGACY_KEYWORDS); ++i) {
+		if (t == LEGACY_KEYWORDS[i]) {
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+// 改动前的分块方式：逐字节前进以找到行首，并识别每个选项的关键字。返回识别出的关键字数
+static UINT LegacyScanDirectives(std::string_view source) {
+	UINT count = 0;
+
+	bool newLine = true;
+	std::string_view t = source;
+	while (t.size() > 5) {
+		if (newLine) {
+			if (CheckNextToken<true>(t, META_INDICATOR)) {
+				std::string_view token;
+				if (GetNextToken<false>(t, token) == 0 && LegacyMatchKeyword(token)) {
+					++count;
+				}
+			}
+
+			if (t.size() <= 5) {
+				break;
+			}
+		} else {
+			t.remove_prefix(1);
+		}
+
+		newLine = t[0] == '\n';
+	}
+
+	return count;
+}
+
+// 当前的方式：用 find 跳到下一行，关键字查表匹配
+static UINT ScanDirectives(std::string_view source) {
+	UINT count = 0;
+
+	size_t lineStart = 0;
+	while (lineStart != std::string_view::npos && source.size() - lineStart > 5) {
+		std::string_view t = source.substr(lineStart);
+		if (CheckNextToken<true>(t, META_INDICATOR)) {
+			std::string_view token;
+			if (GetNextToken<false>(t, token) == 0 && GetMetaKeyword(token) != MetaKeyword::Unknown) {
+				++count;
+			}
+		}
+
+		lineStart = source.find('\n', t.data() - source.data());
+	}
+
+	return count;
+}
+
+// 用法：parse [效果名...]
+// “前端”为 EffectCompiler::Parse，包括删除注释、分块和解析所有选项，按原始源码的大小计算吞吐量。
+// “选项扫描”只包括找到每个 MagpieFX 选项并识别其关键字，对比改为查表前后的实现
+int ParseBenchmark(const std::vector<std::wstring>& args) {
+	std::vector<EffectSet> sets;
+	if (!LoadEffectSets(args, sets)) {
+		return 1;
+	}
+
+	fmt::print("{:<24}{:>10}{:>14}{:>18}{:>18}\n", "", "KB", "前端 MB/s", "选项扫描(旧) MB/s", "选项扫描(新) MB/s");
+
+	for (const EffectSet& set : sets) {
+		bool success = true;
+		double frontEnd = Benchmark::Measure([&]() {
+			for (const std::string& source : set.sources) {
+				std::string copy = source;
+				EffectDesc desc;
+				if (EffectCompiler::Parse(copy, desc)) {
+					success = false;
+				}
+			}
+		});
+		if (!success) {
+			fmt::print("{} 解析失败\n", set.name);
+			return 1;
+		}
+
+		UINT legacyCount = 0;
+		double legacy = Benchmark::Measure([&]() {
+			legacyCount = 0;
+			for (const std::string& source : set.preparedSources) {
+				legacyCount += LegacyScanDirectives(source);
+			}
+		});
+
+		UINT count = 0;
+		double current = Benchmark::Measure([&]() {
+			count = 0;
+			for (const std::string& source : set.preparedSources) {
+				count += ScanDirectives(source);
+			}
+		});
+
+		if (legacyCount != count) {
+			fmt::print("{}：两种实现识别出的关键字数不同（{} 和 {}）\n", set.name, legacyCount, count);
+			return 1;
+		}
+
+		double mb = Benchmark::ToMB(set.totalSize);
+		fmt::print("{:<24}{:>10.1f}{:>14.1f}{:>18.1f}{:>18.1f}\n",
+			set.name, set.totalSize / 1024.0, mb / frontEnd, mb / legacy, mb / current);
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// codegen：为所有通道生成 HLSL
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct ParsedEffect {
+	std::string source;
+	EffectDesc desc;
+	std::vector<std::string_view> commonBlocks;
+	std::vector<std::string_view> passBlocks;
+};
+
+// isPreambleShared 为 false 时每个通道各自生成前导代码，即改动前的方式。返回生成的源码的总大小
+static size_t GenerateAllPasses(const std::vector<ParsedEffect>& effects, bool isPreambleShared) {
+	static const std::map<std::string, std::variant<float, int>> inlineParams;
+
+	size_t totalSize = 0;
+	for (const ParsedEffect& effect : effects) {
+		EffectPreamble sharedPreamble;
+		if (isPreambleShared) {
+			GeneratePreamble(effect.desc, effect.commonBlocks, inlineParams, sharedPreamble);
+		}
+
+		for (UINT i = 0; i < (UINT)effect.passBlocks.size(); ++i) {
+			EffectPreamble passPreamble;
+			if (!isPreambleShared) {
+				GeneratePreamble(effect.desc, effect.commonBlocks, inlineParams, passPreamble);
+			}
+
+			std::string source;
+			PassMacros passMacros;
+			GeneratePassSource(effect.desc, i + 1, isPreambleShared ? sharedPreamble : passPreamble,
+				effect.passBlocks[i], {}, source, passMacros);
+			totalSize += source.size();
+		}
+	}
+
+	return totalSize;
+}
+
+// 用法：codegen [效果名...]
+// 只测量代码生成，解析在计时之外完成。所有效果按最后一个效果（EFFECT_FLAG_LAST_EFFECT）生成，
+// 这样会包含输出到交换链所需的额外代码
+int CodegenBenchmark(const std::vector<std::wstring>& args) {
+	std::vector<std::string> names;
+	if (args.empty()) {
+		names = Benchmark::GetEffectNames();
+	} else {
+		for (const std::wstring& arg : args) {
+			names.push_back(StrUtils::UTF16ToUTF8(arg));
+		}
+	}
+
+	std::vector<ParsedEffect> effects;
+	// 块引用 source，不能重新分配
+	effects.reserve(names.size());
+	size_t passCount = 0;
+	for (const std::string& name : names) {
+		ParsedEffect& effect = effects.emplace_back();
+		if (!Benchmark::ReadEffectSource(name, effect.source) || PrepareSource(effect.source)) {
+			fmt::print("读取 {} 失败\n", name);
+			return 1;
+		}
+
+		effect.desc.name = name;
+		effect.desc.flags = EFFECT_FLAG_LAST_EFFECT;
+		if (ParseEffect(effect.source, effect.desc, effect.commonBlocks, effect.passBlocks, nullptr)) {
+			fmt::print("解析 {} 失败\n", name);
+			return 1;
+		}
+		passCount += effect.passBlocks.size();
+	}
+
+	fmt::print("{} 个效果，共 {} 个通道\n\n", effects.size(), passCount);
+	fmt::print("{:<28}{:>12}{:>12}{:>14}{:>14}\n", "", "用时 ms", "分配次数", "每通道分配", "生成 KB");
+
+	auto printRow = [&](const char* name, bool isPreambleShared) {
+		size_t allocCount = Benchmark::GetAllocCount();
+		size_t totalSize = GenerateAllPasses(effects, isPreambleShared);
+		allocCount = Benchmark::GetAllocCount() - allocCount;
+
+		double seconds = Benchmark::Measure([&]() {
+			GenerateAllPasses(effects, isPreambleShared);
+		});
+
+		fmt::print("{:<28}{:>12.2f}{:>12}{:>14.1f}{:>14.1f}\n", name, seconds * 1000,
+			allocCount, (double)allocCount / passCount, totalSize / 1024.0);
+	};
+	printRow("每个效果生成一次前导代码", true);
+	printRow("每个通道生成前导代码（改动前）", false);
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// canon：检查规范化源码
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// 只改变格式的修改：每行添加缩进和行尾空白，换行符改为 CRLF 并插入空行，逗号和左括号两侧添加空格
+// 预处理指令和 MagpieFX 选项中的空白可能有意义，不添加空格。以 \ 结尾的行后插入空行会截断宏
+static std::string ReformatSource(std::string_view source) {
+	std::string result;
+	result.reserve(source.size() * 2);
+
+	while (!source.empty()) {
+		size_t pos = source.find('\n');
+		std::string_view line = source.substr(0, pos);
+		source.remove_prefix(pos == std::string_view::npos ? source.size() : pos + 1);
+
+		std::string_view trimmed = line;
+		StrUtils::Trim(trimmed);
+		const bool isCode = !trimmed.starts_with(META_INDICATOR) && !trimmed.starts_with('#');
+
+		result.append("\t ");
+		for (char c : line) {
+			if (isCode && (c == ',' || c == '(')) {
+				result.push_back(' ');
+				result.push_back(c);
+				result.push_back(' ');
+			} else {
+				result.push_back(c);
+			}
+		}
+		result.append(trimmed.ends_with('\\') ? "\n" : "  \r\n\r\n");
+	}
+
+	return result;
+}
+
+// 删除所有行首的空白
+static std::string UnindentSource(std::string_view source) {
+	std::string result;
+	result.reserve(source.size());
+
+	bool isLineStart = true;
+	for (char c : source) {
+		if (isLineStart && (c == ' ' || c == '\t')) {
+			continue;
+		}
+		isLineStart = c == '\n';
+		result.push_back(c);
+	}
+
+	return result;
+}
+
+struct CanonicalizeCase {
+	const char* left;
+	const char* right;
+	// 两者的规范化源码是否应相同
+	bool isEqual;
+};
+
+static constexpr CanonicalizeCase CANONICALIZE_CASES[] = {
+	// 块首行之后的选项顺序无关
+	{ "//!MAGPIE EFFECT\n//!VERSION 2\n//!OUTPUT_WIDTH 2\n", "//!MAGPIE EFFECT\n//!OUTPUT_WIDTH 2\n//!VERSION 2\n", true },
+	// PASS 块按序号排列
+	{ "//!PASS 2\nb\n//!PASS 1\na\n", "//!PASS 1\na\n//!PASS 2\nb\n", true },
+	// COMMON 块的顺序决定了代码的顺序
+	{ "//!COMMON\nx\n//!COMMON\ny\n", "//!COMMON\ny\n//!COMMON\nx\n", false },
+	// 宏名和括号间的空白区分对象宏和函数宏
+	{ "#define A (x)\n", "#define A(x)\n", false },
+	{ "#define A(x) f (x) + \\\n  g(x)\n", "#define A(x) f(x)+\\\ng(x)\n", true },
+	// 续行后的空行结束宏定义
+	{ "#define A \\\n\nB\n", "#define A \\\nB\n", false },
+	{ "a - -b;\n", "a--b;\n", false },
+	{ "int a;\nint b;\n", "int a; int b;\n", true },
+	// 行尾的 //! 注释之后的代码不能合并到同一行
+	{ "x; //! y\nz;\n", "x; //! y z;\n", false },
+	// 选项的值原样保留
+	{ "//!LABEL a  b\n", "//!LABEL a b\n", false },
+	{ "float2 a = float2(1 .5, 2);\n", "float2 a = float2(1.5, 2);\n", false },
+};
+
+// 用法：canon
+// 检查所有效果的规范化源码：规范化是幂等的，且只改变格式的修改不改变结果；
+// 然后检查一组改变语义的修改会改变结果。最后测量规范化的吞吐量。有失败时返回 1
+int CanonicalizeBenchmark(const std::vector<std::wstring>&) {
+	std::vector<std::string> names = Benchmark::GetEffectNames();
+	if (names.empty()) {
+		fmt::print("没有找到效果\n");
+		return 1;
+	}
+
+	UINT failedCount = 0;
+	std::vector<std::string> sources;
+	size_t totalSize = 0;
+
+	for (const std::string& name : names) {
+		std::string& source = sources.emplace_back();
+		if (!Benchmark::ReadEffectSource(name, source) || PrepareSource(source)) {
+			fmt::print("读取 {} 失败\n", name);
+			return 1;
+		}
+		totalSize += source.size();
+
+		const std::string canonical = CanonicalizeSource(source);
+		if (CanonicalizeSource(canonical) != canonical) {
+			fmt::print("{}：再次规范化的结果不同\n", name);
+			++failedCount;
+		}
+		if (CanonicalizeSource(ReformatSource(source)) != canonical) {
+			fmt::print("{}：添加空白和空行后的结果不同\n", name);
+			++failedCount;
+		}
+		if (CanonicalizeSource(UnindentSource(source)) != canonical) {
+			fmt::print("{}：删除缩进后的结果不同\n", name);
+			++failedCount;
+		}
+	}
+
+	for (const CanonicalizeCase& c : CANONICALIZE_CASES) {
+		if ((CanonicalizeSource(c.left) == CanonicalizeSource(c.right)) != c.isEqual) {
+			fmt::print("规范化后应{}：\n{}\n和\n{}\n", c.isEqual ? "相同" : "不同", c.left, c.right);
+			++failedCount;
+		}
+	}
+
+	fmt::print("{} 个效果，{} 个用例，{} 项失败\n", names.size(), std::size(CANONICALIZE_CASES), failedCount);
+	if (failedCount > 0) {
+		return 1;
+	}
+
+	double seconds = Benchmark::Measure([&]() {
+		for (const std::string& source : sources) {
+			CanonicalizeSource(source);
+		}
+	});
+	fmt::print("规范化：{:.1f} MB/s\n", Benchmark::ToMB(totalSize) / seconds);
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// validate：用指定的后端编译所有效果
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// 和 Config.cpp 中的 FlagMasks::DisableEffectCache 相同
+static constexpr UINT FLAG_DISABLE_EFFECT_CACHE = 0x400;
+
+// 绕过缓存直接编译所有通道，不会因效果未使用 MF 类型而忽略 EFFECT_FLAG_FP16
+static bool CompileEffectWith(const ShaderCompiler& compiler, const std::string& name, UINT flags, const Config& config, EffectDesc& desc) {
+	static const std::map<std::string, std::variant<float, int>> inlineParams;
+
+	std::string source;
+	if (!Benchmark::ReadEffectSource(name, source) || PrepareSource(source)) {
+		return false;
+	}
+
+	desc = {};
+	desc.name = name;
+	desc.flags = flags;
+
+	std::vector<std::string_view> commonBlocks;
+	std::vector<std::string_view> passBlocks;
+	if (ParseEffect(source, desc, commonBlocks, passBlocks, nullptr)) {
+		return false;
+	}
+
+	return !CompilePasses(desc, commonBlocks, passBlocks, inlineParams, {}, compiler, config);
+}
+
+// 用法：validate [fxc|dxc] [效果名...]
+// 用指定的后端（默认为 DXC）编译所有效果的所有通道，分别作为中间的效果和最后一个效果编译，
+// 两者生成的代码不同。有效果编译失败时返回 1，错误信息见 benchmark.log
+int ValidateBenchmark(const std::vector<std::wstring>& args) {
+	auto it = args.begin();
+
+	const ShaderCompiler* compiler = nullptr;
+	if (it != args.end() && *it == L"fxc") {
+		compiler = &ShaderCompiler::Get(0);
+		++it;
+	} else {
+		if (it != args.end() && *it == L"dxc") {
+			++it;
+		}
+
+		compiler = ShaderCompiler::GetDxc();
+		if (!compiler) {
+			fmt::print("无法加载 dxcompiler.dll\n");
+			return 1;
+		}
+	}
+
+	std::vector<std::string> names;
+	if (it == args.end()) {
+		names = Benchmark::GetEffectNames();
+	} else {
+		for (; it != args.end(); ++it) {
+			names.push_back(StrUtils::UTF16ToUTF8(*it));
+		}
+	}
+
+	if (names.empty()) {
+		fmt::print("没有找到效果\n");
+		return 1;
+	}
+
+	Config config;
+	config.InitializeFlags(FLAG_DISABLE_EFFECT_CACHE);
+
+	fmt::print("后端：{}\n", compiler->GetId());
+
+	UINT passCount = 0;
+	UINT failedCount = 0;
+	auto start = std::chrono::steady_clock::now();
+
+	for (const std::string& name : names) {
+		for (UINT flags : { 0u, (UINT)EFFECT_FLAG_LAST_EFFECT }) {
+			EffectDesc desc;
+			if (CompileEffectWith(*compiler, name, flags, config, desc)) {
+				passCount += (UINT)desc.passes.size();
+			} else {
+				fmt::print("{}{}：编译失败\n", name, flags ? "（最后一个效果）" : "");
+				++failedCount;
+			}
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	fmt::print("{} 个效果，编译 {} 个通道，{} 项失败，用时 {:.1f} s\n", names.size(), passCount, failedCount, seconds);
+	if (failedCount > 0) {
+		fmt::print("错误信息见 benchmark.log\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// fp16：比较 EFFECT_FLAG_FP16 开启前后的字节码
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool IsBytecodeEqual(const EffectDesc& l, const EffectDesc& r) noexcept {
+	if (l.passes.size() != r.passes.size()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < l.passes.size(); ++i) {
+		ID3DBlob* lBlob = l.passes[i].cso.get();
+		ID3DBlob* rBlob = r.passes[i].cso.get();
+		if (lBlob->GetBufferSize() != rBlob->GetBufferSize()
+			|| std::memcmp(lBlob->GetBufferPointer(), rBlob->GetBufferPointer(), lBlob->GetBufferSize()) != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// 用法：fp16 [效果名...]
+// 分别以 FP32 和 FP16 编译所有效果，比较字节码和编译用时。Compile 对未使用 MF 类型的效果忽略 FP16 标志，
+// 这里绕过该判断，检查这些效果在两种模式下的字节码确实相同。不同时返回 1
+int FP16Benchmark(const std::vector<std::wstring>& args) {
+	std::vector<std::string> names;
+	if (args.empty()) {
+		names = Benchmark::GetEffectNames();
+	} else {
+		for (const std::wstring& arg : args) {
+			names.push_back(StrUtils::UTF16ToUTF8(arg));
+		}
+	}
+
+	if (names.empty()) {
+		fmt::print("没有找到效果\n");
+		return 1;
+	}
+
+	Config config;
+	config.InitializeFlags(FLAG_DISABLE_EFFECT_CACHE);
+	const ShaderCompiler& compiler = ShaderCompiler::Get(0);
+
+	fmt::print("{:<36}{:>8}{:>12}{:>12}{:>14}\n", "", "使用 MF", "FP32 ms", "FP16 ms", "字节码");
+
+	UINT sensitiveCount = 0;
+	UINT changedCount = 0;
+	UINT failedCount = 0;
+	double totalSeconds[2]{};
+
+	for (const std::string& name : names) {
+		std::string source;
+		if (!Benchmark::ReadEffectSource(name, source) || PrepareSource(source)) {
+			fmt::print("读取 {} 失败\n", name);
+			return 1;
+		}
+		const bool isSensitive = IsFP16Sensitive(source);
+		sensitiveCount += isSensitive;
+
+		EffectDesc descs[2];
+		double seconds[2]{};
+		bool success = true;
+		for (UINT i = 0; i < 2; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			success = CompileEffectWith(compiler, name, i == 0 ? 0 : EFFECT_FLAG_FP16, config, descs[i]);
+			seconds[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			totalSeconds[i] += seconds[i];
+
+			if (!success) {
+				break;
+			}
+		}
+
+		if (!success) {
+			fmt::print("{:<36}编译失败\n", name);
+			++failedCount;
+			continue;
+		}
+
+		const bool isEqual = IsBytecodeEqual(descs[0], descs[1]);
+		changedCount += !isEqual;
+
+		const char* result = isEqual ? "相同" : "不同";
+		if (!isSensitive && !isEqual) {
+			// Compile 会错误地共享这两种字节码
+			result = "不同（错误）";
+			++failedCount;
+		}
+
+		fmt::print("{:<36}{:>8}{:>12.1f}{:>12.1f}{:>14}\n",
+			name, isSensitive ? "是" : "否", seconds[0] * 1000, seconds[1] * 1000, result);
+	}
+
+	fmt::print("\n{} 个效果，{} 个使用 MF 类型，{} 个的字节码在 FP16 下不同，{} 项失败\n",
+		names.size(), sensitiveCount, changedCount, failedCount);
+	fmt::print("总用时：FP32 {:.2f} s，FP16 {:.2f} s\n", totalSeconds[0], totalSeconds[1]);
+
+	return failedCount > 0 ? 1 : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// compare：比较两个效果编译的结果
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// 和 EffectCacheManager.cpp 中的相同
+static constexpr int CACHE_COMPRESSION_LEVEL = 1;
+
+struct PassStats {
+	size_t bytecodeSize = 0;
+	// 以缓存的方式压缩后的大小
+	size_t compressedSize = 0;
+	UINT instructionCount = 0;
+};
+
+static bool GetPassStats(const EffectPassDesc& pass, PassStats& stats) {
+	std::span<const BYTE> bytecode((const BYTE*)pass.cso->GetBufferPointer(), pass.cso->GetBufferSize());
+	stats.bytecodeSize = bytecode.size();
+
+	std::vector<BYTE> compressed;
+	if (!Utils::ZstdCompress(bytecode, compressed, CACHE_COMPRESSION_LEVEL)) {
+		return false;
+	}
+	stats.compressedSize = compressed.size();
+
+	winrt::com_ptr<ID3D11ShaderReflection> reflection;
+	HRESULT hr = D3DReflect(bytecode.data(), bytecode.size(), IID_PPV_ARGS(reflection.put()));
+	if (FAILED(hr)) {
+		return false;
+	}
+
+	D3D11_SHADER_DESC shaderDesc{};
+	reflection->GetDesc(&shaderDesc);
+	stats.instructionCount = shaderDesc.InstructionCount;
+	return true;
+}
+
+// 用法：compare <效果名> <效果名>
+// 禁用缓存用 FXC 编译两个效果，报告源码大小、编译用时，以及每个通道的字节码大小、压缩后的大小和指令数。
+// 用于评估源码转换，如 WeightPacker 转换前后的 Anime4K_Upscale_UL 和 Anime4K_Upscale_UL_Packed
+int CompareBenchmark(const std::vector<std::wstring>& args) {
+	if (args.size() != 2) {
+		fmt::print("用法：compare <效果名> <效果名>\n");
+		return 1;
+	}
+
+	const std::string names[2] = { StrUtils::UTF16ToUTF8(args[0]), StrUtils::UTF16ToUTF8(args[1]) };
+
+	Config config;
+	config.InitializeFlags(FLAG_DISABLE_EFFECT_CACHE);
+	const ShaderCompiler& compiler = ShaderCompiler::Get(0);
+
+	size_t sourceSizes[2]{};
+	double seconds[2]{};
+	std::vector<PassStats> stats[2];
+	for (UINT i = 0; i < 2; ++i) {
+		std::string source;
+		if (!Benchmark::ReadEffectSource(names[i], source)) {
+			fmt::print("读取 {} 失败\n", names[i]);
+			return 1;
+		}
+		sourceSizes[i] = source.size();
+
+		EffectDesc desc;
+		bool success = true;
+		seconds[i] = Benchmark::Measure([&]() {
+			success = CompileEffectWith(compiler, names[i], 0, config, desc);
+		}, 1, 0);
+		if (!success) {
+			fmt::print("编译 {} 失败，见 benchmark.log\n", names[i]);
+			return 1;
+		}
+
+		for (const EffectPassDesc& pass : desc.passes) {
+			if (!GetPassStats(pass, stats[i].emplace_back())) {
+				fmt::print("分析 {} 的字节码失败\n", names[i]);
+				return 1;
+			}
+		}
+	}
+
+	fmt::print("A：{}\nB：{}\n\n", names[0], names[1]);
+	fmt::print("源码：A {:.1f} KB，B {:.1f} KB\n", sourceSizes[0] / 1024.0, sourceSizes[1] / 1024.0);
+	fmt::print("编译用时：A {:.2f} s，B {:.2f} s\n\n", seconds[0], seconds[1]);
+
+	fmt::print("{:<8}{:>14}{:>14}{:>14}{:>14}{:>12}{:>12}\n",
+		"通道", "A 字节码 KB", "B 字节码 KB", "A 压缩后 KB", "B 压缩后 KB", "A 指令数", "B 指令数");
+
+	// 通道数不同时缺少的一方以 0 计
+	const size_t passCount = std::max(stats[0].size(), stats[1].size());
+	stats[0].resize(passCount);
+	stats[1].resize(passCount);
+
+	PassStats totals[2];
+	auto printRow = [](std::string_view name, const PassStats& a, const PassStats& b) {
+		fmt::print("{:<8}{:>14.1f}{:>14.1f}{:>14.1f}{:>14.1f}{:>12}{:>12}\n", name,
+			a.bytecodeSize / 1024.0, b.bytecodeSize / 1024.0,
+			a.compressedSize / 1024.0, b.compressedSize / 1024.0,
+			a.instructionCount, b.instructionCount);
+	};
+	for (size_t i = 0; i < passCount; ++i) {
+		printRow(fmt::format("{}", i + 1), stats[0][i], stats[1][i]);
+
+		for (UINT j = 0; j < 2; ++j) {
+			totals[j].bytecodeSize += stats[j][i].bytecodeSize;
+			totals[j].compressedSize += stats[j][i].compressedSize;
+			totals[j].instructionCount += stats[j][i].instructionCount;
+		}
+	}
+	printRow("总计", totals[0], totals[1]);
+
+	return 0;
+}
@@ -0,0 +1,197 @@
+#include "pch.h"
+#include "Benchmark.h"
+#include "Utils.h"
+#include "StrUtils.h"
+#include <zstd.h>
+#include <zdict.h>
+
+
+// 和 EffectCacheManager.cpp 中的相同
+static constexpr int CACHE_COMPRESSION_LEVEL = 1;
+static constexpr int CACHE_RECOMPRESSION_LEVEL = 19;
+static constexpr size_t DICT_MAX_SIZE = 64 * 1024;
+static constexpr size_t DICT_MAX_SAMPLES_SIZE = 16 * 1024 * 1024;
+
+struct CompressionMode {
+	const char* name;
+	int level;
+	bool useDict;
+};
+
+static constexpr CompressionMode MODES[] = {
+	{ "等级 1", CACHE_COMPRESSION_LEVEL, false },
+	{ "等级 19", CACHE_RECOMPRESSION_LEVEL, false },
+	{ "等级 1+字典", CACHE_COMPRESSION_LEVEL, true },
+	{ "等级 19+字典", CACHE_RECOMPRESSION_LEVEL, true },
+};
+
+static std::span<const BYTE> GetBytecode(const EffectPassDesc& pass) noexcept {
+	return std::span((const BYTE*)pass.cso->GetBufferPointer(), pass.cso->GetBufferSize());
+}
+
+// 和 EffectCacheManager::_TrainDict 相同的方式从所有字节码训练字典
+static bool TrainDict(const std::vector<EffectDesc>& descs, std::vector<BYTE>& dictData) {
+	std::vector<BYTE> samples;
+	std::vector<size_t> sampleSizes;
+	for (const EffectDesc& desc : descs) {
+		for (const EffectPassDesc& pass : desc.passes) {
+			std::span<const BYTE> bytecode = GetBytecode(pass);
+			if (samples.size() + bytecode.size() > DICT_MAX_SAMPLES_SIZE) {
+				continue;
+			}
+
+			samples.insert(samples.end(), bytecode.begin(), bytecode.end());
+			sampleSizes.push_back(bytecode.size());
+		}
+	}
+
+	dictData.resize(DICT_MAX_SIZE);
+	size_t dictSize = ZDICT_trainFromBuffer(dictData.data(), dictData.size(),
+		samples.data(), sampleSizes.data(), (unsigned)sampleSizes.size());
+	if (ZDICT_isError(dictSize)) {
+		fmt::print("训练字典失败：{}\n", ZDICT_getErrorName(dictSize));
+		return false;
+	}
+
+	dictData.resize(dictSize);
+	return true;
+}
+
+// 一个效果的所有通道以一种方式压缩后的结果
+struct CompressedEffect {
+	std::vector<std::vector<BYTE>> blobs;
+	size_t size = 0;
+};
+
+// 用法：compress [效果名...]
+// 缓存中字节码占绝大部分，且按通道单独压缩，这里以同样的方式压缩每个通道的字节码。
+// 字典从所有效果的字节码训练，和运行时从缓存训练相同。默认报告所有效果
+int CompressionBenchmark(const std::vector<std::wstring>& args) {
+	std::vector<std::string> allNames = Benchmark::GetEffectNames();
+	if (allNames.empty()) {
+		fmt::print("没有找到效果\n");
+		return 1;
+	}
+
+	std::vector<EffectDesc> descs;
+	if (!Benchmark::CompileEffects(allNames, descs)) {
+		return 1;
+	}
+
+	std::vector<BYTE> dictData;
+	if (!TrainDict(descs, dictData)) {
+		return 1;
+	}
+
+	struct DictDeleter {
+		void operator()(ZSTD_CDict* p) const noexcept { ZSTD_freeCDict(p); }
+		void operator()(ZSTD_DDict* p) const noexcept { ZSTD_freeDDict(p); }
+	};
+	std::unique_ptr<ZSTD_CDict, DictDeleter> cdicts[] = {
+		std::unique_ptr<ZSTD_CDict, DictDeleter>(ZSTD_createCDict(dictData.data(), dictData.size(), CACHE_COMPRESSION_LEVEL)),
+		std::unique_ptr<ZSTD_CDict, DictDeleter>(ZSTD_createCDict(dictData.data(), dictData.size(), CACHE_RECOMPRESSION_LEVEL))
+	};
+	std::unique_ptr<ZSTD_DDict, DictDeleter> ddict(ZSTD_createDDict(dictData.data(), dictData.size()));
+	if (!cdicts[0] || !cdicts[1] || !ddict) {
+		fmt::print("创建字典失败\n");
+		return 1;
+	}
+
+	// 要报告的效果在 allNames 中的序号
+	std::vector<size_t> ids;
+	if (args.empty()) {
+		for (size_t i = 0; i < allNames.size(); ++i) {
+			ids.push_back(i);
+		}
+	} else {
+		for (const std::wstring& arg : args) {
+			std::string name = StrUtils::UTF16ToUTF8(arg);
+			auto it = std::find(allNames.begin(), allNames.end(), name);
+			if (it == allNames.end()) {
+				fmt::print("没有找到 {}\n", name);
+				return 1;
+			}
+			ids.push_back(it - allNames.begin());
+		}
+	}
+
+	fmt::print("字典 {:.1f} KB，从 {} 个效果的字节码训练\n\n", dictData.size() / 1024.0, allNames.size());
+
+	fmt::print("{:<36}{:>8}{:>10}", "", "通道", "原始 KB");
+	for (const CompressionMode& mode : MODES) {
+		fmt::print("{:>16}", fmt::format("{} KB", mode.name));
+	}
+	for (const CompressionMode& mode : MODES) {
+		fmt::print("{:>20}", fmt::format("{} 解压 MB/s", mode.name));
+	}
+	fmt::print("\n");
+
+	size_t totalRawSize = 0;
+	size_t totalSizes[std::size(MODES)]{};
+	double totalSeconds[std::size(MODES)]{};
+
+	for (size_t id : ids) {
+		const EffectDesc& desc = descs[id];
+
+		size_t rawSize = 0;
+		for (const EffectPassDesc& pass : desc.passes) {
+			rawSize += pass.cso->GetBufferSize();
+		}
+		totalRawSize += rawSize;
+
+		fmt::print("{:<36}{:>8}{:>10.1f}", allNames[id], desc.passes.size(), rawSize / 1024.0);
+
+		CompressedEffect compressed[std::size(MODES)];
+		for (size_t m = 0; m < std::size(MODES); ++m) {
+			const CompressionMode& mode = MODES[m];
+			for (const EffectPassDesc& pass : desc.passes) {
+				std::vector<BYTE>& blob = compressed[m].blobs.emplace_back();
+				bool success = mode.useDict
+					? Utils::ZstdCompress(GetBytecode(pass), blob, cdicts[mode.level == CACHE_COMPRESSION_LEVEL ? 0 : 1].get())
+					: Utils::ZstdCompress(GetBytecode(pass), blob, mode.level);
+				if (!success) {
+					fmt::print("\n压缩失败，见 benchmark.log\n");
+					return 1;
+				}
+				compressed[m].size += blob.size();
+			}
+
+			totalSizes[m] += compressed[m].size;
+			fmt::print("{:>16.1f}", compressed[m].size / 1024.0);
+		}
+
+		for (size_t m = 0; m < std::size(MODES); ++m) {
+			const ZSTD_DDict* dict = MODES[m].useDict ? ddict.get() : nullptr;
+
+			bool success = true;
+			std::vector<BYTE> buf;
+			double seconds = Benchmark::Measure([&]() {
+				for (const std::vector<BYTE>& blob : compressed[m].blobs) {
+					if (!Utils::ZstdDecompress(blob, buf, dict)) {
+						success = false;
+					}
+				}
+			}, 3, 0.05);
+			if (!success) {
+				fmt::print("\n解压失败，见 benchmark.log\n");
+				return 1;
+			}
+
+			totalSeconds[m] += seconds;
+			fmt::print("{:>20.1f}", Benchmark::ToMB(rawSize) / seconds);
+		}
+		fmt::print("\n");
+	}
+
+	// 不同效果间相同的通道在缓存中只保存一次，这里重复计算
+	fmt::print("{:<36}{:>8}{:>10.1f}", "总计", "", totalRawSize / 1024.0);
+	for (size_t m = 0; m < std::size(MODES); ++m) {
+		fmt::print("{:>16.1f}", totalSizes[m] / 1024.0);
+	}
+	for (size_t m = 0; m < std::size(MODES); ++m) {
+		fmt::print("{:>20.1f}", Benchmark::ToMB(totalRawSize) / totalSeconds[m]);
+	}
+	fmt::print("\n");
+
+	return 0;
+}
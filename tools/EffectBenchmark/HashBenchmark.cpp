@@ -0,0 +1,137 @@
+#include "pch.h"
+#include "Benchmark.h"
+#include "StreamHasher.h"
+#include "Utils.h"
+#include <bcrypt.h>
+#include <thread>
+
+#pragma comment(lib, "bcrypt.lib")
+
+
+// 替换前的 Utils::Hasher：进程内共享一个可重用的 SHA1 对象，BCrypt 在其中保存状态，因此需要加锁
+class BCryptHasher {
+public:
+	~BCryptHasher() {
+		if (_hHash) {
+			BCryptDestroyHash(_hHash);
+		}
+		if (_hashObj) {
+			HeapFree(GetProcessHeap(), 0, _hashObj);
+		}
+		if (_hAlg) {
+			BCryptCloseAlgorithmProvider(_hAlg, 0);
+		}
+	}
+
+	bool Initialize() {
+		if (!BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&_hAlg, BCRYPT_SHA1_ALGORITHM, NULL, 0))) {
+			return false;
+		}
+
+		ULONG result;
+		if (!BCRYPT_SUCCESS(BCryptGetProperty(_hAlg, BCRYPT_OBJECT_LENGTH, (PBYTE)&_hashObjLen, sizeof(_hashObjLen), &result, 0))) {
+			return false;
+		}
+
+		_hashObj = HeapAlloc(GetProcessHeap(), 0, _hashObjLen);
+		if (!_hashObj) {
+			return false;
+		}
+
+		if (!BCRYPT_SUCCESS(BCryptGetProperty(_hAlg, BCRYPT_HASH_LENGTH, (PBYTE)&_hashLen, sizeof(_hashLen), &result, 0))) {
+			return false;
+		}
+
+		return BCRYPT_SUCCESS(BCryptCreateHash(_hAlg, &_hHash, (PUCHAR)_hashObj, _hashObjLen, NULL, 0, BCRYPT_HASH_REUSABLE_FLAG));
+	}
+
+	std::string Hash(std::string_view data) {
+		std::vector<BYTE> result(_hashLen);
+
+		{
+			std::scoped_lock lk(_cs);
+			BCryptHashData(_hHash, (PUCHAR)data.data(), (ULONG)data.size(), 0);
+			BCryptFinishHash(_hHash, result.data(), (ULONG)result.size(), 0);
+		}
+
+		return Utils::Bin2Hex(result);
+	}
+
+private:
+	Utils::CSMutex _cs;
+
+	BCRYPT_ALG_HANDLE _hAlg = NULL;
+	DWORD _hashObjLen = 0;
+	void* _hashObj = nullptr;
+	DWORD _hashLen = 0;
+	BCRYPT_HASH_HANDLE _hHash = NULL;
+};
+
+// 所有线程各自哈希一遍 sources，返回总用时（秒）
+template<typename Fn>
+static double MeasureThreads(UINT threadCount, const std::vector<std::string>& sources, Fn&& hash) {
+	return Benchmark::Measure([&]() {
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount);
+		for (UINT i = 0; i < threadCount; ++i) {
+			threads.emplace_back([&]() {
+				for (const std::string& source : sources) {
+					hash(source);
+				}
+			});
+		}
+		for (std::thread& t : threads) {
+			t.join();
+		}
+	});
+}
+
+// 用法：hash [线程数]
+// 编译效果时每个通道都要计算哈希，并行编译时各线程同时调用。分别测量单线程和多线程的吞吐量
+int HashBenchmark(const std::vector<std::wstring>& args) {
+	UINT threadCount = args.empty() ? std::thread::hardware_concurrency() : (UINT)std::stoul(args[0]);
+	threadCount = std::max(threadCount, 1u);
+
+	std::vector<std::string> sources;
+	size_t totalSize = 0;
+	for (const std::string& name : Benchmark::GetEffectNames()) {
+		std::string& source = sources.emplace_back();
+		if (!Benchmark::ReadEffectSource(name, source)) {
+			fmt::print("读取 {} 失败\n", name);
+			return 1;
+		}
+		totalSize += source.size();
+	}
+
+	if (sources.empty()) {
+		fmt::print("没有找到效果\n");
+		return 1;
+	}
+
+	BCryptHasher bcryptHasher;
+	if (!bcryptHasher.Initialize()) {
+		fmt::print("初始化 BCrypt 失败\n");
+		return 1;
+	}
+
+	auto bcryptHash = [&](const std::string& source) {
+		return bcryptHasher.Hash(source);
+	};
+	auto streamHash = [](const std::string& source) {
+		return StreamHasher().Update(source).Finish();
+	};
+
+	fmt::print("{} 个效果，共 {:.2f} MB\n\n", sources.size(), Benchmark::ToMB(totalSize));
+	fmt::print("{:<16}{:>16}{:>16}\n", "", "单线程 MB/s", fmt::format("{} 线程 MB/s", threadCount));
+
+	auto printRow = [&](const char* name, auto&& hash) {
+		double single = MeasureThreads(1, sources, hash);
+		double multi = MeasureThreads(threadCount, sources, hash);
+		fmt::print("{:<16}{:>16.1f}{:>16.1f}\n", name,
+			Benchmark::ToMB(totalSize) / single, Benchmark::ToMB(totalSize) * threadCount / multi);
+	};
+	printRow("BCrypt SHA1", bcryptHash);
+	printRow("XXH3-128", streamHash);
+
+	return 0;
+}
@@ -0,0 +1,85 @@
+#include "pch.h"
+#include "Benchmark.h"
+#include "Logger.h"
+#include "Utils.h"
+#include "StrUtils.h"
+
+
+// 用法：EffectBenchmark <子命令> [Magpie 目录] [参数...]
+// Magpie 目录中需有 effects 文件夹，默认为当前目录。基准测试不会修改其中的缓存
+
+struct Command {
+	const wchar_t* name;
+	// 为空表示内部使用，不在用法中列出
+	const char* desc;
+	BenchmarkFunc func;
+};
+
+static const Command COMMANDS[] = {
+	{ L"hash", "比较 StreamHasher 和 BCrypt SHA1 哈希所有效果源码的速度", HashBenchmark },
+	{ L"parse", "测量编译器前端解析效果的吞吐量", ParseBenchmark },
+	{ L"codegen", "生成所有效果的所有通道，统计用时和内存分配次数", CodegenBenchmark },
+	{ L"canon", "检查规范化源码并测量其吞吐量，有失败时退出码为 1", CanonicalizeBenchmark },
+	{ L"validate", "用 DXC（cs_6_0）编译所有效果以验证它们，有失败时退出码为 1", ValidateBenchmark },
+	{ L"fp16", "分别以 FP32 和 FP16 编译所有效果，比较字节码和编译用时", FP16Benchmark },
+	{ L"compare", "编译两个效果，比较编译用时、字节码大小和指令数", CompareBenchmark },
+	{ L"compile", "禁用缓存编译所有效果，比较串行和并行编译的吞吐量", CompileThroughputBenchmark },
+	{ L"cache", "保存所有效果的缓存，然后分别从内存和磁盘读取", CacheBenchmark },
+	{ L"compress", "比较字节码在不同压缩等级、有无字典时的大小和解压速度", CompressionBenchmark },
+	// 由 cache 调用
+	{ L"cache-load", nullptr, CacheLoadBenchmark },
+};
+
+static void PrintUsage() {
+	fmt::print("用法：EffectBenchmark <子命令> [Magpie 目录] [参数...]\n\n子命令：\n");
+	for (const Command& cmd : COMMANDS) {
+		if (!cmd.desc) {
+			continue;
+		}
+		fmt::print("  {:<12}{}\n", StrUtils::UTF16ToUTF8(cmd.name), cmd.desc);
+	}
+}
+
+int wmain(int argc, wchar_t* argv[]) {
+	SetConsoleOutputCP(CP_UTF8);
+
+	if (argc < 2) {
+		PrintUsage();
+		return 1;
+	}
+
+	const Command* command = nullptr;
+	for (const Command& cmd : COMMANDS) {
+		if (_wcsicmp(argv[1], cmd.name) == 0) {
+			command = &cmd;
+			break;
+		}
+	}
+	if (!command) {
+		PrintUsage();
+		return 1;
+	}
+
+	if (argc >= 3 && !SetCurrentDirectory(argv[2])) {
+		fmt::print("无法进入 {}\n", StrUtils::UTF16ToUTF8(argv[2]));
+		return 1;
+	}
+
+	if (!Utils::DirExists(L"effects")) {
+		fmt::print("当前目录中没有 effects 文件夹\n");
+		return 1;
+	}
+
+	// 编译器和缓存依赖日志，只记录警告和错误，避免写日志影响计时
+	if (!Logger::Get().Initialize(spdlog::level::warn, "benchmark.log", 100000, 1)) {
+		fmt::print("初始化日志失败\n");
+		return 1;
+	}
+
+	std::vector<std::wstring> args;
+	for (int i = 3; i < argc; ++i) {
+		args.emplace_back(argv[i]);
+	}
+
+	return command->func(args);
+}
@@ -0,0 +1,312 @@
+# 将效果中的卷积层改为先把块和周围一圈像素读入 groupshared 内存，再从中读取所有 3x3 的输入
+#
+# 用法：python main.py <效果文件>...
+# 直接修改效果文件，已经转换过或不符合要求的通道保持不变
+#
+# 支持两种通道：
+# 1. 每个线程计算 2x2 个输出，由四组 Gather 读取 4x4 的输入，如 Anime4K 各效果的第一个通道：
+#      uint2 gxy = (Rmp8x8(threadId.x) << 1) + blockStart;
+#      ...
+#      float3 src[4][4];
+#      for (...) { for (...) { ... Gather ... } }
+# 2. 每个线程计算 1 个输出，由 SampleLevel 读取每个输入纹理的 3x3 邻域，如 Anime4K 的 L/VL/UL 系列和 ACNet：
+#      uint2 gxy = Rmp8x8(threadId.x) + blockStart;
+#      ...
+#      float2 pos = (gxy + 0.5f) * inputPt;
+#      float4 a1 = tex1.SampleLevel(sam, pos + float2(-inputPt.x, -inputPt.y), 0);
+#      ...
+#    也支持每个线程由同一个输入像素计算 2x2 个输出的 Depth-to-Space 通道，此时 pos 为 ((gxy >> 1) + 0.5f) * inputPt。
+#    只转换读取了完整 3x3 邻域的纹理，其他读取保持不变
+# 读取 groupshared 内存使用的坐标和原先相同，因此输出和原效果逐像素相同，见 verify.py
+
+import re
+import sys
+
+
+PASS_PATTERN = re.compile(r'void (Pass\d+)\(uint2 blockStart, uint3 threadId\) \{\n(.*?)\n\}\n', re.S)
+
+BOUNDS_CHECK = (r'\tuint2 inputSize = GetInputSize\(\);\n'
+                r'\tif \(gxy\.x >= inputSize\.x \|\| gxy\.y >= inputSize\.y\) \{\n'
+                r'\t\treturn;\n'
+                r'\t\}\n')
+
+GATHER_PROLOGUE_PATTERN = re.compile(
+    r'\tuint2 gxy = \(Rmp8x8\(threadId\.x\) << 1\) \+ blockStart;\n' + BOUNDS_CHECK +
+    r'\s*\tfloat2 inputPt = GetInputPt\(\);\n'
+    r'(?:\s*\tuint i, j;\n)?'
+    r'\s*\t(float[34]) src\[4\]\[4\];\n'
+    r'\t\[unroll\]\n'
+    r'\tfor \((?:uint )?i = 0; i (?:< 3|<= 2); i \+= 2\) \{\n'
+    r'\t\t\[unroll\]\n'
+    r'\t\tfor \((?:uint )?j = 0; j (?:< 3|<= 2); j \+= 2\) \{\n'
+    r'\t\t\tfloat2 tpos = \(gxy \+ uint2\(i, j\)\) \* inputPt;\n'
+    r'((?:\t\t\tconst float4 s[rgba] = \w+\.Gather\w+\(sam, tpos\);\n)+)'
+    r'\s*\t\t\t// w z\n'
+    r'\t\t\t// x y\n'
+    r'\t\t\tsrc\[i\]\[j\] = float[34]\(([^)]*)\);\n'
+    r'\t\t\tsrc\[i\]\[j \+ 1\] = float[34]\(([^)]*)\);\n'
+    r'\t\t\tsrc\[i \+ 1\]\[j\] = float[34]\(([^)]*)\);\n'
+    r'\t\t\tsrc\[i \+ 1\]\[j \+ 1\] = float[34]\(([^)]*)\);\n'
+    r'\t\t\}\n'
+    r'\t\}\n(?:[ \t]*\n)*')
+
+GATHER_PATTERN = re.compile(r'const float4 (s[rgba]) = (\w+)\.Gather(\w+)\(sam, tpos\);')
+
+GATHER_TEMPLATE = '''#define TILE_SIZE (MP_BLOCK_WIDTH + 2)
+
+// 块和周围一圈像素，所有卷积核从这里读取
+groupshared {T} shSrc[TILE_SIZE][TILE_SIZE];
+
+void {NAME}(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+	uint i, j;
+
+	// 每次 Gather 读取 2x2 个像素
+	for (i = threadId.x; i < (TILE_SIZE / 2) * (TILE_SIZE / 2); i += MP_NUM_THREADS_X) {
+		uint2 pos = uint2(i % (TILE_SIZE / 2), i / (TILE_SIZE / 2)) * 2;
+		float2 tpos = (blockStart + pos) * inputPt;
+{GATHERS}
+
+		// w z
+		// x y
+		shSrc[pos.y][pos.x] = {T}({W});
+		shSrc[pos.y][pos.x + 1] = {T}({Z});
+		shSrc[pos.y + 1][pos.x] = {T}({X});
+		shSrc[pos.y + 1][pos.x + 1] = {T}({Y});
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
+	uint2 gxy = (Rmp8x8(threadId.x) << 1) + blockStart;
+	uint2 inputSize = GetInputSize();
+	if (gxy.x >= inputSize.x || gxy.y >= inputSize.y) {
+		return;
+	}
+
+	uint2 tilePos = gxy - blockStart;
+	{T} src[4][4];
+	[unroll]
+	for (i = 0; i < 4; ++i) {
+		[unroll]
+		for (j = 0; j < 4; ++j) {
+			src[i][j] = shSrc[tilePos.y + j][tilePos.x + i];
+		}
+	}
+
+{TAIL}
+}
+'''
+
+SAMPLE_PROLOGUE_PATTERN = re.compile(
+    r'\tuint2 gxy = (Rmp8x8\(threadId\.x\) \+ blockStart|\(Rmp8x8\(threadId\.x\) << 1\) \+ blockStart);\n'
+    r'((?:[ \t]*\n)*(?:\tuint2 inputSize = GetInputSize\(\);\n)?'
+    r'\tif \((?:gxy\.x >= inputSize\.x \|\| gxy\.y >= inputSize\.y|!CheckViewport\(gxy\))\) \{\n'
+    r'\t\treturn;\n'
+    r'\t\}\n)'
+    r'\s*\tfloat2 inputPt = GetInputPt\(\);\n'
+    r'((?:\s*\tfloat2 \w+ = Get\w+Pt\(\);\n)*)'
+    r'\s*(\tfloat2 pos = \((gxy|\(gxy >> 1\)) \+ 0\.5f\) \* inputPt;\n)')
+
+# 每个线程计算 1 个输出时块内的像素和输入一一对应；每个线程计算 2x2 个输出时（Depth-to-Space）
+# 它们由同一个输入像素得到，块对应的输入只有一半大
+SAMPLE_LAYOUTS = {
+    'Rmp8x8(threadId.x) + blockStart': ('gxy', 'blockStart', '(MP_BLOCK_WIDTH + 2)'),
+    '(Rmp8x8(threadId.x) << 1) + blockStart': ('(gxy >> 1)', '(blockStart >> 1)', '(MP_BLOCK_WIDTH / 2 + 2)'),
+}
+
+# 以 pos 为中心的一次读取，组 5 为偏移
+SAMPLE_PATTERN = re.compile(
+    r'^\t(float[1234]?) (\w+) = (\w+)\.SampleLevel\(sam, pos(| \+ float2\([^()]*\)| [+-] inputPt), ?0\)(\.[xyzwrgba]+)?;$', re.M)
+
+OFFSETS = {
+    '': (0, 0),
+    ' - inputPt': (-1, -1),
+    ' + inputPt': (1, 1),
+}
+AXIS_OFFSETS = {
+    'x': {'-inputPt.x': -1, '0': 0, 'inputPt.x': 1},
+    'y': {'-inputPt.y': -1, '0': 0, 'inputPt.y': 1},
+}
+
+SAMPLE_FILL_TEMPLATE = '''void {NAME}(uint2 blockStart, uint3 threadId) {
+	float2 inputPt = GetInputPt();
+
+	// 每次读取一个像素
+	for (uint {I} = threadId.x; {I} < TILE_SIZE * TILE_SIZE; {I} += MP_NUM_THREADS_X) {
+		uint2 tilePos = uint2({I} % TILE_SIZE, {I} / TILE_SIZE);
+		float2 tpos = ({TILE_START} + tilePos - 0.5f) * inputPt;
+{FILLS}
+	}
+
+	GroupMemoryBarrierWithGroupSync();
+
+	uint2 gxy = {GXY};
+{CHECK}
+
+{EXTRA}{POS}	uint2 tilePos = {CENTER} - {TILE_START} + 1;
+'''
+
+
+def ParseOffset(offset):
+    if offset in OFFSETS:
+        return OFFSETS[offset]
+
+    m = re.fullmatch(r' \+ float2\(([^,]+), ([^,]+)\)', offset)
+    if not m:
+        return None
+    x = AXIS_OFFSETS['x'].get(m.group(1).strip())
+    y = AXIS_OFFSETS['y'].get(m.group(2).strip())
+    if x is None or y is None:
+        return None
+    return x, y
+
+
+def IsIdentifierUsed(body, name):
+    body = re.sub(r'//.*', '', body)
+    return re.search(r'\b%s\b' % name, body) is not None
+
+
+def TransformGatherPass(name, body):
+    m = GATHER_PROLOGUE_PATTERN.match(body)
+    if not m:
+        return None
+
+    t = m.group(1)
+    gathers = GATHER_PATTERN.findall(m.group(2))
+    if not gathers or len(set(tex for _, tex, _ in gathers)) != 1:
+        return None
+
+    # 原先的 src[i][j] 以 x 为第一维
+    vs = [v for v, _, _ in gathers]
+    def Components(c):
+        return ', '.join('%s.%s' % (v, c) for v in vs)
+    if [m.group(3), m.group(4), m.group(5), m.group(6)] != [Components(c) for c in 'wxzy']:
+        return None
+
+    tail = body[m.end():].rstrip()
+    if IsIdentifierUsed(tail, 'tilePos') or IsIdentifierUsed(tail, 'shSrc'):
+        return None
+
+    return (GATHER_TEMPLATE.replace('{NAME}', name)
+            .replace('{T}', t)
+            .replace('{GATHERS}', '\n'.join('\t\t' + line for line in re.findall(r'const float4 .*;', m.group(2))))
+            .replace('{W}', Components('w'))
+            .replace('{Z}', Components('z'))
+            .replace('{X}', Components('x'))
+            .replace('{Y}', Components('y'))
+            .replace('{TAIL}', tail))
+
+
+def TransformSamplePass(name, body):
+    m = SAMPLE_PROLOGUE_PATTERN.match(body)
+    if not m:
+        return None
+
+    center, tileStart, tileSize = SAMPLE_LAYOUTS[m.group(1)]
+    if m.group(5) != center:
+        return None
+
+    rest = body[m.end():]
+
+    # 按纹理分组，只转换读取了完整 3x3 邻域且类型一致的纹理
+    taps = {}
+    for tap in SAMPLE_PATTERN.finditer(rest):
+        offset = ParseOffset(tap.group(4))
+        if offset is None:
+            continue
+        taps.setdefault(tap.group(3), []).append((tap, offset))
+
+    texs = []
+    for tex, texTaps in taps.items():
+        offsets = set(offset for _, offset in texTaps)
+        kinds = set((tap.group(1), tap.group(5)) for tap, _ in texTaps)
+        if len(offsets) == 9 and len(kinds) == 1:
+            texs.append(tex)
+    if not texs:
+        return None
+
+    loopVar = next(v for v in ['i', 'k', 'n'] if not IsIdentifierUsed(body, v))
+    if IsIdentifierUsed(rest, 'tilePos') or IsIdentifierUsed(rest, 'tpos'):
+        return None
+
+    decls = []
+    fills = []
+    for tex in texs:
+        tap = taps[tex][0][0]
+        sh = 'sh' + tex[0].upper() + tex[1:]
+        if IsIdentifierUsed(body, sh):
+            return None
+        decls.append('groupshared %s %s[TILE_SIZE][TILE_SIZE];' % (tap.group(1), sh))
+        fills.append('\t\t%s[tilePos.y][tilePos.x] = %s.SampleLevel(sam, tpos, 0)%s;' % (sh, tex, tap.group(5) or ''))
+
+    def Index(d):
+        return '' if d == 0 else (' + 1' if d > 0 else ' - 1')
+
+    def ReplaceTap(tap):
+        offset = ParseOffset(tap.group(4))
+        if tap.group(3) not in texs or offset is None:
+            return tap.group(0)
+        sh = 'sh' + tap.group(3)[0].upper() + tap.group(3)[1:]
+        return '\t%s %s = %s[tilePos.y%s][tilePos.x%s];' % (
+            tap.group(1), tap.group(2), sh, Index(offset[1]), Index(offset[0]))
+
+    rest = SAMPLE_PATTERN.sub(ReplaceTap, rest)
+    # 残差等仍需要 pos
+    pos = m.group(4) if IsIdentifierUsed(rest, 'pos') else ''
+    extra = ''.join(line.strip('\n') + '\n' for line in re.findall(r'\tfloat2 .*\n', m.group(3)))
+
+    header = ('#define TILE_SIZE %s\n\n'
+              '// 块对应的输入和周围一圈像素，所有 3x3 的读取都从这里进行\n' % tileSize
+              + '\n'.join(decls) + '\n\n')
+    return header + (SAMPLE_FILL_TEMPLATE.replace('{NAME}', name)
+                     .replace('{I}', loopVar)
+                     .replace('{FILLS}', '\n'.join(fills))
+                     .replace('{TILE_START}', tileStart)
+                     .replace('{GXY}', m.group(1))
+                     .replace('{CHECK}', m.group(2).rstrip('\n'))
+                     .replace('{EXTRA}', extra)
+                     .replace('{POS}', pos)
+                     .replace('{CENTER}', center)) + rest.rstrip('\n') + '\n}\n'
+
+
+def TransformEffect(src):
+    # 线性采样时读取的不是单个纹素，无法改为从 groupshared 内存读取
+    isPointSampler = re.search(r'//!SAMPLER\n//!FILTER POINT\nSamplerState sam;', src) is not None
+
+    result = ''
+    last = 0
+    transformed = []
+    for m in PASS_PATTERN.finditer(src):
+        name, body = m.group(1), m.group(2)
+        new = TransformGatherPass(name, body)
+        if new is None and isPointSampler:
+            new = TransformSamplePass(name, body)
+        if new is None:
+            continue
+
+        result += src[last:m.start()] + new
+        last = m.end()
+        transformed.append(name)
+    return result + src[last:], transformed
+
+
+def main():
+    if len(sys.argv) < 2:
+        print('用法：python main.py <效果文件>...')
+        return 1
+
+    for path in sys.argv[1:]:
+        with open(path, encoding='utf-8') as f:
+            src = f.read()
+
+        result, transformed = TransformEffect(src)
+        if transformed:
+            with open(path, 'w', encoding='utf-8', newline='') as f:
+                f.write(result)
+        print('%s：%s' % (path, '、'.join(transformed) if transformed else '没有可以转换的通道'))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
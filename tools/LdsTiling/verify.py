@@ -0,0 +1,113 @@
+# 在 CPU 上模拟转换前后每个线程读取的纹理坐标，验证 main.py 的转换不改变输出
+#
+# 用法：python verify.py
+#
+# 按 FP32 逐步计算转换前后的采样坐标，再按点采样和 CLAMP 寻址得到读取的纹素，检查每个线程的每个输入都读取同一个纹素。
+# x 和 y 方向的计算互相独立且形式相同，因此只需模拟一维。遍历 1~1024 的所有尺寸和常见的分辨率，包括边缘处不完整的块。
+# 纹素中心到纹素边界有半个纹素，舍入误差不会改变选择的纹素，因此不必模拟 GPU 上定点数的精度
+
+import struct
+import sys
+
+
+SIZES = list(range(1, 1025)) + [1280, 1366, 1440, 1600, 1920, 2048, 2160, 2560, 3840, 4096, 5120, 7680, 8192]
+
+
+def f32(x):
+    return struct.unpack('f', struct.pack('f', x))[0]
+
+
+def Clamp(texel, size):
+    return min(max(texel, 0), size - 1)
+
+
+# 点采样读取的纹素
+def Sample(u, size):
+    return Clamp(int(f32(u * size) // 1), size)
+
+
+# Gather 读取的两个纹素，返回 (左, 右)
+def Gather(u, size):
+    left = int((f32(u * size) - 0.5) // 1)
+    return Clamp(left, size), Clamp(left + 1, size)
+
+
+# 原先每个线程通过两次 Gather 读取 src[0..3]，转换后块内所有线程共享 shSrc
+def VerifyGather(size, blockWidth):
+    pt = f32(1 / size)
+    tileSize = blockWidth + 2
+
+    for blockStart in range(0, size, blockWidth):
+        tile = [None] * tileSize
+        for pos in range(0, tileSize, 2):
+            tile[pos], tile[pos + 1] = Gather(f32((blockStart + pos) * pt), size)
+
+        for r in range(blockWidth // 2):
+            gx = blockStart + r * 2
+            if gx >= size:
+                continue
+
+            src = [None] * 4
+            for i in (0, 2):
+                src[i], src[i + 1] = Gather(f32((gx + i) * pt), size)
+
+            tilePos = gx - blockStart
+            if src != tile[tilePos:tilePos + 4]:
+                return 'blockStart=%d gx=%d' % (blockStart, gx)
+
+    return None
+
+
+# 原先每个线程以 pos 为中心读取 3x3 邻域，转换后块内所有线程共享 shTex*。
+# ratio 为每个线程在该方向上计算的输出数，Depth-to-Space 为 2，此时输入的块只有输出的一半大
+def VerifySample(size, blockWidth, ratio):
+    pt = f32(1 / size)
+    inputBlockWidth = blockWidth // ratio
+    tileSize = inputBlockWidth + 2
+    outputSize = size * ratio
+
+    for blockStart in range(0, outputSize, blockWidth):
+        tileStart = blockStart // ratio
+        tile = [Sample(f32(f32(tileStart + t - 0.5) * pt), size) for t in range(tileSize)]
+
+        for r in range(blockWidth // ratio):
+            gx = blockStart + r * ratio
+            if gx >= outputSize:
+                continue
+
+            center = gx // ratio
+            pos = f32(f32(center + 0.5) * pt)
+            for d in (-1, 0, 1):
+                texel = Sample(pos if d == 0 else f32(pos + d * pt), size)
+
+                tilePos = center - tileStart + 1 + d
+                if tilePos < 0 or tilePos >= tileSize or tile[tilePos] != texel:
+                    return 'blockStart=%d gx=%d d=%d' % (blockStart, gx, d)
+
+    return None
+
+
+CASES = [
+    ('Gather，BLOCK_SIZE 16', lambda size: VerifyGather(size, 16)),
+    ('3x3 SampleLevel，BLOCK_SIZE 8', lambda size: VerifySample(size, 8, 1)),
+    ('3x3 SampleLevel，Depth-to-Space，BLOCK_SIZE 16', lambda size: VerifySample(size, 16, 2)),
+]
+
+
+def main():
+    failed = False
+    for name, verify in CASES:
+        for size in SIZES:
+            error = verify(size)
+            if error:
+                print('%s：尺寸 %d 不一致（%s）' % (name, size, error))
+                failed = True
+                break
+        else:
+            print('%s：%d 种尺寸全部一致' % (name, len(SIZES)))
+
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
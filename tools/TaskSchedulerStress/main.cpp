@@ -0,0 +1,207 @@
+#include "TaskScheduler.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+
+// TaskScheduler 的压力测试，只依赖标准库，可以在任何平台上运行
+// 检查每个序号恰好执行一次，覆盖嵌套调用、多个外部线程同时调用和耗时不均的任务
+
+static UINT rounds = 200;
+
+#define CHECK(cond, ...) \
+	do { \
+		if (!(cond)) { \
+			std::printf("失败：%s:%d：", __FILE__, __LINE__); \
+			std::printf(__VA_ARGS__); \
+			std::printf("\n"); \
+			return false; \
+		} \
+	} while (0)
+
+// 每个序号执行的次数
+class Counters {
+public:
+	explicit Counters(UINT count) : _counts(new std::atomic<UINT>[count]), _size(count) {
+		for (UINT i = 0; i < count; ++i) {
+			_counts[i].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	void Hit(UINT id) noexcept {
+		_counts[id].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// 返回第一个执行次数不为 1 的序号，都为 1 时返回 _size
+	UINT FindWrong() const noexcept {
+		for (UINT i = 0; i < _size; ++i) {
+			if (_counts[i].load(std::memory_order_relaxed) != 1) {
+				return i;
+			}
+		}
+		return _size;
+	}
+
+private:
+	std::unique_ptr<std::atomic<UINT>[]> _counts;
+	UINT _size;
+};
+
+static void Spin(UINT iterations) noexcept {
+	volatile UINT x = 0;
+	for (UINT i = 0; i < iterations; ++i) {
+		x = x + i;
+	}
+}
+
+static bool TestFlat() {
+	TaskScheduler& scheduler = TaskScheduler::Get();
+	const UINT workerCount = scheduler.GetWorkerCount();
+
+	for (UINT times : { 0u, 1u, 2u, workerCount, workerCount + 1, 1000u }) {
+		for (UINT r = 0; r < rounds; ++r) {
+			Counters counters(times);
+			scheduler.ParallelFor(times, [&](UINT id) {
+				counters.Hit(id);
+			});
+
+			UINT wrong = counters.FindWrong();
+			CHECK(wrong == times, "ParallelFor(%u) 中序号 %u 执行的次数不为 1", times, wrong);
+		}
+	}
+
+	return true;
+}
+
+// 和编译效果相同的嵌套方式：多个效果并行编译，每个效果的通道再并行编译
+static bool TestNested() {
+	TaskScheduler& scheduler = TaskScheduler::Get();
+
+	constexpr UINT OUTER = 3;
+	constexpr UINT MIDDLE = 20;
+	constexpr UINT INNER = 4;
+
+	for (UINT r = 0; r < rounds; ++r) {
+		Counters counters(OUTER * MIDDLE * INNER);
+		scheduler.ParallelFor(OUTER, [&](UINT i) {
+			scheduler.ParallelFor(MIDDLE, [&](UINT j) {
+				scheduler.ParallelFor(INNER, [&](UINT k) {
+					Spin(2000);
+					counters.Hit((i * MIDDLE + j) * INNER + k);
+				});
+			});
+		});
+
+		UINT wrong = counters.FindWrong();
+		CHECK(wrong == OUTER * MIDDLE * INNER, "嵌套调用中序号 %u 执行的次数不为 1", wrong);
+	}
+
+	return true;
+}
+
+// 多个非工作线程同时调用，它们共享同一个队列
+static bool TestConcurrentCallers() {
+	TaskScheduler& scheduler = TaskScheduler::Get();
+
+	constexpr UINT CALLERS = 4;
+	constexpr UINT OUTER = 16;
+	constexpr UINT INNER = 8;
+
+	std::atomic<bool> success = true;
+	std::vector<std::thread> callers;
+	for (UINT c = 0; c < CALLERS; ++c) {
+		callers.emplace_back([&]() {
+			for (UINT r = 0; r < rounds; ++r) {
+				Counters counters(OUTER * INNER);
+				scheduler.ParallelFor(OUTER, [&](UINT i) {
+					scheduler.ParallelFor(INNER, [&](UINT j) {
+						counters.Hit(i * INNER + j);
+					});
+				});
+
+				if (counters.FindWrong() != OUTER * INNER) {
+					success = false;
+				}
+			}
+		});
+	}
+	for (std::thread& t : callers) {
+		t.join();
+	}
+
+	CHECK(success, "多个线程同时调用时有序号执行的次数不为 1");
+	return true;
+}
+
+// 耗时相差很大的任务，空闲的线程需要窃取剩余的任务
+static bool TestUneven() {
+	TaskScheduler& scheduler = TaskScheduler::Get();
+
+	constexpr UINT COUNT = 64;
+
+	for (UINT r = 0; r < rounds / 10 + 1; ++r) {
+		Counters counters(COUNT * COUNT);
+		scheduler.ParallelFor(COUNT, [&](UINT i) {
+			// 少数任务耗时很长，其余的很短
+			Spin(i % 16 == 0 ? 200000 : 100);
+			scheduler.ParallelFor(COUNT, [&](UINT j) {
+				Spin(j % 8 == 0 ? 20000 : 10);
+				counters.Hit(i * COUNT + j);
+			});
+		});
+
+		UINT wrong = counters.FindWrong();
+		CHECK(wrong == COUNT * COUNT, "耗时不均时序号 %u 执行的次数不为 1", wrong);
+	}
+
+	return true;
+}
+
+// 调度的开销：空任务的 ParallelFor 的平均用时
+static void MeasureOverhead() {
+	TaskScheduler& scheduler = TaskScheduler::Get();
+
+	for (UINT times : { 1u, 16u, 256u }) {
+		constexpr UINT REPEAT = 20000;
+		auto start = std::chrono::steady_clock::now();
+		for (UINT r = 0; r < REPEAT; ++r) {
+			scheduler.ParallelFor(times, [](UINT) {});
+		}
+		std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+		std::printf("ParallelFor(%u) 空任务：%.2f us/次\n", times, elapsed.count() / REPEAT);
+	}
+}
+
+// 用法：TaskSchedulerStress [轮数]
+int main(int argc, char* argv[]) {
+	if (argc >= 2) {
+		rounds = (UINT)std::max(std::atoi(argv[1]), 1);
+	}
+
+	std::printf("工作线程数：%u，轮数：%u\n", TaskScheduler::Get().GetWorkerCount(), rounds);
+
+	struct {
+		const char* name;
+		bool (*func)();
+	} tests[] = {
+		{ "单层", TestFlat },
+		{ "嵌套", TestNested },
+		{ "多个调用者", TestConcurrentCallers },
+		{ "耗时不均", TestUneven }
+	};
+
+	for (const auto& test : tests) {
+		auto start = std::chrono::steady_clock::now();
+		if (!test.func()) {
+			std::printf("%s：失败\n", test.name);
+			return 1;
+		}
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		std::printf("%s：通过（%.1f ms）\n", test.name, elapsed.count());
+	}
+
+	MeasureOverhead();
+	return 0;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// 代替 Runtime 的 pch.h，使 TaskScheduler 可以脱离 Windows 编译
+// TaskScheduler 只依赖标准库和 UINT
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+using UINT = unsigned int;
@@ -0,0 +1,255 @@
+# 将效果中内联的权重矩阵移到纹理中
+#
+# 用法：python main.py [--fp16] <效果文件> <输出文件>
+# 权重保存在输出文件旁的 <输出文件名>_Weights.dds 中，格式为 R32G32B32A32_FLOAT，
+# 每行一个矩阵，每个像素为矩阵的一行。所有数值都是原字面量舍入到 FP32 的结果，和编译器
+# 处理字面量的方式相同，因此计算结果不变
+# 指定 --fp16 时格式为 R16G16B16A16_FLOAT，权重纹理的大小减半，但计算结果会改变，
+# 将打印随机输入下每层输出的误差
+#
+# 只转换通道中由字面量构成的 float3x4 和 float4x4，如 Anime4K 中的
+#   mul(a1, float4x4(-0.009462198, 0.067644134, ...))
+
+import os
+import re
+import math
+import random
+import sys
+import struct
+from fractions import Fraction
+
+
+MATRIX_PATTERN = re.compile(r'float([34])x4\(([^()]*)\)')
+LITERAL_PATTERN = re.compile(r'^\s*-?(\d+\.?\d*|\.\d+)(e[+-]?\d+)?f?\s*$', re.I)
+
+TEXTURE_NAME = 'weights'
+
+# 纹理的最大高度
+MAX_HEIGHT = 16384
+
+# 纹理格式名、DXGI_FORMAT 和一个像素的打包格式
+FORMATS = {
+    False: ('R32G32B32A32_FLOAT', 2, '<4f'),
+    True: ('R16G16B16A16_FLOAT', 10, '<4e'),
+}
+
+# 累加到同一个变量的一组矩阵乘法，如 target += mul(a1, float4x4(...));
+ACCUMULATION_PATTERN = re.compile(r'[ \t]*(?:float4 )?(\w+) (\+)?= mul\(')
+
+# 测量误差时每组矩阵乘法的随机输入个数
+ERROR_SAMPLES = 100
+
+
+def ParseFloat32(s):
+    # 先转换为 FP64 再舍入到 FP32 在极少数情况下会产生不同的结果，这里直接由十进制舍入
+    s = s.strip().rstrip('fF')
+    exact = Fraction(s)
+    f = struct.unpack('f', struct.pack('f', float(exact)))[0]
+
+    bits = struct.unpack('I', struct.pack('f', f))[0]
+    best = f
+    for neighbor in (bits - 1, bits + 1):
+        if not 0 <= neighbor <= 0xFFFFFFFF:
+            continue
+        g = struct.unpack('f', struct.pack('I', neighbor))[0]
+        if math.isfinite(g) and abs(Fraction(g) - exact) < abs(Fraction(best) - exact):
+            best = g
+    return best
+
+
+def ToFloat16(f):
+    try:
+        return struct.unpack('e', struct.pack('e', f))[0]
+    except OverflowError:
+        raise ValueError('权重 %g 超出 FP16 的范围' % f)
+
+
+def WriteDDS(path, rows, isFP16):
+    width = 4
+    height = len(rows)
+    _, dxgiFormat, texelFormat = FORMATS[isFP16]
+    texelSize = struct.calcsize(texelFormat)
+
+    # DDS_HEADER
+    DDSD_CAPS, DDSD_HEIGHT, DDSD_WIDTH, DDSD_PITCH, DDSD_PIXELFORMAT = 0x1, 0x2, 0x4, 0x8, 0x1000
+    DDPF_FOURCC = 0x4
+    DDSCAPS_TEXTURE = 0x1000
+    header = struct.pack(
+        '<7I44x', 124, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PITCH | DDSD_PIXELFORMAT,
+        height, width, width * texelSize, 0, 1)
+    pixelFormat = struct.pack('<2I4s5I', 32, DDPF_FOURCC, b'DX10', 0, 0, 0, 0, 0)
+    caps = struct.pack('<5I', DDSCAPS_TEXTURE, 0, 0, 0, 0)
+    # DDS_HEADER_DXT10：D3D10_RESOURCE_DIMENSION_TEXTURE2D
+    dx10 = struct.pack('<5I', dxgiFormat, 3, 0, 1, 0)
+
+    with open(path, mode='wb') as f:
+        f.write(b'DDS ' + header + pixelFormat + caps + dx10)
+        for row in rows:
+            for texel in row:
+                f.write(struct.pack(texelFormat, *texel))
+            # 不足 4 行的矩阵以 0 填充
+            f.write(b'\0' * texelSize * (width - len(row)))
+
+
+# 以 [-1, 1] 中的随机数作为每个矩阵乘法的输入，比较 FP16 和 FP32 的权重计算的每组累加结果。
+# 返回 (最大绝对误差, 误差的均方根, 结果的均方根)
+def MeasureFP16Error(rows, groups):
+    rng = random.Random(0)
+    maxError = 0
+    sumSqError = 0
+    sumSqResult = 0
+    count = 0
+
+    for group in groups:
+        for _ in range(ERROR_SAMPLES):
+            result = [0.0] * 4
+            error = [0.0] * 4
+            for k in group:
+                for r in rows[k]:
+                    x = rng.uniform(-1, 1)
+                    for c in range(4):
+                        result[c] += x * r[c]
+                        error[c] += x * (ToFloat16(r[c]) - r[c])
+
+            for c in range(4):
+                maxError = max(maxError, abs(error[c]))
+                sumSqError += error[c] ** 2
+                sumSqResult += result[c] ** 2
+            count += 4
+
+    return maxError, math.sqrt(sumSqError / count), math.sqrt(sumSqResult / count)
+
+
+def Convert(src, weightsFileName, isFP16):
+    if re.search(r'\b(%s|W3|W4)\b' % TEXTURE_NAME, src):
+        raise ValueError('效果中已存在名为 %s、W3 或 W4 的标识符' % TEXTURE_NAME)
+
+    # 按 //!PASS 分割，第一部分为头和其他块
+    parts = re.split(r'(?m)^(?=//!PASS\b)', src)
+    rows = []
+    # 累加到同一个变量的矩阵的序号，用于测量误差
+    groups = []
+    literalCount = 0
+
+    for idx in range(1, len(parts)):
+        part = parts[idx]
+        # COMMON 块等位于通道之后时不属于该通道
+        end = re.search(r'(?m)^//!(?!PASS\b|IN\b|OUT\b|BLOCK_SIZE\b|NUM_THREADS\b|STYLE\b|DESC\b)', part)
+        passCode, rest = (part[:end.start()], part[end.start():]) if end else (part, '')
+
+        used = set()
+        # 变量名 -> 正在累加的组在 groups 中的序号
+        accumulating = {}
+
+        def ReplaceMatrix(m):
+            nonlocal literalCount
+            values = m.group(2).split(',')
+            rowCount = int(m.group(1))
+            if len(values) != rowCount * 4 or not all(LITERAL_PATTERN.match(v) for v in values):
+                return m.group(0)
+
+            literalCount += len(values)
+            floats = [ParseFloat32(v) for v in values]
+            rows.append([floats[r * 4:r * 4 + 4] for r in range(rowCount)])
+            used.add(rowCount)
+
+            lineStart = passCode.rfind('\n', 0, m.start()) + 1
+            acc = ACCUMULATION_PATTERN.match(passCode, lineStart)
+            if acc and acc.group(2) and acc.group(1) in accumulating:
+                groups[accumulating[acc.group(1)]].append(len(rows) - 1)
+            else:
+                groups.append([len(rows) - 1])
+                if acc:
+                    accumulating[acc.group(1)] = len(groups) - 1
+            return 'W%d(%d)' % (rowCount, len(rows) - 1)
+
+        passCode = MATRIX_PATTERN.sub(ReplaceMatrix, passCode)
+        if not used:
+            continue
+
+        lines = passCode.split('\n')
+        # 通道的选项之后定义读取矩阵的宏
+        i = 1
+        hasIn = False
+        while i < len(lines) and lines[i].startswith('//!'):
+            if lines[i].startswith('//!IN '):
+                lines[i] += ', ' + TEXTURE_NAME
+                hasIn = True
+            i += 1
+        if not hasIn:
+            lines.insert(1, '//!IN ' + TEXTURE_NAME)
+            i += 1
+
+        macros = ['', '// 第 k 个权重矩阵，每行为一个像素']
+        for rowCount in sorted(used):
+            loads = ', '.join('%s.Load(int3(%d, k, 0))' % (TEXTURE_NAME, r) for r in range(rowCount))
+            macros.append('#define W%d(k) float%dx4(%s)' % (rowCount, rowCount, loads))
+        lines[i:i] = macros
+
+        parts[idx] = '\n'.join(lines) + rest
+
+    if not rows:
+        raise ValueError('没有可以转换的权重矩阵')
+    if len(rows) > MAX_HEIGHT:
+        raise ValueError('权重矩阵过多')
+    if isFP16:
+        # 检查范围
+        for row in rows:
+            for texel in row:
+                for f in texel:
+                    ToFloat16(f)
+
+    # 在第一个 SAMPLER 或 COMMON 块前声明权重纹理，没有则在第一个通道前
+    head = parts[0]
+    m = re.search(r'(?m)^//!(SAMPLER|COMMON)\b', head)
+    pos = m.start() if m else len(head)
+    texture = '//!TEXTURE\n//!SOURCE %s\n//!FORMAT %s\nTexture2D %s;\n\n' % (
+        weightsFileName, FORMATS[isFP16][0], TEXTURE_NAME)
+    parts[0] = head[:pos] + texture + head[pos:]
+
+    return ''.join(parts), rows, groups, literalCount
+
+
+def main():
+    args = sys.argv[1:]
+    isFP16 = len(args) > 0 and args[0] == '--fp16'
+    if isFP16:
+        args = args[1:]
+    if len(args) != 2:
+        print('用法：python main.py [--fp16] <效果文件> <输出文件>')
+        return 1
+
+    inPath, outPath = args
+    with open(inPath, mode='r', encoding='utf8') as f:
+        src = f.read()
+
+    weightsPath = os.path.splitext(outPath)[0] + '_Weights.dds'
+    try:
+        result, rows, groups, literalCount = Convert(src, os.path.basename(weightsPath), isFP16)
+    except ValueError as e:
+        print('转换失败：' + str(e))
+        return 1
+
+    with open(outPath, mode='w', encoding='utf8', newline='') as f:
+        f.write(result)
+    WriteDDS(weightsPath, rows, isFP16)
+
+    print('转换了 %d 个矩阵，共 %d 个字面量' % (len(rows), literalCount))
+    print('源码大小：%d -> %d 字节' % (len(src.encode('utf8')), len(result.encode('utf8'))))
+    print('权重纹理：%s，%d 字节' % (FORMATS[isFP16][0], os.path.getsize(weightsPath)))
+
+    if isFP16:
+        weights = [f for row in rows for texel in row for f in texel]
+        maxAbsError = max(abs(ToFloat16(f) - f) for f in weights)
+        maxRelError = max(abs(ToFloat16(f) - f) / abs(f) for f in weights if f != 0)
+        print('FP16 权重：最大绝对误差 %.3g，最大相对误差 %.3g' % (maxAbsError, maxRelError))
+
+        maxError, rmsError, rmsResult = MeasureFP16Error(rows, groups)
+        print('FP16 每层输出（%d 组累加，输入为 [-1, 1] 中的随机数）：最大绝对误差 %.3g，误差的均方根 %.3g，输出的均方根 %.3g' % (
+            len(groups), maxError, rmsError, rmsResult))
+    print('已写入 %s 和 %s' % (outPath, weightsPath))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
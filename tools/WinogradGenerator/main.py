@@ -0,0 +1,315 @@
+# 为 Anime4K 的 3x3 卷积层生成 Winograd F(2x2, 3x3) 变体
+#
+# 用法：python main.py <效果文件> [输出文件]
+# 未指定输出文件时只打印误差报告
+#
+# 支持的卷积层为以下形式的函数，每个线程由 4x4 的输入计算 2x2 的输出：
+#   float4 Name(float4 src[4][4], int i, int j) {
+#       float4 result = mul(src[i - 1][j - 1], float4x4(...));
+#       result += mul(max(-src[i][j], 0), float4x4(...));
+#       ...
+#       result += float4(...);
+#       return result;
+#   }
+# 直接卷积每个输出需要 9 次矩阵乘法，Winograd 只需 16 / 4 = 4 次
+
+import re
+import sys
+import random
+import struct
+
+
+TAP_PATTERN = re.compile(
+    r'(?:float4 result =|result \+=) mul\((max\()?(-)?src\[i(?: ([+-]) 1)?\]\[j(?: ([+-]) 1)?\](?:, 0\))?, '
+    r'float([34])x4\(([^)]*)\)\);')
+BIAS_PATTERN = re.compile(r'result \+= float4\(([^)]*)\);')
+FUNC_PATTERN = re.compile(
+    r'float4 (\w+)\((float[34]) src\[4\]\[4\], int i, int j\) \{\n(.*?)\n\treturn result;\n\}\n', re.S)
+
+# 激活函数，在卷积前作用于每个输入
+ACTIVATIONS = {
+    (False, False): '{}',
+    (True, False): 'max({}, 0)',
+    (True, True): 'max(-{}, 0)',
+}
+
+# F(2, 3) 的变换矩阵
+BT = [[1, 0, -1, 0], [0, 1, 1, 0], [0, -1, 1, 0], [0, 1, 0, -1]]
+G = [[1, 0, 0], [0.5, 0.5, 0.5], [0.5, -0.5, 0.5], [0, 0, 1]]
+AT = [[1, 1, 1, 0], [0, 1, -1, -1]]
+
+
+def f32(x):
+    return struct.unpack('f', struct.pack('f', x))[0]
+
+
+# 生成 coeffs 和 names 的线性组合，系数只能为 0、1 或 -1
+def Combine(coeffs, names):
+    result = ''
+    for coeff, name in zip(coeffs, names):
+        if coeff == 0:
+            continue
+        if result:
+            result += (' + ' if coeff > 0 else ' - ') + name
+        else:
+            result = name if coeff > 0 else '-' + name
+    return result
+
+
+def fmt(x):
+    s = '%.9g' % x
+    return s if s != '-0' else '0'
+
+
+class Layer:
+    def __init__(self, name, srcType, body):
+        self.name = name
+        self.srcType = srcType
+        self.inChannels = int(srcType[-1])
+        # 按源码顺序保存，用于模拟直接卷积的舍入
+        self.taps = []
+        # 激活函数 -> [dx][dy] -> 权重矩阵（行为输入通道）
+        self.kernels = {}
+        self.bias = None
+
+        for m in TAP_PATTERN.finditer(body):
+            act = (m.group(1) is not None, m.group(2) is not None)
+            dx = {None: 0, '+': 1, '-': -1}[m.group(3)]
+            dy = {None: 0, '+': 1, '-': -1}[m.group(4)]
+            rows = int(m.group(5))
+            values = [float(v) for v in m.group(6).split(',')]
+            if rows != self.inChannels or len(values) != rows * 4 or act not in ACTIVATIONS:
+                raise ValueError('不支持的卷积：' + m.group(0)[:60])
+
+            w = [values[r * 4:r * 4 + 4] for r in range(rows)]
+            self.taps.append((act, dx, dy, w))
+            kernel = self.kernels.setdefault(act, [[None] * 3 for _ in range(3)])
+            if kernel[dx + 1][dy + 1] is not None:
+                raise ValueError('重复的卷积核')
+            kernel[dx + 1][dy + 1] = w
+
+        m = BIAS_PATTERN.search(body)
+        if not m:
+            raise ValueError('没有偏置')
+        self.bias = [float(v) for v in m.group(1).split(',')]
+
+        if not self.kernels:
+            raise ValueError('没有卷积')
+        for kernel in self.kernels.values():
+            if any(w is None for row in kernel for w in row):
+                raise ValueError('卷积核不完整')
+
+        # 统计源码中的 mul 以防遗漏不支持的写法
+        if body.count('mul(') != len(self.taps):
+            raise ValueError('存在无法解析的 mul')
+
+        # U = G * g * Gt，对每个输入和输出通道分别变换
+        self.transformed = {}
+        for act, kernel in self.kernels.items():
+            u = [[[[0.0] * 4 for _ in range(self.inChannels)] for _ in range(4)] for _ in range(4)]
+            for a in range(4):
+                for b in range(4):
+                    for r in range(self.inChannels):
+                        for c in range(4):
+                            u[a][b][r][c] = sum(
+                                G[a][x] * kernel[x][y][r][c] * G[b][y] for x in range(3) for y in range(3))
+            self.transformed[act] = u
+
+    # 生成的函数计算 src[1..2][1..2] 处的四个输出，result[x][y] 对应 src[x + 1][y + 1]
+    def Generate(self):
+        t = self.srcType
+        lines = [
+            '// Winograd F(2x2, 3x3)，result[x][y] 为 src[x + 1][y + 1] 处的输出',
+            'void %s(%s src[4][4], out float4 result[2][2]) {' % (self.name, t),
+            '\tuint x, y;',
+            '\tfloat4 m[4][4];',
+        ]
+
+        for k, act in enumerate(self.kernels):
+            expr = ACTIVATIONS[act]
+            d = 't%d' % k
+            v = 'v%d' % k
+            lines.append('')
+            lines.append('\t// V = Bt * d * B，d 为 ' + expr.format('src'))
+            lines.append('\t%s %s[4][4];' % (t, d))
+            lines.append('\t[unroll]')
+            lines.append('\tfor (y = 0; y < 4; ++y) {')
+            for x in range(4):
+                lines.append('\t\t%s[%d][y] = %s;' % (d, x, Combine(BT[x], [expr.format('src[%d][y]' % i) for i in range(4)])))
+            lines.append('\t}')
+            lines.append('\t%s %s[4][4];' % (t, v))
+            lines.append('\t[unroll]')
+            lines.append('\tfor (x = 0; x < 4; ++x) {')
+            for y in range(4):
+                lines.append('\t\t%s[x][%d] = %s;' % (v, y, Combine(BT[y], ['%s[x][%d]' % (d, i) for i in range(4)])))
+            lines.append('\t}')
+
+        lines.append('')
+        lines.append('\t// M = U .* V，U = G * g * Gt 已预先计算')
+        for a in range(4):
+            for b in range(4):
+                terms = []
+                for k, act in enumerate(self.kernels):
+                    u = self.transformed[act][a][b]
+                    terms.append('mul(v%d[%d][%d], float%dx4(%s))' % (
+                        k, a, b, self.inChannels, ', '.join(fmt(x) for row in u for x in row)))
+                lines.append('\tm[%d][%d] = %s;' % (a, b, ' + '.join(terms)))
+
+        lines.append('')
+        lines.append('\t// Y = At * M * A')
+        lines.append('\tfloat4 s[2][4];')
+        lines.append('\t[unroll]')
+        lines.append('\tfor (y = 0; y < 4; ++y) {')
+        lines.append('\t\ts[0][y] = m[0][y] + m[1][y] + m[2][y];')
+        lines.append('\t\ts[1][y] = m[1][y] - m[2][y] - m[3][y];')
+        lines.append('\t}')
+        lines.append('\tconst float4 bias = float4(%s);' % ', '.join(fmt(x) for x in self.bias))
+        lines.append('\t[unroll]')
+        lines.append('\tfor (x = 0; x < 2; ++x) {')
+        lines.append('\t\tresult[x][0] = s[x][0] + s[x][1] + s[x][2] + bias;')
+        lines.append('\t\tresult[x][1] = s[x][1] - s[x][2] - s[x][3] + bias;')
+        lines.append('\t}')
+        lines.append('}')
+        return '\n'.join(lines) + '\n'
+
+    # 以下用于误差报告，round 为每次运算后的舍入函数
+
+    def Activate(self, act, x):
+        if act == (False, False):
+            return x
+        return max(-x if act[1] else x, 0.0)
+
+    def Direct(self, src, i, j, round):
+        result = [0.0] * 4
+        for act, dx, dy, w in self.taps:
+            v = [self.Activate(act, x) for x in src[i + dx][j + dy]]
+            for c in range(4):
+                # mul 按输入通道依次累加
+                acc = 0.0
+                for r in range(self.inChannels):
+                    acc = round(acc + round(v[r] * w[r][c]))
+                result[c] = round(result[c] + acc)
+        return [round(result[c] + self.bias[c]) for c in range(4)]
+
+    def Winograd(self, src, round):
+        m = [[[0.0] * 4 for _ in range(4)] for _ in range(4)]
+        for act, u in self.transformed.items():
+            d = [[[self.Activate(act, x) for x in src[i][j]] for j in range(4)] for i in range(4)]
+            # 变换只包含加减法
+            t = [[[round(sum(BT[x][i] * d[i][y][ch] for i in range(4) if BT[x][i])) for ch in range(self.inChannels)]
+                  for y in range(4)] for x in range(4)]
+            v = [[[round(sum(BT[y][i] * t[x][i][ch] for i in range(4) if BT[y][i])) for ch in range(self.inChannels)]
+                  for y in range(4)] for x in range(4)]
+            for a in range(4):
+                for b in range(4):
+                    for c in range(4):
+                        acc = 0.0
+                        for r in range(self.inChannels):
+                            acc = round(acc + round(v[a][b][r] * round(u[a][b][r][c])))
+                        m[a][b][c] = round(m[a][b][c] + acc)
+
+        result = [[None] * 2 for _ in range(2)]
+        for x in range(2):
+            s = [[round(sum(AT[x][i] * m[i][y][c] for i in range(4) if AT[x][i])) for c in range(4)] for y in range(4)]
+            for y in range(2):
+                result[x][y] = [round(round(sum(AT[y][i] * s[i][c] for i in range(4) if AT[y][i])) + self.bias[c])
+                                for c in range(4)]
+        return result
+
+
+def Report(layer, isFirstLayer, samples=200):
+    random.seed(0)
+    # 第一层的输入为图像，其他层为特征
+    lo, hi = (0.0, 1.0) if isFirstLayer else (-1.0, 1.0)
+    exact = lambda x: x
+
+    maxDirect = maxWinograd = maxDiff = maxMagnitude = 0.0
+    for _ in range(samples):
+        src = [[[f32(random.uniform(lo, hi)) for _ in range(layer.inChannels)] for _ in range(4)] for _ in range(4)]
+        winograd = layer.Winograd(src, f32)
+        for x in range(2):
+            for y in range(2):
+                ref = layer.Direct(src, x + 1, y + 1, exact)
+                direct = layer.Direct(src, x + 1, y + 1, f32)
+                for c in range(4):
+                    maxDirect = max(maxDirect, abs(direct[c] - ref[c]))
+                    maxWinograd = max(maxWinograd, abs(winograd[x][y][c] - ref[c]))
+                    maxDiff = max(maxDiff, abs(winograd[x][y][c] - direct[c]))
+                    maxMagnitude = max(maxMagnitude, abs(ref[c]))
+
+    print('  %s: %d 次 -> %d 次矩阵乘法（每 2x2 个输出）' % (layer.name, 4 * len(layer.taps), 16 * len(layer.kernels)))
+    print('    最大绝对误差（相对 FP64）：直接 %.3g，Winograd %.3g' % (maxDirect, maxWinograd))
+    print('    Winograd 和直接卷积的最大差异：%.3g（输出的最大幅度 %.3g）' % (maxDiff, maxMagnitude))
+
+
+def Convert(src):
+    layers = []
+    skipped = []
+
+    def ReplaceFunc(m):
+        try:
+            layer = Layer(m.group(1), m.group(2), m.group(3))
+        except ValueError as e:
+            skipped.append('%s（%s）' % (m.group(1), e))
+            return m.group(0)
+        layers.append(layer)
+        return layer.Generate()
+
+    src = FUNC_PATTERN.sub(ReplaceFunc, src)
+
+    # 调用处改为先计算四个输出
+    for layer in layers:
+        calls = list(re.finditer(r'\n(\t+)(.+) = %s\(src, ([12]), ([12])\);' % layer.name, src))
+        if len(calls) != 4:
+            raise ValueError('%s 的调用不是 2x2 的形式' % layer.name)
+
+        for m in reversed(calls):
+            src = src[:m.start()] + '\n%s%s = result[%d][%d];' % (
+                m.group(1), m.group(2), int(m.group(3)) - 1, int(m.group(4)) - 1) + src[m.end():]
+        first = calls[0]
+        src = src[:first.start()] + '\n%sfloat4 result[2][2];\n%s%s(src, result);\n' % (
+            first.group(1), first.group(1), layer.name) + src[first.start():]
+
+    return src, layers, skipped
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        print('用法：python main.py <效果文件> [输出文件]')
+        return 1
+
+    with open(sys.argv[1], mode='r', encoding='utf8') as f:
+        src = f.read()
+
+    try:
+        result, layers, skipped = Convert(src)
+    except ValueError as e:
+        print('转换失败：' + str(e))
+        return 1
+
+    for name in skipped:
+        print('跳过 ' + name)
+
+    if not layers:
+        print('没有可以转换的卷积层')
+        return 1
+
+    print('误差报告：')
+    for layer in layers:
+        Report(layer, layer.inChannels == 3)
+
+    if len(sys.argv) == 3:
+        # 在文件开头的注释后注明来源
+        header = '// Winograd F(2x2, 3x3) 变体，由 tools/WinogradGenerator 生成，请勿手动修改\n'
+        pos = result.find('//!MAGPIE EFFECT')
+        result = result[:pos] + header + '\n' + result[pos:]
+
+        with open(sys.argv[2], mode='w', encoding='utf8', newline='') as f:
+            f.write(result)
+        print('已写入 ' + sys.argv[2])
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())